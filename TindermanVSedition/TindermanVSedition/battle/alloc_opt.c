@@ -0,0 +1,541 @@
+// battle/alloc_opt.c
+#include "alloc_opt.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "battle_core.h"
+#include "battle_ai.h"
+#include "battle_replay.h"   // battle_replay_setup_core()
+#include "battle_stage.h"    // battle_stage_rotation()
+#include "alloc_rules.h"
+#include "girl_base.h"
+#include "battle_rng.h"
+
+// ---------------------------------
+// 調整用
+// ---------------------------------
+#define OPT_DEFAULT_POPULATION  16
+#define OPT_DEFAULT_GAMES       2
+#define OPT_ELITES              4
+#define OPT_TOURNAMENT          3
+#define OPT_CROSSOVER_PCT       70
+#define OPT_EPS_PCT             10      // 評価対戦でランダム手を選ぶ確率
+#define OPT_MAX_TURNS           200
+#define OPT_ARCHIVE_CAP         4096    // 評価済み配分の記録（2の冪）
+
+enum { OPT_HP = 0, OPT_ATK, OPT_SPD, OPT_ST, OPT_STATS };
+
+static const int k_cost[OPT_STATS]  = { ALLOC_COST_HP, ALLOC_COST_ATK, ALLOC_COST_SPD, ALLOC_COST_ST };
+static const int k_block[OPT_STATS] = { ALLOC_BLOCK_UNIT_HP, ALLOC_BLOCK_UNIT_ATK,
+                                        ALLOC_BLOCK_UNIT_SPD, ALLOC_BLOCK_UNIT_ST };
+
+typedef struct {
+    int  add[OPT_STATS];
+    bool tag;
+} Genome;
+
+typedef struct {
+    uint64_t key;       // 0=空き
+    double   score;     // 勝ち=1 引き分け=0.5 の合計
+    int      games;
+} ArchiveSlot;
+
+struct AllocOpt {
+    AllocOptConfig cfg;
+    pthread_t thread;
+    bool thread_started;
+    atomic_int stop;
+
+    // --- 共有（mu で保護） ---
+    pthread_mutex_t mu;
+    AllocOptEntry top[ALLOC_OPT_TOP_MAX];
+    int top_n;
+    uint32_t version;
+    int generation;
+    uint64_t games;
+
+    // --- 探索スレッド専用 ---
+    ArchiveSlot *archive;
+};
+
+// ---------------------------------
+// rng
+// ---------------------------------
+static uint64_t splitmix64(uint64_t *s)
+{
+    uint64_t z = (*s += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+static int rand_below(uint64_t *rng, int n)
+{
+    return (n <= 1) ? 0 : (int)(splitmix64(rng) % (uint64_t)n);
+}
+
+// ---------------------------------
+// genome
+// ---------------------------------
+static int genome_cost(const Genome *g)
+{
+    int c = g->tag ? ALLOC_TAG_COST : 0;
+    for (int s = 0; s < OPT_STATS; s++) c += g->add[s] * k_cost[s];
+    return c;
+}
+
+static uint64_t genome_key(const Genome *g)
+{
+    uint64_t k = g->tag ? 1u : 0u;
+    for (int s = 0; s < OPT_STATS; s++) k = (k << 12) | (uint64_t)(g->add[s] & 0xFFF);
+    return k + 1;   // 0 は空き
+}
+
+// 予算オーバーを削る（ランダムなステから1ずつ。最後はタッグを外す）
+static void genome_repair(const AllocOpt *o, Genome *g, uint64_t *rng)
+{
+    if (!o->cfg.tag_unlocked) g->tag = false;
+    for (int s = 0; s < OPT_STATS; s++) if (g->add[s] < 0) g->add[s] = 0;
+
+    while (genome_cost(g) > o->cfg.points) {
+        int have[OPT_STATS], n = 0;
+        for (int s = 0; s < OPT_STATS; s++) if (g->add[s] > 0) have[n++] = s;
+        if (n == 0) { g->tag = false; break; }
+        g->add[have[rand_below(rng, n)]]--;
+    }
+}
+
+// 余りをランダムなステに（1ブロックまでずつ）使い切る
+static void genome_fill(const AllocOpt *o, Genome *g, uint64_t *rng)
+{
+    for (;;) {
+        int left = o->cfg.points - genome_cost(g);
+        int can[OPT_STATS], n = 0;
+        for (int s = 0; s < OPT_STATS; s++) if (k_cost[s] <= left) can[n++] = s;
+        if (n == 0) break;
+
+        int s = can[rand_below(rng, n)];
+        int most = left / k_cost[s];
+        if (most > k_block[s]) most = k_block[s];
+        g->add[s] += 1 + rand_below(rng, most);
+    }
+}
+
+// 決まった配り方（初期集団と既定プール用）
+//   style 0=均等（ブロック単位で順番に）/ 1=HP寄り / 2=ATK寄り（余りはHP）
+static void genome_styled(int points, bool tag, int style, Genome *out)
+{
+    memset(out, 0, sizeof(*out));
+    out->tag = tag && points >= ALLOC_TAG_COST;
+    int left = points - (out->tag ? ALLOC_TAG_COST : 0);
+
+    if (style == 0) {
+        bool spent = true;
+        while (spent) {
+            spent = false;
+            for (int s = 0; s < OPT_STATS; s++) {
+                int c = k_block[s] * k_cost[s];
+                if (c <= left) { out->add[s] += k_block[s]; left -= c; spent = true; }
+            }
+        }
+    } else if (style == 2) {
+        int n = left / k_cost[OPT_ATK];
+        out->add[OPT_ATK] = n;
+        left -= n * k_cost[OPT_ATK];
+    }
+    out->add[OPT_HP] += left / k_cost[OPT_HP];
+}
+
+static void genome_to_info(const NetGameInfo *base, const Genome *g, NetGameInfo *out)
+{
+    *out = *base;
+    out->hp_add  = (int16_t)g->add[OPT_HP];
+    out->atk_add = (int16_t)g->add[OPT_ATK];
+    out->sp_add  = (int16_t)g->add[OPT_SPD];
+    out->st_add  = (int16_t)g->add[OPT_ST];
+    out->tag_learned = g->tag ? 1 : 0;
+}
+
+int alloc_opt_default_pool(int points, NetGameInfo *out, int cap)
+{
+    int n = 0;
+    bool tag = points >= ALLOC_TAG_UNLOCK_AFFECTION;
+    for (int i = 0; i < girl_base_count(); i++) {
+        const GirlBase *gb = girl_base_at(i);
+        NetGameInfo base;
+        memset(&base, 0, sizeof(base));
+        snprintf(base.girl_id, sizeof(base.girl_id), "%s", gb->girl_id);
+        base.hp_base  = (int16_t)gb->hp;
+        base.atk_base = (int16_t)gb->atk;
+        base.sp_base  = (int16_t)gb->sp;
+        base.st_base  = (int16_t)gb->st;
+        base.move_range = (uint8_t)gb->move_range;
+
+        for (int style = 0; style < 3 && n < cap; style++) {
+            Genome g;
+            genome_styled(points, tag, style, &g);
+            genome_to_info(&base, &g, &out[n++]);
+        }
+    }
+    return n;
+}
+
+// ---------------------------------
+// archive（配分ごとの通算成績）
+// ---------------------------------
+static ArchiveSlot* archive_find(AllocOpt *o, uint64_t key, bool insert)
+{
+    uint64_t h = key * 0x9E3779B97F4A7C15ull;
+    for (int i = 0; i < OPT_ARCHIVE_CAP; i++) {
+        ArchiveSlot *s = &o->archive[(h + (uint64_t)i) & (OPT_ARCHIVE_CAP - 1)];
+        if (s->key == key) return s;
+        if (s->key == 0) {
+            if (!insert) return NULL;
+            s->key = key;
+            return s;
+        }
+    }
+    return NULL;   // 満杯（記録せずに続ける）
+}
+
+static Genome key_to_genome(uint64_t key)
+{
+    Genome g;
+    key -= 1;
+    for (int s = OPT_STATS - 1; s >= 0; s--) { g.add[s] = (int)(key & 0xFFF); key >>= 12; }
+    g.tag = (key & 1) != 0;
+    return g;
+}
+
+static float wilson_lo(double score, int n)
+{
+    if (n <= 0) return 0.0f;
+    const double z = 1.96;
+    double p = score / n;
+    double d = 1.0 + z * z / n;
+    double c = (p + z * z / (2.0 * n)) / d;
+    double h = z * sqrt(p * (1.0 - p) / n + z * z / (4.0 * n * (double)n)) / d;
+    return (float)(c - h < 0.0 ? 0.0 : c - h);
+}
+
+// ---------------------------------
+// evaluate
+// ---------------------------------
+// 戻り値：P1 から見たスコア（勝ち=2 引き分け=1 負け=0）
+//   乱数キーは対戦と同じ決め方。ステージは game 番号でカタログを回す（先後の2戦は同じステージ）
+static int playout(const NetGameInfo *p1, const NetGameInfo *p2, int game, uint64_t seed, TurnCmd *cand)
+{
+    BattleCore b;
+    battle_replay_setup_core(&b, p1, p2);
+    b.rng_seed = battle_replay_match_seed(p1, p2);
+    b.stage = battle_stage_rotation(game);
+
+    // ランダム手は (seed, ターン, チーム) で引く
+    //   → 候補ごとに展開がずれても同じターンの抽選は同じ（共通乱数が崩れにくい）
+    for (int t = 0; t < OPT_MAX_TURNS && b.phase != BPHASE_END; t++) {
+        TurnCmd c[2];
+        for (int team = 0; team < 2; team++) {
+            if (battle_rng_chance(seed, b.turn, team, BRNG_AI, 0, OPT_EPS_PCT)) {
+                int n = battle_ai_gen_candidates(&b, (Team)team, cand, BATTLE_AI_CAND_MAX);
+                if (n > 0) { c[team] = cand[battle_rng_below(seed, b.turn, team, BRNG_AI, 1, (uint32_t)n)]; continue; }
+            }
+            battle_ai_greedy_cmd(&b, (Team)team, &c[team]);
+        }
+        if (!battle_core_run_turn(&b, &c[TEAM_P1], &c[TEAM_P2])) break;
+    }
+
+    bool d1 = !b.units[0].alive && !b.units[1].alive;
+    bool d2 = !b.units[2].alive && !b.units[3].alive;
+    battle_core_free(&b);
+    if (d2 && !d1) return 2;
+    if (d1 && !d2) return 0;
+    return 1;
+}
+
+typedef struct {
+    AllocOpt *o;
+    const Genome *pop;
+    int n;
+    uint64_t gen_seed;
+    atomic_int next;
+    int *half_points;    // [n] 勝ち=2 引き分け=1 の合計
+    int *games;          // [n]
+} EvalJob;
+
+static void* eval_worker(void *arg)
+{
+    EvalJob *job = (EvalJob*)arg;
+    AllocOpt *o = job->o;
+    const AllocOptConfig *cfg = &o->cfg;
+
+    TurnCmd *cand = (TurnCmd*)malloc(sizeof(TurnCmd) * BATTLE_AI_CAND_MAX);
+    if (!cand) return NULL;
+
+    for (;;) {
+        int i = atomic_fetch_add(&job->next, 1);
+        if (i >= job->n) break;
+
+        NetGameInfo me;
+        genome_to_info(&cfg->self, &job->pop[i], &me);
+
+        int pts = 0, games = 0;
+        for (int k = 0; k < cfg->pool_count && !atomic_load(&o->stop); k++) {
+            for (int g = 0; g < cfg->games_per_opponent && !atomic_load(&o->stop); g++) {
+                // 共通乱数：同じ世代の候補は相手・対戦番号が同じなら同じ乱数列
+                uint64_t seed = job->gen_seed ^ ((uint64_t)k << 32) ^ (uint64_t)g;
+                if (g % 2 == 0) pts += playout(&me, &cfg->pool[k], g, seed, cand);
+                else            pts += 2 - playout(&cfg->pool[k], &me, g, seed, cand);
+                games++;
+            }
+        }
+        job->half_points[i] = pts;
+        job->games[i] = games;
+    }
+
+    free(cand);
+    return NULL;
+}
+
+// pop を評価して archive に加算する
+static void evaluate(AllocOpt *o, const Genome *pop, int n, uint64_t gen_seed)
+{
+    int *pts = (int*)calloc((size_t)n * 2, sizeof(int));
+    pthread_t *th = (pthread_t*)calloc((size_t)o->cfg.threads, sizeof(pthread_t));
+    if (!pts || !th) { free(pts); free(th); return; }
+
+    EvalJob job = { .o = o, .pop = pop, .n = n, .gen_seed = gen_seed,
+                    .half_points = pts, .games = pts + n };
+    atomic_init(&job.next, 0);
+
+    int started = 0;
+    for (int t = 1; t < o->cfg.threads; t++) {
+        if (pthread_create(&th[started], NULL, eval_worker, &job) == 0) started++;
+    }
+    eval_worker(&job);   // 呼び出し側スレッドも評価に回る
+    for (int t = 0; t < started; t++) pthread_join(th[t], NULL);
+
+    uint64_t total = 0;
+    for (int i = 0; i < n; i++) {
+        ArchiveSlot *s = archive_find(o, genome_key(&pop[i]), true);
+        if (s) {
+            s->score += job.half_points[i] * 0.5;
+            s->games += job.games[i];
+        }
+        total += (uint64_t)job.games[i];
+    }
+
+    pthread_mutex_lock(&o->mu);
+    o->games += total;
+    pthread_mutex_unlock(&o->mu);
+
+    free(pts);
+    free(th);
+}
+
+static double fitness(AllocOpt *o, const Genome *g)
+{
+    const ArchiveSlot *s = archive_find(o, genome_key(g), false);
+    return (s && s->games > 0) ? s->score / s->games : 0.0;
+}
+
+// archive から上位を作って公開する
+static void publish_top(AllocOpt *o, int generation)
+{
+    AllocOptEntry top[ALLOC_OPT_TOP_MAX];
+    int n = 0;
+
+    for (int i = 0; i < OPT_ARCHIVE_CAP; i++) {
+        const ArchiveSlot *s = &o->archive[i];
+        if (s->key == 0 || s->games <= 0) continue;
+
+        AllocOptEntry e;
+        Genome g = key_to_genome(s->key);
+        memcpy(e.add, g.add, sizeof(e.add));
+        e.tag = g.tag;
+        e.games = s->games;
+        e.score = (float)(s->score / s->games);
+        e.score_lo = wilson_lo(s->score, s->games);
+
+        // 挿入ソート（下限の降順）
+        int at = n;
+        while (at > 0 && top[at - 1].score_lo < e.score_lo) at--;
+        if (at >= ALLOC_OPT_TOP_MAX) continue;
+        int last = (n < ALLOC_OPT_TOP_MAX) ? n : ALLOC_OPT_TOP_MAX - 1;
+        memmove(&top[at + 1], &top[at], sizeof(top[0]) * (size_t)(last - at));
+        top[at] = e;
+        if (n < ALLOC_OPT_TOP_MAX) n++;
+    }
+
+    pthread_mutex_lock(&o->mu);
+    memcpy(o->top, top, sizeof(top[0]) * (size_t)n);
+    o->top_n = n;
+    o->generation = generation;
+    o->version++;
+    pthread_mutex_unlock(&o->mu);
+}
+
+// ---------------------------------
+// search（遺伝的探索）
+// ---------------------------------
+static const Genome* tournament(AllocOpt *o, const Genome *pop, int n, uint64_t *rng)
+{
+    const Genome *best = &pop[rand_below(rng, n)];
+    double bf = fitness(o, best);
+    for (int k = 1; k < OPT_TOURNAMENT; k++) {
+        const Genome *c = &pop[rand_below(rng, n)];
+        double cf = fitness(o, c);
+        if (cf > bf) { best = c; bf = cf; }
+    }
+    return best;
+}
+
+static void mutate(const AllocOpt *o, Genome *g, uint64_t *rng)
+{
+    int moves = 1 + rand_below(rng, 2);
+    for (int m = 0; m < moves; m++) {
+        int s = rand_below(rng, OPT_STATS);
+        int take = 1 + rand_below(rng, k_block[s] * 2);
+        g->add[s] -= (take < g->add[s]) ? take : g->add[s];
+    }
+    if (o->cfg.tag_unlocked && rand_below(rng, 8) == 0) g->tag = !g->tag;
+}
+
+static int cmp_fitness_desc(const void *a, const void *b)
+{
+    double fa = ((const double*)a)[0], fb = ((const double*)b)[0];
+    return (fa < fb) - (fa > fb);
+}
+
+static void* search_thread(void *arg)
+{
+    AllocOpt *o = (AllocOpt*)arg;
+    const int np = o->cfg.population;
+    uint64_t rng = (uint64_t)o->cfg.seed * 0x2545F4914F6CDD1Dull + 1;
+
+    Genome *pop  = (Genome*)calloc((size_t)np, sizeof(Genome));
+    Genome *next = (Genome*)calloc((size_t)np, sizeof(Genome));
+    double *rank = (double*)calloc((size_t)np * 2, sizeof(double));   // {fitness, index}
+    if (!pop || !next || !rank) goto done;
+
+    // 初期集団：決まった配り方 + ランダム
+    for (int i = 0; i < np; i++) {
+        Genome *g = &pop[i];
+        if (i < 6) {
+            genome_styled(o->cfg.points, o->cfg.tag_unlocked && (i >= 3), i % 3, g);
+        } else {
+            memset(g, 0, sizeof(*g));
+            g->tag = o->cfg.tag_unlocked && rand_below(&rng, 2);
+        }
+        genome_repair(o, g, &rng);
+        genome_fill(o, g, &rng);
+    }
+
+    for (int gen = 1; !atomic_load(&o->stop); gen++) {
+        uint64_t gs = splitmix64(&rng);
+        evaluate(o, pop, np, gs);
+        if (atomic_load(&o->stop)) break;
+        publish_top(o, gen);
+        if (o->cfg.max_generations > 0 && gen >= o->cfg.max_generations) break;
+
+        // 次世代：上位はそのまま（再評価で試合数が積み上がる）、残りは交叉＋突然変異
+        for (int i = 0; i < np; i++) { rank[i * 2] = fitness(o, &pop[i]); rank[i * 2 + 1] = i; }
+        qsort(rank, (size_t)np, sizeof(double) * 2, cmp_fitness_desc);
+
+        int elites = (OPT_ELITES < np) ? OPT_ELITES : np;
+        for (int i = 0; i < elites; i++) next[i] = pop[(int)rank[i * 2 + 1]];
+        for (int i = elites; i < np; i++) {
+            Genome c = *tournament(o, pop, np, &rng);
+            if (rand_below(&rng, 100) < OPT_CROSSOVER_PCT) {
+                const Genome *p2 = tournament(o, pop, np, &rng);
+                for (int s = 0; s < OPT_STATS; s++) if (rand_below(&rng, 2)) c.add[s] = p2->add[s];
+                if (rand_below(&rng, 2)) c.tag = p2->tag;
+            }
+            mutate(o, &c, &rng);
+            genome_repair(o, &c, &rng);
+            genome_fill(o, &c, &rng);
+            next[i] = c;
+        }
+        Genome *t = pop; pop = next; next = t;
+    }
+
+done:
+    free(pop);
+    free(next);
+    free(rank);
+    return NULL;
+}
+
+// ---------------------------------
+// public API
+// ---------------------------------
+AllocOpt* alloc_opt_start(const AllocOptConfig *cfg)
+{
+    if (!cfg) return NULL;
+
+    AllocOpt *o = (AllocOpt*)calloc(1, sizeof(AllocOpt));
+    if (!o) return NULL;
+    o->cfg = *cfg;
+    o->archive = (ArchiveSlot*)calloc(OPT_ARCHIVE_CAP, sizeof(ArchiveSlot));
+    if (!o->archive) { free(o); return NULL; }
+
+    AllocOptConfig *c = &o->cfg;
+    if (c->points < 0) c->points = 0;
+    if (c->points > 0xFFF) c->points = 0xFFF;   // genome_key は1ステ12bit
+    if (c->points < ALLOC_TAG_COST) c->tag_unlocked = false;
+    if (c->pool_count <= 0) c->pool_count = alloc_opt_default_pool(c->points, c->pool, ALLOC_OPT_POOL_MAX);
+    if (c->pool_count > ALLOC_OPT_POOL_MAX) c->pool_count = ALLOC_OPT_POOL_MAX;
+    if (c->games_per_opponent <= 0) c->games_per_opponent = OPT_DEFAULT_GAMES;
+    if (c->threads <= 0) c->threads = 1;
+    if (c->population <= 0) c->population = OPT_DEFAULT_POPULATION;
+    if (c->population < 2) c->population = 2;
+
+    atomic_init(&o->stop, 0);
+    pthread_mutex_init(&o->mu, NULL);
+
+    if (pthread_create(&o->thread, NULL, search_thread, o) != 0) {
+        pthread_mutex_destroy(&o->mu);
+        free(o->archive);
+        free(o);
+        return NULL;
+    }
+    o->thread_started = true;
+    return o;
+}
+
+int alloc_opt_poll(AllocOpt *o, uint32_t *seen_version, AllocOptEntry *out, int cap)
+{
+    if (!o || !seen_version) return -1;
+
+    int n = -1;
+    pthread_mutex_lock(&o->mu);
+    if (o->version != *seen_version) {
+        n = (o->top_n < cap) ? o->top_n : cap;
+        if (n > 0 && out) memcpy(out, o->top, sizeof(out[0]) * (size_t)n);
+        *seen_version = o->version;
+    }
+    pthread_mutex_unlock(&o->mu);
+    return n;
+}
+
+void alloc_opt_progress(AllocOpt *o, int *out_generation, uint64_t *out_games)
+{
+    if (!o) return;
+    pthread_mutex_lock(&o->mu);
+    if (out_generation) *out_generation = o->generation;
+    if (out_games) *out_games = o->games;
+    pthread_mutex_unlock(&o->mu);
+}
+
+void alloc_opt_stop(AllocOpt *o)
+{
+    if (!o) return;
+    atomic_store(&o->stop, 1);
+    if (o->thread_started) pthread_join(o->thread, NULL);
+    pthread_mutex_destroy(&o->mu);
+    free(o->archive);
+    free(o);
+}
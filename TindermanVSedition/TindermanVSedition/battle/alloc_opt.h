@@ -0,0 +1,67 @@
+// battle/alloc_opt.h
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "../net/net_protocol.h"   // NetGameInfo
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ===============================
+//  配分最適化（4_scene_allocate のおすすめ表示用）
+//   - 合法な配分（+1単位・コストは alloc_rules.h）を遺伝的探索で探す
+//   - 各候補は対戦相手プールとのヘッドレス対戦（greedy + ランダム手を少し）で評価
+//     同じ世代の候補は同じ乱数列で戦わせて比べる（共通乱数）
+//     乱数キーは本番の対戦と同じ決め方、ステージはカタログを順に回す（カタログは start の前に読んでおく）
+//   - バックグラウンドスレッドで回し続け、上位が入れ替わるたびに版を上げる
+//     scene は alloc_opt_poll で取り出す
+// ===============================
+#define ALLOC_OPT_TOP_MAX 8
+#define ALLOC_OPT_POOL_MAX 32
+
+typedef struct {
+    int  add[4];        // HP/ATK/SPD/ST の増分（scene の配分と同じ実数）
+    bool tag;
+    float score;        // 相手プール全体のスコア（勝ち=1 引き分け=0.5）
+    float score_lo;     // 95% Wilson 下限（並び順はこれ）
+    int  games;
+} AllocOptEntry;
+
+typedef struct {
+    NetGameInfo self;           // girl_id / *_base / move_range（*_add と tag_learned は無視）
+    int  points;                // 配分ポイント（好感度）
+    bool tag_unlocked;
+
+    NetGameInfo pool[ALLOC_OPT_POOL_MAX];   // 対戦相手（配分込み）。0人なら既定プール
+    int  pool_count;
+
+    int  games_per_opponent;    // 候補1つ×相手1人あたりの対戦数（先後交互。0で既定）
+    int  threads;               // 評価スレッド数（0で1）
+    int  population;            // 0で既定
+    int  max_generations;       // 0=止めるまで
+    uint32_t seed;
+} AllocOptConfig;
+
+typedef struct AllocOpt AllocOpt;
+
+// girl_base の各 girl に points を「均等/HP寄り/ATK寄り」で配った相手を out に書く
+int alloc_opt_default_pool(int points, NetGameInfo *out, int cap);
+
+// 開始（スレッドを立てて即戻る）。失敗時 NULL
+AllocOpt* alloc_opt_start(const AllocOptConfig *cfg);
+
+// *seen_version より新しい結果があれば上位を out に書いて件数を返す（*seen_version 更新）
+// 新しい結果がなければ -1
+int alloc_opt_poll(AllocOpt *o, uint32_t *seen_version, AllocOptEntry *out, int cap);
+
+// 進んだ世代数 / 評価した対戦数
+void alloc_opt_progress(AllocOpt *o, int *out_generation, uint64_t *out_games);
+
+// 止めて解放（評価中の対戦は1戦ぶんで切り上げる）
+void alloc_opt_stop(AllocOpt *o);
+
+#ifdef __cplusplus
+}
+#endif
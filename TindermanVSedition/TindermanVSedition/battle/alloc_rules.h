@@ -0,0 +1,26 @@
+// battle/alloc_rules.h
+#pragma once
+
+// ===============================
+//  ステータス配分ルール（4_scene_allocate / tools 共通）
+//   - 配分はステータス実数を +1 ずつ増やす。コストはステ別
+//   - ブロック単位は表示用（balance_sweep の配分グリッドの刻みにも使う）
+// ===============================
+// コスト（+1あたり）
+#define ALLOC_COST_HP   1
+#define ALLOC_COST_ATK  10
+#define ALLOC_COST_SPD  5
+#define ALLOC_COST_ST   3
+
+// ブロック単位
+#define ALLOC_BLOCK_UNIT_HP   10
+#define ALLOC_BLOCK_UNIT_ATK  2
+#define ALLOC_BLOCK_UNIT_SPD  2
+#define ALLOC_BLOCK_UNIT_ST   10
+
+// タッグ技
+#define ALLOC_TAG_UNLOCK_AFFECTION 50
+#define ALLOC_TAG_COST 20
+
+// build.json に好感度が無いときの配分ポイント
+#define ALLOC_DEFAULT_AFFECTION 30
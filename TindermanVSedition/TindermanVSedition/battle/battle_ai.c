@@ -0,0 +1,468 @@
+// battle/battle_ai.c
+#include "battle_ai.h"
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include "battle_skills.h"
+#include "char_defs.h"
+#include "battle_hash.h"
+
+#define MAP_MIN 0
+#define MAP_MAX 20
+
+// 1ユニット分の候補上限（移動先 × 技 × 対象）
+#define UNIT_OPT_MAX 64
+
+#define EVAL_WIN 100000
+
+// 置換表を引く最小の先読み（2ターン以下では同一局面に戻る手順がなく、引いても当たらない）
+#define TT_MIN_DEPTH 3
+
+// ---------------------------------
+// util
+// ---------------------------------
+static int clampi(int v, int lo, int hi) {
+    if (v < lo) return lo;
+    if (v > hi) return hi;
+    return v;
+}
+
+static Team enemy_of(Team t) {
+    return (t == TEAM_P1) ? TEAM_P2 : TEAM_P1;
+}
+
+static const SkillDef* skill_at(const BattleCore *b, const Unit *u, int index) {
+    const CharDef *cd = char_def_get_or_fallback(u->char_id);
+    if (!cd) return NULL;
+    bool tag = (u->team == TEAM_P1) ? b->p1_tag : b->p2_tag;
+    return battle_skill_get(char_def_get_skill_id_at(cd, tag, index));
+}
+
+static int skill_count(const BattleCore *b, const Unit *u) {
+    const CharDef *cd = char_def_get_or_fallback(u->char_id);
+    if (!cd) return 0;
+    bool tag = (u->team == TEAM_P1) ? b->p1_tag : b->p2_tag;
+    return char_def_get_available_skill_count(cd, tag);
+}
+
+static int attack_damage(const Unit *u, const SkillDef *sk) {
+    int v = u->stats.atk + sk->power;   // battle_core.c の calc_atk_plus_power と同じ
+    if (v < 1) v = 1;
+    return v;
+}
+
+// from から to へ最大 steps マス寄る（差の大きい軸から詰める）
+static Pos move_toward(Pos from, Pos to, int steps) {
+    Pos p = from;
+    while (steps-- > 0) {
+        int dx = (int)to.x - (int)p.x;
+        int dy = (int)to.y - (int)p.y;
+        if (dx == 0 && dy == 0) break;
+        if ((dx < 0 ? -dx : dx) >= (dy < 0 ? -dy : dy)) p.x = (int8_t)(p.x + (dx > 0 ? 1 : -1));
+        else                                          p.y = (int8_t)(p.y + (dy > 0 ? 1 : -1));
+    }
+    return p;
+}
+
+// from から away と反対側へ最大 steps マス離れる（盤端で止まる）
+static Pos move_away(Pos from, Pos away, int steps) {
+    Pos p = from;
+    while (steps-- > 0) {
+        int dx = (int)p.x - (int)away.x;
+        int dy = (int)p.y - (int)away.y;
+        int sx = (dx >= 0) ? 1 : -1;
+        int sy = (dy >= 0) ? 1 : -1;
+        Pos nx = p, ny = p;
+        nx.x = (int8_t)clampi(p.x + sx, MAP_MIN, MAP_MAX);
+        ny.y = (int8_t)clampi(p.y + sy, MAP_MIN, MAP_MAX);
+        if (manhattan(nx, away) > manhattan(p, away) && (dx < 0 ? -dx : dx) >= (dy < 0 ? -dy : dy)) p = nx;
+        else if (manhattan(ny, away) > manhattan(p, away)) p = ny;
+        else if (manhattan(nx, away) > manhattan(p, away)) p = nx;
+        else break;
+    }
+    return p;
+}
+
+// ステージありなら距離表で選ぶ（壁を回り込む。なしなら上の直進版）
+static Pos ai_toward(const BattleCore *b, Pos from, Pos to, int steps) {
+    if (!b->stage) return move_toward(from, to, steps);
+    return battle_stage_approach(b->stage, from, steps, to);
+}
+
+static Pos ai_away(const BattleCore *b, Pos from, Pos away, int steps) {
+    if (!b->stage) return move_away(from, away, steps);
+    return battle_stage_retreat(b->stage, from, steps, away);
+}
+
+// from から単体技が届くか（射程 + 見通し）
+static bool ai_can_hit(const BattleCore *b, Pos from, Pos to, int range) {
+    if (range >= 0 && manhattan(from, to) > range) return false;
+    return battle_stage_los(b->stage, from, to);
+}
+
+// 命令（TurnCmd）が2人分なので AI は 2v2 の core だけ扱う（N人の core は全員待機）
+static bool ai_supported(const BattleCore *b) {
+    return b->team_size == 2;
+}
+
+static UnitCmd idle_cmd(const Unit *u) {
+    return (UnitCmd){ .has_move=false, .move_to=u->pos, .skill_index=-1, .target=-1, .center=u->pos };
+}
+
+static int nearest_enemy(const BattleCore *b, const Unit *u) {
+    Team et = enemy_of(u->team);
+    int best = -1, bd = INT_MAX;
+    for (int s = 0; s < 2; s++) {
+        int ei = unit_index(et, (Slot)s);
+        const Unit *e = &b->units[ei];
+        if (!e->alive) continue;
+        int d = manhattan(u->pos, e->pos);
+        if (d < bd) { bd = d; best = ei; }
+    }
+    return best;
+}
+
+// AOE の見込み（敵ダメージ - 味方巻き込み）
+static int aoe_gain(const BattleCore *b, Team team, Pos c, int radius, int dmg) {
+    int r = (radius <= 0) ? 1 : radius;
+    int g = 0;
+    for (int i = 0; i < b->unit_count; i++) {
+        const Unit *t = &b->units[i];
+        if (!t->alive) continue;
+        if (manhattan(t->pos, c) > r) continue;
+        g += (t->team == team) ? -(dmg / 2 < 1 ? 1 : dmg / 2) : dmg;
+    }
+    return g;
+}
+
+// ---------------------------------
+// evaluate
+// ---------------------------------
+int battle_ai_evaluate(const BattleCore *b, Team team) {
+    if (!b) return 0;
+
+    bool mine_dead = true, theirs_dead = true;
+    int score = 0;
+    for (int i = 0; i < b->unit_count; i++) {
+        const Unit *u = &b->units[i];
+        int hpmax = (b->hp_max[i] < 1) ? 1 : b->hp_max[i];
+
+        // HP割合（0..1000）を主に、STは少しだけ
+        int v = u->alive ? (u->stats.hp * 1000 / hpmax + u->stats.st * 2 + 300) : 0;
+        if (u->team == team) { score += v; if (u->alive) mine_dead = false; }
+        else                 { score -= v; if (u->alive) theirs_dead = false; }
+    }
+
+    if (theirs_dead && !mine_dead) return EVAL_WIN;
+    if (mine_dead && !theirs_dead) return -EVAL_WIN;
+    return score;
+}
+
+int battle_ai_evaluate_threat(const BattleCore *b, Team team, BattleThreatMap *m) {
+    int score = battle_ai_evaluate(b, team);
+    if (!b || !m || score == EVAL_WIN || score == -EVAL_WIN) return score;
+
+    battle_threat_sync(m, b);
+    for (int i = 0; i < b->unit_count; i++) {
+        const Unit *u = &b->units[i];
+        if (!u->alive) continue;
+        int hpmax = (b->hp_max[i] < 1) ? 1 : b->hp_max[i];
+
+        int inc = battle_threat_point(m, u->team, u->pos);
+        if (inc > u->stats.hp) inc = u->stats.hp;
+        int pen = inc * 1000 / hpmax / 4;
+        score += (u->team == team) ? -pen : pen;
+    }
+    return score;
+}
+
+// ---------------------------------
+// greedy
+// ---------------------------------
+static void greedy_unit(const BattleCore *b, int ui, UnitCmd *out) {
+    const Unit *u = &b->units[ui];
+    *out = idle_cmd(u);
+    if (!u->alive) return;
+
+    int ei = nearest_enemy(b, u);
+    if (ei < 0) return;
+    const Unit *e = &b->units[ei];
+    int dist = manhattan(u->pos, e->pos);
+    int mv = (u->move < 0) ? 0 : u->move;
+
+    int best_idx = -1, best_gain = 0;
+    Pos best_dest = u->pos;
+    Pos best_center = e->pos;
+
+    int n = skill_count(b, u);
+    for (int k = 0; k < n; k++) {
+        const SkillDef *sk = skill_at(b, u, k);
+        if (!sk || u->stats.st < sk->st_cost) continue;
+
+        if (sk->type == SKTYPE_HEAL) {
+            // 味方が半分を切っていたら回復を優先
+            int ai = unit_index(u->team, SLOT_HERO), gi = unit_index(u->team, SLOT_GIRL);
+            int lack = 0;
+            for (int j = 0; j < 2; j++) {
+                int t = j ? gi : ai;
+                const Unit *a = &b->units[t];
+                if (a->alive && a->stats.hp * 2 < b->hp_max[t]) lack += b->hp_max[t] - a->stats.hp;
+            }
+            int gain = (lack < sk->power) ? lack : sk->power;
+            if (gain > best_gain) { best_gain = gain; best_idx = k; best_dest = u->pos; }
+            continue;
+        }
+        if (sk->type != SKTYPE_ATTACK) continue;
+
+        int dmg = attack_damage(u, sk);
+        if (sk->target == SKT_AOE) {
+            int gain = aoe_gain(b, u->team, e->pos, sk->aoe_radius, dmg);
+            if (gain > best_gain) { best_gain = gain; best_idx = k; best_dest = u->pos; best_center = e->pos; }
+            continue;
+        }
+
+        if (dmg <= best_gain) continue;
+        Pos at;
+        if (b->stage) {
+            // 射程内かつ見通せるマスのうち移動が一番少ないところ
+            if (!battle_stage_attack_cell(b->stage, u->pos, mv, e->pos, sk->range, &at)) continue;
+        } else {
+            int need = (sk->range < 0) ? 0 : dist - sk->range;
+            if (need < 0) need = 0;
+            if (need > mv) continue;
+            at = move_toward(u->pos, e->pos, need);
+        }
+        best_gain = dmg; best_idx = k; best_dest = at;
+    }
+
+    Pos dest;
+    if (best_idx >= 0) dest = best_dest;
+    else               dest = ai_toward(b, u->pos, e->pos, (dist - 1 < mv) ? dist - 1 : mv);
+
+    out->has_move = (dest.x != u->pos.x || dest.y != u->pos.y);
+    out->move_to = dest;
+    out->center = dest;   // 非AOEでも in-bounds にしておく（scene と同じ）
+    if (best_idx < 0) return;
+
+    const SkillDef *sk = skill_at(b, u, best_idx);
+    out->skill_index = (int8_t)best_idx;
+    if (sk->type == SKTYPE_HEAL) {
+        out->target = (int8_t)u->slot;
+    } else if (sk->target == SKT_AOE) {
+        out->center = best_center;
+    } else {
+        out->target = (int8_t)e->slot;
+    }
+}
+
+void battle_ai_greedy_cmd(const BattleCore *b, Team team, TurnCmd *out) {
+    if (!b || !out) return;
+    if (!ai_supported(b)) {
+        for (int s = 0; s < 2; s++) {
+            out->cmd[s] = (UnitCmd){ .has_move=false, .skill_index=-1, .target=-1 };
+            if (s < b->team_size) out->cmd[s] = idle_cmd(&b->units[unit_index(team, (Slot)s)]);
+        }
+        return;
+    }
+    greedy_unit(b, unit_index(team, SLOT_HERO), &out->cmd[SLOT_HERO]);
+    greedy_unit(b, unit_index(team, SLOT_GIRL), &out->cmd[SLOT_GIRL]);
+}
+
+// ---------------------------------
+// candidates
+// ---------------------------------
+static int unit_options(const BattleCore *b, int ui, UnitCmd *out, int cap) {
+    const Unit *u = &b->units[ui];
+    if (!u->alive) {
+        out[0] = idle_cmd(u);
+        return 1;
+    }
+
+    Team et = enemy_of(u->team);
+    int mv = (u->move < 0) ? 0 : u->move;
+
+    // 移動先：その場 / 各敵へ寄る / 最寄りの敵から離れる
+    Pos dests[4];
+    int nd = 0;
+    dests[nd++] = u->pos;
+    for (int s = 0; s < 2; s++) {
+        const Unit *e = &b->units[unit_index(et, (Slot)s)];
+        if (!e->alive) continue;
+        int d = manhattan(u->pos, e->pos);
+        dests[nd++] = ai_toward(b, u->pos, e->pos, (d - 1 < mv) ? d - 1 : mv);
+    }
+    int ne = nearest_enemy(b, u);
+    if (ne >= 0) dests[nd++] = ai_away(b, u->pos, b->units[ne].pos, mv);
+
+    int n = 0;
+    int sc = skill_count(b, u);
+    for (int di = 0; di < nd; di++) {
+        Pos dp = dests[di];
+        bool dup = false;
+        for (int dj = 0; dj < di; dj++) {
+            if (dests[dj].x == dp.x && dests[dj].y == dp.y) { dup = true; break; }
+        }
+        if (dup) continue;
+
+        UnitCmd base = idle_cmd(u);
+        base.has_move = (dp.x != u->pos.x || dp.y != u->pos.y);
+        base.move_to = dp;
+        base.center = dp;
+
+        if (n < cap) out[n++] = base;   // 待機
+
+        for (int k = 0; k < sc; k++) {
+            const SkillDef *sk = skill_at(b, u, k);
+            if (!sk || u->stats.st < sk->st_cost) continue;
+
+            UnitCmd c = base;
+            c.skill_index = (int8_t)k;
+
+            if (sk->type == SKTYPE_COUNTER) {
+                if (n < cap) out[n++] = c;
+            } else if (sk->type == SKTYPE_HEAL) {
+                c.target = (int8_t)u->slot;
+                if (n < cap) out[n++] = c;
+            } else if (sk->type == SKTYPE_ATTACK) {
+                for (int s = 0; s < 2; s++) {
+                    const Unit *e = &b->units[unit_index(et, (Slot)s)];
+                    if (!e->alive) continue;
+                    if (sk->target == SKT_AOE) {
+                        c.target = -1;
+                        c.center = e->pos;
+                    } else {
+                        if (!ai_can_hit(b, dp, e->pos, sk->range)) continue;
+                        c.target = (int8_t)s;
+                        c.center = dp;
+                    }
+                    if (n < cap) out[n++] = c;
+                }
+            }
+        }
+    }
+    return n;
+}
+
+int battle_ai_gen_candidates(const BattleCore *b, Team team, TurnCmd *out, int cap) {
+    if (!b || !out || cap <= 0 || !ai_supported(b)) return 0;
+
+    UnitCmd ho[UNIT_OPT_MAX], go[UNIT_OPT_MAX];
+    int nh = unit_options(b, unit_index(team, SLOT_HERO), ho, UNIT_OPT_MAX);
+    int ng = unit_options(b, unit_index(team, SLOT_GIRL), go, UNIT_OPT_MAX);
+
+    int n = 0;
+    for (int i = 0; i < nh; i++) {
+        for (int j = 0; j < ng; j++) {
+            if (n >= cap) return n;
+            out[n].cmd[SLOT_HERO] = ho[i];
+            out[n].cmd[SLOT_GIRL] = go[j];
+            n++;
+        }
+    }
+    return n;
+}
+
+// ---------------------------------
+// search
+// ---------------------------------
+typedef struct {
+    Team team;
+    BattleTT *tt;
+    uint64_t salt;      // 対戦設定（ハッシュに含まれない固定値）+ 視点
+    BattleThreatMap threat;   // 末端評価用（profile のみ。末端ごとに差分 sync）
+    TurnCmd *cands;     // 先読みの深さごとに BATTLE_AI_CAND_MAX 件（[depth-1] 段目を depth の局面が使う）
+    BattleAiStats st;
+} SearchCtx;
+
+// hash に入らない固定パラメータ（ATK/SPD/移動力/タッグ/キャラ/ステージ）を混ぜる
+static uint64_t config_salt(const BattleCore *b, Team team) {
+    uint64_t h = battle_hash_mix64(0x5441564Cu + (uint64_t)team);
+    for (int i = 0; i < b->unit_count; i++) {
+        const Unit *u = &b->units[i];
+        h = battle_hash_mix64(h ^ (uint64_t)(uint32_t)u->stats.atk);
+        h = battle_hash_mix64(h ^ ((uint64_t)(uint32_t)u->stats.spd << 20) ^ ((uint64_t)(uint32_t)u->move << 40));
+        h = battle_hash_mix64(h ^ (uint64_t)(uint32_t)b->hp_max[i]);
+        for (const char *p = u->char_id; p && *p; p++) h = battle_hash_mix64(h ^ (uint8_t)*p);
+    }
+    for (const char *p = b->stage ? b->stage->id : ""; *p; p++) h = battle_hash_mix64(h ^ (uint8_t)*p ^ 0x100u);
+    return battle_hash_mix64(h ^ ((uint64_t)b->p1_tag << 1) ^ (uint64_t)b->p2_tag);
+}
+
+static int search_rec(SearchCtx *ctx, const BattleCore *b, int depth, int *out_best_idx) {
+    if (depth <= 0 || b->phase == BPHASE_END) return battle_ai_evaluate_threat(b, ctx->team, &ctx->threat);
+
+    uint64_t key = b->hash ^ ctx->salt ^ battle_hash_mix64((uint64_t)depth);
+    if (ctx->tt && !out_best_idx) {
+        BattleTTData d;
+        ctx->st.tt_probes++;
+        if (battle_tt_probe(ctx->tt, key, &d) && d.depth == depth && d.bound == BTT_EXACT) {
+            ctx->st.tt_hits++;
+            return d.value;
+        }
+    }
+
+    TurnCmd *cands = ctx->cands + (size_t)(depth - 1) * BATTLE_AI_CAND_MAX;
+    int n = battle_ai_gen_candidates(b, ctx->team, cands, BATTLE_AI_CAND_MAX);
+
+    TurnCmd enemy_cmd;
+    battle_ai_greedy_cmd(b, enemy_of(ctx->team), &enemy_cmd);
+
+    int best = INT_MIN, best_idx = 0;
+    for (int i = 0; i < n; i++) {
+        BattleCore child;
+        battle_core_copy(&child, b);
+        if (ctx->team == TEAM_P1) battle_core_run_turn(&child, &cands[i], &enemy_cmd);
+        else                      battle_core_run_turn(&child, &enemy_cmd, &cands[i]);
+        ctx->st.nodes++;
+
+        int v = search_rec(ctx, &child, depth - 1, NULL);
+        battle_core_free(&child);
+        if (v > best) { best = v; best_idx = i; }
+    }
+    if (n == 0) best = battle_ai_evaluate_threat(b, ctx->team, &ctx->threat);
+
+    if (ctx->tt) {
+        BattleTTData d = { .value = best, .depth = (uint8_t)depth, .bound = BTT_EXACT,
+                           .best = (uint16_t)best_idx };
+        battle_tt_store(ctx->tt, key, &d);
+    }
+
+    if (out_best_idx) *out_best_idx = (n > 0) ? best_idx : -1;
+    return best;
+}
+
+int battle_ai_search(const BattleCore *b, Team team, const BattleAiParams *p,
+                     BattleAiStats *stats, TurnCmd *out_best) {
+    if (!b || !p) return 0;
+
+    int depth = (p->depth < 1) ? 1 : p->depth;
+    SearchCtx ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.cands = ai_supported(b) ? (TurnCmd*)malloc(sizeof(TurnCmd) * BATTLE_AI_CAND_MAX * (size_t)depth) : NULL;
+    if (!ctx.cands) {
+        if (out_best) battle_ai_greedy_cmd(b, team, out_best);
+        return battle_ai_evaluate(b, team);
+    }
+    ctx.team = team;
+    ctx.tt = (depth >= TT_MIN_DEPTH) ? p->tt : NULL;
+    ctx.salt = config_salt(b, team);
+    battle_threat_build(&ctx.threat, b, false);
+
+    int best_idx = -1;
+    int v = search_rec(&ctx, b, depth, &best_idx);
+
+    if (out_best) {
+        // 根の候補は [depth-1] 段目に残っている（子は浅い段しか使わない）
+        if (best_idx >= 0) *out_best = ctx.cands[(size_t)(depth - 1) * BATTLE_AI_CAND_MAX + (size_t)best_idx];
+        else battle_ai_greedy_cmd(b, team, out_best);
+    }
+    free(ctx.cands);
+
+    if (stats) {
+        stats->nodes     += ctx.st.nodes;
+        stats->tt_probes += ctx.st.tt_probes;
+        stats->tt_hits   += ctx.st.tt_hits;
+    }
+    return v;
+}
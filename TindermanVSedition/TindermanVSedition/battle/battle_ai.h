@@ -0,0 +1,57 @@
+// battle/battle_ai.h
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "battle_core.h"
+#include "battle_tt.h"
+#include "battle_threat.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ===============================
+//  AI（ヘッドレス）
+//   - greedy：近い敵に寄って、届く中で一番痛い技を撃つだけの即答方策
+//   - search：自チームの TurnCmd 候補を総当たりで d ターン先読み
+//             （相手は greedy で動くと仮定）。置換表で同一局面を1回だけ評価する
+//             末端は battle_ai_evaluate_threat（脅威マップを差分更新しながら評価）
+//   - 2v2 の対戦用（命令は TurnCmd＝2人分）。team_size != 2 の core では候補 0 件/全員待機
+// ===============================
+
+// 1チーム分の候補上限（hero候補 × girl候補）
+#define BATTLE_AI_CAND_MAX 1024
+
+typedef struct {
+    int depth;      // 先読みターン数（1以上）
+    BattleTT *tt;   // NULLなら置換表なし（スレッド間で共有してよい）。depth 3 未満では引かない
+} BattleAiParams;
+
+typedef struct {
+    uint64_t nodes;      // 展開した局面数（run_turn 回数）
+    uint64_t tt_probes;
+    uint64_t tt_hits;
+} BattleAiStats;
+
+// 局面評価（team 視点。大きいほど有利）
+int battle_ai_evaluate(const BattleCore *b, Team team);
+
+// 上に「次ターンの被弾見込み」を足した評価（m を b に sync してから使う。m は profile だけでよい）
+//   被弾見込み = 脅威マップの自位置の値（HP まで）を HP 割合に直して 1/4 の重み
+int battle_ai_evaluate_threat(const BattleCore *b, Team team, BattleThreatMap *m);
+
+// 即答方策
+void battle_ai_greedy_cmd(const BattleCore *b, Team team, TurnCmd *out);
+
+// 候補列挙（戻り値=件数。cap を超える分は捨てる）
+int battle_ai_gen_candidates(const BattleCore *b, Team team, TurnCmd *out, int cap);
+
+// 先読み探索。戻り値=最善手の評価値（out_best に手を書く）
+// stats は加算される（NULL可）
+int battle_ai_search(const BattleCore *b, Team team, const BattleAiParams *p,
+                     BattleAiStats *stats, TurnCmd *out_best);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,431 @@
+// battle/battle_analytics.c
+#include "battle_analytics.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "battle_skills.h"   // battle_skill_index_of(), battle_skill_at()
+#include "battle_defs.h"     // battle_defs_checksum()
+
+// ---------------------------------
+// .tvsa（リトルエンディアン。読む側は列を直接指すので LE のマシン専用）
+//   header 16 : magic[4] ver u16 skills u16 defs_checksum u32 pad u32
+//   skills    : id[BATTLE_SKILL_ID_MAX] × skills（8byte 境界まで 0 埋め）
+//   chunk     : rows u32 payload u32 battle_min u32 battle_max u32 pad u64
+//               続いて列（battle u32 / value i32 / turn u16 / type / actor / target / skill / flags の順。
+//               各列は 8byte 境界まで 0 埋め）
+//   チャンクは書き出しスレッドが届いた順に追記する（途中で落ちても、それまでのチャンクは読める）
+// ---------------------------------
+#define AN_HEADER_BYTES 16
+#define AN_CHUNK_HEADER_BYTES 24
+
+static size_t an_pad8(size_t n) { return (n + 7u) & ~(size_t)7u; }
+
+static size_t an_payload_bytes(uint32_t rows) {
+    return an_pad8((size_t)rows * 4) * 2 + an_pad8((size_t)rows * 2) + an_pad8((size_t)rows) * 5;
+}
+
+static void put_u16(uint8_t *p, uint16_t v) { p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); }
+static void put_u32(uint8_t *p, uint32_t v) { put_u16(p, (uint16_t)v); put_u16(p + 2, (uint16_t)(v >> 16)); }
+static uint16_t get_u16(const uint8_t *p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+static uint32_t get_u32(const uint8_t *p) { return (uint32_t)get_u16(p) | ((uint32_t)get_u16(p + 2) << 16); }
+
+static bool host_is_le(void) {
+    const uint16_t one = 1;
+    return *(const uint8_t*)&one == 1;
+}
+
+// ---------------------------------
+// 器（列ごとの配列）
+// ---------------------------------
+typedef struct {
+    uint32_t *battle;
+    int32_t  *value;
+    uint16_t *turn;
+    uint8_t  *type;
+    uint8_t  *actor;
+    int8_t   *target;
+    int8_t   *skill;
+    uint8_t  *flags;
+    uint32_t rows;
+    uint32_t battle_min, battle_max;
+} AnBuf;
+
+struct BattleAnalytics {
+    FILE *fp;
+    uint32_t chunk_rows;
+    AnBuf buf[2];
+    int fill;                   // 溜めている器
+
+    // --- 書き出しスレッドとの受け渡し（mu で保護） ---
+    pthread_t thread;
+    pthread_mutex_t mu;
+    pthread_cond_t cv;
+    int queued;                 // 書き出し待ちの器（-1=なし）
+    bool stop;
+    bool io_error;
+
+    // --- 読み出し位置（記録スレッド専用） ---
+    BattleEventCursor cur;
+    uint32_t battle_id;
+    int8_t  act_skill;          // 直近の演出の技（続く効果の行に付ける）
+    uint8_t act_flags;
+    const char *last_id;        // skill_id → 番号 の1件キャッシュ（表の要素は動かない）
+    int8_t last_idx;
+
+    BattleAnalyticsStats st;
+};
+
+static bool buf_alloc(AnBuf *b, uint32_t cap) {
+    memset(b, 0, sizeof(*b));
+    b->battle = (uint32_t*)malloc(sizeof(uint32_t) * cap);
+    b->value  = (int32_t*)malloc(sizeof(int32_t) * cap);
+    b->turn   = (uint16_t*)malloc(sizeof(uint16_t) * cap);
+    b->type   = (uint8_t*)malloc(cap);
+    b->actor  = (uint8_t*)malloc(cap);
+    b->target = (int8_t*)malloc(cap);
+    b->skill  = (int8_t*)malloc(cap);
+    b->flags  = (uint8_t*)malloc(cap);
+    return b->battle && b->value && b->turn && b->type && b->actor && b->target && b->skill && b->flags;
+}
+
+static void buf_free(AnBuf *b) {
+    free(b->battle); free(b->value); free(b->turn); free(b->type);
+    free(b->actor); free(b->target); free(b->skill); free(b->flags);
+    memset(b, 0, sizeof(*b));
+}
+
+static bool write_col(FILE *fp, const void *p, size_t n) {
+    static const uint8_t zero[8];
+    size_t pad = an_pad8(n) - n;
+    return fwrite(p, 1, n, fp) == n && (pad == 0 || fwrite(zero, 1, pad, fp) == pad);
+}
+
+static bool write_chunk(FILE *fp, const AnBuf *b) {
+    uint8_t h[AN_CHUNK_HEADER_BYTES];
+    memset(h, 0, sizeof(h));
+    put_u32(h, b->rows);
+    put_u32(h + 4, (uint32_t)an_payload_bytes(b->rows));
+    put_u32(h + 8, b->battle_min);
+    put_u32(h + 12, b->battle_max);
+
+    size_t n = b->rows;
+    return fwrite(h, 1, sizeof(h), fp) == sizeof(h)
+        && write_col(fp, b->battle, n * 4)
+        && write_col(fp, b->value, n * 4)
+        && write_col(fp, b->turn, n * 2)
+        && write_col(fp, b->type, n)
+        && write_col(fp, b->actor, n)
+        && write_col(fp, b->target, n)
+        && write_col(fp, b->skill, n)
+        && write_col(fp, b->flags, n);
+}
+
+static void* writer_main(void *arg) {
+    BattleAnalytics *a = (BattleAnalytics*)arg;
+    pthread_mutex_lock(&a->mu);
+    for (;;) {
+        while (a->queued < 0 && !a->stop) pthread_cond_wait(&a->cv, &a->mu);
+        if (a->queued < 0) break;
+        AnBuf *b = &a->buf[a->queued];
+        pthread_mutex_unlock(&a->mu);
+
+        // 書いている間も記録側はもう一方の器に溜め続ける
+        bool ok = write_chunk(a->fp, b);
+
+        pthread_mutex_lock(&a->mu);
+        if (ok) {
+            a->st.chunks++;
+            a->st.bytes += AN_CHUNK_HEADER_BYTES + an_payload_bytes(b->rows);
+        } else {
+            a->io_error = true;
+        }
+        a->queued = -1;
+        pthread_cond_broadcast(&a->cv);
+    }
+    pthread_mutex_unlock(&a->mu);
+    return NULL;
+}
+
+static double mono_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// 溜めた器を書き出しスレッドへ渡して、もう一方に切り替える
+static void hand_off(BattleAnalytics *a) {
+    pthread_mutex_lock(&a->mu);
+    if (a->queued >= 0) {
+        double t0 = mono_sec();
+        while (a->queued >= 0) pthread_cond_wait(&a->cv, &a->mu);
+        a->st.wait_sec += mono_sec() - t0;
+    }
+    a->queued = a->fill;
+    pthread_cond_broadcast(&a->cv);
+    pthread_mutex_unlock(&a->mu);
+
+    a->fill ^= 1;
+    a->buf[a->fill].rows = 0;
+}
+
+// ---------------------------------
+// 書き込み
+// ---------------------------------
+BattleAnalytics* battle_analytics_open(const char *path, int chunk_rows) {
+    if (!path || !host_is_le()) return NULL;
+
+    BattleAnalytics *a = (BattleAnalytics*)calloc(1, sizeof(*a));
+    if (!a) return NULL;
+    a->chunk_rows = (chunk_rows > 0) ? (uint32_t)chunk_rows : BATTLE_ANALYTICS_CHUNK_ROWS;
+    a->queued = -1;
+    a->last_idx = -1;
+    if (!buf_alloc(&a->buf[0], a->chunk_rows) || !buf_alloc(&a->buf[1], a->chunk_rows)) goto fail;
+
+    a->fp = fopen(path, "wb");
+    if (!a->fp) goto fail;
+
+    // 技id の表（今読み込まれている定義の並び = skill 列の番号）
+    int nsk = battle_skill_count();
+    uint8_t h[AN_HEADER_BYTES];
+    memset(h, 0, sizeof(h));
+    memcpy(h, BATTLE_ANALYTICS_MAGIC, 4);
+    put_u16(h + 4, BATTLE_ANALYTICS_VERSION);
+    put_u16(h + 6, (uint16_t)nsk);
+    put_u32(h + 8, battle_defs_checksum());
+    bool ok = fwrite(h, 1, sizeof(h), a->fp) == sizeof(h);
+
+    char ids[BATTLE_SKILL_MAX][BATTLE_SKILL_ID_MAX];
+    memset(ids, 0, sizeof(ids));
+    for (int i = 0; i < nsk; i++) {
+        const SkillDef *sk = battle_skill_at(i);
+        if (sk) memcpy(ids[i], sk->id, strnlen(sk->id, BATTLE_SKILL_ID_MAX - 1));
+    }
+    ok = ok && write_col(a->fp, ids, (size_t)nsk * BATTLE_SKILL_ID_MAX);
+    a->st.bytes = an_pad8(AN_HEADER_BYTES + (size_t)nsk * BATTLE_SKILL_ID_MAX);
+    if (!ok) goto fail;
+
+    pthread_mutex_init(&a->mu, NULL);
+    pthread_cond_init(&a->cv, NULL);
+    if (pthread_create(&a->thread, NULL, writer_main, a) != 0) {
+        pthread_cond_destroy(&a->cv);
+        pthread_mutex_destroy(&a->mu);
+        goto fail;
+    }
+    return a;
+
+fail:
+    if (a->fp) fclose(a->fp);
+    buf_free(&a->buf[0]);
+    buf_free(&a->buf[1]);
+    free(a);
+    return NULL;
+}
+
+void battle_analytics_begin_battle(BattleAnalytics *a, const BattleCore *b, uint32_t battle_id) {
+    if (!a || !b) return;
+    a->st.lost += a->cur.lost;
+    a->cur = battle_core_event_cursor_now(b);
+    a->battle_id = battle_id;
+    a->act_skill = -1;
+    a->act_flags = 0;
+}
+
+static int8_t skill_index_cached(BattleAnalytics *a, const char *skill_id) {
+    if (!skill_id) return -1;
+    if (skill_id != a->last_id) {
+        a->last_id = skill_id;
+        a->last_idx = (int8_t)battle_skill_index_of(skill_id);
+    }
+    return a->last_idx;
+}
+
+void battle_analytics_collect(BattleAnalytics *a, const BattleCore *b) {
+    if (!a || !b) return;
+
+    const BattleEvent *ev;
+    while ((ev = battle_core_next_event(b, &a->cur)) != NULL) {
+        if (ev->type == BEV_ANIM_SKILL) {
+            // 演出ごとに技を決め直す（効果は必ず自分の演出の後に並ぶ）
+            int8_t si = skill_index_cached(a, ev->skill_id);
+            const SkillDef *sk = (si >= 0) ? battle_skill_at(si) : NULL;
+            a->act_skill = si;
+            a->act_flags = 0;
+            if (!sk || sk->type == SKTYPE_COUNTER) a->act_flags |= BATTLE_AF_COUNTER;
+            else if (sk->target == SKT_AOE) a->act_flags |= BATTLE_AF_AOE;
+        } else if (ev->type != BEV_EFFECT_DAMAGE && ev->type != BEV_EFFECT_HEAL) {
+            continue;
+        }
+
+        AnBuf *buf = &a->buf[a->fill];
+        uint32_t r = buf->rows;
+        if (r == 0) {
+            buf->battle_min = buf->battle_max = a->battle_id;
+        } else {
+            if (a->battle_id < buf->battle_min) buf->battle_min = a->battle_id;
+            if (a->battle_id > buf->battle_max) buf->battle_max = a->battle_id;
+        }
+        buf->battle[r] = a->battle_id;
+        buf->value[r]  = ev->value;
+        buf->turn[r]   = (uint16_t)ev->turn;
+        buf->type[r]   = (uint8_t)ev->type;
+        buf->actor[r]  = (uint8_t)ev->actor_ui;
+        buf->target[r] = (int8_t)ev->target_ui;
+        buf->skill[r]  = a->act_skill;
+        buf->flags[r]  = a->act_flags;
+        buf->rows = r + 1;
+        a->st.rows++;
+
+        if (buf->rows == a->chunk_rows) hand_off(a);
+    }
+}
+
+bool battle_analytics_close(BattleAnalytics *a, BattleAnalyticsStats *out) {
+    if (!a) return false;
+
+    if (a->buf[a->fill].rows > 0) hand_off(a);
+
+    pthread_mutex_lock(&a->mu);
+    a->stop = true;
+    pthread_cond_broadcast(&a->cv);
+    pthread_mutex_unlock(&a->mu);
+    pthread_join(a->thread, NULL);
+    pthread_cond_destroy(&a->cv);
+    pthread_mutex_destroy(&a->mu);
+
+    bool ok = !a->io_error;
+    ok = (fclose(a->fp) == 0) && ok;
+
+    a->st.lost += a->cur.lost;
+    if (out) *out = a->st;
+
+    buf_free(&a->buf[0]);
+    buf_free(&a->buf[1]);
+    free(a);
+    return ok;
+}
+
+// ---------------------------------
+// 読み出し
+// ---------------------------------
+bool battle_analytics_map(BattleAnalyticsFile *f, const char *path) {
+    if (!f) return false;
+    memset(f, 0, sizeof(*f));
+    if (!path || !host_is_le()) return false;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat stt;
+    if (fstat(fd, &stt) != 0 || stt.st_size < AN_HEADER_BYTES) {
+        close(fd);
+        return false;
+    }
+    size_t size = (size_t)stt.st_size;
+    void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return false;
+    f->map = map;
+    f->map_size = size;
+
+    const uint8_t *p = (const uint8_t*)map;
+    int nsk = get_u16(p + 6);
+    size_t off = an_pad8(AN_HEADER_BYTES + (size_t)nsk * BATTLE_SKILL_ID_MAX);
+    bool ok = memcmp(p, BATTLE_ANALYTICS_MAGIC, 4) == 0
+           && get_u16(p + 4) == BATTLE_ANALYTICS_VERSION
+           && nsk <= BATTLE_SKILL_MAX
+           && off <= size;
+    for (int i = 0; ok && i < nsk; i++) {
+        ok = memchr(p + AN_HEADER_BYTES + (size_t)i * BATTLE_SKILL_ID_MAX, 0, BATTLE_SKILL_ID_MAX) != NULL;
+    }
+    if (!ok) {
+        battle_analytics_unmap(f);
+        return false;
+    }
+    f->defs_checksum = get_u32(p + 8);
+    f->skill_count = nsk;
+    f->skill_ids = (const char (*)[BATTLE_SKILL_ID_MAX])(p + AN_HEADER_BYTES);
+
+    int cap = 0;
+    while (off + AN_CHUNK_HEADER_BYTES <= size) {
+        const uint8_t *h = p + off;
+        uint32_t rows = get_u32(h);
+        size_t payload = get_u32(h + 4);
+        if (rows == 0 || payload != an_payload_bytes(rows)) break;
+        if (payload > size - off - AN_CHUNK_HEADER_BYTES) break;   // 書きかけ
+
+        if (f->chunk_count == cap) {
+            int ncap = cap ? cap * 2 : 16;
+            BattleAnalyticsChunk *nc = (BattleAnalyticsChunk*)realloc(f->chunks, sizeof(*nc) * (size_t)ncap);
+            if (!nc) break;
+            f->chunks = nc;
+            cap = ncap;
+        }
+        BattleAnalyticsChunk *c = &f->chunks[f->chunk_count++];
+        c->rows = rows;
+        c->battle_min = get_u32(h + 8);
+        c->battle_max = get_u32(h + 12);
+
+        const uint8_t *q = h + AN_CHUNK_HEADER_BYTES;
+        c->battle = (const uint32_t*)q; q += an_pad8((size_t)rows * 4);
+        c->value  = (const int32_t*)q;  q += an_pad8((size_t)rows * 4);
+        c->turn   = (const uint16_t*)q; q += an_pad8((size_t)rows * 2);
+        c->type   = q;                  q += an_pad8(rows);
+        c->actor  = q;                  q += an_pad8(rows);
+        c->target = (const int8_t*)q;   q += an_pad8(rows);
+        c->skill  = (const int8_t*)q;   q += an_pad8(rows);
+        c->flags  = q;
+        f->rows += rows;
+
+        off += AN_CHUNK_HEADER_BYTES + payload;
+    }
+    if (f->chunk_count == 0) {
+        battle_analytics_unmap(f);
+        return false;
+    }
+    return true;
+}
+
+void battle_analytics_unmap(BattleAnalyticsFile *f) {
+    if (!f) return;
+    if (f->map) munmap(f->map, f->map_size);
+    free(f->chunks);
+    memset(f, 0, sizeof(*f));
+}
+
+// ---------------------------------
+// 集計
+// ---------------------------------
+void battle_analytics_sum_skills(const BattleAnalyticsChunk *c, BattleAnalyticsSkillSum out[BATTLE_SKILL_MAX + 1]) {
+    if (!c || !out) return;
+
+    // 分岐なしで (type, 技) ごとに 件数/量/カウンター件数 を足す（技の番号は +1 して 0..255 に）
+    uint64_t cnt[4][256], sum[4][256], ctr[4][256];
+    memset(cnt, 0, sizeof(cnt));
+    memset(sum, 0, sizeof(sum));
+    memset(ctr, 0, sizeof(ctr));
+
+    for (uint32_t i = 0; i < c->rows; i++) {
+        unsigned t = c->type[i] & 3u;
+        unsigned s = (uint8_t)(c->skill[i] + 1);
+        cnt[t][s]++;
+        sum[t][s] += (uint64_t)(int64_t)c->value[i];
+        ctr[t][s] += c->flags[i] & BATTLE_AF_COUNTER;
+    }
+
+    for (int s = 0; s <= BATTLE_SKILL_MAX; s++) {
+        BattleAnalyticsSkillSum *o = &out[s];
+        o->uses        += cnt[BEV_ANIM_SKILL][s];
+        o->damage_rows += cnt[BEV_EFFECT_DAMAGE][s];
+        o->damage      += sum[BEV_EFFECT_DAMAGE][s];
+        o->heal_rows   += cnt[BEV_EFFECT_HEAL][s];
+        o->heal        += sum[BEV_EFFECT_HEAL][s];
+        o->counter_triggers += ctr[BEV_ANIM_SKILL][s];
+        o->counter_hits     += ctr[BEV_EFFECT_DAMAGE][s];
+    }
+}
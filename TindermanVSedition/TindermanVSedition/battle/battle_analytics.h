@@ -0,0 +1,105 @@
+// battle/battle_analytics.h
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "battle_core.h"
+#include "battle_skills.h"   // BATTLE_SKILL_MAX / BATTLE_SKILL_ID_MAX
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ===============================
+//  対戦分析の記録（任意。balance_sweep --analytics / battle_bench analytics）
+//   - イベントストリームはターン頭に捨てられるので、ターンを回すたびにカーソルで読み出して列ごとの配列に溜める
+//       1行 = 1イベント（ANIM / DAMAGE / HEAL）：対戦番号・ターン・出した人・対象・技・量・フラグ
+//   - CHUNK_ROWS 行たまったら書き出しスレッドへ渡し、別の器に溜め続ける（器は2つ。両方埋まったら待つ）
+//   - 書き出した .tvsa は battle_analytics_map で mmap し、列を直接なめて集計する（tools/battle_query）
+//   - 1つの BattleAnalytics には1スレッドから1対戦ずつ（スレッドごとに別ファイルを開く）
+// ===============================
+#define BATTLE_ANALYTICS_MAGIC   "TVSA"
+#define BATTLE_ANALYTICS_VERSION 1
+#define BATTLE_ANALYTICS_CHUNK_ROWS 65536
+
+// flags 列
+#define BATTLE_AF_COUNTER 0x01   // カウンター（構えの演出と、その反撃ダメージ）
+#define BATTLE_AF_AOE     0x02   // 範囲技の演出と、その効果
+
+// 技の列：battle_skill_index_of() の番号。-1 = 定義なし（既定のカウンター演出 "counter" など）
+// ファイルごとに技id の表を持つ（読む側は id 文字列で突き合わせる）
+
+typedef struct BattleAnalytics BattleAnalytics;
+
+// path を作り直して書き始める（書き出しスレッドを立てる）。chunk_rows<=0 で既定。失敗時 NULL
+BattleAnalytics* battle_analytics_open(const char *path, int chunk_rows);
+
+// 対戦の頭に呼ぶ（b は初期局面。以後のイベントを battle_id の対戦として記録する）
+void battle_analytics_begin_battle(BattleAnalytics *a, const BattleCore *b, uint32_t battle_id);
+
+// 前回から後に出たイベントを読み出して溜める。ターンを回すたびに（次のターンを回す前に）呼ぶ
+// 呼び忘れて捨てられた件数は battle_analytics_close の lost に数える
+void battle_analytics_collect(BattleAnalytics *a, const BattleCore *b);
+
+typedef struct {
+    uint64_t rows;
+    uint64_t chunks;
+    uint64_t bytes;
+    uint64_t lost;          // 読む前に捨てられたイベント数
+    double   wait_sec;      // 書き出し待ちで止まった時間
+} BattleAnalyticsStats;
+
+// 残りを書き出して閉じる（スレッドを止めて解放）。書き込みに失敗していたら false
+bool battle_analytics_close(BattleAnalytics *a, BattleAnalyticsStats *out);
+
+// ---------------------------------
+// 読み出し（mmap。列はそのまま指す）
+// ---------------------------------
+typedef struct {
+    uint32_t rows;
+    uint32_t battle_min, battle_max;
+    const uint32_t *battle;
+    const uint16_t *turn;
+    const uint8_t  *type;       // BattleEventType
+    const uint8_t  *actor;
+    const int8_t   *target;     // -1 = なし
+    const int8_t   *skill;      // 上の技の列
+    const uint8_t  *flags;
+    const int32_t  *value;
+} BattleAnalyticsChunk;
+
+typedef struct {
+    void *map;
+    size_t map_size;
+    uint32_t defs_checksum;     // 書いたときの battle_defs_checksum()
+    int skill_count;
+    const char (*skill_ids)[BATTLE_SKILL_ID_MAX];   // skill 列の番号 → 技id
+    BattleAnalyticsChunk *chunks;
+    int chunk_count;
+    uint64_t rows;
+} BattleAnalyticsFile;
+
+// 壊れた/途中で切れたチャンクは、そこで読むのをやめる（それより前は使える）。1つも読めなければ false
+bool battle_analytics_map(BattleAnalyticsFile *f, const char *path);
+void battle_analytics_unmap(BattleAnalyticsFile *f);
+
+// ---------------------------------
+// 集計（技ごと）
+//   out[0] = 技なし（skill -1）、out[i + 1] = ファイルの技表の i 番。チャンクごとに足し込む
+//   カウンターの命中率 = counter_hits / counter_triggers（構えが発動して反撃が届いた割合）
+// ---------------------------------
+typedef struct {
+    uint64_t uses;              // 演出の回数（範囲技は1回の使用で1回）
+    uint64_t damage_rows;       // ダメージを与えた回数
+    uint64_t damage;            // 与えたダメージの合計
+    uint64_t heal_rows;
+    uint64_t heal;
+    uint64_t counter_triggers;  // カウンターの発動回数
+    uint64_t counter_hits;      // うち反撃が射程内に届いた回数
+} BattleAnalyticsSkillSum;
+
+void battle_analytics_sum_skills(const BattleAnalyticsChunk *c, BattleAnalyticsSkillSum out[BATTLE_SKILL_MAX + 1]);
+
+#ifdef __cplusplus
+}
+#endif
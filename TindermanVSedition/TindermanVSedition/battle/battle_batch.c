@@ -0,0 +1,286 @@
+// battle/battle_batch.c
+#include "battle_batch.h"
+#include <stdlib.h>
+#include <string.h>
+
+#include "battle_skills.h"  // battle_skill_get(), battle_skill_index_of(), battle_skill_at()
+#include "char_defs.h"      // char_def_get(), char_def_get_skill_id_at()
+
+// x86-64/GCC：AVX2 版も作って実行時に選ぶ（それ以外は汎用版のみ）
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) && !defined(__APPLE__)
+#define BATCH_HAS_AVX2 1
+#else
+#define BATCH_HAS_AVX2 0
+#endif
+
+#define MAP_MIN 0
+#define MAP_MAX 20
+
+// 技index の枠（CharDef.skill_ids[4] + タッグ枠）
+#define BATCH_SKILL_SLOTS 5
+
+// ---------------------------------
+// layout
+// ---------------------------------
+// 技表（ユニット×技index ごと。load 時に char_defs/battle_skills から解決）
+enum {
+    SKF_TYPE = 0,   // SkillType（-1=解決できない/なし）
+    SKF_COST,
+    SKF_RANGE,      // <0 は射程∞
+    SKF_AOE,        // 0/1
+    SKF_AMOUNT,     // ATTACK: max(1, ATK+power) / HEAL: max(1, power)
+    SKF_RADIUS,     // ATTACK AOE の半径（<=0 は 1）
+    SKF_ID,         // battle_skill_index_of()
+    BATCH_SK_FIELDS
+};
+
+// ターン命令（ブロックごとにスタック上の表へデコード [f][u][lane]）
+enum {
+    CF_HM = 0, CF_MX, CF_MY,                    // 移動（盤面にクランプ済み）
+    CF_TYPE, CF_COST, CF_RANGE, CF_AOE, CF_AMOUNT, CF_RADIUS, CF_ID,
+    CF_TS,                                      // 単体対象 slot（0=hero, 1=girl）
+    CF_CX, CF_CY,                               // AOE中心（クランプ済み）
+    CF_COUNT
+};
+
+// 技表は対戦ごとに連続（デコード時に1対戦ぶんをまとめて読む）
+#define SK_ROW(bb, i, u, s) ((bb)->sk + ((size_t)(i) * 4 * BATCH_SKILL_SLOTS + (size_t)((u) * BATCH_SKILL_SLOTS + (s))) * BATCH_SK_FIELDS)
+#define U_AT(arr, bb, u)    ((arr) + (size_t)(u) * (size_t)(bb)->n_pad)
+
+static int clampi(int v, int lo, int hi) {
+    if (v < lo) return lo;
+    if (v > hi) return hi;
+    return v;
+}
+
+// ---------------------------------
+// setup
+// ---------------------------------
+bool battle_batch_init(BattleBatch *bb, int n) {
+    if (!bb || n < 1) return false;
+    memset(bb, 0, sizeof(*bb));
+
+    int np = (n + BATTLE_BATCH_LANES - 1) / BATTLE_BATCH_LANES * BATTLE_BATCH_LANES;
+    size_t per_unit = 12;                           // hp..ctr_skill
+    size_t words = (per_unit * 4 + 2 + 4 + 4
+                    + 4 * BATCH_SKILL_SLOTS * BATCH_SK_FIELDS) * (size_t)np;
+
+    int32_t *m = (int32_t*)calloc(words, sizeof(int32_t));
+    if (!m) return false;
+
+    bb->n = n;
+    bb->n_pad = np;
+    bb->mem = m;
+
+    int32_t **arr[] = { &bb->hp, &bb->st, &bb->x, &bb->y, &bb->alive,
+                        &bb->hp_max, &bb->st_max, &bb->regen, &bb->regen_on,
+                        &bb->ctr_ready, &bb->ctr_range, &bb->ctr_skill };
+    for (size_t k = 0; k < sizeof(arr) / sizeof(arr[0]); k++) { *arr[k] = m; m += 4 * np; }
+    bb->ended = m; m += np;
+    bb->turn  = m; m += np;
+    bb->order = m; m += 4 * np;
+    bb->atk   = m; m += 4 * np;
+    bb->sk    = m;
+
+    // 未使用レーン（n..n_pad）は決着済み扱い
+    for (int i = 0; i < np; i++) bb->ended[i] = 1;
+    return true;
+}
+
+void battle_batch_free(BattleBatch *bb) {
+    if (!bb) return;
+    free(bb->mem);
+    memset(bb, 0, sizeof(*bb));
+}
+
+bool battle_batch_load(BattleBatch *bb, int i, const BattleCore *b) {
+    if (!bb || !b || i < 0 || i >= bb->n) return false;
+    if (b->team_size != 2 || b->unit_count != 4) return false;   // カーネルは 2v2 固定
+    if (b->stage) return false;                                   // 地形（壁/悪路/見通し）は解かない
+    if (b->_exec_active || (b->phase != BPHASE_INPUT && b->phase != BPHASE_END)) return false;
+
+    for (int u = 0; u < 4; u++) {
+        const Unit *un = &b->units[u];
+        const CharDef *cd = char_def_get_or_fallback(un->char_id);
+
+        U_AT(bb->hp, bb, u)[i]     = un->stats.hp;
+        U_AT(bb->st, bb, u)[i]     = un->stats.st;
+        U_AT(bb->x, bb, u)[i]      = un->pos.x;
+        U_AT(bb->y, bb, u)[i]      = un->pos.y;
+        U_AT(bb->alive, bb, u)[i]  = un->alive ? 1 : 0;
+        U_AT(bb->hp_max, bb, u)[i] = b->hp_max[u];
+        U_AT(bb->st_max, bb, u)[i] = b->st_max[u];
+        U_AT(bb->regen, bb, u)[i]    = cd ? cd->st_regen_per_turn : 0;
+        U_AT(bb->regen_on, bb, u)[i] = cd ? 1 : 0;
+        U_AT(bb->ctr_ready, bb, u)[i] = b->counter_ready[u] ? 1 : 0;
+        U_AT(bb->ctr_range, bb, u)[i] = b->counter_range[u];
+        U_AT(bb->ctr_skill, bb, u)[i] = battle_skill_index_of(b->counter_skill_id[u]);
+        U_AT(bb->atk, bb, u)[i] = un->stats.atk;
+
+        // 技表（core の resolve_skill_id_for_actor と同じ解決）
+        bool tag = (un->team == TEAM_P1) ? b->p1_tag : b->p2_tag;
+        for (int s = 0; s < BATCH_SKILL_SLOTS; s++) {
+            const SkillDef *sk = cd ? battle_skill_get(char_def_get_skill_id_at(cd, tag, s)) : NULL;
+            int type = -1, amount = 0, radius = 0;
+            if (sk && (sk->type == SKTYPE_ATTACK || sk->type == SKTYPE_HEAL || sk->type == SKTYPE_COUNTER)) {
+                type = (int)sk->type;
+                if (sk->type == SKTYPE_ATTACK) {
+                    amount = un->stats.atk + sk->power;
+                    radius = (sk->aoe_radius <= 0) ? 1 : sk->aoe_radius;
+                } else {
+                    amount = sk->power;
+                }
+                if (amount < 1) amount = 1;
+            }
+            int32_t *row = SK_ROW(bb, i, u, s);
+            row[SKF_TYPE]   = type;
+            row[SKF_COST]   = sk ? sk->st_cost : 0;
+            row[SKF_RANGE]  = sk ? sk->range : 0;
+            row[SKF_AOE]    = (sk && sk->target == SKT_AOE) ? 1 : 0;
+            row[SKF_AMOUNT] = amount;
+            row[SKF_RADIUS] = radius;
+            row[SKF_ID]     = sk ? battle_skill_index_of(sk->id) : -1;
+        }
+    }
+
+    // 行動順：SPD降順、同値は index 昇順（build_action_order と同じ。死亡は実行時に飛ばす）
+    int ord[4] = { 0, 1, 2, 3 };
+    for (int a = 0; a < 4; a++) {
+        for (int c = a + 1; c < 4; c++) {
+            int sa = b->units[ord[a]].stats.spd, sc = b->units[ord[c]].stats.spd;
+            if (sc > sa || (sc == sa && ord[c] < ord[a])) { int t = ord[a]; ord[a] = ord[c]; ord[c] = t; }
+        }
+    }
+    for (int k = 0; k < 4; k++) bb->order[(size_t)k * bb->n_pad + i] = ord[k];
+
+    bb->ended[i] = (b->phase == BPHASE_END) ? 1 : 0;
+    bb->turn[i] = b->turn;
+    return true;
+}
+
+void battle_batch_store(const BattleBatch *bb, int i, BattleCore *out) {
+    if (!bb || !out || i < 0 || i >= bb->n) return;
+
+    for (int u = 0; u < 4; u++) {
+        Unit *un = &out->units[u];
+        un->stats.hp = U_AT(bb->hp, bb, u)[i];
+        un->stats.st = U_AT(bb->st, bb, u)[i];
+        un->pos = (Pos){ (int8_t)U_AT(bb->x, bb, u)[i], (int8_t)U_AT(bb->y, bb, u)[i] };
+        un->alive = U_AT(bb->alive, bb, u)[i] != 0;
+
+        const SkillDef *sk = battle_skill_at(U_AT(bb->ctr_skill, bb, u)[i]);
+        out->counter_ready[u] = U_AT(bb->ctr_ready, bb, u)[i] != 0;
+        out->counter_range[u] = U_AT(bb->ctr_range, bb, u)[i];
+        out->counter_skill_id[u] = sk ? sk->id : NULL;
+    }
+    out->phase = bb->ended[i] ? BPHASE_END : BPHASE_INPUT;
+    out->turn = bb->turn[i];
+    out->_exec_active = false;
+    out->_has_cmd[TEAM_P1] = false;
+    out->_has_cmd[TEAM_P2] = false;
+    battle_core_refresh_hash(out);
+}
+
+int battle_batch_count_ended(const BattleBatch *bb) {
+    if (!bb) return 0;
+    int c = 0;
+    for (int i = 0; i < bb->n; i++) c += bb->ended[i] ? 1 : 0;
+    return c;
+}
+
+// ---------------------------------
+// decode（スカラー：命令 → ブロック内 SoA）
+// ---------------------------------
+typedef int32_t BatchCmdTile[CF_COUNT][4][BATTLE_BATCH_LANES];
+
+static void decode_block(const BattleBatch *bb, const TurnCmd *cmds, int o, BatchCmdTile c) {
+    for (int l = 0; l < BATTLE_BATCH_LANES; l++) {
+        int i = o + l;
+        if (i >= bb->n || bb->ended[i]) {
+            for (int u = 0; u < 4; u++) c[CF_TYPE][u][l] = -1;
+            continue;
+        }
+        for (int t = 0; t < 2; t++) {
+            for (int s = 0; s < 2; s++) {
+                const UnitCmd *uc = &cmds[i * 2 + t].cmd[s];
+                int u = unit_index((Team)t, (Slot)s);
+
+                c[CF_HM][u][l] = uc->has_move ? 1 : 0;
+                c[CF_MX][u][l] = clampi(uc->move_to.x, MAP_MIN, MAP_MAX);
+                c[CF_MY][u][l] = clampi(uc->move_to.y, MAP_MIN, MAP_MAX);
+                c[CF_TS][u][l] = (uc->target == 1) ? 1 : 0;
+                c[CF_CX][u][l] = clampi(uc->center.x, MAP_MIN, MAP_MAX);
+                c[CF_CY][u][l] = clampi(uc->center.y, MAP_MIN, MAP_MAX);
+
+                int si = uc->skill_index;
+                if (si < 0 || si >= BATCH_SKILL_SLOTS) {
+                    c[CF_TYPE][u][l] = -1;
+                    continue;
+                }
+                const int32_t *row = SK_ROW(bb, i, u, si);
+                for (int f = 0; f < BATCH_SK_FIELDS; f++) c[CF_TYPE + f][u][l] = row[f];
+            }
+        }
+    }
+}
+
+// ---------------------------------
+// kernel
+//   本体は battle_batch_kernel.inc。x86-64/GCC では 8レーン幅（AVX2）版も作り、実行時に選ぶ
+//   汎用版は SSE2 でそのまま載る 4レーン幅で、1ブロックを2回に分けて処理する
+//   ※ ベクタを値渡しする関数は ABI 警告が出るので演算はマクロで書く
+// ---------------------------------
+#define VLOAD(dst, p)   memcpy(&(dst), (p), sizeof(dst))
+#define VSTORE(p, src)  memcpy((p), &(src), sizeof(src))
+#define BLEND(m, a, b)  (((m) & (a)) | (~(m) & (b)))
+#define VMIN(a, b)      BLEND((a) < (b), (a), (b))
+#define VMAX(a, b)      BLEND((a) > (b), (a), (b))
+#define VABS(d)         (((d) ^ ((d) >> 31)) - ((d) >> 31))
+#define SEL4(a, v)      ((((a) == 0) & (v)[0]) | (((a) == 1) & (v)[1]) | \
+                         (((a) == 2) & (v)[2]) | (((a) == 3) & (v)[3]))
+#define IN_RANGE(d, r)  (((r) < 0) | ((d) <= (r)))
+
+typedef int32_t batch_v4 __attribute__((vector_size(4 * sizeof(int32_t))));
+
+#define BK_VI   batch_v4
+#define BK_NAME batch_kernel_generic
+#define BK_ATTR
+#include "battle_batch_kernel.inc"
+#undef BK_VI
+#undef BK_NAME
+#undef BK_ATTR
+
+#if BATCH_HAS_AVX2
+typedef int32_t batch_v8 __attribute__((vector_size(8 * sizeof(int32_t))));
+
+#define BK_VI   batch_v8
+#define BK_NAME batch_kernel_avx2
+#define BK_ATTR __attribute__((target("avx2")))
+#include "battle_batch_kernel.inc"
+#undef BK_VI
+#undef BK_NAME
+#undef BK_ATTR
+#endif
+
+static bool batch_use_avx2(void) {
+#if BATCH_HAS_AVX2
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
+
+void battle_batch_run_turn(BattleBatch *bb, const TurnCmd *cmds) {
+    if (!bb || !cmds) return;
+#if BATCH_HAS_AVX2
+    if (batch_use_avx2()) {
+        batch_kernel_avx2(bb, cmds);
+        return;
+    }
+#endif
+    batch_kernel_generic(bb, cmds);
+}
+
+const char* battle_batch_kernel_name(void) {
+    return batch_use_avx2() ? "avx2" : "generic";
+}
@@ -0,0 +1,67 @@
+// battle/battle_batch.h
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "battle_core.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ===============================
+//  バッチ解決（バランス検証用）
+//   - 独立した多数の対戦を同じターンで足並みをそろえて解決する
+//   - 状態は SoA（[unit][battle]）で持ち、BATTLE_BATCH_LANES 対戦ずつ
+//     ベクタ演算（GCC vector extension）でまとめて処理する
+//     x86-64/GCC では AVX2 版（8レーン幅）も作り、実行時に選ぶ（汎用版は4レーン幅）
+//   - 結果は battle_core_run_turn と完全一致させる（battle_bench batch で差分検証）
+//   - 演出イベントは出さない（HP/ST/位置/生存/構え/決着だけ）
+//   - 地形なし（BattleCore.stage == NULL）の対戦専用。ステージ付きは battle_core_run_turn で回す
+//   - 2v2（team_size == 2）専用
+//     どちらも load が false を返す（その対戦はバッチに入らない。呼ぶ側が確かめること）
+// ===============================
+#define BATTLE_BATCH_LANES 8
+
+typedef struct {
+    int n;          // 対戦数
+    int n_pad;      // LANES の倍数に切り上げ（余りは決着済み扱い）
+
+    // --- 状態 [u * n_pad + i] ---
+    int32_t *hp, *st, *x, *y, *alive;
+    int32_t *hp_max, *st_max, *regen, *regen_on;
+    int32_t *ctr_ready, *ctr_range, *ctr_skill;   // ctr_skill = battle_skill_index_of()
+
+    // --- 対戦ごと [i] ---
+    int32_t *ended;     // BPHASE_END
+    int32_t *turn;
+
+    // --- 固定値 ---
+    int32_t *order;     // [k * n_pad + i] SPD順の行動順（SPDは対戦中に変わらない）
+    int32_t *atk;       // [u * n_pad + i]
+    int32_t *sk;        // 技表（対戦ごとにまとめて持つ。並びは battle_batch.c）
+
+    void *mem;
+} BattleBatch;
+
+bool battle_batch_init(BattleBatch *bb, int n);
+void battle_batch_free(BattleBatch *bb);
+
+// i 番目の対戦に局面を読み込む（入力待ちか決着済みの局面であること）
+// ステージ付き・2v2 以外・解決中の局面は読み込まずに false（i 番目は前の内容のまま）
+bool battle_batch_load(BattleBatch *bb, int i, const BattleCore *b);
+
+// i 番目の状態を out に書き戻す（out は load 元と同じ対戦の BattleCore。イベントストリームは触らない）
+void battle_batch_store(const BattleBatch *bb, int i, BattleCore *out);
+
+// 全対戦を1ターン進める。cmds[i * 2 + TEAM_P1/P2]（決着済みの対戦は無視）
+void battle_batch_run_turn(BattleBatch *bb, const TurnCmd *cmds);
+
+int battle_batch_count_ended(const BattleBatch *bb);
+
+// 実行中のカーネル（"avx2" / "generic"）
+const char* battle_batch_kernel_name(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -76,3 +76,11 @@ bool battle_cmd_unpack(const uint8_t in[TURNCMD_WIRE_BYTES], TurnCmd* out){
     return battle_cmd_validate(out);
 }
 
+void battle_cmd_mirror(TurnCmd* c){
+    if(!c) return;
+    for(int i=0;i<2;i++){
+        UnitCmd* u=&c->cmd[i];
+        if(u->has_move) u->move_to.x=(int8_t)(MAP_W-1-u->move_to.x);
+        u->center.x=(int8_t)(MAP_W-1-u->center.x);
+    }
+}
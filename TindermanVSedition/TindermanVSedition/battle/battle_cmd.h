@@ -29,3 +29,6 @@ bool battle_cmd_unpack(const uint8_t in[TURNCMD_WIRE_BYTES], TurnCmd* out);
 
 // 自己検証用：値域チェック（オンラインでは必須）
 bool battle_cmd_validate(const TurnCmd* c);
+
+// 相手視点の命令を自分視点へ（x を左右反転: 20-x）。オンライン受信/サーバ記録用
+void battle_cmd_mirror(TurnCmd* c);
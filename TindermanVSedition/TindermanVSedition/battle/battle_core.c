@@ -2,13 +2,19 @@
 #include "battle_core.h"
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
 
 #include "battle_skills.h"  // battle_skill_get()
 #include "char_defs.h"      // char_def_get(), char_def_get_skill_id_at()
+#include "battle_hash.h"    // battle_hash_key()
 
 #define MAP_MIN 0
 #define MAP_MAX 20
 
+_Static_assert(BATTLE_UNIT_MAX <= 32, "aoe_bucket は unit index の uint32_t bit 集合");
+_Static_assert(sizeof(UnitCmd) <= 8, "BattleJournalEntry の union に命令1人分が入ること");
+
 // ---------------------------------
 // util
 // ---------------------------------
@@ -18,22 +24,163 @@ static int clampi(int v, int lo, int hi) {
     return v;
 }
 
+// ---------------------------------
+// AOE バケット
+// ---------------------------------
+static bool aoe_use_bucket(const BattleCore *b) {
+    return b->unit_count > BATTLE_AOE_SCAN_MAX;
+}
+
+static int aoe_bucket_axis(int v, int n) {
+    return clampi(v / BATTLE_AOE_CELL, 0, n - 1);
+}
+
+static int aoe_bucket_of(Pos p) {
+    return aoe_bucket_axis(p.y < 0 ? 0 : p.y, BATTLE_AOE_BH) * BATTLE_AOE_BW
+         + aoe_bucket_axis(p.x < 0 ? 0 : p.x, BATTLE_AOE_BW);
+}
+
+static void aoe_rebuild(BattleCore *b) {
+    memset(b->aoe_bucket, 0, sizeof(b->aoe_bucket));
+    if (!aoe_use_bucket(b)) return;
+    for (int i = 0; i < b->unit_count; i++) b->aoe_bucket[aoe_bucket_of(b->units[i].pos)] |= 1u << i;
+}
+
+// ---------------------------------
+// 変更の記録（battle_core.h 参照）
+// ---------------------------------
+enum {
+    BJ_POS = 1,     // s=x v=y
+    BJ_HP,          // v
+    BJ_ST,          // v
+    BJ_ALIVE,       // v
+    BJ_COUNTER,     // s=ready v=range p=skill_id
+    BJ_HP_MAX,      // v
+    BJ_CMD,         // cmd
+    BJ_MARK,        // ui=命令済み(bit0,1)/実行中(bit2) s=phase v=turn
+    BJ_MARK_LAST,   // s=actor v=target p=skill_id（last_executed_*）
+    BJ_MARK_HASH    // hash
+};
+
+static bool jr_on(const BattleCore *b) {
+    return b->journal && b->journal_owner == b;
+}
+
+static BattleJournalEntry* jr_push(BattleCore *b, int kind, int ui) {
+    BattleJournal *j = b->journal;
+    if (j->count == j->cap) {
+        int ncap = j->cap ? j->cap * 2 : 256;
+        BattleJournalEntry *ne = (BattleJournalEntry*)realloc(j->e, (size_t)ncap * sizeof(BattleJournalEntry));
+        if (!ne) {
+            j->overflow = true;
+            return NULL;
+        }
+        j->e = ne;
+        j->cap = ncap;
+    }
+    BattleJournalEntry *e = &j->e[j->count++];
+    e->kind = (uint8_t)kind;
+    e->ui = (uint8_t)ui;
+    return e;
+}
+
+// ---------------------------------
+// state write（局面ハッシュ / AOE バケットを差分更新する）
+//   units / counter_* / hp_max はここを通して書き換える（記録が付いていれば元の値を積む）
+// ---------------------------------
+static void set_pos(BattleCore *b, int ui, Pos p) {
+    Unit *u = &b->units[ui];
+    if (jr_on(b)) {
+        BattleJournalEntry *e = jr_push(b, BJ_POS, ui);
+        if (e) { e->s = u->pos.x; e->v = u->pos.y; }
+    }
+    b->hash ^= battle_hash_pos_key(ui, u->pos) ^ battle_hash_pos_key(ui, p);
+    if (aoe_use_bucket(b)) {
+        b->aoe_bucket[aoe_bucket_of(u->pos)] &= ~(1u << ui);
+        b->aoe_bucket[aoe_bucket_of(p)] |= 1u << ui;
+    }
+    u->pos = p;
+}
+
+static void set_hp(BattleCore *b, int ui, int hp) {
+    Unit *u = &b->units[ui];
+    if (jr_on(b)) {
+        BattleJournalEntry *e = jr_push(b, BJ_HP, ui);
+        if (e) e->v = u->stats.hp;
+    }
+    b->hash ^= battle_hash_key(BHK_HP, ui, u->stats.hp) ^ battle_hash_key(BHK_HP, ui, hp);
+    u->stats.hp = hp;
+}
+
+static void set_st(BattleCore *b, int ui, int st) {
+    Unit *u = &b->units[ui];
+    if (jr_on(b)) {
+        BattleJournalEntry *e = jr_push(b, BJ_ST, ui);
+        if (e) e->v = u->stats.st;
+    }
+    b->hash ^= battle_hash_key(BHK_ST, ui, u->stats.st) ^ battle_hash_key(BHK_ST, ui, st);
+    u->stats.st = st;
+}
+
+static void set_alive(BattleCore *b, int ui, bool alive) {
+    Unit *u = &b->units[ui];
+    if (u->alive == alive) return;
+    if (jr_on(b)) {
+        BattleJournalEntry *e = jr_push(b, BJ_ALIVE, ui);
+        if (e) e->v = u->alive;
+    }
+    b->hash ^= battle_hash_key(BHK_ALIVE, ui, 1);
+    u->alive = alive;
+}
+
+static void set_counter(BattleCore *b, int ui, bool ready, int range, const char *skill_id) {
+    if (jr_on(b)) {
+        BattleJournalEntry *e = jr_push(b, BJ_COUNTER, ui);
+        if (e) { e->s = b->counter_ready[ui]; e->v = b->counter_range[ui]; e->u.p = b->counter_skill_id[ui]; }
+    }
+    if (b->counter_ready[ui]) b->hash ^= battle_hash_key(BHK_COUNTER, ui, b->counter_range[ui]);
+    b->counter_ready[ui] = ready;
+    b->counter_range[ui] = range;
+    b->counter_skill_id[ui] = skill_id;
+    if (ready) b->hash ^= battle_hash_key(BHK_COUNTER, ui, range);
+}
+
+static void set_hp_max(BattleCore *b, int ui, int hp_max) {
+    if (jr_on(b)) {
+        BattleJournalEntry *e = jr_push(b, BJ_HP_MAX, ui);
+        if (e) e->v = b->hp_max[ui];
+    }
+    b->hp_max[ui] = hp_max;
+}
+
+static void set_pending_cmd(BattleCore *b, int ui, const UnitCmd *uc) {
+    if (jr_on(b)) {
+        BattleJournalEntry *e = jr_push(b, BJ_CMD, ui);
+        if (e) e->u.cmd = b->_pending_cmd[ui];
+    }
+    b->_pending_cmd[ui] = *uc;
+}
+
 static bool team_all_dead(const BattleCore *b, Team t) {
-    int i0 = unit_index(t, SLOT_HERO);
-    int i1 = unit_index(t, SLOT_GIRL);
-    return (!b->units[i0].alive) && (!b->units[i1].alive);
+    int i0 = battle_core_unit_index(b, t, 0);
+    for (int i = i0; i < i0 + b->team_size; i++) {
+        if (b->units[i].alive) return false;
+    }
+    return true;
 }
 
 static bool is_tag_learned_for_team(const BattleCore *b, Team t) {
     return (t == TEAM_P1) ? b->p1_tag : b->p2_tag;
 }
 
-static bool spend_st_if_possible(Unit *u, int cost) {
-    if (!u) return false;
+static bool spend_st_if_possible(BattleCore *b, int ui, int cost) {
+    if (!b) return false;
     if (cost <= 0) return true;
-    if (u->stats.st < cost) return false;
-    u->stats.st -= cost;
-    if (u->stats.st < 0) u->stats.st = 0;
+    int st = b->units[ui].stats.st;
+    if (st < cost) return false;
+    st -= cost;
+    if (st < 0) st = 0;
+    set_st(b, ui, st);
     return true;
 }
 
@@ -55,29 +202,155 @@ static bool in_range_manhattan_units(const Unit *a, const Unit *t, int range) {
     return in_range_manhattan_pos(a->pos, t->pos, range);
 }
 
+// 単体技の成立判定：射程 + 見通し（ステージなしなら射程だけ）
+static bool can_reach_pos(const BattleCore *b, Pos a, Pos t, int range) {
+    return in_range_manhattan_pos(a, t, range) && battle_stage_los(b->stage, a, t);
+}
+
+static bool can_reach_units(const BattleCore *b, const Unit *a, const Unit *t, int range) {
+    return in_range_manhattan_units(a, t, range) && battle_stage_los(b->stage, a->pos, t->pos);
+}
+
 // ---------------------------------
-// event queue
+// event stream
 // ---------------------------------
+static const BattleEvent* stream_at(const BattleEventStream *s, int i) {
+    if (i < BATTLE_EVENT_INLINE) return &s->inline_ev[i];
+    return &s->heap[i - BATTLE_EVENT_INLINE];
+}
+
+// ターン頭：保持分を捨てる（seq は続き番号。ヒープは再利用）
+static void stream_reset(BattleEventStream *s) {
+    s->base_seq += (uint32_t)s->count;
+    s->count = 0;
+    s->act_begin = 0;
+}
+
 void battle_core_clear_events(BattleCore *b) {
     if (!b) return;
-    b->ev_count = 0;
+    b->ev.act_begin = b->ev.count;
 }
 
 int battle_core_event_count(const BattleCore *b) {
     if (!b) return 0;
-    return b->ev_count;
+    return b->ev.count - b->ev.act_begin;
 }
 
 const BattleEvent* battle_core_get_event(const BattleCore *b, int idx) {
     if (!b) return NULL;
-    if (idx < 0 || idx >= b->ev_count) return NULL;
-    return &b->events[idx];
+    if (idx < 0 || idx >= battle_core_event_count(b)) return NULL;
+    return stream_at(&b->ev, b->ev.act_begin + idx);
+}
+
+const BattleEvent* battle_core_next_event(const BattleCore *b, BattleEventCursor *cur) {
+    if (!b || !cur) return NULL;
+    const BattleEventStream *s = &b->ev;
+
+    // 読む前に捨てられた分は lost に数えて先頭へ
+    int32_t behind = (int32_t)(s->base_seq - cur->seq);
+    if (behind > 0) {
+        cur->lost += (uint32_t)behind;
+        cur->seq = s->base_seq;
+    }
+
+    uint32_t i = cur->seq - s->base_seq;
+    if (i >= (uint32_t)s->count) return NULL;
+    cur->seq++;
+    return stream_at(s, (int)i);
+}
+
+BattleEventCursor battle_core_event_cursor_now(const BattleCore *b) {
+    BattleEventCursor c = { 0, 0 };
+    if (b) c.seq = b->ev.base_seq + (uint32_t)b->ev.count;
+    return c;
+}
+
+void battle_core_free(BattleCore *b) {
+    if (!b) return;
+    BattleEventStream *s = &b->ev;
+    if (s->heap_owner == b) free(s->heap);
+    s->heap = NULL;
+    s->heap_cap = 0;
+    s->heap_owner = NULL;
+    if (s->count > BATTLE_EVENT_INLINE) s->count = BATTLE_EVENT_INLINE;
+    if (s->act_begin > s->count) s->act_begin = s->count;
+}
+
+void battle_core_move(BattleCore *dst, BattleCore *src) {
+    if (!dst || !src || dst == src) return;
+    const bool owns_heap = (src->ev.heap_owner == src);
+    const bool owns_journal = (src->journal_owner == src);
+    memcpy(dst, src, sizeof(*dst));
+    if (owns_heap) dst->ev.heap_owner = dst;
+    if (owns_journal) dst->journal_owner = dst;
+    src->ev.heap = NULL;
+    src->ev.heap_cap = 0;
+    src->ev.heap_owner = NULL;
+    if (src->ev.count > BATTLE_EVENT_INLINE) src->ev.count = BATTLE_EVENT_INLINE;
+    src->journal = NULL;
+    src->journal_owner = NULL;
+}
+
+void battle_core_copy(BattleCore *dst, const BattleCore *src) {
+    if (!dst || !src || dst == src) return;
+    memcpy(dst, src, sizeof(*dst));
+    dst->ev.heap = NULL;
+    dst->ev.heap_cap = 0;
+    dst->ev.heap_owner = NULL;
+    dst->journal = NULL;
+    dst->journal_owner = NULL;
+
+    int hi = src->ev.count - BATTLE_EVENT_INLINE;
+    if (hi <= 0) return;
+    BattleEvent *nh = (BattleEvent*)malloc((size_t)hi * sizeof(BattleEvent));
+    if (!nh) {
+        // 確保失敗時は溢れ分を捨てる（push_event と同じ。局面そのものは写せている）
+        dst->ev.count = BATTLE_EVENT_INLINE;
+        if (dst->ev.act_begin > dst->ev.count) dst->ev.act_begin = dst->ev.count;
+        return;
+    }
+    memcpy(nh, src->ev.heap, (size_t)hi * sizeof(BattleEvent));
+    dst->ev.heap = nh;
+    dst->ev.heap_cap = hi;
+    dst->ev.heap_owner = dst;
 }
 
 static void push_event(BattleCore *b, BattleEvent ev) {
     if (!b) return;
-    if (b->ev_count >= BATTLE_EVENT_MAX) return;
-    b->events[b->ev_count++] = ev;
+    BattleEventStream *s = &b->ev;
+
+    ev.seq = s->base_seq + (uint32_t)s->count;
+    ev.turn = b->turn;
+
+    if (s->count < BATTLE_EVENT_INLINE) {
+        s->inline_ev[s->count++] = ev;
+        return;
+    }
+
+    int hi = s->count - BATTLE_EVENT_INLINE;
+
+    // 自分のものでないヒープには書かない（自分用を確保して、読めていた hi 件を写してから足す）
+    if (s->heap_owner != b) {
+        int ncap = 32;
+        while (ncap <= hi) ncap *= 2;
+        BattleEvent *nh = (BattleEvent*)malloc((size_t)ncap * sizeof(BattleEvent));
+        if (!nh) return; // 確保失敗時は従来どおり捨てる（コピー元のヒープは読めるまま）
+        if (hi > 0) memcpy(nh, s->heap, (size_t)hi * sizeof(BattleEvent));
+        s->heap = nh;
+        s->heap_cap = ncap;
+        s->heap_owner = b;
+    }
+
+    if (hi >= s->heap_cap) {
+        int ncap = s->heap_cap ? s->heap_cap : 32;
+        while (ncap <= hi) ncap *= 2;
+        BattleEvent *nh = (BattleEvent*)realloc(s->heap, (size_t)ncap * sizeof(BattleEvent));
+        if (!nh) return; // 確保失敗時は従来どおり捨てる
+        s->heap = nh;
+        s->heap_cap = ncap;
+    }
+    s->heap[hi] = ev;
+    s->count++;
 }
 
 static void push_anim(BattleCore *b, int actor_ui, int target_ui, const char *skill_id, Pos center, int radius) {
@@ -125,20 +398,26 @@ static void push_heal(BattleCore *b, int actor_ui, int target_ui, int heal) {
 // ---------------------------------
 // effect application (delayed)
 // ---------------------------------
-static void apply_damage_raw(Unit *tgt, int dmg) {
-    if (!tgt || !tgt->alive) return;
+static void apply_damage_raw(BattleCore *b, int tidx, int dmg) {
+    if (!b) return;
+    if (tidx < 0 || tidx >= b->unit_count) return;
+
+    Unit *tgt = &b->units[tidx];
+    if (!tgt->alive) return;
     if (dmg < 1) dmg = 1;
 
-    tgt->stats.hp -= dmg;
-    if (tgt->stats.hp <= 0) {
-        tgt->stats.hp = 0;
-        tgt->alive = false;
+    int nhp = tgt->stats.hp - dmg;
+    if (nhp <= 0) {
+        set_hp(b, tidx, 0);
+        set_alive(b, tidx, false);
+    } else {
+        set_hp(b, tidx, nhp);
     }
 }
 
 static void apply_heal_raw(BattleCore *b, int tidx, int amount) {
     if (!b) return;
-    if (tidx < 0 || tidx >= 4) return;
+    if (tidx < 0 || tidx >= b->unit_count) return;
 
     Unit *tgt = &b->units[tidx];
     if (!tgt->alive) return;
@@ -149,12 +428,12 @@ static void apply_heal_raw(BattleCore *b, int tidx, int amount) {
         // 念のため：未初期化なら現HPを最大として扱う
         maxhp = tgt->stats.hp;
         if (maxhp < 1) maxhp = 1;
-        b->hp_max[tidx] = maxhp;
+        set_hp_max(b, tidx, maxhp);
     }
 
     int nhp = tgt->stats.hp + amount;
     if (nhp > maxhp) nhp = maxhp;
-    tgt->stats.hp = nhp;
+    set_hp(b, tidx, nhp);
 }
 
 void battle_core_apply_event(BattleCore *b, const BattleEvent *ev) {
@@ -162,9 +441,7 @@ void battle_core_apply_event(BattleCore *b, const BattleEvent *ev) {
 
     switch (ev->type) {
     case BEV_EFFECT_DAMAGE:
-        if (ev->target_ui >= 0 && ev->target_ui < 4) {
-            apply_damage_raw(&b->units[ev->target_ui], ev->value);
-        }
+        apply_damage_raw(b, ev->target_ui, ev->value);
         break;
     case BEV_EFFECT_HEAL:
         apply_heal_raw(b, ev->target_ui, ev->value);
@@ -179,8 +456,8 @@ void battle_core_apply_event(BattleCore *b, const BattleEvent *ev) {
 void battle_core_apply_events(BattleCore *b) {
     if (!b) return;
 
-    for (int i = 0; i < b->ev_count; ++i) {
-        battle_core_apply_event(b, &b->events[i]);
+    for (int i = b->ev.act_begin; i < b->ev.count; ++i) {
+        battle_core_apply_event(b, stream_at(&b->ev, i));
     }
 
     // 適用後に勝敗判定
@@ -194,18 +471,40 @@ void battle_core_apply_events(BattleCore *b) {
 // ---------------------------------
 // misc
 // ---------------------------------
+// ST回復は1ターンに2回かかる（対戦ルール。変えるとリプレイ/オンラインの結果がずれる）
+//   1回目：ターン終了時の回復。上限クランプなし（未決着のときだけ）
+//   2回目：旧 scene 側の回復。上限は最大ST（最低1）。決着ターンでも生存者にはかかる
 static void apply_st_regen_end_of_turn(BattleCore *b) {
     if (!b) return;
-    for (int i = 0; i < 4; i++) {
+    for (int i = 0; i < b->unit_count; i++) {
         Unit *u = &b->units[i];
         if (!u->alive) continue;
 
-        const CharDef *cd = char_def_get(u->char_id);
+        const CharDef *cd = char_def_get_or_fallback(u->char_id);
         if (!cd) continue;
 
-        u->stats.st += cd->st_regen_per_turn;
-        if (u->stats.st < 0) u->stats.st = 0;
-        // max_st がまだ無いなら上限クランプはしない
+        int st = u->stats.st + cd->st_regen_per_turn;
+        if (st < 0) st = 0;
+        set_st(b, i, st);
+    }
+}
+
+static void apply_st_regen_capped(BattleCore *b) {
+    if (!b) return;
+    for (int i = 0; i < b->unit_count; i++) {
+        Unit *u = &b->units[i];
+        if (!u->alive) continue;
+
+        const CharDef *cd = char_def_get_or_fallback(u->char_id);
+        if (!cd) continue;
+
+        int max_st = b->st_max[i];
+        if (max_st < 1) max_st = 1;
+
+        int st = u->stats.st + cd->st_regen_per_turn;
+        if (st > max_st) st = max_st;
+        if (st < 0) st = 0;
+        set_st(b, i, st);
     }
 }
 
@@ -213,33 +512,36 @@ static const char* resolve_skill_id_for_actor(const BattleCore *b, const Unit *a
     if (!b || !actor) return NULL;
     if (skill_index < 0) return NULL;
 
-    const CharDef *cd = char_def_get(actor->char_id);
+    const CharDef *cd = char_def_get_or_fallback(actor->char_id);
     if (!cd) return NULL;
 
     bool tag = is_tag_learned_for_team(b, actor->team);
     return char_def_get_skill_id_at(cd, tag, skill_index);
 }
 
-static void apply_move_if_any(BattleCore *b, Team t, Slot s, const UnitCmd *uc) {
+static void apply_move_if_any(BattleCore *b, int idx, const UnitCmd *uc) {
     if (!uc->has_move) return;
 
-    int idx = unit_index(t, s);
     Unit *u = &b->units[idx];
     if (!u->alive) return;
 
     int nx = clampi((int)uc->move_to.x, MAP_MIN, MAP_MAX);
     int ny = clampi((int)uc->move_to.y, MAP_MIN, MAP_MAX);
-    u->pos.x = (int8_t)nx;
-    u->pos.y = (int8_t)ny;
+    Pos to = { (int8_t)nx, (int8_t)ny };
+
+    // ステージあり：壁/移動力オーバーは不成立（距離表を1回引くだけ）
+    if (b->stage && !battle_stage_can_move(b->stage, u->pos, to, u->move)) return;
+
+    set_pos(b, idx, to);
 }
 
 // ---------------------------------
 // skill resolve (eventized)
 // ---------------------------------
-static void do_skill(BattleCore *b, Team actor_team, Slot actor_slot, const UnitCmd *uc) {
-    int aidx = unit_index(actor_team, actor_slot);
+static void do_skill(BattleCore *b, int aidx, const UnitCmd *uc) {
     Unit *att = &b->units[aidx];
     if (!att->alive) return;
+    Team actor_team = att->team;
 
     // wait
     if (uc->skill_index < 0) return;
@@ -258,16 +560,14 @@ static void do_skill(BattleCore *b, Team actor_team, Slot actor_slot, const Unit
     //   - 構え成立時にのみ状態付与（演出はここでは出さない）
     // -------------------------
     if (sk->type == SKTYPE_COUNTER) {
-        if (!spend_st_if_possible(att, sk->st_cost)) return;
+        if (!spend_st_if_possible(b, aidx, sk->st_cost)) return;
 
-        b->counter_ready[aidx] = true;
-        b->counter_range[aidx] = sk->range;
-        b->counter_skill_id[aidx] = skill_id;
+        set_counter(b, aidx, true, sk->range, skill_id);
         return;
     }
 
-    // target slot は 0=hero, 1=girl を共通利用
-    Slot ts = (uc->target == 1) ? SLOT_GIRL : SLOT_HERO;
+    // target slot は 0=hero, 1=girl, 2.. を共通利用（範囲外は hero）
+    int ts = (uc->target > 0 && uc->target < b->team_size) ? uc->target : SLOT_HERO;
 
     // -------------------------
     // HEAL：味方を対象
@@ -279,28 +579,28 @@ static void do_skill(BattleCore *b, Team actor_team, Slot actor_slot, const Unit
         int heal = sk->power;
         if (heal < 1) heal = 1;
 
-        if (!spend_st_if_possible(att, sk->st_cost)) return;
+        if (!spend_st_if_possible(b, aidx, sk->st_cost)) return;
 
         if (sk->target == SKT_SINGLE) {
-            int tidx = unit_index(actor_team, ts);
+            int tidx = battle_core_unit_index(b, actor_team, ts);
             Unit *tgt = &b->units[tidx];
             if (!tgt->alive) return;
 
-            if (!in_range_manhattan_units(att, tgt, sk->range)) return;
+            if (!can_reach_units(b, att, tgt, sk->range)) return;
 
             // 成立
             push_anim(b, aidx, tidx, skill_id, (Pos){0,0}, 0);
             push_heal(b, aidx, tidx, heal);
         } else {
-            // 範囲回復：味方全体（hero + girl）
-            int iH = unit_index(actor_team, SLOT_HERO);
-            int iG = unit_index(actor_team, SLOT_GIRL);
+            // 範囲回復：味方全体（slot 順）
+            int i0 = battle_core_unit_index(b, actor_team, 0);
 
             // 成立（演出は1回）
             push_anim(b, aidx, -1, skill_id, (Pos){0,0}, 0);
 
-            if (b->units[iH].alive) push_heal(b, aidx, iH, heal);
-            if (b->units[iG].alive) push_heal(b, aidx, iG, heal);
+            for (int i = i0; i < i0 + b->team_size; i++) {
+                if (b->units[i].alive) push_heal(b, aidx, i, heal);
+            }
         }
         return;
     }
@@ -318,31 +618,31 @@ static void do_skill(BattleCore *b, Team actor_team, Slot actor_slot, const Unit
         Team enemy = (actor_team == TEAM_P1) ? TEAM_P2 : TEAM_P1;
 
         // まずST消費（使った時点）
-        if (!spend_st_if_possible(att, sk->st_cost)) return;
+        if (!spend_st_if_possible(b, aidx, sk->st_cost)) return;
 
         int dmg = calc_atk_plus_power(att, sk->power);
 
         if (sk->target == SKT_SINGLE) {
-            int tidx = unit_index(enemy, ts);
+            int tidx = battle_core_unit_index(b, enemy, ts);
             Unit *tgt = &b->units[tidx];
             if (!tgt->alive) return;
 
             // 射程外：不成立（STは消費済み）
-            if (!in_range_manhattan_units(att, tgt, sk->range)) return;
+            if (!can_reach_units(b, att, tgt, sk->range)) return;
 
             // ---- カウンター判定（対象が構え中なら、こちらの攻撃を無効化） ----
             if (b->counter_ready[tidx]) {
-                // 構えは消費（発動してもしなくても解除）
-                b->counter_ready[tidx] = false;
-
                 const char *cid = b->counter_skill_id[tidx];
                 int cr = b->counter_range[tidx];
 
+                // 構えは消費（発動してもしなくても解除）
+                set_counter(b, tidx, false, 0, NULL);
+
                 // カウンター発動：必ず演出（敵側の演出は出さない）
                 push_anim(b, tidx, aidx, cid ? cid : "counter", (Pos){0,0}, 0);
 
                 // 射程内なら反撃（ダメージ=「本来与えるはずだった dmg」の2倍）
-                if (tgt->alive && att->alive && in_range_manhattan_pos(tgt->pos, att->pos, cr)) {
+                if (tgt->alive && att->alive && can_reach_pos(b, tgt->pos, att->pos, cr)) {
                     int cdmg = dmg * 2;
                     if (cdmg < 1) cdmg = 1;
                     push_damage(b, tidx, aidx, cdmg);
@@ -366,11 +666,12 @@ static void do_skill(BattleCore *b, Team actor_team, Slot actor_slot, const Unit
         // 成立：演出1回
         push_anim(b, aidx, -1, skill_id, c, r);
 
-        // 影響：中心からマンハッタン <= r の全員
-        for (int i = 0; i < 4; i++) {
+        // 影響：中心からマンハッタン <= r の全員（index 順）
+        int hit[BATTLE_UNIT_MAX];
+        int nhit = battle_core_units_in_radius(b, c, r, hit);
+        for (int k = 0; k < nhit; k++) {
+            int i = hit[k];
             Unit *u = &b->units[i];
-            if (!u->alive) continue;
-            if (manhattan(u->pos, c) > r) continue;
 
             if (u->team == enemy) {
                 push_damage(b, aidx, i, dmg);
@@ -386,24 +687,64 @@ static void do_skill(BattleCore *b, Team actor_team, Slot actor_slot, const Unit
     // 未知 type は不発
 }
 
+// Unit.char_id は BattleCore の値コピー後も有効な文字列を指す
+// （CharDef 側の静的文字列。未定義キャラ＝汎用 girl 扱いだけは b 内のバッファを指す）
+static const char* stable_char_id(const char *buf, const char *fallback) {
+    if (!buf[0]) return fallback;
+    const CharDef *cd = char_def_get(buf);
+    return (cd && strcmp(cd->char_id, buf) == 0) ? cd->char_id : buf;
+}
+
 // ---------------------------------
 // public API
 // ---------------------------------
-bool battle_core_init(
-    BattleCore *b,
-    const char *p1_girl_id, bool p1_tag, Stats p1_hero, Stats p1_girl,
-    const char *p2_girl_id, bool p2_tag, Stats p2_hero, Stats p2_girl
-) {
-    if (!b) return false;
+static const UnitCmd k_idle_cmd = {
+    .has_move = false, .move_to = {0,0}, .skill_index = -1, .target = -1, .center = {0,0}
+};
+
+static void init_begin(BattleCore *b, int team_size) {
     memset(b, 0, sizeof(*b));
 
     b->phase = BPHASE_INPUT;
     b->turn = 1;
+    b->team_size = team_size;
+    b->unit_count = team_size * 2;
     b->last_executed_skill_id = NULL;
     b->last_executed_actor_ui = -1;
     b->last_executed_target_ui = -1;
     b->_exec_active = false;
-    b->ev_count = 0;
+}
+
+// units を置いた後：最大HP/ST は「初期値＝最大」として保存し、ハッシュ/バケットを作る
+static void init_finish(BattleCore *b) {
+    b->_has_cmd[TEAM_P1] = false;
+    b->_has_cmd[TEAM_P2] = false;
+
+    for (int i = 0; i < b->unit_count; ++i) {
+        int hp = b->units[i].stats.hp;
+        if (hp < 1) hp = 1;
+        b->hp_max[i] = hp;
+
+        int st = b->units[i].stats.st;
+        if (st < 0) st = 0;
+        b->st_max[i] = st;
+
+        b->counter_ready[i] = false;
+        b->counter_range[i] = 0;
+        b->counter_skill_id[i] = NULL;
+    }
+
+    aoe_rebuild(b);
+    b->hash = battle_core_compute_hash(b);
+}
+
+bool battle_core_init(
+    BattleCore *b,
+    const char *p1_girl_id, bool p1_tag, Stats p1_hero, Stats p1_girl,
+    const char *p2_girl_id, bool p2_tag, Stats p2_hero, Stats p2_girl
+) {
+    if (!b) return false;
+    init_begin(b, 2);
 
     if (p1_girl_id) snprintf(b->p1_girl_id, sizeof(b->p1_girl_id), "%s", p1_girl_id);
     if (p2_girl_id) snprintf(b->p2_girl_id, sizeof(b->p2_girl_id), "%s", p2_girl_id);
@@ -417,7 +758,7 @@ bool battle_core_init(
     };
     b->units[unit_index(TEAM_P1, SLOT_GIRL)] = (Unit){
         .alive=true, .team=TEAM_P1, .slot=SLOT_GIRL,
-        .char_id=(b->p1_girl_id[0] ? b->p1_girl_id : "himari"),
+        .char_id=stable_char_id(b->p1_girl_id, "himari"),
         .pos=(Pos){2,12}, .stats=p1_girl
     };
     b->units[unit_index(TEAM_P2, SLOT_HERO)] = (Unit){
@@ -426,53 +767,170 @@ bool battle_core_init(
     };
     b->units[unit_index(TEAM_P2, SLOT_GIRL)] = (Unit){
         .alive=true, .team=TEAM_P2, .slot=SLOT_GIRL,
-        .char_id=(b->p2_girl_id[0] ? b->p2_girl_id : "kiritan"),
+        .char_id=stable_char_id(b->p2_girl_id, "kiritan"),
         .pos=(Pos){18,12}, .stats=p2_girl
     };
 
-    b->_has_cmd[TEAM_P1] = false;
-    b->_has_cmd[TEAM_P2] = false;
-
-    // 最大HPは「初期HP＝最大」として保存
+    // 移動力の既定値（scene の HERO_MOVE_RANGE / move_range_base 既定と同じ。必要なら呼び出し側で上書き）
     for (int i = 0; i < 4; ++i) {
-        int hp = b->units[i].stats.hp;
-        if (hp < 1) hp = 1;
-        b->hp_max[i] = hp;
+        b->units[i].move = (b->units[i].slot == SLOT_HERO) ? 4 : 3;
+    }
 
-        b->counter_ready[i] = false;
-        b->counter_range[i] = 0;
-        b->counter_skill_id[i] = NULL;
+    init_finish(b);
+    return true;
+}
+
+bool battle_core_init_teams(BattleCore *b, int team_size,
+                            const BattleUnitSpec *p1, bool p1_tag,
+                            const BattleUnitSpec *p2, bool p2_tag) {
+    if (!b || !p1 || !p2) return false;
+    if (team_size < 1 || team_size > BATTLE_TEAM_MAX) return false;
+    init_begin(b, team_size);
+
+    // 従来の girl_id 欄は slot 1 のキャラ（AI の設定キーなどの互換用）
+    if (team_size > 1) {
+        snprintf(b->p1_girl_id, sizeof(b->p1_girl_id), "%s", p1[1].char_id ? p1[1].char_id : "");
+        snprintf(b->p2_girl_id, sizeof(b->p2_girl_id), "%s", p2[1].char_id ? p2[1].char_id : "");
+    }
+    b->p1_tag = p1_tag;
+    b->p2_tag = p2_tag;
+
+    for (int t = 0; t < 2; t++) {
+        const BattleUnitSpec *sp = (t == TEAM_P1) ? p1 : p2;
+        for (int s = 0; s < team_size; s++) {
+            // 1列 8 人。2列目は端の側へ（2v2 は従来の (2,10)(2,12) / (18,10)(18,12)）
+            int col = s / 8, row = s % 8;
+            int rows = team_size - col * 8;
+            if (rows > 8) rows = 8;
+            int x = 2 - col * 2;
+            int y = 11 + row * 2 - (rows - 1);
+            if (t == TEAM_P2) x = MAP_MAX - x;
+
+            const CharDef *cd = char_def_get(sp[s].char_id);
+            b->units[battle_core_unit_index(b, (Team)t, s)] = (Unit){
+                .alive=true, .team=(Team)t, .slot=(Slot)s,
+                .char_id=cd ? cd->char_id : CHAR_DEF_FALLBACK_ID,
+                .pos=(Pos){ (int8_t)x, (int8_t)y }, .stats=sp[s].stats,
+                .move=(sp[s].move > 0) ? sp[s].move : ((s == SLOT_HERO) ? 4 : 3)
+            };
+        }
     }
 
+    init_finish(b);
     return true;
 }
 
 void battle_core_submit_cmd(BattleCore *b, Team team, const TurnCmd *cmd) {
     if (!b || !cmd) return;
-    b->_pending_cmd[(int)team] = *cmd;
+    int i0 = battle_core_unit_index(b, team, 0);
+    for (int s = 0; s < b->team_size; s++) {
+        set_pending_cmd(b, i0 + s, (s < 2) ? &cmd->cmd[s] : &k_idle_cmd);
+    }
+    b->_has_cmd[(int)team] = true;
+}
+
+void battle_core_submit_unit_cmds(BattleCore *b, Team team, const UnitCmd *cmds) {
+    if (!b || !cmds) return;
+    int i0 = battle_core_unit_index(b, team, 0);
+    for (int s = 0; s < b->team_size; s++) set_pending_cmd(b, i0 + s, &cmds[s]);
     b->_has_cmd[(int)team] = true;
 }
 
-void battle_core_build_action_order(const BattleCore *b, int out_idx[4], int *out_n) {
-    int tmp[4], n = 0;
-    for (int i = 0; i < 4; i++) if (b->units[i].alive) tmp[n++] = i;
+// ---------------------------------
+// 行動順
+// ---------------------------------
+// SPD 降順・同値は index 昇順を1つのキーに（大きいほど先）
+static int64_t order_key(const BattleCore *b, int ui) {
+    return ((int64_t)b->units[ui].stats.spd << 8) | (int64_t)(255 - ui);
+}
+
+// 4人以下：ソーティングネットワーク（5回の比較交換。足りない分は最小キーで埋める）
+static void order_network4(const BattleCore *b, const int *alive, int n, int *out) {
+    int64_t k[4];
+    for (int i = 0; i < 4; i++) k[i] = (i < n) ? order_key(b, alive[i]) : INT64_MIN;
 
-    // SPD降順、同値は index 昇順
+    static const int pairs[5][2] = { {0,1}, {2,3}, {0,2}, {1,3}, {1,2} };
+    for (int p = 0; p < 5; p++) {
+        int64_t x = k[pairs[p][0]], y = k[pairs[p][1]];
+        k[pairs[p][0]] = (x > y) ? x : y;
+        k[pairs[p][1]] = (x > y) ? y : x;
+    }
+    for (int i = 0; i < n; i++) out[i] = 255 - (int)(k[i] & 0xFF);
+}
+
+// 5人以上：(最大SPD - SPD) を 4bit ずつの LSD 基数ソート（安定なので同値は入力の index 昇順のまま）
+//   パス数は SPD の幅で決まる（幅 16 未満なら1回、256 未満なら2回）
+static void order_radix(const BattleCore *b, const int *alive, int n, int *out) {
+    int mx = INT_MIN, mn = INT_MAX;
     for (int i = 0; i < n; i++) {
-        for (int j = i + 1; j < n; j++) {
-            int a = tmp[i], c = tmp[j];
-            int sa = b->units[a].stats.spd;
-            int sc = b->units[c].stats.spd;
-            if (sc > sa || (sc == sa && c < a)) {
-                int t = tmp[i]; tmp[i] = tmp[j]; tmp[j] = t;
-            }
+        int v = b->units[alive[i]].stats.spd;
+        if (v > mx) mx = v;
+        if (v < mn) mn = v;
+    }
+    uint32_t range = (uint32_t)((int64_t)mx - mn);
+
+    uint32_t key_a[BATTLE_UNIT_MAX], key_b[BATTLE_UNIT_MAX];
+    int idx_b[BATTLE_UNIT_MAX];
+    uint32_t *key = key_a, *tkey = key_b;
+    int *idx = out, *tidx = idx_b;
+    for (int i = 0; i < n; i++) {
+        key[i] = (uint32_t)((int64_t)mx - b->units[alive[i]].stats.spd);
+        idx[i] = alive[i];
+    }
+
+    for (int shift = 0; ; shift += 4) {
+        int cnt[17] = { 0 };
+        for (int i = 0; i < n; i++) cnt[((key[i] >> shift) & 15u) + 1]++;
+        for (int d = 1; d <= 16; d++) cnt[d] += cnt[d - 1];
+        for (int i = 0; i < n; i++) {
+            int at = cnt[(key[i] >> shift) & 15u]++;
+            tkey[at] = key[i];
+            tidx[at] = idx[i];
         }
+        uint32_t *sk = key; key = tkey; tkey = sk;
+        int *si = idx; idx = tidx; tidx = si;
+        if ((range >> shift) < 16u) break;
     }
+    if (idx != out) memcpy(out, idx, sizeof(int) * (size_t)n);
+}
+
+void battle_core_build_action_order(const BattleCore *b, int out_idx[BATTLE_UNIT_MAX], int *out_n) {
+    int alive[BATTLE_UNIT_MAX], n = 0;
+    for (int i = 0; i < b->unit_count; i++) if (b->units[i].alive) alive[n++] = i;
 
-    for (int i = 0; i < n; i++) out_idx[i] = tmp[i];
+    if (n <= 4) order_network4(b, alive, n, out_idx);
+    else order_radix(b, alive, n, out_idx);
     *out_n = n;
 }
 
+int battle_core_units_in_radius(const BattleCore *b, Pos c, int r, int out_idx[BATTLE_UNIT_MAX]) {
+    if (!b || !out_idx || r < 0) return 0;
+    int n = 0;
+
+    if (!aoe_use_bucket(b)) {
+        for (int i = 0; i < b->unit_count; i++) {
+            const Unit *u = &b->units[i];
+            if (u->alive && manhattan(u->pos, c) <= r) out_idx[n++] = i;
+        }
+        return n;
+    }
+
+    // 菱形を囲む矩形にかかる区画の bit 集合を OR して、候補だけ距離を見る
+    int x0 = aoe_bucket_axis((int)c.x - r, BATTLE_AOE_BW), x1 = aoe_bucket_axis((int)c.x + r, BATTLE_AOE_BW);
+    int y0 = aoe_bucket_axis((int)c.y - r, BATTLE_AOE_BH), y1 = aoe_bucket_axis((int)c.y + r, BATTLE_AOE_BH);
+    uint32_t cand = 0;
+    for (int by = y0; by <= y1; by++) {
+        for (int bx = x0; bx <= x1; bx++) cand |= b->aoe_bucket[by * BATTLE_AOE_BW + bx];
+    }
+    while (cand) {
+        int i = __builtin_ctz(cand);
+        cand &= cand - 1;
+        const Unit *u = &b->units[i];
+        if (u->alive && manhattan(u->pos, c) <= r) out_idx[n++] = i;
+    }
+    return n;
+}
+
 // --- 段階実行 ---
 bool battle_core_begin_exec(BattleCore *b) {
     if (!b) return false;
@@ -485,15 +943,27 @@ bool battle_core_begin_exec(BattleCore *b) {
     b->last_executed_actor_ui = -1;
     b->last_executed_target_ui = -1;
     b->_exec_active = true;
-    battle_core_clear_events(b);
+    stream_reset(&b->ev);
+    if (aoe_use_bucket(b)) aoe_rebuild(b);
     return true;
 }
 
+void battle_core_exec_move_for_unit(BattleCore *b, int ui) {
+    if (!b) return;
+    if (!b->_exec_active) return;
+    if (ui < 0 || ui >= b->unit_count) return;
+
+    // 決着後に残ったユニットも移動だけはする（scene の演出と同じ）
+    //   ※旧 scene は移動先をそのまま置いていた。TurnCmd は battle_cmd_validate 済みで盤内なので、
+    //     ここのクランプで結果は変わらない
+    apply_move_if_any(b, ui, &b->_pending_cmd[ui]);
+}
+
 void battle_core_exec_act_for_unit(BattleCore *b, int ui) {
     if (!b) return;
     if (!b->_exec_active) return;
     if (b->phase != BPHASE_RESOLVE) return;
-    if (ui < 0 || ui >= 4) return;
+    if (ui < 0 || ui >= b->unit_count) return;
 
     Unit *u = &b->units[ui];
     if (!u->alive) {
@@ -505,11 +975,10 @@ void battle_core_exec_act_for_unit(BattleCore *b, int ui) {
     battle_core_clear_events(b);
 
     // 座標を盤面にクランプ（scene側保険）
-    u->pos.x = (int8_t)clampi((int)u->pos.x, MAP_MIN, MAP_MAX);
-    u->pos.y = (int8_t)clampi((int)u->pos.y, MAP_MIN, MAP_MAX);
+    set_pos(b, ui, (Pos){ (int8_t)clampi((int)u->pos.x, MAP_MIN, MAP_MAX),
+                          (int8_t)clampi((int)u->pos.y, MAP_MIN, MAP_MAX) });
 
-    const UnitCmd *uc = &b->_pending_cmd[(int)u->team].cmd[(int)u->slot];
-    do_skill(b, u->team, u->slot, uc);
+    do_skill(b, ui, &b->_pending_cmd[ui]);
 
     // HP反映は scene 側が battle_core_apply_events() を呼ぶタイミングで行う
 }
@@ -525,15 +994,224 @@ void battle_core_end_exec(BattleCore *b) {
 
     if (team_all_dead(b, TEAM_P1) || team_all_dead(b, TEAM_P2)) {
         b->phase = BPHASE_END;
+        apply_st_regen_capped(b);
         return;
     }
 
     apply_st_regen_end_of_turn(b);
+    apply_st_regen_capped(b);
 
     b->phase = BPHASE_INPUT;
     b->turn += 1;
 }
 
+// --- ヘッドレス1ターン ---
+// scene の exec_update と同じ並び（SPD順に 移動→行動→効果適用）で1ターン解決する
+static bool run_submitted_turn(BattleCore *b) {
+    if (!battle_core_begin_exec(b)) return false;
+
+    int order[BATTLE_UNIT_MAX], n = 0;
+    battle_core_build_action_order(b, order, &n);
+
+    for (int k = 0; k < n; k++) {
+        int ui = order[k];
+        Unit *u = &b->units[ui];
+        if (!u->alive) continue;
+
+        battle_core_exec_move_for_unit(b, ui);
+        battle_core_exec_act_for_unit(b, ui);
+        battle_core_apply_events(b);
+    }
+
+    battle_core_end_exec(b);
+    return true;
+}
+
+bool battle_core_run_turn(BattleCore *b, const TurnCmd *p1, const TurnCmd *p2) {
+    if (!b || !p1 || !p2) return false;
+
+    battle_core_submit_cmd(b, TEAM_P1, p1);
+    battle_core_submit_cmd(b, TEAM_P2, p2);
+    return run_submitted_turn(b);
+}
+
+bool battle_core_run_turn_units(BattleCore *b, const UnitCmd *p1, const UnitCmd *p2) {
+    if (!b || !p1 || !p2) return false;
+
+    battle_core_submit_unit_cmds(b, TEAM_P1, p1);
+    battle_core_submit_unit_cmds(b, TEAM_P2, p2);
+    return run_submitted_turn(b);
+}
+
+// --- 作戦プレビュー ---
+bool battle_core_preview(const BattleCore *b, Team team, const TurnCmd *cmd,
+                         const TurnCmd *assumed_enemy_cmd, BattlePreview *out) {
+    if (!out) return false;
+    memset(out, 0, sizeof(*out));
+    for (int i = 0; i < BATTLE_UNIT_MAX; i++) out->countered_by[i] = -1;
+    if (!b || !cmd) return false;
+    if (b->phase != BPHASE_INPUT || b->_exec_active) return false;
+
+    TurnCmd idle;
+    for (int s = 0; s < 2; s++) idle.cmd[s] = k_idle_cmd;
+    const TurnCmd *enemy = assumed_enemy_cmd ? assumed_enemy_cmd : &idle;
+
+    BattleCore s;
+    battle_core_copy(&s, b);
+    battle_core_submit_cmd(&s, TEAM_P1, (team == TEAM_P1) ? cmd : enemy);
+    battle_core_submit_cmd(&s, TEAM_P2, (team == TEAM_P1) ? enemy : cmd);
+    if (!battle_core_begin_exec(&s)) {
+        battle_core_free(&s);
+        return false;
+    }
+
+    int order[BATTLE_UNIT_MAX], n = 0;
+    battle_core_build_action_order(&s, order, &n);
+
+    for (int k = 0; k < n; k++) {
+        int ui = order[k];
+        if (!s.units[ui].alive) continue;
+
+        battle_core_exec_move_for_unit(&s, ui);
+        battle_core_exec_act_for_unit(&s, ui);
+
+        // 行動中でないユニットの演出 = カウンター（target は止められた攻撃者）
+        for (int i = s.ev.act_begin; i < s.ev.count; i++) {
+            const BattleEvent *ev = stream_at(&s.ev, i);
+            if (ev->type != BEV_ANIM_SKILL || ev->actor_ui == ui) continue;
+            if (ev->target_ui >= 0 && ev->target_ui < s.unit_count) out->countered_by[ev->target_ui] = ev->actor_ui;
+            out->counter_count++;
+        }
+        battle_core_apply_events(&s);
+    }
+    battle_core_end_exec(&s);
+
+    for (int i = 0; i < b->unit_count; i++) {
+        out->hp_delta[i] = s.units[i].stats.hp - b->units[i].stats.hp;
+        out->st_delta[i] = s.units[i].stats.st - b->units[i].stats.st;
+        out->killed[i] = b->units[i].alive && !s.units[i].alive;
+    }
+    out->ends = (s.phase == BPHASE_END);
+
+    battle_core_free(&s);
+    return true;
+}
+
+// --- 局面ハッシュ ---
+void battle_core_set_unit_pos(BattleCore *b, int ui, Pos p) {
+    if (!b) return;
+    if (ui < 0 || ui >= b->unit_count) return;
+    set_pos(b, ui, p);
+}
+
+uint64_t battle_core_compute_hash(const BattleCore *b) {
+    if (!b) return 0;
+
+    uint64_t h = 0;
+    for (int i = 0; i < b->unit_count; i++) {
+        const Unit *u = &b->units[i];
+        h ^= battle_hash_pos_key(i, u->pos);
+        h ^= battle_hash_key(BHK_HP, i, u->stats.hp);
+        h ^= battle_hash_key(BHK_ST, i, u->stats.st);
+        if (!u->alive) h ^= battle_hash_key(BHK_ALIVE, i, 1);
+        if (b->counter_ready[i]) h ^= battle_hash_key(BHK_COUNTER, i, b->counter_range[i]);
+    }
+    return h;
+}
+
+void battle_core_refresh_hash(BattleCore *b) {
+    if (!b) return;
+    aoe_rebuild(b);
+    b->hash = battle_core_compute_hash(b);
+}
+
+// --- 変更の記録 / 巻き戻し ---
+void battle_journal_free(BattleJournal *j) {
+    if (!j) return;
+    free(j->e);
+    memset(j, 0, sizeof(*j));
+}
+
+void battle_core_journal_attach(BattleCore *b, BattleJournal *j) {
+    if (!b) return;
+    b->journal = j;
+    b->journal_owner = j ? b : NULL;
+    if (j) {
+        j->count = 0;
+        j->overflow = false;
+    }
+}
+
+int battle_core_journal_mark(BattleCore *b) {
+    if (!b || !jr_on(b)) return -1;
+    int mark = b->journal->count;
+
+    // 戻すときは後ろから読むので MARK_HASH → MARK_LAST → MARK の順に積む
+    BattleJournalEntry *e = jr_push(b, BJ_MARK_HASH, 0);
+    if (e) e->u.hash = b->hash;
+    e = jr_push(b, BJ_MARK_LAST, 0);
+    if (e) {
+        e->s = (int16_t)b->last_executed_actor_ui;
+        e->v = b->last_executed_target_ui;
+        e->u.p = b->last_executed_skill_id;
+    }
+    e = jr_push(b, BJ_MARK, (b->_has_cmd[TEAM_P1] ? 1 : 0) | (b->_has_cmd[TEAM_P2] ? 2 : 0)
+                          | (b->_exec_active ? 4 : 0));
+    if (e) {
+        e->s = (int16_t)b->phase;
+        e->v = b->turn;
+    }
+    return mark;
+}
+
+bool battle_core_undo_to(BattleCore *b, int mark) {
+    if (!b || !jr_on(b)) return false;
+    BattleJournal *j = b->journal;
+    if (j->overflow || mark < 0 || mark + 3 > j->count || j->e[mark].kind != BJ_MARK_HASH) return false;
+
+    // 値を置くだけ（hash は最後に印の値へ。AOE バケットは使っていれば作り直す）
+    bool moved = false;
+    while (j->count > mark) {
+        const BattleJournalEntry *e = &j->e[--j->count];
+        int ui = e->ui;
+        switch (e->kind) {
+        case BJ_POS:
+            b->units[ui].pos = (Pos){ (int8_t)e->s, (int8_t)e->v };
+            moved = true;
+            break;
+        case BJ_HP:      b->units[ui].stats.hp = e->v; break;
+        case BJ_ST:      b->units[ui].stats.st = e->v; break;
+        case BJ_ALIVE:   b->units[ui].alive = (e->v != 0); break;
+        case BJ_COUNTER:
+            b->counter_ready[ui] = (e->s != 0);
+            b->counter_range[ui] = e->v;
+            b->counter_skill_id[ui] = (const char*)e->u.p;
+            break;
+        case BJ_HP_MAX:  b->hp_max[ui] = e->v; break;
+        case BJ_CMD:     b->_pending_cmd[ui] = e->u.cmd; break;
+        case BJ_MARK:
+            b->_has_cmd[TEAM_P1] = (ui & 1) != 0;
+            b->_has_cmd[TEAM_P2] = (ui & 2) != 0;
+            b->_exec_active = (ui & 4) != 0;
+            b->phase = (BattlePhase)e->s;
+            b->turn = e->v;
+            break;
+        case BJ_MARK_LAST:
+            b->last_executed_actor_ui = e->s;
+            b->last_executed_target_ui = e->v;
+            b->last_executed_skill_id = (const char*)e->u.p;
+            break;
+        case BJ_MARK_HASH:
+            b->hash = e->u.hash;
+            break;
+        default:
+            break;
+        }
+    }
+    if (moved && aoe_use_bucket(b)) aoe_rebuild(b);
+    return true;
+}
+
 // --- 旧：一括step（互換のため残す）---
 // ※ event化したので、旧stepは「即時適用」モードとして実装する
 bool battle_core_step(BattleCore *b) {
@@ -546,15 +1224,14 @@ bool battle_core_step(BattleCore *b) {
     b->last_executed_skill_id = NULL;
     b->last_executed_actor_ui = -1;
     b->last_executed_target_ui = -1;
+    stream_reset(&b->ev);
+    if (aoe_use_bucket(b)) aoe_rebuild(b);
 
-    // 1) move
-    apply_move_if_any(b, TEAM_P1, SLOT_HERO, &b->_pending_cmd[TEAM_P1].cmd[SLOT_HERO]);
-    apply_move_if_any(b, TEAM_P1, SLOT_GIRL, &b->_pending_cmd[TEAM_P1].cmd[SLOT_GIRL]);
-    apply_move_if_any(b, TEAM_P2, SLOT_HERO, &b->_pending_cmd[TEAM_P2].cmd[SLOT_HERO]);
-    apply_move_if_any(b, TEAM_P2, SLOT_GIRL, &b->_pending_cmd[TEAM_P2].cmd[SLOT_GIRL]);
+    // 1) move（index 順 = P1 の slot 順 → P2 の slot 順）
+    for (int i = 0; i < b->unit_count; i++) apply_move_if_any(b, i, &b->_pending_cmd[i]);
 
     // 2) actions
-    int order[4], n = 0;
+    int order[BATTLE_UNIT_MAX], n = 0;
     battle_core_build_action_order(b, order, &n);
 
     for (int k = 0; k < n; k++) {
@@ -562,11 +1239,9 @@ bool battle_core_step(BattleCore *b) {
         Unit *u = &b->units[uidx];
         if (!u->alive) continue;
 
-        const UnitCmd *uc = &b->_pending_cmd[(int)u->team].cmd[(int)u->slot];
-
         // exec + apply immediately
         battle_core_clear_events(b);
-        do_skill(b, u->team, u->slot, uc);
+        do_skill(b, uidx, &b->_pending_cmd[uidx]);
         battle_core_apply_events(b);
 
         if (b->phase == BPHASE_END) break;
@@ -576,9 +1251,13 @@ bool battle_core_step(BattleCore *b) {
     b->_has_cmd[TEAM_P1] = false;
     b->_has_cmd[TEAM_P2] = false;
 
-    if (b->phase == BPHASE_END) return true;
+    if (b->phase == BPHASE_END) {
+        apply_st_regen_capped(b);
+        return true;
+    }
 
     apply_st_regen_end_of_turn(b);
+    apply_st_regen_capped(b);
     b->phase = BPHASE_INPUT;
     b->turn += 1;
     return true;
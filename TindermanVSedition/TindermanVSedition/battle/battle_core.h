@@ -5,6 +5,7 @@
 
 #include "battle_types.h"
 #include "battle_cmd.h"
+#include "battle_stage.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -46,15 +47,95 @@ typedef struct {
 
     // ANIM_SKILL の識別子（skill_id）。EFFECT_* は基本NULLでOK
     const char *skill_id;
+
+    // ストリーム上の通し番号（対戦内で単調増加）と発生ターン
+    uint32_t seq;
+    int turn;
 } BattleEvent;
 
-#define BATTLE_EVENT_MAX 32
+// ===============================
+//  イベントストリーム
+//   - 1ターン分（begin_exec 〜 次の begin_exec）のイベントを件数無制限で保持
+//   - 先頭 BATTLE_EVENT_INLINE 件は構造体内、溢れた分はヒープ
+//     （ヒープは伸ばすだけで縮めない → 定常状態ではメモリ確保なし）
+//   - ヒープは確保した BattleCore が所有する（アドレスで見分ける）。代入/memcpy で写すとヒープを共有してしまい、
+//     元が free/再確保した時点で写した側は解放済みを指す → 局面を写すときは battle_core_copy()、
+//     移すときは battle_core_move() を使う（どちらも使い終わったら battle_core_free()）
+//   - 代入/memcpy は、比べるだけで進めも解放もしないバイト列の写し（検証用のスナップショット等）に限る
+// ===============================
+#define BATTLE_EVENT_INLINE 24
+
+typedef struct {
+    BattleEvent inline_ev[BATTLE_EVENT_INLINE];
+    BattleEvent *heap;          // inline に入りきらない分（index - BATTLE_EVENT_INLINE）
+    int heap_cap;
+    const void *heap_owner;     // heap を確保した BattleCore（代入で写した側を見分ける）
+
+    uint32_t base_seq;          // 保持中の先頭イベントの seq
+    int count;                  // 保持中の件数
+    int act_begin;              // 直近アクションの先頭（従来の event_count/get_event の窓）
+} BattleEventStream;
+
+// consumer ごとの読み出し位置（{0} で「保持中の先頭から」）
+typedef struct {
+    uint32_t seq;
+    uint32_t lost;              // 読む前にターンが進んで捨てられた件数
+} BattleEventCursor;
+
+// ===============================
+//  変更の記録（巻き戻し用。リプレイのシーク/逆再生・手戻し向け）
+//   - battle_core_journal_attach した BattleCore は、位置/HP/ST/生存/構え/最大HP/命令 を書き換えるたびに
+//     元の値を1件 16byte で積む。battle_core_undo_to は積んだ分を逆順に書き戻すだけ
+//     → 何ターンも戻るときにターンごとの丸ごとスナップショットを持たなくてよい（メモリが小さい）
+//   - 1ターン進めて戻すだけ（AI探索の戻り）なら記録の手間の方が高くつく → 探索は battle_core_copy() を使う
+//   - フェーズ/ターン/命令済みフラグ/直近の技/局面ハッシュ は印（mark）に持たせて、戻すときに印の時点の値にする
+//     （書き戻しは値を置くだけ。ハッシュは差分で戻さず印の値をそのまま使う）
+//   - イベントストリームは戻さない（戻した後のイベントは次の begin_exec から読む）
+//   - battle_core_copy() の写しは記録しない（付けた本人だけ。preview/探索のコピーが混ざらない）
+//   - init は構造体を丸ごと初期化するので、付けるのは init の後
+// ===============================
+typedef struct {
+    uint8_t kind;           // 何を戻すか（battle_core.c の BJ_*）
+    uint8_t ui;
+    int16_t s;
+    int32_t v;
+    union {
+        const void *p;      // 構えの技id / 直近の技id
+        UnitCmd cmd;        // 上書きされた命令
+        uint64_t hash;      // 印の時点の局面ハッシュ
+    } u;
+} BattleJournalEntry;
+
+typedef struct {
+    BattleJournalEntry *e;
+    int count;
+    int cap;
+    bool overflow;          // 確保に失敗した（以後の undo_to は false）
+} BattleJournal;
+
+// ===============================
+//  人数
+//   - team_size 人ずつの 2 チーム。units[0..team_size-1] が P1、続く team_size 人が P2
+//     （2v2 は従来どおり 0=P1 hero, 1=P1 girl, 2=P2 hero, 3=P2 girl）
+//   - 2v2 以外は battle_core_init_teams で作り、命令は battle_core_submit_unit_cmds で出す
+//     TurnCmd（2人分）を渡した場合は 3人目以降は待機
+//   - AI / 脅威マップ / バッチ / リプレイ / 通信は 2v2 のみ
+// ===============================
+// AOE の対象探しでバケットを使う人数（これ以下は全員を順に見る方が速い）
+#define BATTLE_AOE_SCAN_MAX 8
+// バケット：盤面を 4x4 マスずつに区切り、各区画にいるユニットを bit 集合で持つ
+#define BATTLE_AOE_CELL 4
+#define BATTLE_AOE_BW ((MAP_W + BATTLE_AOE_CELL - 1) / BATTLE_AOE_CELL)
+#define BATTLE_AOE_BH ((MAP_H + BATTLE_AOE_CELL - 1) / BATTLE_AOE_CELL)
 
 typedef struct {
     BattlePhase phase;
     int turn;
-    Unit units[4];
-    int  hp_max[4];      // 最大HP（初期値を最大として保持）
+    int team_size;       // 1チームの人数（2=2v2）
+    int unit_count;      // team_size * 2
+    Unit units[BATTLE_UNIT_MAX];
+    int  hp_max[BATTLE_UNIT_MAX];      // 最大HP（初期値を最大として保持）
+    int  st_max[BATTLE_UNIT_MAX];      // 最大ST（同上。ターン終了時の2回目のST回復の上限）
 
     // （互換）scene側が参照しているなら維持
     const char *last_executed_skill_id;
@@ -62,7 +143,7 @@ typedef struct {
     int last_executed_target_ui;
 
 
-    TurnCmd _pending_cmd[2];
+    UnitCmd _pending_cmd[BATTLE_UNIT_MAX];   // unit index ごと
     bool    _has_cmd[2];
 
     char p1_girl_id[32];
@@ -74,38 +155,146 @@ typedef struct {
     bool _exec_active;
 
     // --- カウンター状態（Unitを汚さない） ---
-    bool        counter_ready[4];     // 構え中か
-    int         counter_range[4];     // 反撃射程（マンハッタン）
-    const char *counter_skill_id[4];  // 反撃時に流す演出（skill_id）
+    bool        counter_ready[BATTLE_UNIT_MAX];     // 構え中か
+    int         counter_range[BATTLE_UNIT_MAX];     // 反撃射程（マンハッタン）
+    const char *counter_skill_id[BATTLE_UNIT_MAX];  // 反撃時に流す演出（skill_id）
+
+    // --- イベントストリーム（今ターン分） ---
+    BattleEventStream ev;
+
+    // --- 局面ハッシュ（battle_hash.h 参照。位置/HP/ST/生存/構えの変更時に差分更新） ---
+    uint64_t hash;
 
-    // --- 新：イベントキュー（直近の1アクション分） ---
-    BattleEvent events[BATTLE_EVENT_MAX];
-    int ev_count;
+    // --- 乱数キー（battle_rng.h。対戦中は不変なので hash には含めない） ---
+    //   init で 0。対戦開始時に battle_replay_match_seed() の値を入れる
+    //   乱数を使う処理は battle_rng_*(rng_seed, turn, ui, 用途, n) で引く（状態を持たない）
+    uint64_t rng_seed;
+
+    // --- 地形（battle_stage.h。対戦中は不変なので hash には含めない） ---
+    //   init で NULL（何もない盤面＝従来どおり移動はクランプだけ・見通し常に可）
+    //   ステージありなら 移動は「壁を避けて移動力以内で行けるマス」だけ成立（不成立はその場に留まる）、
+    //   単体技（回復/攻撃/反撃）は射程に加えて見通しが要る。AOE は見通し不要
+    const BattleStage *stage;
+
+    // --- AOE 用バケット（unit_count > BATTLE_AOE_SCAN_MAX のときだけ使う） ---
+    //   位置の変更で差分更新。units を直接書き換えたら battle_core_refresh_hash で作り直す
+    uint32_t aoe_bucket[BATTLE_AOE_BW * BATTLE_AOE_BH];
+
+    // --- 変更の記録（NULL=記録しない。journal_owner と一致するときだけ積む） ---
+    BattleJournal *journal;
+    const void *journal_owner;
 } BattleCore;
 
+// 人数可変の対戦の1人分
+typedef struct {
+    const char *char_id;    // 未定義のキャラは汎用 girl 扱い
+    Stats stats;
+    int move;               // 0 なら既定（hero=4 / それ以外=3）
+} BattleUnitSpec;
+
+static inline int battle_core_unit_index(const BattleCore *b, Team t, int slot) {
+    return (int)t * b->team_size + slot;
+}
+
 bool battle_core_init(
     BattleCore *b,
     const char *p1_girl_id, bool p1_tag, Stats p1_hero, Stats p1_girl,
     const char *p2_girl_id, bool p2_tag, Stats p2_hero, Stats p2_girl
 );
 
+// team_size 人ずつ（1..BATTLE_TEAM_MAX）。p1/p2 は team_size 人分
+//   初期配置は P1 が左端寄り、P2 が右端寄りの縦列（1列 8 人まで。溢れたら外側にもう1列）
+//   ステージの床保証は 2v2 の初期配置だけ（他の人数でステージを使うなら呼ぶ側で確かめる）
+bool battle_core_init_teams(BattleCore *b, int team_size,
+                            const BattleUnitSpec *p1, bool p1_tag,
+                            const BattleUnitSpec *p2, bool p2_tag);
+
+// イベントストリームの溢れ用ヒープを解放
+//   - init は構造体を丸ごと初期化するので、使い回す前にも呼ぶ
+//   - 自分で確保していないヒープ（所有者が別）には触らない
+void battle_core_free(BattleCore *b);
+
+// src を dst へ写す（溢れ分のイベントも dst 用に確保して写す。記録（journal）は引き継がない）
+//   dst は未使用か battle_core_free 済みであること。src はそのまま使える
+void battle_core_copy(BattleCore *dst, const BattleCore *src);
+
+// src を dst へ移す（ヒープの所有も dst へ。src は init し直すまで使わない）
+//   dst に持っていたヒープは先に battle_core_free() しておく
+void battle_core_move(BattleCore *dst, BattleCore *src);
+
 void battle_core_submit_cmd(BattleCore *b, Team team, const TurnCmd *cmd);
+// team の team_size 人分（cmds[slot]）。単体技の target は味方/敵の slot 番号
+void battle_core_submit_unit_cmds(BattleCore *b, Team team, const UnitCmd *cmds);
 
 // 互換のため残す（旧：一括確定）
 bool battle_core_step(BattleCore *b);
 
 // --- 段階実行API ---
 bool battle_core_begin_exec(BattleCore *b);
+// ui の移動命令を反映（scene は移動演出が終わった時点で呼ぶ。命令なし/死亡なら何もしない）
+void battle_core_exec_move_for_unit(BattleCore *b, int ui);
 void battle_core_exec_act_for_unit(BattleCore *b, int ui);
 void battle_core_end_exec(BattleCore *b);
 
-void battle_core_build_action_order(const BattleCore *b, int out_idx[4], int *out_n);
+// 生存ユニットを SPD 降順（同値は index 昇順）に並べる
+//   4人以下はソーティングネットワーク、それより多いと SPD の安定基数ソート
+void battle_core_build_action_order(const BattleCore *b, int out_idx[BATTLE_UNIT_MAX], int *out_n);
+
+// 生存していて c からマンハッタン r 以内のユニット（index 昇順）。戻り値=件数
+//   AOE の解決と同じ探し方（人数が多いとバケットを引く）
+int battle_core_units_in_radius(const BattleCore *b, Pos c, int r, int out_idx[BATTLE_UNIT_MAX]);
+
+// --- ヘッドレス1ターン実行（scene と同じ順序：SPD順に 移動→行動→効果適用） ---
+// AI探索/シミュレータ用。戻り値は begin_exec できたかどうか
+bool battle_core_run_turn(BattleCore *b, const TurnCmd *p1, const TurnCmd *p2);
+// 人数可変版（p1/p2 は team_size 人分）
+bool battle_core_run_turn_units(BattleCore *b, const UnitCmd *p1, const UnitCmd *p2);
+
+// --- 作戦プレビュー ---
+// team が cmd、相手が assumed_enemy_cmd（NULL なら全員その場で待機）を出したときの1ターン後を予測する
+//   - b の写し（battle_core_copy）上で battle_core_run_turn と同じ順序で解決する（b もイベントストリームも触らない）
+//   - 1ターンのイベントは inline に収まるのでメモリ確保なし（作戦UIでカーソルが動くたびに呼んでよい）
+typedef struct {
+    int  hp_delta[BATTLE_UNIT_MAX];       // ターン後 - 現在
+    int  st_delta[BATTLE_UNIT_MAX];       // 同上（ターン終了時の回復込み）
+    bool killed[BATTLE_UNIT_MAX];         // このターンで倒れる
+    int  countered_by[BATTLE_UNIT_MAX];   // ui の単体攻撃を構えで止めたユニット（-1=なし）
+    int  counter_count;     // カウンター発動回数
+    bool ends;              // このターンで決着
+} BattlePreview;
+
+bool battle_core_preview(const BattleCore *b, Team team, const TurnCmd *cmd,
+                         const TurnCmd *assumed_enemy_cmd, BattlePreview *out);
+
+// --- 局面ハッシュ ---
+// 位置はこのAPI経由で書き換える（ハッシュを差分更新する）
+void battle_core_set_unit_pos(BattleCore *b, int ui, Pos p);
+// 全項目から計算し直した値（検証用）
+uint64_t battle_core_compute_hash(const BattleCore *b);
+// units を直接書き換えた後に呼ぶ（hash と AOE バケットを作り直して合わせる）
+void battle_core_refresh_hash(BattleCore *b);
+
+// --- 変更の記録 / 巻き戻し ---
+void battle_journal_free(BattleJournal *j);
 
-// --- 新：イベントAPI ---
+// j を b 専用の記録として付ける（中身は空にする）。NULL で外す
+void battle_core_journal_attach(BattleCore *b, BattleJournal *j);
+// 今の時点の印（記録が付いていなければ -1）。印は入れ子にしてよい
+int  battle_core_journal_mark(BattleCore *b);
+// 印を付けた時点の局面に戻す（印より後の記録は捨てる）。戻せなければ false
+bool battle_core_undo_to(BattleCore *b, int mark);
+
+// --- 新：イベントAPI（直近1アクション分の窓） ---
 void battle_core_clear_events(BattleCore *b);
 int  battle_core_event_count(const BattleCore *b);
 const BattleEvent* battle_core_get_event(const BattleCore *b, int idx);
 
+// --- イベントストリーム（カーソル読み出し。コピーなし・consumerごとに独立） ---
+// 次のイベントを返す（無ければNULL）。返したポインタは次のイベント発行まで有効
+const BattleEvent* battle_core_next_event(const BattleCore *b, BattleEventCursor *cur);
+// 「今から後に出るイベントだけ」を読むカーソル
+BattleEventCursor battle_core_event_cursor_now(const BattleCore *b);
+
 // イベントの効果を反映（ANIM_SKILLは何もしない）
 void battle_core_apply_event(BattleCore *b, const BattleEvent *ev);
 
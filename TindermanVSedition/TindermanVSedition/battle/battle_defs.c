@@ -0,0 +1,526 @@
+// battle/battle_defs.c
+#include "battle_defs.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#if defined(TVSE_DEV) && defined(__linux__)
+#include <sys/inotify.h>
+#endif
+
+#include "battle_skills.h"
+#include "char_defs.h"
+
+// ---------------------------------
+// .bin（リトルエンディアン・固定長）
+//   header 16 : magic[4] ver u16 skills u16 chars u16 pad u16 body_fnv u32
+//   skill  88 : id[24] name[48] range i16 st i16 power i16 radius i16 mult i16
+//               type u8 target u8 once u8 pad[3]
+//   char   32 : id[24] regen i16 skill_count u8 tag u8（技表の通し番号。0xFF=なし）skill u8×4
+// ---------------------------------
+#define DF_HEADER_BYTES 16
+#define DF_SKILL_BYTES  88
+#define DF_CHAR_BYTES   32
+#define DF_NO_SKILL     0xFF
+
+static void put_u16(uint8_t *p, uint16_t v) { p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); }
+static void put_u32(uint8_t *p, uint32_t v) { put_u16(p, (uint16_t)v); put_u16(p + 2, (uint16_t)(v >> 16)); }
+static uint16_t get_u16(const uint8_t *p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+static uint32_t get_u32(const uint8_t *p) { return (uint32_t)get_u16(p) | ((uint32_t)get_u16(p + 2) << 16); }
+
+static uint32_t fnv1a32(const uint8_t *p, size_t n) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < n; i++) { h ^= p[i]; h *= 16777619u; }
+    return h;
+}
+
+// 固定長の文字列欄（NUL 終端を保証して写す）
+static void get_str(char *dst, size_t cap, const uint8_t *src, size_t field) {
+    size_t n = (field < cap) ? field : cap;
+    memcpy(dst, src, n);
+    dst[n - 1] = '\0';
+}
+
+static char g_loaded_path[512];
+static uint32_t g_loaded_sum = 0;
+
+// ---------------------------------
+// load（mmap → 検証 → 表へ写す）
+// ---------------------------------
+// 読み直しで要素の場所を動かさない：今の表にある id は同じ場所、新しい id は後ろへ足す
+//   slot_of[i] に .bin の i 番目を置く場所。今の表の id が .bin から消えていたら false
+//   （BattleCore は skill_id/char_id のポインタを持つが、どれを持っているかは表から分からない
+//     → 読み込み済みの id は全部「使用中」とみなし、消すのは再起動で）
+static bool place_by_id(const char *const *cur_ids, int cur_n, const char *const *new_ids, int new_n,
+                        int cap, int *slot_of, const char *kind, const char *path) {
+    for (int i = 0; i < new_n; i++) {
+        slot_of[i] = -1;
+        for (int k = 0; k < i; k++) {
+            if (strcmp(new_ids[k], new_ids[i]) == 0) {
+                fprintf(stderr, "[DEFS] %s: %s '%s' is defined twice\n", path, kind, new_ids[i]);
+                return false;
+            }
+        }
+    }
+    for (int j = 0; j < cur_n; j++) {
+        int found = -1;
+        for (int i = 0; i < new_n && found < 0; i++) {
+            if (strcmp(cur_ids[j], new_ids[i]) == 0) found = i;
+        }
+        if (found < 0) {
+            fprintf(stderr, "[DEFS] %s: %s '%s' is in use and cannot be removed by a reload (restart)\n",
+                    path, kind, cur_ids[j]);
+            return false;
+        }
+        slot_of[found] = j;
+    }
+    int next = cur_n;
+    for (int i = 0; i < new_n; i++) {
+        if (slot_of[i] >= 0) continue;
+        if (next >= cap) {
+            fprintf(stderr, "[DEFS] %s: too many %ss (max %d)\n", path, kind, cap);
+            return false;
+        }
+        slot_of[i] = next++;
+    }
+    return true;
+}
+
+static bool decode_blob(const uint8_t *p, size_t size, const char *path) {
+    if (size < DF_HEADER_BYTES || memcmp(p, BATTLE_DEFS_MAGIC, 4) != 0) {
+        fprintf(stderr, "[DEFS] %s: not a defs blob\n", path);
+        return false;
+    }
+    if (get_u16(p + 4) != BATTLE_DEFS_VERSION) {
+        fprintf(stderr, "[DEFS] %s: version %u (expected %d). run make defs\n",
+                path, get_u16(p + 4), BATTLE_DEFS_VERSION);
+        return false;
+    }
+    int ns = get_u16(p + 6), nc = get_u16(p + 8);
+    if (ns > BATTLE_SKILL_MAX || nc > CHAR_DEF_MAX ||
+        size != DF_HEADER_BYTES + (size_t)ns * DF_SKILL_BYTES + (size_t)nc * DF_CHAR_BYTES ||
+        get_u32(p + 12) != fnv1a32(p + DF_HEADER_BYTES, size - DF_HEADER_BYTES)) {
+        fprintf(stderr, "[DEFS] %s: broken (size/checksum)\n", path);
+        return false;
+    }
+
+    SkillDef skills[BATTLE_SKILL_MAX];     // .bin の順
+    CharDef chars[CHAR_DEF_MAX];
+    memset(skills, 0, sizeof(skills));
+    memset(chars, 0, sizeof(chars));
+
+    const uint8_t *q = p + DF_HEADER_BYTES;
+    for (int i = 0; i < ns; i++, q += DF_SKILL_BYTES) {
+        SkillDef *s = &skills[i];
+        get_str(s->id, sizeof(s->id), q, 24);
+        get_str(s->name, sizeof(s->name), q + 24, 48);
+        s->range      = (int16_t)get_u16(q + 72);
+        s->st_cost    = (int16_t)get_u16(q + 74);
+        s->power      = (int16_t)get_u16(q + 76);
+        s->aoe_radius = (int16_t)get_u16(q + 78);
+        s->multiplier = (int16_t)get_u16(q + 80);
+        s->type       = (SkillType)q[82];
+        s->target     = (SkillTarget)q[83];
+        s->once_per_battle = q[84] != 0;
+    }
+
+    // キャラ側の検証を先に（失敗したら技表も差し替えない）
+    const uint8_t *cq = q;
+    bool has_fallback = false;
+    for (int i = 0; i < nc; i++, q += DF_CHAR_BYTES) {
+        char cid[24];
+        get_str(cid, sizeof(cid), q, 24);
+        if (q[26] > 4) {
+            fprintf(stderr, "[DEFS] %s: char #%d '%s': skill_count %u (max 4)\n", path, i, cid, q[26]);
+            return false;
+        }
+        for (int k = 0; k < q[26]; k++) {
+            if (q[28 + k] >= ns) {
+                fprintf(stderr, "[DEFS] %s: char #%d '%s': skill[%d] index %u (skills %d)\n",
+                        path, i, cid, k, q[28 + k], ns);
+                return false;
+            }
+        }
+        if (q[27] != DF_NO_SKILL && q[27] >= ns) {
+            fprintf(stderr, "[DEFS] %s: char #%d '%s': tag skill index %u (skills %d)\n", path, i, cid, q[27], ns);
+            return false;
+        }
+        if (strcmp(cid, CHAR_DEF_FALLBACK_ID) == 0) has_fallback = true;
+        get_str(chars[i].char_id, sizeof(chars[i].char_id), q, 24);
+    }
+    if (!has_fallback) {
+        fprintf(stderr, "[DEFS] %s: no '%s' character\n", path, CHAR_DEF_FALLBACK_ID);
+        return false;
+    }
+
+    // 置き場所を id で決める（両方の表で決まってから差し替える。失敗したらどちらも変えない）
+    const char *cur_ids[BATTLE_SKILL_MAX], *new_ids[BATTLE_SKILL_MAX];
+    int skill_slot[BATTLE_SKILL_MAX], char_slot[CHAR_DEF_MAX];
+    const int cur_ns = battle_skill_count(), cur_nc = char_def_count();
+    for (int j = 0; j < cur_ns; j++) cur_ids[j] = battle_skill_at(j)->id;
+    for (int i = 0; i < ns; i++) new_ids[i] = skills[i].id;
+    if (!place_by_id(cur_ids, cur_ns, new_ids, ns, BATTLE_SKILL_MAX, skill_slot, "skill", path)) return false;
+    for (int j = 0; j < cur_nc; j++) cur_ids[j] = char_def_at(j)->char_id;
+    for (int i = 0; i < nc; i++) new_ids[i] = chars[i].char_id;
+    if (!place_by_id(cur_ids, cur_nc, new_ids, nc, CHAR_DEF_MAX, char_slot, "char", path)) return false;
+
+    SkillDef placed_skills[BATTLE_SKILL_MAX];
+    memset(placed_skills, 0, sizeof(placed_skills));
+    for (int i = 0; i < ns; i++) placed_skills[skill_slot[i]] = skills[i];
+    if (!battle_skill_table_set(placed_skills, ns)) return false;
+
+    // 技の参照は差し替え後の技表の id を指す（表の場所は動かないのでそのまま持てる）
+    CharDef placed_chars[CHAR_DEF_MAX];
+    memset(placed_chars, 0, sizeof(placed_chars));
+    q = cq;
+    for (int i = 0; i < nc; i++, q += DF_CHAR_BYTES) {
+        CharDef *c = &placed_chars[char_slot[i]];
+        memcpy(c->char_id, chars[i].char_id, sizeof(c->char_id));
+        c->st_regen_per_turn = (int16_t)get_u16(q + 24);
+        c->skill_count = q[26];
+        for (int k = 0; k < c->skill_count; k++) c->skill_ids[k] = battle_skill_at(skill_slot[q[28 + k]])->id;
+        c->tag_skill_id = (q[27] == DF_NO_SKILL) ? NULL : battle_skill_at(skill_slot[q[27]])->id;
+    }
+    if (!char_def_table_set(placed_chars, nc)) return false;
+    g_loaded_sum = get_u32(p + 12);
+    return true;
+}
+
+bool battle_defs_load(const char *bin_path) {
+    if (!bin_path) return false;
+
+    int fd = open(bin_path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "[DEFS] %s: cannot open (run make defs)\n", bin_path);
+        return false;
+    }
+    struct stat stt;
+    if (fstat(fd, &stt) != 0 || stt.st_size <= 0) {
+        close(fd);
+        fprintf(stderr, "[DEFS] %s: empty\n", bin_path);
+        return false;
+    }
+    size_t size = (size_t)stt.st_size;
+    void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "[DEFS] %s: mmap failed\n", bin_path);
+        return false;
+    }
+
+    bool ok = decode_blob((const uint8_t*)map, size, bin_path);
+    munmap(map, size);
+
+    if (ok && g_loaded_path != bin_path) snprintf(g_loaded_path, sizeof(g_loaded_path), "%s", bin_path);
+    return ok;
+}
+
+const char* battle_defs_loaded_path(void) {
+    return g_loaded_path[0] ? g_loaded_path : NULL;
+}
+
+uint32_t battle_defs_checksum(void) {
+    return g_loaded_sum;
+}
+
+// ---------------------------------
+// compile（テキスト → .bin）
+// ---------------------------------
+typedef struct {
+    char id[24];
+    char skills[4][24];
+    int  nskill;
+    char tag[24];
+    int  regen;
+} CharSrc;
+
+static bool parse_int_kv(const char *tok, const char *key, int *out) {
+    size_t n = strlen(key);
+    if (strncmp(tok, key, n) != 0 || tok[n] != '=') return false;
+    char *end = NULL;
+    long v = strtol(tok + n + 1, &end, 10);
+    if (!end || *end || v < -32768 || v > 32767) return false;
+    *out = (int)v;
+    return true;
+}
+
+static bool copy_id(char *dst, size_t cap, const char *src) {
+    if (!src || !src[0] || strlen(src) >= cap) return false;
+    memcpy(dst, src, strlen(src) + 1);
+    return true;
+}
+
+static int find_skill(const SkillDef *skills, int ns, const char *id) {
+    for (int i = 0; i < ns; i++) if (strcmp(skills[i].id, id) == 0) return i;
+    return -1;
+}
+
+static bool parse_skill(char *save, SkillDef *s) {
+    char *id = strtok_r(NULL, " \t", &save);
+    char *name = strtok_r(NULL, " \t", &save);
+    char *type = strtok_r(NULL, " \t", &save);
+    char *target = strtok_r(NULL, " \t", &save);
+    if (!copy_id(s->id, sizeof(s->id), id) || !copy_id(s->name, sizeof(s->name), name) || !type || !target) return false;
+
+    if      (strcmp(type, "attack") == 0)  s->type = SKTYPE_ATTACK;
+    else if (strcmp(type, "heal") == 0)    s->type = SKTYPE_HEAL;
+    else if (strcmp(type, "counter") == 0) s->type = SKTYPE_COUNTER;
+    else return false;
+
+    if      (strcmp(target, "single") == 0) s->target = SKT_SINGLE;
+    else if (strcmp(target, "aoe") == 0)    s->target = SKT_AOE;
+    else return false;
+
+    s->multiplier = 1;
+    for (char *t; (t = strtok_r(NULL, " \t", &save)) != NULL; ) {
+        if (strcmp(t, "once") == 0) { s->once_per_battle = true; continue; }
+        if (parse_int_kv(t, "range", &s->range) || parse_int_kv(t, "st", &s->st_cost) ||
+            parse_int_kv(t, "power", &s->power) || parse_int_kv(t, "radius", &s->aoe_radius) ||
+            parse_int_kv(t, "mult", &s->multiplier)) continue;
+        return false;
+    }
+    return true;
+}
+
+static bool parse_char(char *save, CharSrc *c) {
+    char *id = strtok_r(NULL, " \t", &save);
+    if (!copy_id(c->id, sizeof(c->id), id)) return false;
+
+    for (char *t; (t = strtok_r(NULL, " \t", &save)) != NULL; ) {
+        if (parse_int_kv(t, "regen", &c->regen)) continue;
+        if (strncmp(t, "tag=", 4) == 0) {
+            if (!copy_id(c->tag, sizeof(c->tag), t + 4)) return false;
+            continue;
+        }
+        if (strncmp(t, "skills=", 7) == 0) {
+            char *s2 = NULL;
+            for (char *k = strtok_r(t + 7, ",", &s2); k; k = strtok_r(NULL, ",", &s2)) {
+                if (c->nskill >= 4 || !copy_id(c->skills[c->nskill], sizeof(c->skills[0]), k)) return false;
+                c->nskill++;
+            }
+            continue;
+        }
+        return false;
+    }
+    // タッグ枠込みで技index 0..3（UnitCmd.skill_index の範囲）に収める
+    return c->nskill > 0 && c->nskill + (c->tag[0] ? 1 : 0) <= 4;
+}
+
+bool battle_defs_compile(const char *txt_path, const char *bin_path) {
+    if (!txt_path || !bin_path) return false;
+    FILE *fp = fopen(txt_path, "r");
+    if (!fp) {
+        fprintf(stderr, "[DEFS] %s: cannot open\n", txt_path);
+        return false;
+    }
+
+    SkillDef skills[BATTLE_SKILL_MAX];
+    CharSrc chars[CHAR_DEF_MAX];
+    int ns = 0, nc = 0, lineno = 0;
+    bool ok = true;
+    char line[512];
+    memset(skills, 0, sizeof(skills));
+    memset(chars, 0, sizeof(chars));
+
+    while (ok && fgets(line, sizeof(line), fp)) {
+        lineno++;
+        line[strcspn(line, "\r\n")] = '\0';
+        char *save = NULL;
+        char *kind = strtok_r(line, " \t", &save);
+        if (!kind || strncmp(kind, "//", 2) == 0) continue;
+
+        if (strcmp(kind, "skill") == 0) {
+            if (ns >= BATTLE_SKILL_MAX || !parse_skill(save, &skills[ns])) ok = false;
+            else if (find_skill(skills, ns, skills[ns].id) >= 0) ok = false;
+            else ns++;
+        } else if (strcmp(kind, "char") == 0) {
+            if (nc >= CHAR_DEF_MAX || !parse_char(save, &chars[nc])) ok = false;
+            else nc++;
+        } else {
+            ok = false;
+        }
+        if (!ok) fprintf(stderr, "[DEFS] %s:%d: bad line\n", txt_path, lineno);
+    }
+    fclose(fp);
+    if (!ok) return false;
+
+    // 参照の解決
+    bool has_fallback = false;
+    for (int i = 0; i < nc; i++) {
+        for (int j = 0; j < i; j++) {
+            if (strcmp(chars[i].id, chars[j].id) == 0) {
+                fprintf(stderr, "[DEFS] %s: duplicate char '%s'\n", txt_path, chars[i].id);
+                return false;
+            }
+        }
+        for (int k = 0; k < chars[i].nskill; k++) {
+            if (find_skill(skills, ns, chars[i].skills[k]) < 0) {
+                fprintf(stderr, "[DEFS] %s: char '%s' uses unknown skill '%s'\n", txt_path, chars[i].id, chars[i].skills[k]);
+                return false;
+            }
+        }
+        if (chars[i].tag[0] && find_skill(skills, ns, chars[i].tag) < 0) {
+            fprintf(stderr, "[DEFS] %s: char '%s' uses unknown tag skill '%s'\n", txt_path, chars[i].id, chars[i].tag);
+            return false;
+        }
+        if (strcmp(chars[i].id, CHAR_DEF_FALLBACK_ID) == 0) has_fallback = true;
+    }
+    if (!has_fallback) {
+        fprintf(stderr, "[DEFS] %s: '%s' character is required\n", txt_path, CHAR_DEF_FALLBACK_ID);
+        return false;
+    }
+
+    size_t size = DF_HEADER_BYTES + (size_t)ns * DF_SKILL_BYTES + (size_t)nc * DF_CHAR_BYTES;
+    uint8_t *buf = (uint8_t*)calloc(1, size);
+    if (!buf) return false;
+
+    uint8_t *q = buf + DF_HEADER_BYTES;
+    for (int i = 0; i < ns; i++, q += DF_SKILL_BYTES) {
+        const SkillDef *s = &skills[i];
+        memcpy(q, s->id, strlen(s->id));
+        memcpy(q + 24, s->name, strlen(s->name));
+        put_u16(q + 72, (uint16_t)s->range);
+        put_u16(q + 74, (uint16_t)s->st_cost);
+        put_u16(q + 76, (uint16_t)s->power);
+        put_u16(q + 78, (uint16_t)s->aoe_radius);
+        put_u16(q + 80, (uint16_t)s->multiplier);
+        q[82] = (uint8_t)s->type;
+        q[83] = (uint8_t)s->target;
+        q[84] = s->once_per_battle ? 1 : 0;
+    }
+    for (int i = 0; i < nc; i++, q += DF_CHAR_BYTES) {
+        const CharSrc *c = &chars[i];
+        memcpy(q, c->id, strlen(c->id));
+        put_u16(q + 24, (uint16_t)c->regen);
+        q[26] = (uint8_t)c->nskill;
+        q[27] = c->tag[0] ? (uint8_t)find_skill(skills, ns, c->tag) : DF_NO_SKILL;
+        for (int k = 0; k < 4; k++) {
+            q[28 + k] = (k < c->nskill) ? (uint8_t)find_skill(skills, ns, c->skills[k]) : DF_NO_SKILL;
+        }
+    }
+    memcpy(buf, BATTLE_DEFS_MAGIC, 4);
+    put_u16(buf + 4, BATTLE_DEFS_VERSION);
+    put_u16(buf + 6, (uint16_t)ns);
+    put_u16(buf + 8, (uint16_t)nc);
+    put_u32(buf + 12, fnv1a32(buf + DF_HEADER_BYTES, size - DF_HEADER_BYTES));
+
+    // 一時ファイルに書いて rename（読む側が書きかけを見ない / inotify は IN_MOVED_TO で拾う）
+    char tmp[600];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", bin_path);
+    FILE *out = fopen(tmp, "wb");
+    ok = out != NULL;
+    if (out) {
+        ok = fwrite(buf, 1, size, out) == size;
+        ok = (fclose(out) == 0) && ok;
+    }
+    free(buf);
+    if (ok && rename(tmp, bin_path) != 0) ok = false;
+    if (!ok) {
+        fprintf(stderr, "[DEFS] %s: write failed\n", bin_path);
+        remove(tmp);
+        return false;
+    }
+    printf("[DEFS] %s: %d skills, %d chars, %zu bytes\n", bin_path, ns, nc, size);
+    return true;
+}
+
+// ---------------------------------
+// ホットリロード（開発ビルドのみ）
+// ---------------------------------
+static bool watch_begin(BattleDefsWatch *w, const char *bin_path) {
+    if (!w) return false;
+    memset(w, 0, sizeof(*w));
+    w->fd = -1;
+    if (!bin_path || !bin_path[0]) return false;
+    snprintf(w->path, sizeof(w->path), "%s", bin_path);
+    return true;
+}
+
+#ifdef TVSE_DEV
+static bool watch_reload(BattleDefsWatch *w) {
+    bool ok = battle_defs_load(w->path);
+    printf("[DEFS] reload %s: %s\n", w->path, ok ? "ok" : "FAILED (kept previous tables)");
+    return ok;
+}
+#endif
+
+#if defined(TVSE_DEV) && defined(__linux__)
+bool battle_defs_watch_start(BattleDefsWatch *w, const char *bin_path) {
+    if (!watch_begin(w, bin_path)) return false;
+
+    char dir[512];
+    snprintf(dir, sizeof(dir), "%s", w->path);
+    char *slash = strrchr(dir, '/');
+    if (slash) *slash = '\0';
+    else snprintf(dir, sizeof(dir), ".");
+
+    w->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (w->fd < 0) return false;
+    if (inotify_add_watch(w->fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        close(w->fd);
+        w->fd = -1;
+        return false;
+    }
+    w->active = true;
+    printf("[DEFS] watching %s\n", dir);
+    return true;
+}
+
+bool battle_defs_poll_reload(BattleDefsWatch *w) {
+    if (!w || !w->active) return false;
+
+    const char *base = strrchr(w->path, '/');
+    base = base ? base + 1 : w->path;
+
+    _Alignas(struct inotify_event) char buf[4096];
+    bool hit = false;
+    for (;;) {
+        ssize_t n = read(w->fd, buf, sizeof(buf));
+        if (n <= 0) break;
+        for (char *p = buf; p < buf + n; ) {
+            const struct inotify_event *ev = (const struct inotify_event*)p;
+            if (ev->len > 0 && strcmp(ev->name, base) == 0) hit = true;
+            p += sizeof(*ev) + ev->len;
+        }
+    }
+    return hit && watch_reload(w);
+}
+
+void battle_defs_watch_stop(BattleDefsWatch *w) {
+    if (!w) return;
+    if (w->fd >= 0) close(w->fd);
+    w->fd = -1;
+    w->active = false;
+}
+#elif defined(TVSE_DEV)
+// inotify のない環境：更新時刻を見る
+bool battle_defs_watch_start(BattleDefsWatch *w, const char *bin_path) {
+    struct stat stt;
+    if (!watch_begin(w, bin_path) || stat(w->path, &stt) != 0) return false;
+    w->mtime = (int64_t)stt.st_mtime;
+    w->active = true;
+    return true;
+}
+
+bool battle_defs_poll_reload(BattleDefsWatch *w) {
+    struct stat stt;
+    if (!w || !w->active || stat(w->path, &stt) != 0 || (int64_t)stt.st_mtime == w->mtime) return false;
+    w->mtime = (int64_t)stt.st_mtime;
+    return watch_reload(w);
+}
+
+void battle_defs_watch_stop(BattleDefsWatch *w) {
+    if (w) w->active = false;
+}
+#else
+bool battle_defs_watch_start(BattleDefsWatch *w, const char *bin_path) {
+    watch_begin(w, bin_path);
+    return false;
+}
+bool battle_defs_poll_reload(BattleDefsWatch *w) { (void)w; return false; }
+void battle_defs_watch_stop(BattleDefsWatch *w) { if (w) w->active = false; }
+#endif
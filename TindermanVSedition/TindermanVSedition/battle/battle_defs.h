@@ -0,0 +1,58 @@
+// battle/battle_defs.h
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ===============================
+//  技/キャラ定義データ
+//   - 元データ：assets/data/battle_defs.txt（人が編集する）
+//   - ビルド時に tools/defs_pack で固定長レコードのバイナリ（.bin）にする（make defs）
+//   - 実行時は .bin を mmap して検証し、battle_skills.c / char_defs.c の表（固定長の静的配列）へ写す
+//       → 引く側は従来どおり静的配列を先頭から見るだけ（引く速さは変わらない）
+//       → 表の各要素の場所は読み直しても動かない（BattleCore が持つ skill_id/char_id のポインタが生きたまま）
+//         読み直しは id で今の表と突き合わせる（同じ id は同じ場所、新しい id は後ろへ）。
+//         読み込み済みの id を消す .bin は使用中とみなして断る（消すのは再起動で）
+//   - 開発ビルド（make DEV=1 → TVSE_DEV）では .bin の置き換えを inotify で拾って読み直せる
+//       読み直しは表を読むスレッドが他にいない所（battle scene の入力待ち）でだけ呼ぶ
+//   - 表と下の loaded_path/checksum は「読み込み時だけ書くプロセス共通データ」（tvse_battle.h 参照）
+//       見張りの状態は BattleDefsWatch として呼ぶ側が持つ
+// ===============================
+#define BATTLE_DEFS_PATH "assets/data/battle_defs.bin"
+#define BATTLE_DEFS_MAGIC "TVSD"
+#define BATTLE_DEFS_VERSION 1
+
+// .bin の全体を検証して表を差し替える（失敗時は表を変えずに false。理由は stderr）
+bool battle_defs_load(const char *bin_path);
+
+// テキストを読んで .bin を書く（tools/defs_pack 用。書き出しは一時ファイル→rename）
+bool battle_defs_compile(const char *txt_path, const char *bin_path);
+
+// 最後に読めた .bin のパス（未読込なら NULL）
+const char* battle_defs_loaded_path(void);
+
+// 最後に読めた .bin の中身のチェックサム（結果の再利用判定用。未読込なら 0）
+uint32_t battle_defs_checksum(void);
+
+// ---------------------------------
+// ホットリロード（TVSE_DEV のときだけ動く。それ以外は何もしない/false）
+// ---------------------------------
+typedef struct {
+    char path[512];     // 見張る .bin
+    int fd;             // inotify（-1=なし）
+    int64_t mtime;      // inotify のない環境：最後に見た更新時刻
+    bool active;
+} BattleDefsWatch;
+
+// bin_path（普通は battle_defs_loaded_path()）のあるディレクトリを見張り始める
+bool battle_defs_watch_start(BattleDefsWatch *w, const char *bin_path);
+// .bin が書き換わっていたら読み直す（ノンブロッキング）。読み直したら true
+bool battle_defs_poll_reload(BattleDefsWatch *w);
+void battle_defs_watch_stop(BattleDefsWatch *w);
+
+#ifdef __cplusplus
+}
+#endif
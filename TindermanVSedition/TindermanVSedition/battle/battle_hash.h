@@ -0,0 +1,36 @@
+// battle/battle_hash.h
+#pragma once
+#include <stdint.h>
+
+#include "battle_types.h"
+
+// ===============================
+//  Zobrist 風の局面ハッシュ
+//   - 乱数表の代わりに (種別, ユニット, 値) を splitmix64 で混ぜてキーにする
+//     → 表の初期化が要らず、スレッド間で共有しても安全
+//   - HP/ST のように値域が広い項目も表サイズを気にせず扱える
+//   - 局面ハッシュ = 各項目のキーの XOR（変更時は 旧キー^新キー で差分更新）
+// ===============================
+typedef enum {
+    BHK_POS = 1,
+    BHK_HP,
+    BHK_ST,
+    BHK_ALIVE,
+    BHK_COUNTER,   // 構え中のみ XOR（値=反撃射程）
+} BattleHashKind;
+
+static inline uint64_t battle_hash_mix64(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+static inline uint64_t battle_hash_key(BattleHashKind kind, int ui, int32_t value) {
+    uint64_t k = ((uint64_t)kind << 56) ^ ((uint64_t)(uint8_t)ui << 48) ^ (uint64_t)(uint32_t)value;
+    return battle_hash_mix64(k);
+}
+
+static inline uint64_t battle_hash_pos_key(int ui, Pos p) {
+    return battle_hash_key(BHK_POS, ui, ((int32_t)p.x << 8) | (int32_t)(uint8_t)p.y);
+}
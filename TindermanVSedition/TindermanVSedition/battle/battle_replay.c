@@ -0,0 +1,501 @@
+// battle/battle_replay.c
+#include "battle_replay.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "battle_skills.h"  // battle_skill_index_of(), battle_skill_at()
+#include "battle_hash.h"    // battle_hash_mix64()
+#include "battle_defs.h"    // battle_defs_checksum()
+
+// ---------------------------------
+// 開始条件
+// ---------------------------------
+static Stats girl_stats_from_info(const NetGameInfo *info) {
+    Stats s;
+    s.hp  = info->hp_base  + info->hp_add;
+    s.atk = info->atk_base + info->atk_add;
+    s.spd = info->sp_base  + info->sp_add;
+    s.st  = info->st_base  + info->st_add;
+    return s;
+}
+
+static int clamp_move(int mv) {
+    if (mv < 0) return 0;
+    if (mv > 20) return 20;
+    return mv;
+}
+
+bool battle_replay_setup_core(BattleCore *b, const NetGameInfo *p1, const NetGameInfo *p2) {
+    if (!b || !p1 || !p2) return false;
+
+    Stats hero = { .hp = BATTLE_HERO_HP, .atk = BATTLE_HERO_ATK,
+                   .spd = BATTLE_HERO_SPD, .st = BATTLE_HERO_ST };
+
+    if (!battle_core_init(b,
+                          p1->girl_id, p1->tag_learned != 0, hero, girl_stats_from_info(p1),
+                          p2->girl_id, p2->tag_learned != 0, hero, girl_stats_from_info(p2))) {
+        return false;
+    }
+
+    battle_core_set_unit_pos(b, 0, (Pos){ BATTLE_INIT_P1_X, BATTLE_INIT_HERO_Y });
+    battle_core_set_unit_pos(b, 1, (Pos){ BATTLE_INIT_P1_X, BATTLE_INIT_GIRL_Y });
+    battle_core_set_unit_pos(b, 2, (Pos){ BATTLE_INIT_P2_X, BATTLE_INIT_HERO_Y });
+    battle_core_set_unit_pos(b, 3, (Pos){ BATTLE_INIT_P2_X, BATTLE_INIT_GIRL_Y });
+
+    b->units[0].move = BATTLE_HERO_MOVE;
+    b->units[1].move = clamp_move(p1->move_range);
+    b->units[2].move = BATTLE_HERO_MOVE;
+    b->units[3].move = clamp_move(p2->move_range);
+    return true;
+}
+
+// 開始条件の部分だけ（版数などは混ぜない。リプレイに残る情報から同じ seed を作り直せる）
+static uint64_t info_hash(const NetGameInfo *info) {
+    uint8_t buf[NET_GAME_INFO_BYTES];
+    net_game_info_pack(info, buf);
+    uint64_t h = 0xCBF29CE484222325ull;           // FNV-1a
+    for (int i = 0; i < NET_GAME_INFO_SETUP_BYTES; i++) {
+        h ^= buf[i];
+        h *= 0x100000001B3ull;
+    }
+    return h;
+}
+
+uint32_t battle_replay_match_seed(const NetGameInfo *a, const NetGameInfo *b) {
+    if (!a || !b) return 0;
+    uint64_t ha = info_hash(a), hb = info_hash(b);
+    uint64_t lo = ha < hb ? ha : hb;
+    uint64_t hi = ha < hb ? hb : ha;
+    uint64_t h = battle_hash_mix64(lo) ^ battle_hash_mix64(hi + 0x9E3779B97F4A7C15ull);
+    return (uint32_t)(h ^ (h >> 32));
+}
+
+// ---------------------------------
+// keyframe
+// ---------------------------------
+static void snap_core(const BattleCore *b, int turn_index, BattleReplayKeyframe *k) {
+    memset(k, 0, sizeof(*k));
+    k->turn_index = turn_index;
+    k->phase = (uint8_t)b->phase;
+    for (int i = 0; i < 4; i++) {
+        const Unit *u = &b->units[i];
+        BattleReplayUnitSnap *s = &k->u[i];
+        s->x  = u->pos.x;
+        s->y  = u->pos.y;
+        s->hp = (int16_t)u->stats.hp;
+        s->st = (int16_t)u->stats.st;
+        s->alive = u->alive ? 1 : 0;
+        s->counter_ready = b->counter_ready[i] ? 1 : 0;
+        s->counter_range = (int8_t)b->counter_range[i];
+        s->counter_skill = (int16_t)battle_skill_index_of(b->counter_skill_id[i]);
+    }
+}
+
+static bool snap_equal(const BattleReplayKeyframe *a, const BattleReplayKeyframe *c) {
+    if (a->turn_index != c->turn_index || a->phase != c->phase) return false;
+    for (int i = 0; i < 4; i++) {
+        const BattleReplayUnitSnap *x = &a->u[i], *y = &c->u[i];
+        if (x->x != y->x || x->y != y->y || x->hp != y->hp || x->st != y->st) return false;
+        if (x->alive != y->alive || x->counter_ready != y->counter_ready) return false;
+        if (x->counter_range != y->counter_range || x->counter_skill != y->counter_skill) return false;
+    }
+    return true;
+}
+
+static void apply_keyframe(BattleCore *b, const BattleReplayKeyframe *k) {
+    for (int i = 0; i < 4; i++) {
+        const BattleReplayUnitSnap *s = &k->u[i];
+        Unit *u = &b->units[i];
+        u->pos = (Pos){ s->x, s->y };
+        u->stats.hp = s->hp;
+        u->stats.st = s->st;
+        u->alive = s->alive != 0;
+
+        const SkillDef *sk = battle_skill_at(s->counter_skill);
+        b->counter_ready[i] = s->counter_ready != 0;
+        b->counter_range[i] = s->counter_range;
+        b->counter_skill_id[i] = sk ? sk->id : NULL;
+    }
+    b->phase = (BattlePhase)k->phase;
+    b->turn = k->turn_index + 1;
+    battle_core_refresh_hash(b);
+}
+
+static bool push_keyframe(BattleReplay *r, const BattleReplayKeyframe *k) {
+    if (r->key_count >= r->key_cap) {
+        int ncap = r->key_cap ? r->key_cap * 2 : 16;
+        BattleReplayKeyframe *nk = (BattleReplayKeyframe*)realloc(r->keys, (size_t)ncap * sizeof(*nk));
+        if (!nk) return false;
+        r->keys = nk;
+        r->key_cap = ncap;
+    }
+    r->keys[r->key_count++] = *k;
+    return true;
+}
+
+// ---------------------------------
+// record
+// ---------------------------------
+void battle_replay_init(BattleReplay *r, const NetGameInfo *p1, const NetGameInfo *p2, uint32_t seed) {
+    if (!r) return;
+    memset(r, 0, sizeof(*r));
+    r->seed = seed;
+    r->defs_checksum = battle_defs_checksum();
+    if (p1) r->info[TEAM_P1] = *p1;
+    if (p2) r->info[TEAM_P2] = *p2;
+}
+
+void battle_replay_set_stage(BattleReplay *r, const BattleStage *stage) {
+    if (!r) return;
+    snprintf(r->stage_id, sizeof(r->stage_id), "%s", stage ? stage->id : "");
+    r->stage_checksum = stage ? stage->checksum : 0;
+}
+
+void battle_replay_free(BattleReplay *r) {
+    if (!r) return;
+    free(r->turns);
+    free(r->keys);
+    r->turns = NULL;
+    r->keys = NULL;
+    r->turn_count = r->turn_cap = 0;
+    r->key_count = r->key_cap = 0;
+}
+
+bool battle_replay_record_turn(BattleReplay *r, const BattleCore *before,
+                               const TurnCmd *p1, const TurnCmd *p2) {
+    if (!r || !before || !p1 || !p2) return false;
+    if (!battle_cmd_validate(p1) || !battle_cmd_validate(p2)) return false;
+
+    if (r->turn_count % BATTLE_REPLAY_KEYFRAME_INTERVAL == 0) {
+        BattleReplayKeyframe k;
+        snap_core(before, r->turn_count, &k);
+        if (!push_keyframe(r, &k)) return false;
+    }
+
+    if (r->turn_count >= r->turn_cap) {
+        int ncap = r->turn_cap ? r->turn_cap * 2 : 64;
+        BattleReplayTurn *nt = (BattleReplayTurn*)realloc(r->turns, (size_t)ncap * sizeof(*nt));
+        if (!nt) return false;
+        r->turns = nt;
+        r->turn_cap = ncap;
+    }
+    r->turns[r->turn_count].cmd[TEAM_P1] = *p1;
+    r->turns[r->turn_count].cmd[TEAM_P2] = *p2;
+    r->turn_count++;
+    return true;
+}
+
+// ---------------------------------
+// seek
+// ---------------------------------
+bool battle_replay_seek(const BattleReplay *r, int turn_index, BattleCore *out) {
+    if (!r || !out) return false;
+    if (turn_index < 0) turn_index = 0;
+    if (turn_index > r->turn_count) turn_index = r->turn_count;
+
+    if (!battle_replay_setup_core(out, &r->info[TEAM_P1], &r->info[TEAM_P2])) return false;
+    out->rng_seed = r->seed;
+    out->stage = battle_stage_find(r->stage_id);
+
+    // turn_index 以下で最後のキーフレーム（二分探索）
+    int lo = 0, hi = r->key_count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (r->keys[mid].turn_index <= turn_index) lo = mid + 1;
+        else hi = mid;
+    }
+
+    int t = 0;
+    if (lo > 0) {
+        apply_keyframe(out, &r->keys[lo - 1]);
+        t = r->keys[lo - 1].turn_index;
+    }
+
+    for (; t < turn_index && out->phase != BPHASE_END; t++) {
+        const BattleReplayTurn *rt = &r->turns[t];
+        battle_core_run_turn(out, &rt->cmd[TEAM_P1], &rt->cmd[TEAM_P2]);
+    }
+    return true;
+}
+
+int battle_replay_verify_keyframes(const BattleReplay *r) {
+    if (!r) return 0;
+
+    BattleCore b;
+    if (!battle_replay_setup_core(&b, &r->info[TEAM_P1], &r->info[TEAM_P2])) return 1;
+    b.rng_seed = r->seed;
+    b.stage = battle_stage_find(r->stage_id);
+
+    int diff = 0, ki = 0;
+    for (int t = 0; t < r->turn_count; t++) {
+        if (t % BATTLE_REPLAY_KEYFRAME_INTERVAL == 0) {
+            BattleReplayKeyframe k;
+            snap_core(&b, t, &k);
+            if (ki >= r->key_count || !snap_equal(&r->keys[ki], &k)) diff++;
+            ki++;
+        }
+        if (b.phase == BPHASE_END) break;
+        battle_core_run_turn(&b, &r->turns[t].cmd[TEAM_P1], &r->turns[t].cmd[TEAM_P2]);
+    }
+    if (ki != r->key_count) diff++;
+
+    battle_core_free(&b);
+    return diff;
+}
+
+// ---------------------------------
+// file I/O（リトルエンディアン）
+//   header 20 : magic[4] ver u16 key_interval u16 seed u32 turns u32 keys u32
+//   stage  16 : ステージid（NUL 詰め。ver 2 から。ver 1 は無し＝ステージなし）
+//   defs    4 : battle_defs_checksum u32（ver 3 から。ver 2 以前は無し＝照合しない）
+//   ssum    4 : BattleStage.checksum u32（ver 4 から。ver 3 以前は無し＝id だけ照合）
+//   info  100 : NetGameInfo ×2（girl_id[32] + i16×8 + tag u8 + move u8）
+//   turns     : TurnCmd wire ×2 = 28 byte/turn
+//   keys      : turn u32 phase u8 pad[3] + unit 10byte ×4 = 48 byte/keyframe
+//   tail    4 : FNV-1a 32（先頭からの全バイト）
+// ---------------------------------
+#define RP_HEADER_BYTES 20
+#define RP_STAGE_BYTES  BATTLE_STAGE_ID_MAX
+#define RP_DEFS_BYTES   4
+#define RP_SSUM_BYTES   4
+#define RP_INFO_BYTES   50
+#define RP_TURN_BYTES   (TURNCMD_WIRE_BYTES * 2)
+#define RP_UNIT_BYTES   10
+#define RP_KEY_BYTES    (8 + RP_UNIT_BYTES * 4)
+
+static void put_u16(uint8_t *p, uint16_t v) { p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); }
+static void put_u32(uint8_t *p, uint32_t v) { put_u16(p, (uint16_t)v); put_u16(p + 2, (uint16_t)(v >> 16)); }
+static uint16_t get_u16(const uint8_t *p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+static uint32_t get_u32(const uint8_t *p) { return (uint32_t)get_u16(p) | ((uint32_t)get_u16(p + 2) << 16); }
+
+static uint32_t fnv1a32(const uint8_t *p, size_t n) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < n; i++) { h ^= p[i]; h *= 16777619u; }
+    return h;
+}
+
+static void put_info(uint8_t *p, const NetGameInfo *info) {
+    memset(p, 0, RP_INFO_BYTES);
+    memcpy(p, info->girl_id, 32);
+    put_u16(p + 32, (uint16_t)info->hp_base);
+    put_u16(p + 34, (uint16_t)info->atk_base);
+    put_u16(p + 36, (uint16_t)info->sp_base);
+    put_u16(p + 38, (uint16_t)info->st_base);
+    put_u16(p + 40, (uint16_t)info->hp_add);
+    put_u16(p + 42, (uint16_t)info->atk_add);
+    put_u16(p + 44, (uint16_t)info->sp_add);
+    put_u16(p + 46, (uint16_t)info->st_add);
+    p[48] = info->tag_learned;
+    p[49] = info->move_range;
+}
+
+static void get_info(const uint8_t *p, NetGameInfo *info) {
+    memset(info, 0, sizeof(*info));
+    memcpy(info->girl_id, p, 32);
+    info->girl_id[31] = '\0';
+    info->hp_base  = (int16_t)get_u16(p + 32);
+    info->atk_base = (int16_t)get_u16(p + 34);
+    info->sp_base  = (int16_t)get_u16(p + 36);
+    info->st_base  = (int16_t)get_u16(p + 38);
+    info->hp_add   = (int16_t)get_u16(p + 40);
+    info->atk_add  = (int16_t)get_u16(p + 42);
+    info->sp_add   = (int16_t)get_u16(p + 44);
+    info->st_add   = (int16_t)get_u16(p + 46);
+    info->tag_learned = p[48];
+    info->move_range  = p[49];
+}
+
+static void put_key(uint8_t *p, const BattleReplayKeyframe *k) {
+    memset(p, 0, RP_KEY_BYTES);
+    put_u32(p, (uint32_t)k->turn_index);
+    p[4] = k->phase;
+    for (int i = 0; i < 4; i++) {
+        const BattleReplayUnitSnap *s = &k->u[i];
+        uint8_t *q = p + 8 + i * RP_UNIT_BYTES;
+        q[0] = (uint8_t)s->x;
+        q[1] = (uint8_t)s->y;
+        put_u16(q + 2, (uint16_t)s->hp);
+        put_u16(q + 4, (uint16_t)s->st);
+        q[6] = (uint8_t)((s->alive ? 1 : 0) | (s->counter_ready ? 2 : 0));
+        q[7] = (uint8_t)s->counter_range;
+        put_u16(q + 8, (uint16_t)s->counter_skill);
+    }
+}
+
+static void get_key(const uint8_t *p, BattleReplayKeyframe *k) {
+    memset(k, 0, sizeof(*k));
+    k->turn_index = (int)get_u32(p);
+    k->phase = p[4];
+    for (int i = 0; i < 4; i++) {
+        BattleReplayUnitSnap *s = &k->u[i];
+        const uint8_t *q = p + 8 + i * RP_UNIT_BYTES;
+        s->x = (int8_t)q[0];
+        s->y = (int8_t)q[1];
+        s->hp = (int16_t)get_u16(q + 2);
+        s->st = (int16_t)get_u16(q + 4);
+        s->alive = (q[6] & 1) ? 1 : 0;
+        s->counter_ready = (q[6] & 2) ? 1 : 0;
+        s->counter_range = (int8_t)q[7];
+        s->counter_skill = (int16_t)get_u16(q + 8);
+    }
+}
+
+bool battle_replay_save(const BattleReplay *r, const char *path) {
+    if (!r || !path) return false;
+
+    size_t size = RP_HEADER_BYTES + RP_STAGE_BYTES + RP_DEFS_BYTES + RP_SSUM_BYTES + RP_INFO_BYTES * 2
+                + (size_t)r->turn_count * RP_TURN_BYTES
+                + (size_t)r->key_count * RP_KEY_BYTES + 4;
+    uint8_t *buf = (uint8_t*)malloc(size);
+    if (!buf) return false;
+
+    uint8_t *p = buf;
+    memcpy(p, BATTLE_REPLAY_MAGIC, 4);
+    put_u16(p + 4, BATTLE_REPLAY_VERSION);
+    put_u16(p + 6, BATTLE_REPLAY_KEYFRAME_INTERVAL);
+    put_u32(p + 8, r->seed);
+    put_u32(p + 12, (uint32_t)r->turn_count);
+    put_u32(p + 16, (uint32_t)r->key_count);
+    p += RP_HEADER_BYTES;
+
+    memset(p, 0, RP_STAGE_BYTES);
+    memcpy(p, r->stage_id, strnlen(r->stage_id, RP_STAGE_BYTES - 1));
+    p += RP_STAGE_BYTES;
+
+    put_u32(p, r->defs_checksum);
+    p += RP_DEFS_BYTES;
+    put_u32(p, r->stage_checksum);
+    p += RP_SSUM_BYTES;
+
+    put_info(p, &r->info[TEAM_P1]); p += RP_INFO_BYTES;
+    put_info(p, &r->info[TEAM_P2]); p += RP_INFO_BYTES;
+
+    for (int t = 0; t < r->turn_count; t++) {
+        // record_turn で validate 済みなので pack は失敗しない
+        battle_cmd_pack(&r->turns[t].cmd[TEAM_P1], p);
+        battle_cmd_pack(&r->turns[t].cmd[TEAM_P2], p + TURNCMD_WIRE_BYTES);
+        p += RP_TURN_BYTES;
+    }
+    for (int i = 0; i < r->key_count; i++) {
+        put_key(p, &r->keys[i]);
+        p += RP_KEY_BYTES;
+    }
+    put_u32(p, fnv1a32(buf, (size_t)(p - buf)));
+
+    FILE *fp = fopen(path, "wb");
+    bool ok = false;
+    if (fp) {
+        ok = fwrite(buf, 1, size, fp) == size;
+        ok = (fclose(fp) == 0) && ok;
+    }
+    free(buf);
+    return ok;
+}
+
+bool battle_replay_load(BattleReplay *r, const char *path) {
+    if (!r || !path) return false;
+    memset(r, 0, sizeof(*r));
+
+    FILE *fp = fopen(path, "rb");
+    if (!fp) return false;
+    fseek(fp, 0, SEEK_END);
+    long fsz = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    if (fsz < RP_HEADER_BYTES + RP_INFO_BYTES * 2 + 4) { fclose(fp); return false; }
+
+    uint8_t *buf = (uint8_t*)malloc((size_t)fsz);
+    if (!buf) { fclose(fp); return false; }
+    bool ok = fread(buf, 1, (size_t)fsz, fp) == (size_t)fsz;
+    fclose(fp);
+
+    const uint8_t *p = buf;
+    uint32_t turns = 0, keys = 0;
+    uint16_t ver = 0;
+    size_t stage_bytes = 0, defs_bytes = 0, ssum_bytes = 0;
+    if (ok) {
+        ver   = get_u16(p + 4);
+        turns = get_u32(p + 12);
+        keys  = get_u32(p + 16);
+        stage_bytes = (ver >= 2) ? RP_STAGE_BYTES : 0;
+        defs_bytes  = (ver >= 3) ? RP_DEFS_BYTES : 0;
+        ssum_bytes  = (ver >= 4) ? RP_SSUM_BYTES : 0;
+        ok = memcmp(p, BATTLE_REPLAY_MAGIC, 4) == 0
+          && ver >= 1 && ver <= BATTLE_REPLAY_VERSION
+          && turns <= 0xFFFFu && keys <= turns + 1u
+          && (size_t)fsz == RP_HEADER_BYTES + stage_bytes + defs_bytes + ssum_bytes + RP_INFO_BYTES * 2
+                          + (size_t)turns * RP_TURN_BYTES + (size_t)keys * RP_KEY_BYTES + 4
+          && get_u32(buf + fsz - 4) == fnv1a32(buf, (size_t)fsz - 4);
+    }
+    if (ok) {
+        r->seed = get_u32(p + 8);
+        p += RP_HEADER_BYTES;
+        if (stage_bytes) {
+            memcpy(r->stage_id, p, RP_STAGE_BYTES - 1);
+            r->stage_id[RP_STAGE_BYTES - 1] = '\0';
+            p += stage_bytes;
+        }
+        if (defs_bytes) {
+            r->defs_checksum = get_u32(p);
+            p += defs_bytes;
+        }
+        if (ssum_bytes) {
+            r->stage_checksum = get_u32(p);
+            p += ssum_bytes;
+        }
+        get_info(p, &r->info[TEAM_P1]); p += RP_INFO_BYTES;
+        get_info(p, &r->info[TEAM_P2]); p += RP_INFO_BYTES;
+
+        r->turns = (BattleReplayTurn*)calloc(turns ? turns : 1, sizeof(BattleReplayTurn));
+        r->keys  = (BattleReplayKeyframe*)calloc(keys ? keys : 1, sizeof(BattleReplayKeyframe));
+        r->turn_cap = (int)turns;
+        r->key_cap  = (int)keys;
+        ok = r->turns && r->keys;
+    }
+    for (uint32_t t = 0; ok && t < turns; t++) {
+        ok = battle_cmd_unpack(p, &r->turns[t].cmd[TEAM_P1])
+          && battle_cmd_unpack(p + TURNCMD_WIRE_BYTES, &r->turns[t].cmd[TEAM_P2]);
+        p += RP_TURN_BYTES;
+        r->turn_count++;
+    }
+    for (uint32_t i = 0; ok && i < keys; i++) {
+        get_key(p, &r->keys[i]);
+        p += RP_KEY_BYTES;
+        r->key_count++;
+    }
+    free(buf);
+
+    if (!ok) {
+        battle_replay_free(r);
+        return false;
+    }
+
+    // 地形なしで再生すると別の対戦になる
+    if (r->stage_id[0]) {
+        const BattleStage *st = battle_stage_find(r->stage_id);
+        if (!st || (r->stage_checksum && st->checksum != r->stage_checksum)) {
+            printf("[REPLAY] %s: stage '%s' %s, not playable\n", path, r->stage_id,
+                   st ? "differs from the recorded one" : "is not loaded");
+            battle_replay_free(r);
+            return false;
+        }
+    }
+
+    // 定義が記録時と違えば同じ命令でも結果が変わる
+    if (r->defs_checksum && r->defs_checksum != battle_defs_checksum()) {
+        printf("[REPLAY] %s: recorded with battle defs %08x, loaded %08x, not playable\n",
+               path, (unsigned)r->defs_checksum, (unsigned)battle_defs_checksum());
+        battle_replay_free(r);
+        return false;
+    }
+
+    // 記録時とルール/定義が変わっていれば再シミュレートは記録どおりにならない。
+    //   キーフレームを作り直すと「記録と違う対戦」を再生してしまうので読み込み失敗にする
+    int diff = battle_replay_verify_keyframes(r);
+    if (diff > 0) {
+        printf("[REPLAY] %s: %d keyframe(s) differ from re-simulation, not playable\n", path, diff);
+        battle_replay_free(r);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,111 @@
+// battle/battle_replay.h
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "battle_core.h"
+#include "../net/net_protocol.h"   // NetGameInfo
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ===============================
+//  対戦の開始条件（scene / server / 再生で共通）
+// ===============================
+// 主人公固定ステ（1P/2P共通）
+#define BATTLE_HERO_HP    150
+#define BATTLE_HERO_ATK   10
+#define BATTLE_HERO_SPD   10
+#define BATTLE_HERO_ST    100
+#define BATTLE_HERO_MOVE  4
+
+// 初期配置（仕様固定）
+#define BATTLE_INIT_P1_X   0
+#define BATTLE_INIT_P2_X   20
+#define BATTLE_INIT_HERO_Y 10
+#define BATTLE_INIT_GIRL_Y 12
+
+// NetGameInfo 2つ（P1=自分視点）から開始局面を作る
+// b は未使用か battle_core_free 済みであること
+bool battle_replay_setup_core(BattleCore *b, const NetGameInfo *p1, const NetGameInfo *p2);
+
+// 両者の GAME_INFO から対戦の乱数キーを決める
+//   - 引数の順に依らない（各クライアントは自分を P1 として呼ぶ。サーバは接続順）
+//     → 両クライアントとサーバが通信なしで同じ値になる
+uint32_t battle_replay_match_seed(const NetGameInfo *a, const NetGameInfo *b);
+
+// ===============================
+//  リプレイ
+//   - 開始条件（NetGameInfo×2 + seed + ステージid + 定義のチェックサム）と毎ターンの TurnCmd を記録
+//   - BATTLE_REPLAY_KEYFRAME_INTERVAL ターンごとに局面スナップショットを持ち、
+//     シークは「直前のキーフレームから再シミュレート」で行う
+//   - ファイルはリトルエンディアン固定長（TurnCmd は battle_cmd_pack の14byte×2）
+// ===============================
+#define BATTLE_REPLAY_MAGIC   "TVSR"
+#define BATTLE_REPLAY_VERSION 4      // 2: ステージid を追加（1 も読める＝ステージなし）
+                                     // 3: 定義のチェックサムを追加（違う定義では読み込み失敗。2 以前は照合なし）
+                                     // 4: ステージのチェックサムを追加（盤面が違えば読み込み失敗）
+#define BATTLE_REPLAY_KEYFRAME_INTERVAL 16
+
+typedef struct {
+    TurnCmd cmd[2];            // [TEAM_P1], [TEAM_P2]（どちらも P1 視点の座標）
+} BattleReplayTurn;
+
+typedef struct {
+    int8_t  x, y;
+    int16_t hp, st;
+    uint8_t alive;
+    uint8_t counter_ready;
+    int8_t  counter_range;
+    int16_t counter_skill;     // battle_skill_index_of()（-1=なし）
+} BattleReplayUnitSnap;
+
+typedef struct {
+    int turn_index;            // このターンを実行する直前の局面（0=初期局面）
+    uint8_t phase;
+    BattleReplayUnitSnap u[4];
+} BattleReplayKeyframe;
+
+typedef struct {
+    uint32_t seed;             // 対戦の乱数キー（BattleCore.rng_seed。battle_replay_match_seed）
+    NetGameInfo info[2];       // [TEAM_P1], [TEAM_P2]
+    char stage_id[BATTLE_STAGE_ID_MAX];   // 空 = ステージなし。再生時は battle_stage_find() で引く
+    uint32_t stage_checksum;   // BattleStage.checksum（ステージなし・ver 3 以前は 0 = 照合しない）
+    uint32_t defs_checksum;    // 記録時の battle_defs_checksum()（init で入る。0 = 照合しない）
+
+    BattleReplayTurn *turns;
+    int turn_count;
+    int turn_cap;
+
+    BattleReplayKeyframe *keys;   // turn_index 昇順
+    int key_count;
+    int key_cap;
+} BattleReplay;
+
+void battle_replay_init(BattleReplay *r, const NetGameInfo *p1, const NetGameInfo *p2, uint32_t seed);
+void battle_replay_free(BattleReplay *r);
+
+// 記録する対戦のステージ（init の後に。NULL ならステージなし）
+void battle_replay_set_stage(BattleReplay *r, const BattleStage *stage);
+
+// 記録：before = このターンを実行する直前の局面（submit 前）
+// 命令が battle_cmd_validate を通らない場合は false（記録しない）
+bool battle_replay_record_turn(BattleReplay *r, const BattleCore *before,
+                               const TurnCmd *p1, const TurnCmd *p2);
+
+bool battle_replay_save(const BattleReplay *r, const char *path);
+// 記録時のステージが読み込まれていない/盤面が違う、定義のチェックサムが違う場合は false。
+// さらにキーフレームを再シミュレーション結果と照合し、食い違えば（ルール変更後の古いファイル等）false
+bool battle_replay_load(BattleReplay *r, const char *path);
+
+// 先頭から再シミュレートしてキーフレームと照合する（r は変更しない）。戻り値=食い違った件数
+int battle_replay_verify_keyframes(const BattleReplay *r);
+
+// turn_index ターン目を実行する直前の局面を out に作る（turn_count で最終局面）
+// out は未使用か battle_core_free 済みであること。ステージはカタログから引く（読み込み済みであること）
+bool battle_replay_seek(const BattleReplay *r, int turn_index, BattleCore *out);
+
+#ifdef __cplusplus
+}
+#endif
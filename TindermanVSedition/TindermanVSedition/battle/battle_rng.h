@@ -0,0 +1,70 @@
+// battle/battle_rng.h
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+// ===============================
+//  カウンタ方式の乱数（Philox4x32-10）
+//   - 状態を持たない：値は (対戦seed, ターン, ユニット, 用途, 通し番号) だけで決まる
+//     → どの順で引いても、どのスレッドで引いても、どのクライアントで引いても同じ値
+//     → 途中の1個を O(1) で引き直せる（リプレイのシーク/探索の分岐でも列がずれない）
+//   - 1ブロック（Philox 1回）で 32bit×4 個。通し番号 n は n/4 ブロック目の n%4 語
+//   - カウンタ：{ n/4, turn, unit | purpose<<8, 0 }  キー：seed の下位/上位32bit
+//   - 値は Random123 の既知解（battle_bench rng）で検証する
+// ===============================
+typedef enum {
+    BRNG_CRIT = 1,      // 会心（予約）
+    BRNG_EVADE,         // 回避（予約）
+    BRNG_AI,            // AI のランダム手（プレイアウト/ε-greedy）
+    BRNG_USER = 0x80,   // ツール側で自由に使う（BRNG_USER + k）
+} BattleRngPurpose;
+
+#define BATTLE_RNG_PHILOX_M0 0xD2511F53u
+#define BATTLE_RNG_PHILOX_M1 0xCD9E8D57u
+#define BATTLE_RNG_PHILOX_W0 0x9E3779B9u
+#define BATTLE_RNG_PHILOX_W1 0xBB67AE85u
+
+static inline void battle_rng_philox4x32(const uint32_t ctr[4], const uint32_t key[2], uint32_t out[4]) {
+    uint32_t c0 = ctr[0], c1 = ctr[1], c2 = ctr[2], c3 = ctr[3];
+    uint32_t k0 = key[0], k1 = key[1];
+    for (int r = 0; r < 10; r++) {
+        if (r > 0) { k0 += BATTLE_RNG_PHILOX_W0; k1 += BATTLE_RNG_PHILOX_W1; }
+        uint64_t p0 = (uint64_t)BATTLE_RNG_PHILOX_M0 * c0;
+        uint64_t p1 = (uint64_t)BATTLE_RNG_PHILOX_M1 * c2;
+        uint32_t n0 = (uint32_t)(p1 >> 32) ^ c1 ^ k0;
+        uint32_t n2 = (uint32_t)(p0 >> 32) ^ c3 ^ k1;
+        c0 = n0; c1 = (uint32_t)p1;
+        c2 = n2; c3 = (uint32_t)p0;
+    }
+    out[0] = c0; out[1] = c1; out[2] = c2; out[3] = c3;
+}
+
+// (turn, unit, purpose) の n/4 ブロック目を丸ごと（4語まとめて使うとき用）
+static inline void battle_rng_block(uint64_t seed, int turn, int unit, BattleRngPurpose purpose,
+                                    uint32_t block, uint32_t out[4]) {
+    const uint32_t ctr[4] = { block, (uint32_t)turn,
+                              (uint32_t)(uint8_t)unit | ((uint32_t)purpose << 8), 0 };
+    const uint32_t key[2] = { (uint32_t)seed, (uint32_t)(seed >> 32) };
+    battle_rng_philox4x32(ctr, key, out);
+}
+
+static inline uint32_t battle_rng_u32(uint64_t seed, int turn, int unit, BattleRngPurpose purpose, uint32_t n) {
+    uint32_t v[4];
+    battle_rng_block(seed, turn, unit, purpose, n >> 2, v);
+    return v[n & 3];
+}
+
+// [0, bound)（乗算で写す。bound が小さいので偏りは無視できる＝棄却ループなしで O(1) を保つ）
+static inline uint32_t battle_rng_below(uint64_t seed, int turn, int unit, BattleRngPurpose purpose,
+                                        uint32_t n, uint32_t bound) {
+    if (bound <= 1) return 0;
+    return (uint32_t)(((uint64_t)battle_rng_u32(seed, turn, unit, purpose, n) * bound) >> 32);
+}
+
+// pct% で true
+static inline bool battle_rng_chance(uint64_t seed, int turn, int unit, BattleRngPurpose purpose,
+                                     uint32_t n, int pct) {
+    if (pct <= 0) return false;
+    if (pct >= 100) return true;
+    return (int)battle_rng_below(seed, turn, unit, purpose, n, 100) < pct;
+}
@@ -3,66 +3,30 @@
 #include <string.h>
 #include <stdio.h>
 
-static const SkillDef g_skills[] = {
-    // =========================
-    // hero
-    // =========================
-    // 技1：ST15 / 射程3 / ATK
-    { "hero_tech1", "アルティメットインパクト", SKTYPE_ATTACK, 3, 15, SKT_SINGLE, 0, 0, 1, false },
+// 中身は battle_defs_load()（assets/data/battle_defs.txt）で入る
+static SkillDef g_skills[BATTLE_SKILL_MAX];
+static int g_skill_count = 0;
 
-    // 技2：ST30 / 射程8 / ATK+10
-    { "hero_tech2", "魔閃光", SKTYPE_ATTACK, 8, 30, SKT_SINGLE, 10, 0, 1, false },
-
-    // 技3：ST50 / 射程∞ / 味方全員HP+30
-    // range=-1 を「射程∞」として扱う（射程判定/表示はスキップ）
-    { "hero_tech3", "エリアリカバー", SKTYPE_HEAL, -1, 50, SKT_AOE, 30, 0, 1, false },
-
-    // =========================
-    // himaris
-    // =========================
-    // 技1：ST5 / 射程2 / ATK
-    { "himari_1", "神越演舞", SKTYPE_ATTACK, 2, 5, SKT_SINGLE, 0, 0, 1, false },
-
-    // 技2：カウンター ST30 / 自身から4マス以内の敵から攻撃を受けたとき / 敵ATK×2
-    // 表現：COUNTER / range=4 / mult=2 / power=0
-    { "himari_2", "メトロアタック", SKTYPE_COUNTER, 4, 30, SKT_SINGLE, 0, 0, 3, false },
-
-    // 技3：ST30 / 射程5 / ATK+10
-    { "himari_3", "超神撃拳", SKTYPE_ATTACK, 5, 30, SKT_SINGLE, 10, 0, 1, false },
-
-    // タッグ：バトル中1回 / 射程5 / ATK×3
-    { "himari_tag", "ひまりTAG", SKTYPE_ATTACK, 5, 30, SKT_SINGLE, 0, 0, 3, true },
-
-    // =========================
-    // kiritan
-    // =========================
-    // 技1：ST20 / 射程12 / ATK+10
-    { "kiritan_1", "裁きの刃", SKTYPE_ATTACK, 12, 20, SKT_SINGLE, 10, 0, 1, false },
-
-    // 技2：ST35 / 射程16 / ATK+10
-    { "kiritan_2", "粉塵爆発", SKTYPE_ATTACK, 16, 35, SKT_SINGLE, 10, 0, 1, false },
-
-    // 技3：ST40 / 射程12（範囲攻撃）/ ATK+15 / 半径1
-    { "kiritan_3", "スターダストフォール", SKTYPE_ATTACK, -1, 40, SKT_AOE, 15, 8, 1, false },
-
-    // タッグ：バトル中1回 / 射程10 / ATK×6
-    { "kiritan_tag", "覚醒の一撃", SKTYPE_ATTACK, 10, 40, SKT_SINGLE, 0, 0, 6, true },
+bool battle_skill_table_set(const SkillDef *defs, int n)
+{
+    if (!defs || n < 0 || n > BATTLE_SKILL_MAX) return false;
+    memcpy(g_skills, defs, sizeof(SkillDef) * (size_t)n);
+    memset(g_skills + n, 0, sizeof(SkillDef) * (size_t)(BATTLE_SKILL_MAX - n));
+    g_skill_count = n;
+    return true;
+}
 
-    // =========================
-    // fallback（未知のgirl用）
-    // =========================
-    { "girl_1", "ガール1", SKTYPE_ATTACK, 3, 10, SKT_SINGLE, 0, 0, 1, false },
-    { "girl_2", "ガール2", SKTYPE_ATTACK, 4, 20, SKT_SINGLE, 10, 0, 1, false },
-    { "girl_3", "ガール範囲", SKTYPE_ATTACK, 4, 30, SKT_AOE, 10, 1, 1, false },
-    { "girl_tag", "ガールTAG", SKTYPE_ATTACK, 4, 40, SKT_SINGLE, 0, 0, 3, true },
-};
+int battle_skill_count(void)
+{
+    return g_skill_count;
+}
 
 const SkillDef* battle_skill_get(const char* skill_id)
 {
     if (!skill_id) return NULL;
 
-    const size_t n = sizeof(g_skills) / sizeof(g_skills[0]);
-    for (size_t i = 0; i < n; i++) {
+    const int n = g_skill_count;
+    for (int i = 0; i < n; i++) {
         if (strcmp(g_skills[i].id, skill_id) == 0) {
             return &g_skills[i];
         }
@@ -70,12 +34,24 @@ const SkillDef* battle_skill_get(const char* skill_id)
     return NULL;
 }
 
-const char* battle_skill_movie_path(const char* skill_id)
+int battle_skill_index_of(const char* skill_id)
 {
-    static char path[256];
-    if (!skill_id) return NULL;
+    const SkillDef *s = battle_skill_get(skill_id);
+    if (!s) return -1;
+    return (int)(s - g_skills);
+}
+
+const SkillDef* battle_skill_at(int index)
+{
+    if (index < 0 || index >= g_skill_count) return NULL;
+    return &g_skills[index];
+}
+
+bool battle_skill_movie_path(const char* skill_id, char* out, size_t out_sz)
+{
+    if (!skill_id || !out || out_sz == 0) return false;
 
     // ここは「skill_idのファイル名を信用する」前提（必要ならバリデーション追加）
-    snprintf(path, sizeof(path), "assets/cutin/%s.mp4", skill_id);
-    return path;
+    int n = snprintf(out, out_sz, "assets/cutin/%s.mp4", skill_id);
+    return n > 0 && (size_t)n < out_sz;
 }
@@ -1,6 +1,7 @@
 // battle/battle_skills.h
 #pragma once
 #include <stdbool.h>
+#include <stddef.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -17,9 +18,14 @@ typedef enum {
     SKT_AOE    = 1,   // 範囲/全体
 } SkillTarget;
 
+// 表の大きさ（中身は assets/data/battle_defs.txt → battle_defs_load() で入る）
+#define BATTLE_SKILL_MAX      64
+#define BATTLE_SKILL_ID_MAX   24
+#define BATTLE_SKILL_NAME_MAX 48
+
 typedef struct {
-    const char *id;          // 内部ID（cmd/jsonの参照キー）
-    const char *name;        // 表示名（UI/ログ用）
+    char id[BATTLE_SKILL_ID_MAX];       // 内部ID（cmd/jsonの参照キー）
+    char name[BATTLE_SKILL_NAME_MAX];   // 表示名（UI/ログ用。UTF-8）
     SkillType type;          // ATTACK / HEAL / COUNTER
 
     int range;               // 射程（>=0: manhattan距離, <0: 無限扱い）
@@ -35,8 +41,18 @@ typedef struct {
 // skill_id から定義を引く（見つからなければNULL）
 const SkillDef* battle_skill_get(const char* skill_id);
 
-// cutin動画パスを生成（assets/cutin/<skill_id>.mp4）
-const char* battle_skill_movie_path(const char* skill_id);
+// 定義表の通し番号 <-> 定義（リプレイ等の保存用。見つからなければ -1 / NULL）
+int battle_skill_index_of(const char* skill_id);
+const SkillDef* battle_skill_at(int index);
+
+// 読み込まれている技の数
+int battle_skill_count(void);
+
+// 表を丸ごと差し替える（battle_defs.c 専用。要素の場所は変わらない）
+bool battle_skill_table_set(const SkillDef *defs, int n);
+
+// cutin動画パスを out に生成（assets/cutin/<skill_id>.mp4）。書けたら true
+bool battle_skill_movie_path(const char* skill_id, char* out, size_t out_sz);
 
 // ===== 便利関数（ロジック側での一貫解釈）=====
 
@@ -0,0 +1,332 @@
+// battle/battle_stage.c
+#include "battle_stage.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// 初期配置（battle_replay.h の BATTLE_INIT_*。ここは床に戻す）
+static const Pos k_spawn[4] = { {0, 10}, {0, 12}, {20, 10}, {20, 12} };
+
+static BattleStage *g_stages[BATTLE_STAGE_MAX];
+static int g_stage_count = 0;
+
+// ---------------------------------
+// 前計算
+// ---------------------------------
+static int enter_cost(const BattleStage *s, int c) {
+    switch (s->tile[c]) {
+    case BTILE_WALL: return -1;
+    case BTILE_SLOW: return 2;
+    default:         return 1;
+    }
+}
+
+// origin からの最小移動コスト（コストは1か2なので距離ごとのバケツで足りる）
+#define DIST_BUCKETS 256
+#define PUSH_MAX (BATTLE_STAGE_CELLS * 4 + 1)
+
+static void solve_dist(const BattleStage *s, int origin, uint8_t out[BATTLE_STAGE_CELLS]) {
+    static const int kdx[4] = { 1, -1, 0, 0 };
+    static const int kdy[4] = { 0, 0, 1, -1 };
+
+    int16_t head[DIST_BUCKETS];
+    int16_t next[PUSH_MAX];
+    int16_t cell[PUSH_MAX];
+    int np = 0;
+
+    memset(out, BATTLE_STAGE_UNREACHABLE, BATTLE_STAGE_CELLS);
+    for (int i = 0; i < DIST_BUCKETS; i++) head[i] = -1;
+    if (s->tile[origin] == BTILE_WALL) return;
+
+    out[origin] = 0;
+    cell[np] = (int16_t)origin; next[np] = -1; head[0] = (int16_t)np++;
+
+    for (int d = 0; d < BATTLE_STAGE_UNREACHABLE; d++) {
+        for (int e = head[d]; e >= 0; e = next[e]) {
+            int c = cell[e];
+            if (out[c] != d) continue;   // もっと近い経路で確定済み
+            int x = c % MAP_W, y = c / MAP_W;
+            for (int k = 0; k < 4; k++) {
+                int nx = x + kdx[k], ny = y + kdy[k];
+                if (nx < 0 || nx >= MAP_W || ny < 0 || ny >= MAP_H) continue;
+                int nc = ny * MAP_W + nx;
+                int w = enter_cost(s, nc);
+                if (w < 0) continue;
+                int nd = d + w;
+                if (nd >= BATTLE_STAGE_UNREACHABLE || nd >= out[nc]) continue;
+                out[nc] = (uint8_t)nd;
+                if (np >= PUSH_MAX) continue;
+                cell[np] = (int16_t)nc; next[np] = head[nd]; head[nd] = (int16_t)np++;
+            }
+        }
+    }
+}
+
+static bool is_wall_xy(const BattleStage *s, int x, int y) {
+    return s->tile[y * MAP_W + x] == BTILE_WALL;
+}
+
+// マス中心どうしを結ぶ線分が通るマス（端点は除く）に壁があるか
+//   - 線分そのもので判定するので向きに依らない（a→b と b→a が同じ結果）
+//   - ちょうど角を通るときは、角を挟む2マスが両方壁のときだけ遮る
+static bool line_clear(const BattleStage *s, int x0, int y0, int x1, int y1) {
+    int dx = x1 - x0, dy = y1 - y0;
+    int nx = dx < 0 ? -dx : dx, ny = dy < 0 ? -dy : dy;
+    int sx = dx < 0 ? -1 : 1, sy = dy < 0 ? -1 : 1;
+    int x = x0, y = y0;
+
+    for (int ix = 0, iy = 0; ix < nx || iy < ny; ) {
+        int d = (1 + 2 * ix) * ny - (1 + 2 * iy) * nx;
+        if (d == 0) {
+            if (is_wall_xy(s, x + sx, y) && is_wall_xy(s, x, y + sy)) return false;
+            x += sx; y += sy; ix++; iy++;
+        } else if (d < 0) {
+            x += sx; ix++;
+        } else {
+            y += sy; iy++;
+        }
+        if ((x != x1 || y != y1) && is_wall_xy(s, x, y)) return false;
+    }
+    return true;
+}
+
+static void set_los(BattleStage *s, int a, int b) {
+    s->los[a][b >> 6] |= 1ull << (b & 63);
+    s->los[b][a >> 6] |= 1ull << (a & 63);
+}
+
+void battle_stage_precompute(BattleStage *s) {
+    if (!s) return;
+
+    s->walls = s->slows = 0;
+    uint32_t h = 2166136261u;   // FNV-1a
+    for (int c = 0; c < BATTLE_STAGE_CELLS; c++) {
+        if (s->tile[c] == BTILE_WALL) s->walls++;
+        if (s->tile[c] == BTILE_SLOW) s->slows++;
+        h ^= s->tile[c];
+        h *= 16777619u;
+    }
+    s->checksum = h;
+
+    for (int c = 0; c < BATTLE_STAGE_CELLS; c++) solve_dist(s, c, s->dist[c]);
+
+    memset(s->los, 0, sizeof(s->los));
+    for (int a = 0; a < BATTLE_STAGE_CELLS; a++) {
+        int ax = a % MAP_W, ay = a / MAP_W;
+        for (int b = a; b < BATTLE_STAGE_CELLS; b++) {
+            if (s->walls == 0 || line_clear(s, ax, ay, b % MAP_W, b / MAP_W)) set_los(s, a, b);
+        }
+    }
+}
+
+// ---------------------------------
+// 読み込み
+// ---------------------------------
+static int tile_of_char(char ch) {
+    switch (ch) {
+    case '.': return BTILE_FLOOR;
+    case '#': return BTILE_WALL;
+    case '~': return BTILE_SLOW;
+    default:  return -1;
+    }
+}
+
+bool battle_stage_load_file(BattleStage *s, const char *id, const char *path) {
+    if (!s || !id || !path) return false;
+    memset(s, 0, sizeof(*s));
+    snprintf(s->id, sizeof(s->id), "%s", id);
+
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        fprintf(stderr, "[STAGE] %s: cannot open\n", path);
+        return false;
+    }
+
+    char line[256];
+    int row = 0, lineno = 0;
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), fp)) {
+        lineno++;
+        size_t n = strcspn(line, "\r\n");
+        line[n] = '\0';
+        if (n == 0 || strncmp(line, "//", 2) == 0) continue;
+
+        if (row >= MAP_H || n != MAP_W) {
+            fprintf(stderr, "[STAGE] %s:%d: expected %d rows of %d tiles\n", path, lineno, MAP_H, MAP_W);
+            ok = false;
+            break;
+        }
+        for (int x = 0; x < MAP_W; x++) {
+            int t = tile_of_char(line[x]);
+            if (t < 0) {
+                fprintf(stderr, "[STAGE] %s:%d: unknown tile '%c'\n", path, lineno, line[x]);
+                ok = false;
+                break;
+            }
+            s->tile[row * MAP_W + x] = (uint8_t)t;
+        }
+        row++;
+    }
+    fclose(fp);
+
+    if (ok && row != MAP_H) {
+        fprintf(stderr, "[STAGE] %s: %d rows (expected %d)\n", path, row, MAP_H);
+        ok = false;
+    }
+    for (int y = 0; ok && y < MAP_H; y++) {
+        for (int x = 0; x < MAP_W / 2; x++) {
+            if (s->tile[y * MAP_W + x] != s->tile[y * MAP_W + (MAP_W - 1 - x)]) {
+                fprintf(stderr, "[STAGE] %s: not left-right symmetric at row %d\n", path, y + 1);
+                ok = false;
+                break;
+            }
+        }
+    }
+    if (!ok) return false;
+
+    for (int i = 0; i < 4; i++) s->tile[battle_stage_cell(k_spawn[i])] = BTILE_FLOOR;
+    battle_stage_precompute(s);
+
+    // 陣地どうしが繋がっていないと決着がつかない
+    if (battle_stage_dist(s, k_spawn[0], k_spawn[2]) == BATTLE_STAGE_UNREACHABLE ||
+        battle_stage_dist(s, k_spawn[1], k_spawn[3]) == BATTLE_STAGE_UNREACHABLE) {
+        fprintf(stderr, "[STAGE] %s: spawns are not connected\n", path);
+        return false;
+    }
+    return true;
+}
+
+// ---------------------------------
+// カタログ
+// ---------------------------------
+int battle_stage_catalog_load(const char *dir) {
+    if (!dir) return g_stage_count;
+
+    char path[512];
+    snprintf(path, sizeof(path), "%s/stages.txt", dir);
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        fprintf(stderr, "[STAGE] %s: cannot open\n", path);
+        return g_stage_count;
+    }
+
+    char line[128];
+    while (fgets(line, sizeof(line), fp) && g_stage_count < BATTLE_STAGE_MAX) {
+        line[strcspn(line, "\r\n \t")] = '\0';
+        if (!line[0] || strncmp(line, "//", 2) == 0) continue;
+        if (battle_stage_find(line)) continue;
+
+        BattleStage *s = (BattleStage*)malloc(sizeof(*s));
+        if (!s) break;
+        char spath[512];
+        snprintf(spath, sizeof(spath), "%s/%s.txt", dir, line);
+        if (!battle_stage_load_file(s, line, spath)) {
+            free(s);
+            continue;
+        }
+        g_stages[g_stage_count++] = s;
+    }
+    fclose(fp);
+    return g_stage_count;
+}
+
+int battle_stage_catalog_count(void) {
+    return g_stage_count;
+}
+
+const BattleStage* battle_stage_catalog_at(int i) {
+    return (i >= 0 && i < g_stage_count) ? g_stages[i] : NULL;
+}
+
+const BattleStage* battle_stage_find(const char *id) {
+    if (!id || !id[0]) return NULL;
+    for (int i = 0; i < g_stage_count; i++) {
+        if (strcmp(g_stages[i]->id, id) == 0) return g_stages[i];
+    }
+    return NULL;
+}
+
+const BattleStage* battle_stage_for_seed(uint32_t seed) {
+    if (g_stage_count <= 0) return NULL;
+    return g_stages[(seed >> 8) % (uint32_t)g_stage_count];
+}
+
+const BattleStage* battle_stage_rotation(int game) {
+    if (g_stage_count <= 0 || game < 0) return NULL;
+    return g_stages[(game / 2) % g_stage_count];
+}
+
+uint32_t battle_stage_catalog_checksum(void) {
+    if (g_stage_count <= 0) return 0;
+    uint32_t h = 2166136261u;   // FNV-1a
+    for (int i = 0; i < g_stage_count; i++) {
+        const BattleStage *st = g_stages[i];
+        for (const char *c = st->id; *c; c++) { h ^= (uint8_t)*c; h *= 16777619u; }
+        for (int k = 0; k < 4; k++) { h ^= (uint8_t)(st->checksum >> (k * 8)); h *= 16777619u; }
+    }
+    return h;
+}
+
+// ---------------------------------
+// AI 用の移動先選び
+// ---------------------------------
+Pos battle_stage_approach(const BattleStage *s, Pos from, int mv, Pos target) {
+    Pos best = from;
+    int bd = battle_stage_dist(s, from, target), bm = 0;
+    if (bd == 0) bd = BATTLE_STAGE_UNREACHABLE + 1;
+
+    // 1歩のコストは1以上なので、行けるマスは from からマンハッタン mv 以内に収まる
+    for (int dy = -mv; dy <= mv; dy++) {
+        int rx = mv - (dy < 0 ? -dy : dy);
+        for (int dx = -rx; dx <= rx; dx++) {
+            Pos p = { (int8_t)(from.x + dx), (int8_t)(from.y + dy) };
+            if (!battle_stage_in_map(p)) continue;
+            int m = battle_stage_dist(s, from, p);
+            if (m > mv) continue;
+            int d = battle_stage_dist(s, p, target);
+            if (d == 0) continue;
+            if (d < bd || (d == bd && m < bm)) { best = p; bd = d; bm = m; }
+        }
+    }
+    return best;
+}
+
+Pos battle_stage_retreat(const BattleStage *s, Pos from, int mv, Pos away) {
+    Pos best = from;
+    int bd = battle_stage_dist(s, away, from), bm = 0;
+
+    for (int dy = -mv; dy <= mv; dy++) {
+        int rx = mv - (dy < 0 ? -dy : dy);
+        for (int dx = -rx; dx <= rx; dx++) {
+            Pos p = { (int8_t)(from.x + dx), (int8_t)(from.y + dy) };
+            if (!battle_stage_in_map(p)) continue;
+            int m = battle_stage_dist(s, from, p);
+            if (m > mv) continue;
+            int d = battle_stage_dist(s, away, p);
+            if (d == BATTLE_STAGE_UNREACHABLE) d = -1;   // 壁の向こうは「離れた」に数えない
+            if (d > bd || (d == bd && m < bm)) { best = p; bd = d; bm = m; }
+        }
+    }
+    return best;
+}
+
+bool battle_stage_attack_cell(const BattleStage *s, Pos from, int mv, Pos target, int range, Pos *out) {
+    bool found = false;
+    int bm = 0, bd = 0;
+
+    for (int dy = -mv; dy <= mv; dy++) {
+        int rx = mv - (dy < 0 ? -dy : dy);
+        for (int dx = -rx; dx <= rx; dx++) {
+            Pos p = { (int8_t)(from.x + dx), (int8_t)(from.y + dy) };
+            if (!battle_stage_in_map(p)) continue;
+            int m = battle_stage_dist(s, from, p);
+            if (m > mv) continue;
+            int d = manhattan(p, target);
+            if (range >= 0 && d > range) continue;
+            if (!battle_stage_los(s, p, target)) continue;
+            // 移動が少ない方、同じなら target から遠い方（射程ぎりぎりで撃つ）
+            if (!found || m < bm || (m == bm && d > bd)) { found = true; *out = p; bm = m; bd = d; }
+        }
+    }
+    return found;
+}
@@ -0,0 +1,121 @@
+// battle/battle_stage.h
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "battle_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ===============================
+//  ステージ（地形）
+//   - assets/stages/<id>.txt：21行×21文字
+//       '.' 床 / '#' 壁（入れない・見通しを遮る） / '~' 悪路（入るのに移動力2）
+//       '//' で始まる行はコメント。初期配置マスは床に戻す
+//   - 左右対称であること（オンラインは各自が自分を左に置いて x を反転するため。読み込み時に検査）
+//   - 読み込み時に全部前計算して以後は読み取り専用（AI の探索スレッドからそのまま引ける）
+//       dist[from][to] : from から to へ行く最小移動コスト（到達不能=BATTLE_STAGE_UNREACHABLE）
+//                        起点ごとに移動力の上限なしで解いた表なので、(起点, 移動力) の到達判定は
+//                        dist <= 移動力 の1回の比較で済む
+//       los[from]      : from から見通せるマスのビット集合（441bit）
+//   - stage == NULL は従来の何もない盤面（マンハッタン距離・見通し常に可）
+// ===============================
+#define BATTLE_STAGE_CELLS (MAP_W * MAP_H)
+#define BATTLE_STAGE_ID_MAX 16
+#define BATTLE_STAGE_LOS_WORDS ((BATTLE_STAGE_CELLS + 63) / 64)
+#define BATTLE_STAGE_UNREACHABLE 255
+#define BATTLE_STAGE_MAX 16
+
+typedef enum {
+    BTILE_FLOOR = 0,
+    BTILE_WALL,
+    BTILE_SLOW
+} BattleTile;
+
+typedef struct {
+    char id[BATTLE_STAGE_ID_MAX];
+    uint8_t tile[BATTLE_STAGE_CELLS];                       // BattleTile（y * MAP_W + x）
+    uint8_t dist[BATTLE_STAGE_CELLS][BATTLE_STAGE_CELLS];   // [from][to]
+    uint64_t los[BATTLE_STAGE_CELLS][BATTLE_STAGE_LOS_WORDS];
+    int walls, slows;
+    uint32_t checksum;          // tile の FNV-1a（同じ id で盤面が違わないか、オンライン/リプレイで照合）
+} BattleStage;
+
+static inline int battle_stage_cell(Pos p) {
+    return (int)p.y * MAP_W + (int)p.x;
+}
+
+static inline bool battle_stage_in_map(Pos p) {
+    return p.x >= 0 && p.x < MAP_W && p.y >= 0 && p.y < MAP_H;
+}
+
+static inline BattleTile battle_stage_tile(const BattleStage *s, Pos p) {
+    if (!s || !battle_stage_in_map(p)) return BTILE_FLOOR;
+    return (BattleTile)s->tile[battle_stage_cell(p)];
+}
+
+// from から to への移動コスト（stage なしならマンハッタン距離）
+static inline int battle_stage_dist(const BattleStage *s, Pos from, Pos to) {
+    if (!s) return manhattan(from, to);
+    if (!battle_stage_in_map(from) || !battle_stage_in_map(to)) return BATTLE_STAGE_UNREACHABLE;
+    return s->dist[battle_stage_cell(from)][battle_stage_cell(to)];
+}
+
+// 移動力 mv で from から to に行けるか
+static inline bool battle_stage_can_move(const BattleStage *s, Pos from, Pos to, int mv) {
+    return battle_stage_dist(s, from, to) <= mv;
+}
+
+// a と b の間に壁がないか（対称。stage なしなら常に true）
+static inline bool battle_stage_los(const BattleStage *s, Pos a, Pos b) {
+    if (!s) return true;
+    if (!battle_stage_in_map(a) || !battle_stage_in_map(b)) return false;
+    int cb = battle_stage_cell(b);
+    return (s->los[battle_stage_cell(a)][cb >> 6] >> (cb & 63)) & 1u;
+}
+
+// 1枚読み込んで前計算まで（失敗時 false と理由を stderr に）
+bool battle_stage_load_file(BattleStage *s, const char *id, const char *path);
+
+// 盤面（tile）から dist/los/checksum を作り直す（読み込み後・ツールで地形を書き換えた後に呼ぶ）
+void battle_stage_precompute(BattleStage *s);
+
+// ---------------------------------
+// カタログ（dir/stages.txt に並んだ id を順に読む）
+//   - 起動時にメインスレッドで1回。以後の取得は読み取りだけ（スレッド安全）
+//   - 読めないステージは飛ばす。戻り値=読めた枚数
+// ---------------------------------
+int battle_stage_catalog_load(const char *dir);
+int battle_stage_catalog_count(void);
+const BattleStage* battle_stage_catalog_at(int i);
+
+// id から（見つからない/空文字なら NULL）
+const BattleStage* battle_stage_find(const char *id);
+
+// 対戦の乱数キーからステージを決める（両クライアントとサーバで同じ結果。カタログ空なら NULL）
+const BattleStage* battle_stage_for_seed(uint32_t seed);
+
+// ヘッドレスの連戦用：game 番号でカタログを順に回す（先後を入れ替えた2戦ずつ同じステージ。空なら NULL）
+const BattleStage* battle_stage_rotation(int game);
+
+// カタログ全体（並び順・各ステージの id と盤面）のチェックサム（結果の再利用判定用。空なら 0）
+uint32_t battle_stage_catalog_checksum(void);
+
+// ---------------------------------
+// AI 用の移動先選び（stage の表を引くだけ。候補は from の周り移動力ぶんの菱形）
+// ---------------------------------
+// 移動力 mv で行けるマスのうち、歩いて target に一番近いマス（target 自身は除く。同点は移動が少ない方）
+Pos battle_stage_approach(const BattleStage *s, Pos from, int mv, Pos target);
+
+// 移動力 mv で行けるマスのうち、away から歩いて一番遠いマス
+Pos battle_stage_retreat(const BattleStage *s, Pos from, int mv, Pos away);
+
+// 移動力 mv で行けて、target が射程 range（マンハッタン）内かつ見通せるマス（移動が少ない方）
+//   見つからなければ false
+bool battle_stage_attack_cell(const BattleStage *s, Pos from, int mv, Pos target, int range, Pos *out);
+
+#ifdef __cplusplus
+}
+#endif
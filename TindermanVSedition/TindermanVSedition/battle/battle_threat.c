@@ -0,0 +1,154 @@
+// battle/battle_threat.c
+#include "battle_threat.h"
+#include <string.h>
+
+#include "battle_skills.h"
+#include "char_defs.h"
+
+// ---------------------------------
+// profile
+// ---------------------------------
+static Team team_of_ui(int ui) {
+    return (ui < 2) ? TEAM_P1 : TEAM_P2;
+}
+
+static void load_skills(BattleThreatUnit *t, const BattleCore *b, const Unit *u) {
+    t->nsk = 0;
+    const CharDef *cd = char_def_get_or_fallback(u->char_id);
+    if (!cd) return;
+
+    bool tag = (u->team == TEAM_P1) ? b->p1_tag : b->p2_tag;
+    int n = char_def_get_available_skill_count(cd, tag);
+    for (int k = 0; k < n && t->nsk < BATTLE_THREAT_SKILL_MAX; k++) {
+        const SkillDef *sk = battle_skill_get(char_def_get_skill_id_at(cd, tag, k));
+        if (!sk || sk->type != SKTYPE_ATTACK) continue;
+
+        int dmg = u->stats.atk + sk->power;   // battle_core.c の calc_atk_plus_power と同じ
+        if (dmg < 1) dmg = 1;
+
+        BattleThreatSkill *s = &t->sk[t->nsk++];
+        s->st_cost = (int16_t)sk->st_cost;
+        s->dmg = (int16_t)dmg;
+        s->reach = (int16_t)((sk->target == SKT_AOE) ? -1 : sk->range);
+    }
+}
+
+static void build_profile(BattleThreatUnit *t) {
+    memset(t->prof, 0, sizeof(t->prof));
+    if (!t->alive) return;
+
+    int mv = (t->move < 0) ? 0 : t->move;
+    for (int k = 0; k < t->nsk; k++) {
+        const BattleThreatSkill *s = &t->sk[k];
+        if (t->st < s->st_cost) continue;
+
+        int lim = (s->reach < 0) ? BATTLE_THREAT_DIST_MAX : mv + s->reach;
+        if (lim > BATTLE_THREAT_DIST_MAX) lim = BATTLE_THREAT_DIST_MAX;
+        for (int d = 0; d <= lim; d++) {
+            if (t->prof[d] < s->dmg) t->prof[d] = s->dmg;
+        }
+    }
+}
+
+// 攻撃側 t の寄与を被害側 victim のマス表へ sign 倍で足す
+static void add_contrib(BattleThreatMap *m, Team victim, const BattleThreatUnit *t, int sign) {
+    if (!t->alive) return;
+
+    int16_t *c = m->cell[victim];
+    const int16_t *prof = t->prof;
+    for (int y = 0; y < MAP_H; y++) {
+        int dy = y - t->pos.y;
+        if (dy < 0) dy = -dy;
+        int16_t *row = c + y * MAP_W;
+        for (int x = 0; x < MAP_W; x++) {
+            int dx = x - t->pos.x;
+            if (dx < 0) dx = -dx;
+            row[x] = (int16_t)(row[x] + sign * prof[dx + dy]);
+        }
+    }
+}
+
+static void snap_inputs(BattleThreatUnit *t, const Unit *u) {
+    t->pos = u->pos;
+    t->st = u->stats.st;
+    t->move = u->move;
+    t->atk = u->stats.atk;
+    t->alive = u->alive;
+}
+
+// ---------------------------------
+// public
+// ---------------------------------
+void battle_threat_build(BattleThreatMap *m, const BattleCore *b, bool with_cells) {
+    if (!m || !b) return;
+    memset(m, 0, sizeof(*m));
+    m->with_cells = with_cells;
+
+    for (int i = 0; i < 4; i++) {
+        BattleThreatUnit *t = &m->u[i];
+        const Unit *u = &b->units[i];
+        load_skills(t, b, u);
+        snap_inputs(t, u);
+        build_profile(t);
+        m->profile_rebuilds++;
+        if (with_cells) add_contrib(m, (team_of_ui(i) == TEAM_P1) ? TEAM_P2 : TEAM_P1, t, +1);
+    }
+}
+
+int battle_threat_sync(BattleThreatMap *m, const BattleCore *b) {
+    if (!m || !b) return 0;
+
+    BattleThreatUnit old[4];
+    int changed[4], n = 0;
+    for (int i = 0; i < 4; i++) {
+        BattleThreatUnit *t = &m->u[i];
+        const Unit *u = &b->units[i];
+
+        bool moved = (t->pos.x != u->pos.x || t->pos.y != u->pos.y);
+        bool inputs = (t->st != u->stats.st || t->alive != u->alive || t->move != u->move);
+        if (!moved && !inputs) continue;
+
+        old[n] = *t;
+        snap_inputs(t, u);
+        if (inputs) {
+            build_profile(t);
+            m->profile_rebuilds++;
+        }
+        // ST が技コストの境目をまたがない変化なら profile は同じ → 位置が同じなら表はそのまま
+        if (!moved && old[n].alive == t->alive && memcmp(old[n].prof, t->prof, sizeof(t->prof)) == 0) continue;
+
+        changed[n++] = i;
+    }
+    if (n == 0) return 0;
+    m->unit_updates += (uint32_t)n;
+
+    if (m->with_cells) {
+        if (n * 2 > 4) {
+            // 半分より多く変わったら「引いて足す」より profile から足し直す方が軽い（技表は引き直さない）
+            memset(m->cell, 0, sizeof(m->cell));
+            for (int i = 0; i < 4; i++) {
+                add_contrib(m, (team_of_ui(i) == TEAM_P1) ? TEAM_P2 : TEAM_P1, &m->u[i], +1);
+            }
+        } else {
+            for (int k = 0; k < n; k++) {
+                int i = changed[k];
+                Team victim = (team_of_ui(i) == TEAM_P1) ? TEAM_P2 : TEAM_P1;
+                add_contrib(m, victim, &old[k], -1);
+                add_contrib(m, victim, &m->u[i], +1);
+            }
+        }
+    }
+    return n;
+}
+
+int battle_threat_point(const BattleThreatMap *m, Team victim, Pos p) {
+    if (!m) return 0;
+    int sum = 0;
+    for (int i = 0; i < 4; i++) {
+        if (team_of_ui(i) == victim) continue;
+        const BattleThreatUnit *t = &m->u[i];
+        if (!t->alive) continue;
+        sum += t->prof[manhattan(t->pos, p)];
+    }
+    return sum;
+}
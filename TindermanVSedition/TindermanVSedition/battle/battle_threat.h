@@ -0,0 +1,74 @@
+// battle/battle_threat.h
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "battle_core.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ===============================
+//  脅威マップ（次ターンに各マスで受けうる最大ダメージ）
+//   - 敵1体の寄与は「距離だけで決まる」：移動力 + 射程の内側なら、その時点のSTで撃てる
+//     一番痛い単体技のダメージ。AOE（中心指定に射程なし）は盤面全体に同じ値
+//     → ユニットごとに 距離→ダメージ の表（profile）を持てば足りる
+//   - cell[t][マス] = チーム t のユニットがそこにいたら受けうる合計（敵2体の寄与の和）
+//   - 差分更新：battle_threat_sync が前回から変わったユニットだけ
+//       移動       → そのユニットの寄与を旧位置で引いて新位置で足す
+//       ST/生死    → profile を作り直して同上（ST が技コストの境目をまたがなければ profile は同じ）
+//       3体以上    → マス表は profile から足し直す（技表の引き直しはしない）
+//   - AI 評価用に profile だけ持つ（マス表なし）モードもある（battle_threat_point で O(1)）
+//   - 地形（BattleCore.stage）は見ない：壁越しもマンハッタン距離で数える（危険側に倒した見積もり）
+//   - 2v2 の対戦用（units[0..3] を見る）
+// ===============================
+#define BATTLE_THREAT_CELLS (MAP_W * MAP_H)
+#define BATTLE_THREAT_DIST_MAX ((MAP_W - 1) + (MAP_H - 1))
+#define BATTLE_THREAT_SKILL_MAX 4
+
+typedef struct {
+    int16_t st_cost;
+    int16_t dmg;
+    int16_t reach;          // 射程（<0 = どこへでも。AOE もこれ）
+} BattleThreatSkill;
+
+typedef struct {
+    // profile の入力（前回 sync 時の値）
+    Pos  pos;
+    int  st, move, atk;
+    bool alive;
+
+    BattleThreatSkill sk[BATTLE_THREAT_SKILL_MAX];   // 攻撃技だけ（build 時に固定）
+    int  nsk;
+
+    int16_t prof[BATTLE_THREAT_DIST_MAX + 1];       // 距離→ダメージ
+} BattleThreatUnit;
+
+typedef struct {
+    BattleThreatUnit u[4];
+    bool with_cells;
+    int16_t cell[2][BATTLE_THREAT_CELLS];   // [被害側チーム][y * MAP_W + x]
+
+    // 統計（ベンチ用）
+    uint32_t profile_rebuilds;
+    uint32_t unit_updates;
+} BattleThreatMap;
+
+// 全部作り直す（技表の取得もここ）。with_cells=false なら profile だけ
+void battle_threat_build(BattleThreatMap *m, const BattleCore *b, bool with_cells);
+
+// 前回から位置/ST/生死/移動力が変わったユニットだけ反映。戻り値=更新したユニット数
+//   b は build と同じ対戦であること（キャラ/タッグ/ATK は固定として扱う）
+int battle_threat_sync(BattleThreatMap *m, const BattleCore *b);
+
+// victim 側のユニットが p にいたら次ターンに受けうる最大ダメージ
+//   _at は cell 表を引く（with_cells のとき）。_point は profile から計算（どちらのモードでも可）
+static inline int battle_threat_at(const BattleThreatMap *m, Team victim, Pos p) {
+    return m->cell[victim][p.y * MAP_W + p.x];
+}
+int battle_threat_point(const BattleThreatMap *m, Team victim, Pos p);
+
+#ifdef __cplusplus
+}
+#endif
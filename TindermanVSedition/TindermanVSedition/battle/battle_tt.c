@@ -0,0 +1,79 @@
+// battle/battle_tt.c
+#include "battle_tt.h"
+#include <stdlib.h>
+#include <string.h>
+
+static uint64_t pack_data(const BattleTTData *d) {
+    return (uint64_t)(uint32_t)d->value
+         | ((uint64_t)d->depth << 32)
+         | ((uint64_t)d->bound << 40)
+         | ((uint64_t)d->best  << 48);
+}
+
+static BattleTTData unpack_data(uint64_t v) {
+    BattleTTData d;
+    d.value = (int32_t)(uint32_t)(v & 0xFFFFFFFFu);
+    d.depth = (uint8_t)(v >> 32);
+    d.bound = (uint8_t)(v >> 40);
+    d.best  = (uint16_t)(v >> 48);
+    return d;
+}
+
+bool battle_tt_init(BattleTT *tt, size_t size_mb) {
+    if (!tt) return false;
+    memset(tt, 0, sizeof(*tt));
+    if (size_mb == 0) return true;
+
+    size_t want = (size_mb * 1024u * 1024u) / sizeof(BattleTTEntry);
+    size_t n = 1;
+    while (n * 2 <= want) n *= 2;
+
+    tt->entries = (BattleTTEntry*)calloc(n, sizeof(BattleTTEntry));
+    if (!tt->entries) return false;
+    tt->mask = n - 1;
+    return true;
+}
+
+void battle_tt_free(BattleTT *tt) {
+    if (!tt) return;
+    free(tt->entries);
+    tt->entries = NULL;
+    tt->mask = 0;
+}
+
+void battle_tt_clear(BattleTT *tt) {
+    if (!tt || !tt->entries) return;
+    // 探索スレッドが止まっている前提（memsetで一括）
+    memset((void*)tt->entries, 0, (tt->mask + 1) * sizeof(BattleTTEntry));
+}
+
+size_t battle_tt_entry_count(const BattleTT *tt) {
+    if (!tt || !tt->entries) return 0;
+    return tt->mask + 1;
+}
+
+bool battle_tt_probe(const BattleTT *tt, uint64_t key, BattleTTData *out) {
+    if (!tt || !tt->entries) return false;
+
+    BattleTTEntry *e = &tt->entries[key & tt->mask];
+    uint64_t kx = atomic_load_explicit(&e->key_xor_data, memory_order_relaxed);
+    uint64_t dv = atomic_load_explicit(&e->data, memory_order_relaxed);
+    if ((kx ^ dv) != key) return false;   // 別局面 or 書き込み途中
+    if (dv == 0 && kx == 0) return false; // 未使用
+
+    if (out) *out = unpack_data(dv);
+    return true;
+}
+
+void battle_tt_store(BattleTT *tt, uint64_t key, const BattleTTData *d) {
+    if (!tt || !tt->entries || !d) return;
+
+    BattleTTEntry *e = &tt->entries[key & tt->mask];
+    uint64_t kx = atomic_load_explicit(&e->key_xor_data, memory_order_relaxed);
+    uint64_t dv = atomic_load_explicit(&e->data, memory_order_relaxed);
+    if ((kx ^ dv) == key && unpack_data(dv).depth > d->depth) return;
+
+    uint64_t nd = pack_data(d);
+    atomic_store_explicit(&e->data, nd, memory_order_relaxed);
+    atomic_store_explicit(&e->key_xor_data, key ^ nd, memory_order_relaxed);
+}
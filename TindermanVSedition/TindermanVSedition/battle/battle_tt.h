@@ -0,0 +1,55 @@
+// battle/battle_tt.h
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ===============================
+//  置換表（AI探索用・スレッド共有可）
+//   - ロックなし：各エントリは (key^data, data) の2ワード
+//     読み出し時に key^data^data == key を確かめ、書き込みが途中で
+//     混ざったエントリは「ミス」として捨てる（いわゆる lockless hashing）
+//   - サイズは MB 指定（2のべき乗エントリ数に切り下げ）
+// ===============================
+typedef enum {
+    BTT_EXACT = 0,
+    BTT_LOWER = 1,   // value 以上
+    BTT_UPPER = 2,   // value 以下
+} BattleTTBound;
+
+typedef struct {
+    int32_t value;
+    uint8_t depth;
+    uint8_t bound;      // BattleTTBound
+    uint16_t best;      // 最善候補の index（不明なら 0xFFFF）
+} BattleTTData;
+
+typedef struct {
+    _Atomic uint64_t key_xor_data;
+    _Atomic uint64_t data;
+} BattleTTEntry;
+
+typedef struct {
+    BattleTTEntry *entries;
+    size_t mask;        // エントリ数-1（0件なら entries==NULL）
+} BattleTT;
+
+// size_mb==0 なら無効（probeは常にミス）
+bool battle_tt_init(BattleTT *tt, size_t size_mb);
+void battle_tt_free(BattleTT *tt);
+void battle_tt_clear(BattleTT *tt);
+
+size_t battle_tt_entry_count(const BattleTT *tt);
+
+bool battle_tt_probe(const BattleTT *tt, uint64_t key, BattleTTData *out);
+// 同じキーなら浅い結果で深い結果を上書きしない。別キーは常に置き換える
+void battle_tt_store(BattleTT *tt, uint64_t key, const BattleTTData *d);
+
+#ifdef __cplusplus
+}
+#endif
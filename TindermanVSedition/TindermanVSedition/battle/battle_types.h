@@ -7,8 +7,17 @@
 #define MAP_H 21
 
 typedef enum { TEAM_P1=0, TEAM_P2=1 } Team;
+// 2v2 の並び。3人目以降（3v3/4v4 など）は 2, 3, ... をそのまま Slot として使う
 typedef enum { SLOT_HERO=0, SLOT_GIRL=1 } Slot;
 
+// 1チームの最大人数（BattleCore の配列の大きさ。実際の人数は BattleCore.team_size）
+//   既定は 4v4 まで。BattleCore は AI/バッチで大量に値コピーするので必要以上に大きくしない
+//   （16v16 などは -DBATTLE_TEAM_MAX=16 でライブラリごとビルドする。make bench-wide）
+#ifndef BATTLE_TEAM_MAX
+#define BATTLE_TEAM_MAX 4
+#endif
+#define BATTLE_UNIT_MAX (BATTLE_TEAM_MAX * 2)
+
 typedef struct { int8_t x, y; } Pos; // 0..20で十分
 
 static inline int manhattan(Pos a, Pos b) {
@@ -32,6 +41,7 @@ typedef struct {
     bool tag_learned;     // girl only
 } Unit;
 
+// 2v2 の unit index（0..3）。人数可変の対戦は battle_core_unit_index()
 static inline int unit_index(Team t, Slot s) {
     return (t==TEAM_P1) ? (s==SLOT_HERO?0:1) : (s==SLOT_HERO?2:3);
 }
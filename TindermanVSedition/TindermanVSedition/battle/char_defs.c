@@ -2,43 +2,52 @@
 #include "char_defs.h"
 #include <string.h>
 
-static const CharDef g_chars[] = {
-    // 主人公（例：タッグ技なし）
-    {
-        .char_id = "hero",
-        .st_regen_per_turn = 5,
-        .skill_ids = { "hero_tech1", "hero_tech2", "hero_tech3", NULL },
-        .skill_count = 3,
-        .tag_skill_id = NULL
-    },
-
-    // ひまり
-    {
-        .char_id = "himari",
-        .st_regen_per_turn = 3,
-        .skill_ids = { "himari_1", "himari_2", "himari_3", NULL },
-        .skill_count = 3,
-        .tag_skill_id = "himari_tag"
-    },
-
-    // きりたん
-    {
-        .char_id = "kiritan",
-        .st_regen_per_turn = 10,
-        .skill_ids = { "kiritan_1", "kiritan_2", "kiritan_3", NULL },
-        .skill_count = 3,
-        .tag_skill_id = "kiritan_tag"
-    },
-};
+// 中身は battle_defs_load()（assets/data/battle_defs.txt）で入る
+static CharDef g_chars[CHAR_DEF_MAX];
+static int g_char_count = 0;
+static int g_fallback = -1;     // 汎用 girl の位置
+
+bool char_def_table_set(const CharDef* defs, int n){
+    if(!defs || n < 0 || n > CHAR_DEF_MAX) return false;
+    int fb = -1;
+    for(int i=0;i<n;i++){
+        if(strcmp(defs[i].char_id, CHAR_DEF_FALLBACK_ID)==0) fb = i;
+    }
+    if(fb < 0) return false;
+
+    memcpy(g_chars, defs, sizeof(CharDef) * (size_t)n);
+    memset(g_chars + n, 0, sizeof(CharDef) * (size_t)(CHAR_DEF_MAX - n));
+    g_char_count = n;
+    g_fallback = fb;
+    return true;
+}
+
+int char_def_count(void){
+    return g_char_count;
+}
+
+const CharDef* char_def_at(int index){
+    if(index < 0 || index >= g_char_count) return NULL;
+    return &g_chars[index];
+}
 
 const CharDef* char_def_get(const char* char_id){
-    if(!char_id) return NULL;
-    for(size_t i=0;i<sizeof(g_chars)/sizeof(g_chars[0]);i++){
+    if(!char_id || !char_id[0]) return NULL;
+    const int n = g_char_count;
+    for(int i=0;i<n;i++){
         if(strcmp(g_chars[i].char_id, char_id)==0) return &g_chars[i];
     }
     return NULL;
 }
 
+const CharDef* char_def_get_or_fallback(const char* char_id){
+    if(!char_id || !char_id[0]) return NULL;
+    const CharDef* cd = char_def_get(char_id);
+    if(cd) return cd;
+    // 未知の id は汎用 girl
+    return (g_fallback >= 0) ? &g_chars[g_fallback] : NULL;
+}
+
 int char_def_get_available_skill_count(const CharDef* cd, bool tag_learned){
     if(!cd) return 0;
     int n = cd->skill_count;
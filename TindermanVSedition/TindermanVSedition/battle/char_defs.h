@@ -2,11 +2,15 @@
 #pragma once
 #include <stdbool.h>
 
+// 表の大きさ（中身は assets/data/battle_defs.txt → battle_defs_load() で入る）
+#define CHAR_DEF_MAX    16
+#define CHAR_DEF_ID_MAX 24
+
 typedef struct {
-    const char* char_id;        // "hero" / "himari" / "kiritan"
+    char char_id[CHAR_DEF_ID_MAX];  // "hero" / "himari" / "kiritan"
     int st_regen_per_turn;      // ターン終了時などの回復量
 
-    // 通常技（タッグ未習得でも使える）
+    // 通常技（タッグ未習得でも使える）。battle_skills の表の id を指す
     const char* skill_ids[4];   // 最大3想定だが余裕で4
     int skill_count;
 
@@ -14,11 +18,24 @@ typedef struct {
     const char* tag_skill_id;   // 例: "himari_tag" / NULL
 } CharDef;
 
-// char_id から定義を取得（無ければNULL）
+// 定義のない girl が使う汎用定義の char_id（技は battle_defs.txt の girl_*）
+#define CHAR_DEF_FALLBACK_ID "girl"
+
+// char_id から定義を取得（未知の id/NULL/空文字は NULL）
 const CharDef* char_def_get(const char* char_id);
 
+// 戦闘中のユニット用：定義のない girl（小夜など）は汎用 girl の定義（NULL/空文字は NULL）
+const CharDef* char_def_get_or_fallback(const char* char_id);
+
 // このキャラが「今」選べる技数（tag_learned込み）
 int char_def_get_available_skill_count(const CharDef* cd, bool tag_learned);
 
 // index -> skill_id（tag_learned込み）。範囲外はNULL
 const char* char_def_get_skill_id_at(const CharDef* cd, bool tag_learned, int index);
+
+// 読み込まれているキャラの数 / 通し番号で
+int char_def_count(void);
+const CharDef* char_def_at(int index);
+
+// 表を丸ごと差し替える（battle_defs.c 専用。汎用 girl が無ければ false で差し替えない）
+bool char_def_table_set(const CharDef* defs, int n);
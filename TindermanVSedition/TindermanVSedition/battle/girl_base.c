@@ -0,0 +1,39 @@
+// battle/girl_base.c
+#include "girl_base.h"
+#include <string.h>
+
+#include "char_defs.h"   // CHAR_DEF_FALLBACK_ID
+
+static const GirlBase g_bases[] = {
+    // 画像の「基礎ステータス(確定)」
+    { "himari",  120, 20, 14, 80,  5, 6 },
+    { "kiritan", 100,  5,  8, 40, 20, 3 },
+
+    // 小夜：暫定（全部0）
+    { "sayo",      0,  0,  0,  0,  0, 4 },
+
+    // 汎用（未知の girl）：末尾
+    { CHAR_DEF_FALLBACK_ID, 0, 0, 0, 0, 0, 3 },
+};
+
+const GirlBase* girl_base_get(const char *girl_id)
+{
+    if (!girl_id) return NULL;
+
+    const int n = girl_base_count();
+    for (int i = 0; i < n; i++) {
+        if (strcmp(g_bases[i].girl_id, girl_id) == 0) return &g_bases[i];
+    }
+    return &g_bases[n - 1];
+}
+
+int girl_base_count(void)
+{
+    return (int)(sizeof(g_bases) / sizeof(g_bases[0]));
+}
+
+const GirlBase* girl_base_at(int index)
+{
+    if (index < 0 || index >= girl_base_count()) return NULL;
+    return &g_bases[index];
+}
@@ -0,0 +1,32 @@
+// battle/girl_base.h
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ===============================
+//  girl の基礎ステータス（選択時に build.json へ書く値）
+//   - 2_scene_select / 配分最適化 / tools で共通
+//   - 配分（*_add）はここに含まない
+// ===============================
+typedef struct {
+    const char *girl_id;
+    int hp;
+    int atk;
+    int sp;             // SPD相当
+    int st;
+    int st_regen;       // 表示用（戦闘中の回復量は char_defs.c）
+    int move_range;     // 移動距離（マス）
+} GirlBase;
+
+// girl_id から取得（未知の id は汎用 girl、NULL は NULL）
+const GirlBase* girl_base_get(const char *girl_id);
+
+// 一覧（汎用 girl を含む）
+int girl_base_count(void);
+const GirlBase* girl_base_at(int index);
+
+#ifdef __cplusplus
+}
+#endif
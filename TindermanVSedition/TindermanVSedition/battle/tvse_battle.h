@@ -0,0 +1,37 @@
+// battle/tvse_battle.h
+#pragma once
+
+// ===============================
+//  libtvse_battle.a（battle/ の SDL に依存しない部分。make lib）
+//   サーバ・ツール・クライアントはこのヘッダ1つとライブラリをリンクして使う
+//
+//   状態の置き場所
+//   - 対戦ごと/処理ごとの状態は全部呼ぶ側が持つ構造体の中（グローバルなし）
+//       BattleCore / BattleEventCursor / BattleThreatMap / BattleReplay / BattleBatch /
+//       BattleTT / AllocOpt / BattleDefsWatch / BattleAnalytics / BattleJournal
+//     → 別々の構造体なら、何スレッドで何個同時に動かしてもよい
+//       1つの構造体を複数スレッドから触ってよいのは BattleTT だけ（ロックなし・探索スレッド共有用）
+//   - プロセス共通データ（読み込むときだけ書く。以後はどのスレッドから読んでもよい）
+//       技/キャラ表（battle_defs_load）・ステージカタログ（battle_stage_catalog_load）・girl_base（定数）
+//       → 読み込み/読み直しは、コアを動かす他のスレッドがいない所でメインスレッドから
+//   - 乱数は battle_rng（状態なし）。静的バッファを返す関数は置かない（文字列は呼ぶ側のバッファへ）
+//
+//   検証：make tsan（battle_bench stress を ThreadSanitizer 付きで回す）
+// ===============================
+#include "battle_types.h"
+#include "alloc_rules.h"
+#include "battle_cmd.h"
+#include "battle_skills.h"
+#include "char_defs.h"
+#include "battle_defs.h"
+#include "girl_base.h"
+#include "battle_stage.h"
+#include "battle_core.h"
+#include "battle_rng.h"
+#include "battle_tt.h"
+#include "battle_threat.h"
+#include "battle_ai.h"
+#include "battle_replay.h"
+#include "battle_batch.h"
+#include "battle_analytics.h"
+#include "alloc_opt.h"
@@ -0,0 +1,105 @@
+// core/frame_stats.c
+#include "frame_stats.h"
+
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <string.h>
+
+#define FRAME_STATS_REPORT_SEC 2.0
+
+typedef struct {
+    int frames;
+    double cpu_sum, cpu_max;        // 秒
+    double interval_sum;
+    long long uploads;
+    long long upload_bytes;
+    long long draws;
+} FrameStatsWindow;
+
+static bool g_enabled = false;
+static double g_freq = 0.0;
+static Uint64 g_frame_start = 0;
+static Uint64 g_prev_start = 0;
+static Uint64 g_window_start = 0;
+static char g_scene[32] = "";
+static FrameStatsWindow g_win;
+static FrameStatsWindow g_frame;    // 今のフレームの分（frame_end で g_win へ足す）
+
+void frame_stats_enable(bool on)
+{
+    g_enabled = on;
+    memset(&g_win, 0, sizeof(g_win));
+    memset(&g_frame, 0, sizeof(g_frame));
+    g_scene[0] = '\0';
+    g_prev_start = 0;
+}
+
+bool frame_stats_enabled(void)
+{
+    return g_enabled;
+}
+
+static void report(void)
+{
+    if (g_win.frames > 0) {
+        const double n = (double)g_win.frames;
+        printf("[FRAME] %-8s %4d frames  cpu avg %.2fms max %.2fms  interval %.2fms  "
+               "uploads %.2f/frame (%.1f KB/frame)  draws %.1f/frame\n",
+               g_scene, g_win.frames,
+               g_win.cpu_sum / n * 1e3, g_win.cpu_max * 1e3,
+               g_win.interval_sum / n * 1e3,
+               (double)g_win.uploads / n, (double)g_win.upload_bytes / n / 1024.0,
+               (double)g_win.draws / n);
+    }
+    memset(&g_win, 0, sizeof(g_win));
+}
+
+void frame_stats_frame_begin(void)
+{
+    if (g_freq <= 0.0) g_freq = (double)SDL_GetPerformanceFrequency();
+    g_frame_start = SDL_GetPerformanceCounter();
+    g_frame.interval_sum = g_prev_start ? (double)(g_frame_start - g_prev_start) / g_freq : 0.0;
+    g_prev_start = g_frame_start;
+}
+
+void frame_stats_frame_end(const char *scene)
+{
+    FrameStatsWindow f = g_frame;
+    memset(&g_frame, 0, sizeof(g_frame));
+    if (!g_enabled) return;
+
+    const Uint64 now = SDL_GetPerformanceCounter();
+    if (!scene) scene = "?";
+
+    // シーンが変わったら前のシーンの分をそこで区切って出す
+    if (strcmp(scene, g_scene) != 0) {
+        report();
+        snprintf(g_scene, sizeof(g_scene), "%s", scene);
+        g_window_start = g_frame_start;
+    }
+
+    const double cpu = (double)(now - g_frame_start) / g_freq;
+    g_win.frames++;
+    g_win.cpu_sum += cpu;
+    if (cpu > g_win.cpu_max) g_win.cpu_max = cpu;
+    g_win.interval_sum += f.interval_sum;
+    g_win.uploads += f.uploads;
+    g_win.upload_bytes += f.upload_bytes;
+    g_win.draws += f.draws;
+
+    if ((double)(now - g_window_start) / g_freq >= FRAME_STATS_REPORT_SEC) {
+        report();
+        g_window_start = now;
+    }
+}
+
+void frame_stats_count_upload(int bytes)
+{
+    g_frame.uploads++;
+    if (bytes > 0) g_frame.upload_bytes += bytes;
+}
+
+void frame_stats_count_draw(int calls)
+{
+    g_frame.draws += calls;
+}
@@ -0,0 +1,24 @@
+#ifndef FRAME_STATS_H
+#define FRAME_STATS_H
+
+#include <stdbool.h>
+
+// ===============================
+//  フレーム計測（./tvse --frame-stats）
+//   - 1フレームの CPU 時間（入力〜描画命令の発行まで。Present の vsync 待ちは含めない）と間隔
+//   - テクスチャへの書き込み回数/バイト数と描画呼び出し数（数える側が frame_stats_count_* を呼ぶ）
+//   - 2秒ごと、またはシーンが変わったときに [FRAME] 行でまとめて出す（無効時は数えるだけで出さない）
+// ===============================
+void frame_stats_enable(bool on);
+bool frame_stats_enabled(void);
+
+// main ループから：入力の前に begin、描画命令を出し終えたら（Present の前に）end
+void frame_stats_frame_begin(void);
+void frame_stats_frame_end(const char *scene);
+
+// テクスチャ生成/更新 1回（bytes = 書き込んだピクセルのバイト数）
+void frame_stats_count_upload(int bytes);
+// 描画呼び出し（SDL_RenderCopy / SDL_RenderGeometry など）
+void frame_stats_count_draw(int calls);
+
+#endif
@@ -7,6 +7,8 @@
 #include "../scenes/3_scene_chat.h"
 #include "../scenes/4_scene_allocate.h"
 #include "../scenes/5_scene_battle.h"   // ★追加：バトル
+#include "../util/asset_pack.h"
+#include "../util/res_cache.h"
 
 #include <stdio.h>
 
@@ -24,18 +26,15 @@ static void call_leave(SceneID s)
     switch (s)
     {
     case SCENE_HOME:
-        // home が leave を持つならここで呼ぶ（無ければ何もしない）
-        // scene_home_leave();
+        scene_home_leave();
         break;
 
     case SCENE_SELECT:
-        // select が exit/leave を持つならここで呼ぶ（無ければ何もしない）
-        // scene_select_exit();
+        scene_select_leave();
         break;
 
     case SCENE_CHAT:
-        // chat が exit/leave を持つならここで呼ぶ（無ければ何もしない）
-        // scene_chat_exit();
+        scene_chat_leave();
         break;
 
     case SCENE_ALLOCATE:
@@ -51,6 +50,24 @@ static void call_leave(SceneID s)
     }
 }
 
+// -------------------------------------------------------------
+// 次のシーンの画像/フォント/音声をキャッシュに先読み（参照は増やさない）
+//  - change_scene が leave の前に呼ぶ（共通のフォントなどを捨てさせない）
+//  - 演出で待ち時間のあるシーンは、待ち始めにも呼んで展開を前倒しする
+// -------------------------------------------------------------
+void scene_prefetch(SceneID next)
+{
+    switch (next)
+    {
+    case SCENE_HOME:     scene_home_prefetch();     break;
+    case SCENE_SELECT:   scene_select_prefetch();   break;
+    case SCENE_CHAT:     scene_chat_prefetch();     break;
+    case SCENE_ALLOCATE: scene_allocate_prefetch(); break;
+    case SCENE_BATTLE:   scene_battle_prefetch();   break;
+    default:             break;
+    }
+}
+
 void scene_manager_init(void)
 {
     current_scene = SCENE_HOME;
@@ -62,8 +79,16 @@ void scene_manager_init(void)
 void change_scene(SceneID next)
 {
     printf("[SCENE] change_scene: %d -> %d\n", (int)current_scene, (int)next);
+    const Uint64 t0 = SDL_GetPerformanceCounter();
+
+    // 出ていくシーンが持っていたテクスチャ（パックの縮小/半分が効いているかをここで見る）
+    ResCacheStats rs;
+    res_cache_get_stats(&rs);
+    printf("[RES] %s textures in use %.1f MB (%s)\n", scene_manager_current_name(),
+           rs.texture_bytes_in_use / 1048576.0, asset_pack_variant() == ASSET_VARIANT_HALF ? "half" : "full");
 
-    // ★追加：遷移前に前シーンの leave
+    // 次のシーンの分を先に頼んでから、前シーンの leave（参照を返すだけ。キャッシュには残る）
+    scene_prefetch(next);
     call_leave(current_scene);
 
     current_scene = next;
@@ -99,6 +124,15 @@ void change_scene(SceneID next)
         printf("[SCENE] enter UNKNOWN (%d)\n", (int)next);
         break;
     }
+
+    // 切り替えで止まった時間（画像が揃うまでは [ASSET] の行）
+    printf("[SCENE] leave+enter %.1f ms\n",
+           (double)(SDL_GetPerformanceCounter() - t0) * 1000.0 / (double)SDL_GetPerformanceFrequency());
+
+    res_cache_get_stats(&rs);
+    printf("[RES] %d entries (%d in use) %.1f/%.0f MB, hit %llu miss %llu evict %llu\n",
+           rs.entries, rs.referenced, rs.bytes / 1048576.0, rs.budget / 1048576.0,
+           (unsigned long long)rs.hits, (unsigned long long)rs.misses, (unsigned long long)rs.evictions);
 }
 
 void scene_update(float dt)
@@ -165,3 +199,16 @@ void scene_render(SDL_Renderer *r)
         break;
     }
 }
+
+const char* scene_manager_current_name(void)
+{
+    switch (current_scene)
+    {
+    case SCENE_HOME:     return "HOME";
+    case SCENE_SELECT:   return "SELECT";
+    case SCENE_CHAT:     return "CHAT";
+    case SCENE_ALLOCATE: return "ALLOCATE";
+    case SCENE_BATTLE:   return "BATTLE";
+    default:             return "UNKNOWN";
+    }
+}
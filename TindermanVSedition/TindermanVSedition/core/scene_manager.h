@@ -16,7 +16,12 @@ typedef enum
 
 void scene_manager_init(void);
 void change_scene(SceneID next);
+// 次のシーンのリソースを先読み（change_scene も呼ぶ。待ち時間のある演出の始めに呼ぶと早く揃う）
+void scene_prefetch(SceneID next);
 void scene_update(float dt);
 void scene_render(SDL_Renderer* r);
 
+// 今のシーン名（ログ/計測用）
+const char* scene_manager_current_name(void);
+
 #endif
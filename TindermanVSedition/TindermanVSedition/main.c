@@ -5,26 +5,111 @@
 #include "core/engine.h"
 #include "core/scene_manager.h"
 #include "core/input.h"
+#include "core/frame_stats.h"
 #include "net/net_client.h"
+#include "ui/ui_text.h"
+#include "ui/ui_layer.h"
+#include "util/asset_loader.h"
+#include "util/asset_pack.h"
+#include "util/res_cache.h"
+#include "util/texture.h"
+#include "scenes/5_scene_battle.h"
+#include "battle/battle_defs.h"
+#include "battle/battle_stage.h"
+
+// 描画先が論理サイズ（1280x720）の半分以下なら半分の画像で足りる。--low-end なら常に半分
+static void choose_texture_variant(bool low_end)
+{
+    int ow = 0, oh = 0, lw = 0, lh = 0;
+    SDL_GetRendererOutputSize(g_renderer, &ow, &oh);
+    SDL_RenderGetLogicalSize(g_renderer, &lw, &lh);
+    const bool small = lw > 0 && lh > 0 && ow * 2 <= lw && oh * 2 <= lh;
+    const AssetVariant v = (low_end || small) ? ASSET_VARIANT_HALF : ASSET_VARIANT_FULL;
+    if (v != asset_pack_variant())
+        SDL_Log("[PACK] %s images (output %dx%d)", v == ASSET_VARIANT_HALF ? "half-size" : "full-size", ow, oh);
+    asset_pack_set_variant(v);
+}
 
 int main(int argc, char **argv)
 {
+    const Uint64 startup_counter = SDL_GetPerformanceCounter();
+    const char *replay_path = NULL;
+    bool use_pack = true;
+    bool low_end = false;
+
     for (int i = 1; i < argc; i++) {
         if ((strcmp(argv[i], "--hostname") == 0 || strcmp(argv[i], "-h") == 0) && i + 1 < argc) {
             g_net_host = argv[++i];
         } else if ((strcmp(argv[i], "--port") == 0 || strcmp(argv[i], "-p") == 0) && i + 1 < argc) {
             g_net_port = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replay_path = argv[++i];
+        } else if (strcmp(argv[i], "--frame-stats") == 0) {
+            // フレーム時間/テクスチャ書き込み/描画呼び出しを2秒ごとに [FRAME] で出す
+            frame_stats_enable(true);
+        } else if (strcmp(argv[i], "--no-glyph-atlas") == 0) {
+            // 文字列ごとのテクスチャで描く（アトラスとの比較用）
+            ui_text_set_glyph_atlas(false);
+        } else if (strcmp(argv[i], "--no-pack") == 0) {
+            // assets.tvsp があってもバラのファイルから読む（パックとの比較用）
+            use_pack = false;
+        } else if (strcmp(argv[i], "--low-end") == 0) {
+            // パックの半分の大きさの画像を使う（テクスチャのメモリ 1/4）
+            low_end = true;
+        } else if (strcmp(argv[i], "--res-budget") == 0 && i + 1 < argc) {
+            // 使っていないリソースを残しておける合計（MB）。0 で参照が切れたらすぐ捨てる
+            const int mb = atoi(argv[++i]);
+            res_cache_set_budget(mb > 0 ? (size_t)mb * 1024 * 1024 : 0);
         }
     }
 
+    // 技/キャラ定義（make defs で作る .bin。開発ビルドの書き換え監視は battle scene が持つ）
+    if (!battle_defs_load(BATTLE_DEFS_PATH)) {
+        SDL_Log("battle defs load failed: %s", BATTLE_DEFS_PATH);
+        return 1;
+    }
+
+    // ステージのカタログ（以後は読み取りだけ。対戦・再生・配分おすすめの評価スレッドが引く）
+    SDL_Log("stages: %d", battle_stage_catalog_load("assets/stages"));
+
     if (!engine_init()) {
         SDL_Log("Engine init failed");
         return 1;
     }
 
+    // 画像/フォント/音声のパック（make pack）。なければバラのファイルから
+    if (use_pack && asset_pack_open(ASSET_PACK_PATH)) {
+        SDL_RendererInfo info;
+        bool native = false;
+        if (SDL_GetRendererInfo(g_renderer, &info) == 0) {
+            for (Uint32 i = 0; i < info.num_texture_formats; i++)
+                native = native || info.texture_formats[i] == asset_pack_pixel_format();
+        }
+        if (!native)
+            SDL_Log("[PACK] %s is not a texture format of this renderer (converted on upload). "
+                    "rebuild with make pack on this machine", SDL_GetPixelFormatName(asset_pack_pixel_format()));
+
+        // premultiplied のブレンドが使えなければ、展開時にふつうの alpha へ戻す
+        if (!texture_premultiplied_supported(g_renderer)) {
+            SDL_Log("[PACK] renderer has no premultiplied blending, converting on load");
+            asset_pack_set_premultiplied(false);
+        }
+        choose_texture_variant(low_end);
+    }
+
+    // PNG の展開はワーカーで（シーン切り替えで止まらないように）。作れなければ同期読み込み
+    asset_loader_init(0);
+    res_cache_init(g_renderer);
+
     scene_manager_init();
 
+    // --replay <file>: 起動直後にリプレイ再生
+    if (replay_path && scene_battle_request_replay(replay_path)) {
+        change_scene(SCENE_BATTLE);
+    }
+
     g_running = true;
+    bool first_frame = true;
 
     // 高精度タイマ
     const double freq = (double)SDL_GetPerformanceFrequency();
@@ -32,6 +117,8 @@ int main(int argc, char **argv)
 
     while (g_running)
     {
+        frame_stats_frame_begin();
+
         // ===== 入力フレーム開始 =====
         input_begin_frame();
 
@@ -39,6 +126,9 @@ int main(int argc, char **argv)
         SDL_Event e;
         while (SDL_PollEvent(&e)) {
             input_handle_event(&e);
+            ui_layer_handle_event(&e);   // 描画先の作り直し → 静的レイヤを描き直す
+            if (e.type == SDL_WINDOWEVENT && e.window.event == SDL_WINDOWEVENT_SIZE_CHANGED && asset_pack_is_open())
+                choose_texture_variant(low_end);   // これから読む画像から
         }
 
         // ===== 入力確定 =====
@@ -55,16 +145,33 @@ int main(int argc, char **argv)
         // ===== 更新 =====
         scene_update((float)dt);
 
+        // ===== 展開済み画像をテクスチャへ（1フレームの予算内）=====
+        asset_loader_pump(g_renderer, ASSET_UPLOAD_BUDGET_MS);
+        res_cache_pump();
+
         // ===== 描画 =====
         SDL_SetRenderDrawColor(g_renderer, 0, 0, 0, 255);
         SDL_RenderClear(g_renderer);
 
         scene_render(g_renderer);
+        frame_stats_frame_end(scene_manager_current_name());
         SDL_RenderPresent(g_renderer);
 
+        if (first_frame) {
+            // 起動〜最初の画面まで（pack/no-pack・コールド/ウォームの比較用）
+            first_frame = false;
+            SDL_Log("[STARTUP] first frame %.1f ms (%s)",
+                    (double)(SDL_GetPerformanceCounter() - startup_counter) * 1000.0 / freq,
+                    asset_pack_is_open() ? "pack" : "loose files");
+        }
+
         SDL_Delay(1);
     }
 
+    res_cache_shutdown();       // フォントはアトラスから外すので ui_text より先に
+    ui_text_cache_shutdown();   // renderer より先にテクスチャを捨てる
+    asset_loader_shutdown();
     engine_cleanup();
+    asset_pack_close();         // 開いたままのフォントがパックを指しているので最後に
     return 0;
 }
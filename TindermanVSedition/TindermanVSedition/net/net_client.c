@@ -26,6 +26,8 @@ static bool has_opponent_info = false;
 static NetGameInfo opponent_info;
 static bool has_opponent_cmd = false;
 static TurnCmd opponent_cmd;
+static bool has_match_stage = false;
+static NetMatchStage match_stage;
 
 // 確実に全バイト書き込む
 static int send_all(const uint8_t *data, int len)
@@ -79,6 +81,7 @@ void net_connect(const char *host, int port)
     player_id = -1;
     has_opponent_info = false;
     has_opponent_cmd = false;
+    has_match_stage = false;
 
     printf("[net] connected to server\n");
 }
@@ -93,6 +96,7 @@ void net_disconnect(void)
     player_id = -1;
     has_opponent_info = false;
     has_opponent_cmd = false;
+    has_match_stage = false;
     printf("[net] disconnected\n");
 }
 
@@ -153,6 +157,14 @@ bool net_received_opponent_cmd(TurnCmd *out)
     return true;
 }
 
+bool net_received_match_stage(NetMatchStage *out)
+{
+    if (!has_match_stage) return false;
+    if (out) *out = match_stage;
+    has_match_stage = false;
+    return true;
+}
+
 int net_received_start(void)
 {
     // 旧互換: ASSIGN受信済み = マッチング成立
@@ -176,6 +188,19 @@ static void handle_message(uint8_t msg_type, const uint8_t *payload, int payload
         printf("[net] RECV OPPONENT_INFO: girl_id=%s\n", opponent_info.girl_id);
         break;
 
+    case MSG_MATCH_STAGE:
+        net_match_stage_unpack(payload, &match_stage);
+        has_match_stage = true;
+        printf("[net] RECV MATCH_STAGE: %s\n", match_stage.stage_id[0] ? match_stage.stage_id : "(none)");
+        break;
+
+    case MSG_REJECT:
+        fprintf(stderr, "[net] RECV REJECT: reason=%d%s\n", (int)payload[0],
+                payload[0] == NET_REJECT_PROTOCOL ? " (protocol version mismatch)" :
+                payload[0] == NET_REJECT_DEFS     ? " (battle defs mismatch)" : "");
+        net_disconnect();
+        break;
+
     case MSG_OPPONENT_CMD:
         if (!battle_cmd_unpack(payload, &opponent_cmd)) {
             fprintf(stderr, "[net] battle_cmd_unpack failed\n");
@@ -207,6 +232,7 @@ static void process_recv_buf(void)
         if (recv_len < total) break;
 
         handle_message(msg_type, recv_buf + 1, psize);
+        if (sock < 0) return;   // REJECT で切断した
 
         int remain = recv_len - total;
         if (remain > 0) {
@@ -26,6 +26,9 @@ void net_send_game_info(const NetGameInfo *info);
 // OPPONENT_INFO受信（受信済みならtrueを返しoutに書き込み、内部フラグクリア）
 bool net_received_opponent_info(NetGameInfo *out);
 
+// MATCH_STAGE受信（サーバが決めたステージ。受信済みならtrueを返しoutに書き込み、内部フラグクリア）
+bool net_received_match_stage(NetMatchStage *out);
+
 // TURN_CMD送信
 void net_send_turn_cmd(const TurnCmd *cmd);
 
@@ -7,27 +7,45 @@
 
 #include "../battle/battle_cmd.h"
 
+// 対戦ルールの版数（GAME_INFO に載せる。サーバは版数の違う相手とはマッチさせない）
+//   1: 版数なし。build.json に無いキーは GAME_INFO では 0、ローカルの自分は 100/10/10/30（両者でずれる）
+//   2: GAME_INFO もローカルと同じ既定値 100/10/10/30
+#define NET_PROTOCOL_VERSION 2
+
 // メッセージ型 (1byte header)
 #define MSG_READY         0x01
 #define MSG_ASSIGN        0x02  // server -> client  payload: 1byte player_id
-#define MSG_GAME_INFO     0x03  // client -> server  payload: 50bytes
-#define MSG_OPPONENT_INFO 0x04  // server -> client  payload: 50bytes
+#define MSG_GAME_INFO_V1  0x03  // client -> server  payload: 50bytes（版数なしの旧クライアント。サーバは拒否する）
+#define MSG_OPPONENT_INFO 0x04  // server -> client  payload: 56bytes
 #define MSG_TURN_CMD      0x05  // client -> server  payload: 14bytes (TurnCmd)
 #define MSG_OPPONENT_CMD  0x06  // server -> client  payload: 14bytes (TurnCmd)
+#define MSG_GAME_INFO     0x07  // client -> server  payload: 56bytes
+#define MSG_REJECT        0x08  // server -> client  payload: 1byte reason（送ったあと切断する）
+#define MSG_MATCH_STAGE   0x09  // server -> client  payload: 20bytes（OPPONENT_INFO の直後。ステージはサーバが決める）
+
+// MSG_REJECT の理由
+#define NET_REJECT_PROTOCOL 1   // 対戦ルールの版数が違う
+#define NET_REJECT_DEFS     2   // 技/キャラ定義（battle_defs.bin）が違う
 
-// GAME_INFO payload: girl_id[32] + stats i16×8(16) + tag(u8) + move_range(u8) = 50bytes
-#define NET_GAME_INFO_BYTES 50
+// GAME_INFO payload: girl_id[32] + stats i16×8(16) + tag(u8) + move_range(u8) + protocol(u16) + defs(u32) = 56bytes
+//   先頭 50bytes が対戦の開始条件（乱数キーもここから作る）
+#define NET_GAME_INFO_SETUP_BYTES 50
+#define NET_GAME_INFO_V1_BYTES    50
+#define NET_GAME_INFO_BYTES       56
 
 // メッセージ全体サイズ (header 1byte + payload)
 #define MSG_READY_SIZE          1
 #define MSG_ASSIGN_SIZE         2
-#define MSG_GAME_INFO_SIZE     51
-#define MSG_OPPONENT_INFO_SIZE 51
+#define MSG_GAME_INFO_V1_SIZE  51
+#define MSG_GAME_INFO_SIZE     57
+#define MSG_OPPONENT_INFO_SIZE 57
 #define MSG_TURN_CMD_SIZE      15
 #define MSG_OPPONENT_CMD_SIZE  15
+#define MSG_REJECT_SIZE         2
+#define MSG_MATCH_STAGE_SIZE   21
 
 // メッセージの最大サイズ
-#define NET_MSG_MAX_SIZE       51
+#define NET_MSG_MAX_SIZE       57
 
 typedef struct {
     char    girl_id[32];
@@ -41,6 +59,8 @@ typedef struct {
     int16_t st_add;
     uint8_t tag_learned;
     uint8_t move_range;
+    uint16_t protocol;        // NET_PROTOCOL_VERSION
+    uint32_t defs_checksum;   // battle_defs_checksum()（定義が違う相手とは結果が合わない）
 } NetGameInfo;
 
 static inline void net_game_info_pack(const NetGameInfo *info, uint8_t out[NET_GAME_INFO_BYTES])
@@ -58,6 +78,8 @@ static inline void net_game_info_pack(const NetGameInfo *info, uint8_t out[NET_G
     memcpy(out + 46, &info->st_add,   2);
     out[48] = info->tag_learned;
     out[49] = info->move_range;
+    memcpy(out + 50, &info->protocol, 2);
+    memcpy(out + 52, &info->defs_checksum, 4);
 }
 
 static inline void net_game_info_unpack(const uint8_t in[NET_GAME_INFO_BYTES], NetGameInfo *info)
@@ -75,6 +97,34 @@ static inline void net_game_info_unpack(const uint8_t in[NET_GAME_INFO_BYTES], N
     memcpy(&info->st_add,   in + 46, 2);
     info->tag_learned = in[48];
     info->move_range  = in[49];
+    memcpy(&info->protocol, in + 50, 2);
+    memcpy(&info->defs_checksum, in + 52, 4);
+}
+
+// MATCH_STAGE payload: stage_id[16]（NUL 詰め。空=ステージなし）+ checksum(u32) = 20bytes
+#define NET_STAGE_ID_BYTES    16   // = BATTLE_STAGE_ID_MAX
+#define NET_MATCH_STAGE_BYTES 20
+
+typedef struct {
+    char     stage_id[NET_STAGE_ID_BYTES];
+    uint32_t checksum;        // BattleStage.checksum（ステージなしなら 0）
+} NetMatchStage;
+
+static inline void net_match_stage_pack(const NetMatchStage *ms, uint8_t out[NET_MATCH_STAGE_BYTES])
+{
+    memset(out, 0, NET_MATCH_STAGE_BYTES);
+    size_t n = 0;
+    while (n < NET_STAGE_ID_BYTES - 1 && ms->stage_id[n]) n++;
+    memcpy(out, ms->stage_id, n);
+    memcpy(out + 16, &ms->checksum, 4);
+}
+
+static inline void net_match_stage_unpack(const uint8_t in[NET_MATCH_STAGE_BYTES], NetMatchStage *ms)
+{
+    memset(ms, 0, sizeof(*ms));
+    memcpy(ms->stage_id, in, NET_STAGE_ID_BYTES);
+    ms->stage_id[NET_STAGE_ID_BYTES - 1] = '\0';
+    memcpy(&ms->checksum, in + 16, 4);
 }
 
 // msg_type からペイロードサイズを返す (-1: 不明)
@@ -83,10 +133,13 @@ static inline int net_msg_payload_size(uint8_t msg_type)
     switch (msg_type) {
     case MSG_READY:         return 0;
     case MSG_ASSIGN:        return 1;
-    case MSG_GAME_INFO:     return NET_GAME_INFO_BYTES;
+    case MSG_GAME_INFO_V1:  return NET_GAME_INFO_V1_BYTES;
     case MSG_OPPONENT_INFO: return NET_GAME_INFO_BYTES;
     case MSG_TURN_CMD:      return TURNCMD_WIRE_BYTES;
     case MSG_OPPONENT_CMD:  return TURNCMD_WIRE_BYTES;
+    case MSG_GAME_INFO:     return NET_GAME_INFO_BYTES;
+    case MSG_REJECT:        return 1;
+    case MSG_MATCH_STAGE:   return NET_MATCH_STAGE_BYTES;
     default:                return -1;
     }
 }
@@ -2,15 +2,22 @@
 #include "../core/scene_manager.h"
 #include "../core/input.h"
 #include "../core/engine.h"
-#include "../util/texture.h"
+#include "../util/asset_loader.h"
+#include "../util/res_cache.h"
 #include "../ui/ui_text.h"
 #include "../ui/ui_button.h"
 
 // ホーム画面データ
 static SDL_Texture *bg_title = NULL;
 static SDL_Texture *bg_true = NULL;
+static ResRef bg_title_ref;
+static ResRef bg_true_ref;
 static TTF_Font *font_main = NULL;
 
+#define HOME_FONT     "assets/font/main.otf"
+#define HOME_BG_TITLE "assets/bg/home.png"
+#define HOME_BG_TRUE  "assets/bg/true_home.png"
+
 // focus: 0=START, 1=対戦, 2=SETTINGS, 3=EXIT
 static int focus = 0;
 #define HOME_MENU_COUNT 4
@@ -27,13 +34,31 @@ const float START_DELAY = 2.0f;
 void scene_home_enter(void)
 {
     if (!font_main)
-        font_main = ui_load_font("assets/font/main.otf", 48);
+        font_main = res_font_acquire(HOME_FONT, 48);
+
+    // 背景はワーカーで展開（キャッシュに残っていればすぐ）。出来るまでは読み込み中の表示
+    if (!bg_title_ref.id)
+        bg_title_ref = res_texture_acquire(HOME_BG_TITLE);
+    if (!bg_true_ref.id)
+        bg_true_ref = res_texture_acquire(HOME_BG_TRUE);
+    bg_title = res_texture(bg_title_ref);
+    bg_true = res_texture(bg_true_ref);
+}
 
-    if (!bg_title)
-        bg_title = load_texture(g_renderer, "assets/bg/home.png");
+void scene_home_leave(void)
+{
+    res_release(&bg_title_ref);
+    res_release(&bg_true_ref);
+    bg_title = bg_true = NULL;
+    res_font_release(font_main);
+    font_main = NULL;
+}
 
-    if (!bg_true)
-        bg_true = load_texture(g_renderer, "assets/bg/true_home.png");
+void scene_home_prefetch(void)
+{
+    res_prefetch_font(HOME_FONT, 48);
+    res_prefetch_texture(HOME_BG_TITLE);
+    res_prefetch_texture(HOME_BG_TRUE);
 }
 
 // ------------------------------------
@@ -41,6 +66,9 @@ void scene_home_enter(void)
 // ------------------------------------
 void scene_home_update(float dt)
 {
+    bg_title = res_texture(bg_title_ref);
+    bg_true = res_texture(bg_true_ref);
+
     // 「愛を始める」演出中
     if (start_transition) {
         start_timer += dt;
@@ -60,6 +88,7 @@ void scene_home_update(float dt)
         if (focus == 0) {
             start_transition = true;
             start_timer = 0.0f;
+            scene_prefetch(SCENE_SELECT);   // 演出の間に次の立ち絵/声を読んでおく
         }
         else if (focus == 1) {
             // 対戦（未実装）
@@ -80,10 +109,20 @@ void scene_home_render(SDL_Renderer *r)
 {
     SDL_Rect fullscreen = {0, 0, 1280, 720};
 
-    if (start_transition)
-        SDL_RenderCopy(r, bg_true, NULL, &fullscreen);
-    else
-        SDL_RenderCopy(r, bg_title, NULL, &fullscreen);
+    SDL_Texture *bg = start_transition ? bg_true : bg_title;
+    if (bg) {
+        SDL_RenderCopy(r, bg, NULL, &fullscreen);
+    } else {
+        // 読み込み中：画面下に進み具合の棒
+        int done = 0, total = 0;
+        asset_loader_progress(&done, &total);
+        SDL_SetRenderDrawColor(r, 60, 60, 70, 255);
+        SDL_RenderFillRect(r, &(SDL_Rect){440, 680, 400, 6});
+        if (total > 0) {
+            SDL_SetRenderDrawColor(r, 230, 120, 160, 255);
+            SDL_RenderFillRect(r, &(SDL_Rect){440, 680, 400 * done / total, 6});
+        }
+    }
 
     if (start_transition)
         return;
@@ -4,7 +4,11 @@
 #include <SDL2/SDL.h>
 
 void scene_home_enter(void);
+void scene_home_leave(void);
 void scene_home_update(float dt);
 void scene_home_render(SDL_Renderer* r);
 
+// 次に入るときの画像/フォントを先読み（scene_prefetch から）
+void scene_home_prefetch(void);
+
 #endif
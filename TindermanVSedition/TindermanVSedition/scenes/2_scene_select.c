@@ -3,10 +3,12 @@
 #include "../core/scene_manager.h"
 #include "../core/input.h"
 #include "../core/engine.h"
+#include "../util/res_cache.h"
 #include "../util/texture.h"
 #include "../ui/ui_text.h"
 #include "../util/json.h"
 #include "../net/net_client.h"
+#include "../battle/girl_base.h"
 
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_ttf.h>
@@ -45,52 +47,9 @@ static Girl girls[3] = {
 };
 
 // ==============================================================
-// ステータス（基礎）
-//   ※画像の「基礎ステータス(確定)」に合わせる
-//   - himari: HP120 ATK20 SP14 ST80 (毎ターン+5)
-//   - kiritan: HP100 ATK5  SP8  ST40 (毎ターン+20)
-//   - sayo: 全部 0（暫定）
+// ステータス（基礎）/ 移動距離（基礎）
+//   battle/girl_base.c の表を使う（配分最適化・ツールと共通）
 // ==============================================================
-typedef struct
-{
-    int hp;
-    int atk;
-    int sp;
-    int st;
-    int st_regen; // 毎ターン +X（不要なら削除OK）
-} BaseStats;
-
-static BaseStats base_stats_by_index(int idx)
-{
-    switch (idx)
-    {
-    case 0: // himari
-        return (BaseStats){120, 20, 14, 80, 5};
-    case 1: // kiritan
-        return (BaseStats){100, 5, 8, 40, 20};
-    case 2: // sayo (暫定：全部0)
-        return (BaseStats){0, 0, 0, 0, 0};
-    default:
-        return (BaseStats){0, 0, 0, 0, 0};
-    }
-}
-
-// ==============================================================
-// 移動距離（基礎）
-//   - himari: 6マス
-//   - kiritan: 3マス
-//   - sayo:   暫定（必要なら変更）
-// ==============================================================
-static int move_range_by_index(int idx)
-{
-    switch (idx)
-    {
-    case 0: return 6; // himari
-    case 1: return 3; // kiritan
-    case 2: return 4; // sayo（暫定。0でも可）
-    default: return 3;
-    }
-}
 
 // ==============================================================
 // ステート
@@ -98,6 +57,14 @@ static int move_range_by_index(int idx)
 static SDL_Texture *tex_portrait[3];
 static SDL_Texture *tex_selected_icon;
 static SDL_Texture *tex_spark;
+// キャッシュの参照（展開中は立ち絵/アイコンなしで描く）
+static ResRef ref_portrait[3];
+static ResRef ref_selected_icon;
+static ResRef ref_spark;
+
+#define SELECT_FONT          "assets/font/main.otf"
+#define SELECT_SELECTED_ICON "assets/ui/selected.png"
+#define SELECT_SPARK         "assets/effects/spark.png"
 
 static TTF_Font *font_main;
 static TTF_Font *font_timer;
@@ -262,14 +229,12 @@ static void draw_neon_frame(SDL_Renderer *R, SDL_Rect dst, float t)
             float intensity = 1.0f - ((float)i / trail_count);
             SDL_Color col = lerp_color(pink, blue, tt);
 
-            SDL_SetTextureColorMod(
+            // パックの spark は premultiplied なので、色と透明度はまとめて掛ける
+            texture_set_mod(
                 tex_spark,
                 (Uint8)(col.r * intensity),
                 (Uint8)(col.g * intensity),
-                (Uint8)(col.b * intensity));
-
-            SDL_SetTextureAlphaMod(
-                tex_spark,
+                (Uint8)(col.b * intensity),
                 (Uint8)(255 * powf(intensity, 1.8f)));
 
             float size = size_base * (0.55f + 0.45f * intensity);
@@ -281,7 +246,7 @@ static void draw_neon_frame(SDL_Renderer *R, SDL_Rect dst, float t)
 
             SDL_RenderCopy(R, tex_spark, NULL, &sp);
         }
-        SDL_SetTextureAlphaMod(tex_spark, 255);
+        texture_set_mod(tex_spark, 255, 255, 255, 255);
     }
 }
 
@@ -304,25 +269,28 @@ static void finalize_selection(void)
     // キャラID
     json_write_string("build.json", "girl_id", girls[idx].id);
 
-    // キャラ別 基礎ステ注入
-    BaseStats bs = base_stats_by_index(idx);
-    json_write_int("build.json", "hp_base", bs.hp);
-    json_write_int("build.json", "atk_base", bs.atk);
-    json_write_int("build.json", "sp_base", bs.sp);
-    json_write_int("build.json", "st_base", bs.st);
-    json_write_int("build.json", "st_regen_base", bs.st_regen);
+    // キャラ別 基礎ステ注入（battle/girl_base.c）
+    const GirlBase *bs = girl_base_get(girls[idx].id);
+    json_write_int("build.json", "hp_base", bs->hp);
+    json_write_int("build.json", "atk_base", bs->atk);
+    json_write_int("build.json", "sp_base", bs->sp);
+    json_write_int("build.json", "st_base", bs->st);
+    json_write_int("build.json", "st_regen_base", bs->st_regen);
 
     // キャラ別 移動距離注入
-    int mv = move_range_by_index(idx);
+    int mv = bs->move_range;
     json_write_int("build.json", "move_range_base", mv);
 
     SDL_Log("[SELECT] girl=%s base=(HP:%d ATK:%d SP:%d ST:%d regen:%d) move=%d",
-            girls[idx].id, bs.hp, bs.atk, bs.sp, bs.st, bs.st_regen, mv);
+            girls[idx].id, bs->hp, bs->atk, bs->sp, bs->st, bs->st_regen, mv);
 
     if (voice_girl[idx])
         Mix_PlayChannel(-1, voice_girl[idx], 0);
 
     finalize_start_ms = SDL_GetTicks();
+
+    // 決定の演出（5秒）の間に、build.json の girl_id で会話の立ち絵を読んでおく
+    scene_prefetch(SCENE_CHAT);
 }
 
 // ==============================================================
@@ -335,17 +303,17 @@ void scene_select_enter(void)
     start_ms = SDL_GetTicks();
     deadline_ms = start_ms + 15000;
 
-    font_main = ui_load_font("assets/font/main.otf", 36);
-    font_timer = ui_load_font("assets/font/main.otf", 48);
+    font_main = res_font_acquire(SELECT_FONT, 36);
+    font_timer = res_font_acquire(SELECT_FONT, 48);
 
+    // 先読み済み/前回のものが残っていればそのまま使う
     for (int i = 0; i < 3; i++)
-        tex_portrait[i] = load_texture(g_renderer, girls[i].portrait_path);
-
-    tex_selected_icon = load_texture(g_renderer, "assets/ui/selected.png");
-    tex_spark = load_texture(g_renderer, "assets/effects/spark.png");
+        ref_portrait[i] = res_texture_acquire(girls[i].portrait_path);
+    ref_selected_icon = res_texture_acquire(SELECT_SELECTED_ICON);
+    ref_spark = res_texture_acquire(SELECT_SPARK);
 
     for (int i = 0; i < 3; i++)
-        voice_girl[i] = Mix_LoadWAV(girls[i].voice_path);
+        voice_girl[i] = res_chunk_acquire(girls[i].voice_path);
 
     focus = 0;
     decided_index = -1;
@@ -378,6 +346,11 @@ void scene_select_enter(void)
 // ==============================================================
 void scene_select_update(float dt)
 {
+    for (int i = 0; i < 3; i++)
+        tex_portrait[i] = res_texture(ref_portrait[i]);
+    tex_selected_icon = res_texture(ref_selected_icon);
+    tex_spark = res_texture(ref_spark);
+
     // サーバ接続中（リトライ処理）
     if (connecting_to_server) {
         Uint32 now = SDL_GetTicks();
@@ -538,19 +511,36 @@ void scene_select_render(SDL_Renderer *R)
 }
 
 // ==============================================================
-// exit
+// leave（キャッシュに返すだけ。決定ボイスは鳴り終わるまで残る）
 // ==============================================================
-void scene_select_exit(void)
+void scene_select_leave(void)
 {
-    for (int i = 0; i < 3; i++)
-        if (tex_portrait[i]) SDL_DestroyTexture(tex_portrait[i]);
+    for (int i = 0; i < 3; i++) {
+        res_release(&ref_portrait[i]);
+        tex_portrait[i] = NULL;
+    }
+    res_release(&ref_selected_icon);
+    res_release(&ref_spark);
+    tex_selected_icon = tex_spark = NULL;
 
-    if (tex_selected_icon) SDL_DestroyTexture(tex_selected_icon);
-    if (tex_spark) SDL_DestroyTexture(tex_spark);
+    res_font_release(font_main);
+    res_font_release(font_timer);
+    font_main = font_timer = NULL;
 
-    if (font_main) TTF_CloseFont(font_main);
-    if (font_timer) TTF_CloseFont(font_timer);
+    for (int i = 0; i < 3; i++) {
+        res_chunk_release(voice_girl[i]);
+        voice_girl[i] = NULL;
+    }
+}
 
-    for (int i = 0; i < 3; i++)
-        if (voice_girl[i]) Mix_FreeChunk(voice_girl[i]);
+void scene_select_prefetch(void)
+{
+    res_prefetch_font(SELECT_FONT, 36);
+    res_prefetch_font(SELECT_FONT, 48);
+    for (int i = 0; i < 3; i++) {
+        res_prefetch_texture(girls[i].portrait_path);
+        res_prefetch_chunk(girls[i].voice_path);
+    }
+    res_prefetch_texture(SELECT_SELECTED_ICON);
+    res_prefetch_texture(SELECT_SPARK);
 }
@@ -8,4 +8,7 @@ void scene_select_update(float dt);
 void scene_select_render(SDL_Renderer *r); // ← ★ render に変更、引数追加
 void scene_select_leave(void);             // ← ★ exit → leave に変更
 
+// 次に入るときの画像/フォント/声を先読み（scene_prefetch から）
+void scene_select_prefetch(void);
+
 #endif
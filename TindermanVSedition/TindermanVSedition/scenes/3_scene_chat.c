@@ -13,7 +13,9 @@
 #include "../core/scene_manager.h"
 #include "../core/input.h"
 #include "../core/engine.h"
-#include "../util/texture.h"
+#include "../util/res_cache.h"
+#include "../ui/ui_text.h"
+#include "../ui/ui_vlist.h"
 
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_ttf.h>
@@ -48,15 +50,45 @@ typedef enum
     CHAT_SYSTEM
 } ChatLineType;
 
+// 折り返し済みの表示行（描画のたびに組み直さない）
+//  - font / 幅 / 行送りが組んだときと同じなら使い回す
+//  - ChatLine を (ChatLine){type, ""} で作り直すと valid=false に戻る（本文を書き換えたら組み直し）
+#define CHAT_WRAP_MAX 32        // 1メッセージの最大行数（超えた分は最後の行へ）
+#define CHAT_LAYOUT_BUF 640     // prefix 込みの本文 + 行ごとの終端
+
+typedef struct
+{
+    bool valid;
+    TTF_Font *font;
+    int max_width;
+    int line_spacing;
+    int lines;
+    short start[CHAT_WRAP_MAX];     // buf 内の各行の先頭（行ごとに '\0' で切ってある）
+    char buf[CHAT_LAYOUT_BUF];
+} ChatLineLayout;
+
 typedef struct
 {
     ChatLineType type;
     char text[512];
+    ChatLineLayout layout;
 } ChatLine;
 
 static ChatLine chat_lines[CHAT_MAX];
 static int chat_line_count = 0;
 
+// ログ領域（折り返し幅と行送りは ChatLine の組みにも使う）
+#define CHAT_LOG_X 350
+#define CHAT_LOG_TOP 100
+#define CHAT_LOG_BOTTOM 600
+#define CHAT_LOG_WIDTH 700
+#define CHAT_LOG_LINE_SPACING 32
+
+// 高さの累積（見える範囲だけ描く）とスクロール位置（一番下に張り付くのが既定）
+static UiVList g_log_list;
+static int g_log_scroll = 0;
+static bool g_log_follow = true;
+
 // =============================================================
 // JSON パーサ（最小限）
 // =============================================================
@@ -238,23 +270,26 @@ static int emotion_key_to_id(const char *key)
 // =============================================================
 static SDL_Texture *g_portrait_by_emotion[EMO_COUNT] = {0};
 static SDL_Texture *g_portrait_current = NULL;
-static int g_portrait_current_id = EMO_TRUST; // 初期は trust
+static int g_portrait_current_id = EMO_TRUST; // 初期は trust（展開中なら「出したい表情」）
+static ResRef g_portrait_ref[EMO_COUNT];
+
+static void portrait_path(char *out, size_t n, const char *girl_id, int emo)
+{
+    snprintf(out, n, "assets/girls/%s/portrait/%s.png", girl_id, g_emotion_keys[emo]);
+}
 
 static void unload_portraits(void)
 {
     for (int i = 0; i < EMO_COUNT; i++)
     {
-        if (g_portrait_by_emotion[i])
-        {
-            SDL_DestroyTexture(g_portrait_by_emotion[i]);
-            g_portrait_by_emotion[i] = NULL;
-        }
+        res_release(&g_portrait_ref[i]);
+        g_portrait_by_emotion[i] = NULL;
     }
     g_portrait_current = NULL;
     g_portrait_current_id = EMO_TRUST;
 }
 
-static void load_portraits_for_girl(SDL_Renderer *r, const char *girl_id)
+static void load_portraits_for_girl(const char *girl_id)
 {
     unload_portraits();
 
@@ -264,25 +299,30 @@ static void load_portraits_for_girl(SDL_Renderer *r, const char *girl_id)
     for (int i = 0; i < EMO_COUNT; i++)
     {
         char path[512];
-        snprintf(path, sizeof(path),
-                 "assets/girls/%s/portrait/%s.png",
-                 girl_id, g_emotion_keys[i]);
+        portrait_path(path, sizeof(path), girl_id, i);
 
-        g_portrait_by_emotion[i] = load_texture(r, path);
+        // 展開はワーカーで（先読み済みならすぐ）。届いたものから portraits_poll で拾う
+        g_portrait_ref[i] = res_texture_acquire(path);
     }
+}
+
+// 毎フレーム：届いた表情差分を受け取る
+//  出したい表情が届いたらそれに、まだ何も出ていなければ先に届いたものを出しておく
+static void portraits_poll(void)
+{
+    for (int i = 0; i < EMO_COUNT; i++)
+        g_portrait_by_emotion[i] = res_texture(g_portrait_ref[i]);
 
-    if (g_portrait_by_emotion[EMO_TRUST])
+    if (g_portrait_by_emotion[g_portrait_current_id])
     {
-        g_portrait_current_id = EMO_TRUST;
-        g_portrait_current = g_portrait_by_emotion[EMO_TRUST];
+        g_portrait_current = g_portrait_by_emotion[g_portrait_current_id];
     }
-    else
+    else if (!g_portrait_current)
     {
         for (int i = 0; i < EMO_COUNT; i++)
         {
             if (g_portrait_by_emotion[i])
             {
-                g_portrait_current_id = i;
                 g_portrait_current = g_portrait_by_emotion[i];
                 break;
             }
@@ -296,8 +336,14 @@ static void set_current_emotion(const char *emotion_key)
     if (id < 0)
         return;
 
+    g_portrait_by_emotion[id] = res_texture(g_portrait_ref[id]);
     if (!g_portrait_by_emotion[id])
+    {
+        // 展開中なら届いたときに切り替える（今の絵はそのまま）
+        if (res_texture_state(g_portrait_ref[id]) == ASSET_PENDING)
+            g_portrait_current_id = id;
         return;
+    }
 
     g_portrait_current_id = id;
     g_portrait_current = g_portrait_by_emotion[id];
@@ -383,6 +429,10 @@ static char input_buf[CHAT_INPUT_MAX];
 static int input_len = 0;
 
 static SDL_Texture *tex_intro = NULL;
+static ResRef tex_intro_ref;
+
+#define CHAT_FONT  "assets/font/main.ttf"
+#define CHAT_INTRO "assets/ui/chat_start.png"
 
 // HUD
 static int g_current_affection = 30;
@@ -401,22 +451,6 @@ static float g_turn_time_left = TURN_LIMIT_SEC;
 static bool g_chat_ended = false;
 static bool g_end_notice_added = false;
 
-// =============================================================
-// UTF-8
-// =============================================================
-static int utf8_char_len(unsigned char c)
-{
-    if (c < 0x80)
-        return 1;
-    if ((c >> 5) == 0x6)
-        return 2;
-    if ((c >> 4) == 0xE)
-        return 3;
-    if ((c >> 3) == 0x1E)
-        return 4;
-    return 1;
-}
-
 // =============================================================
 // draw_text
 // =============================================================
@@ -425,105 +459,105 @@ static void draw_text(SDL_Renderer *r, TTF_Font *font, int x, int y, const char
     if (!font || !s || !s[0])
         return;
 
-    SDL_Color col = {255, 255, 255, 255};
-    SDL_Surface *surf = TTF_RenderUTF8_Blended(font, s, col);
-    if (!surf)
-        return;
+    // グリフアトラス経由（毎フレームの surface/texture 生成をしない）
+    ui_text_draw(r, font, s, x, y);
+}
 
-    SDL_Texture *tex = SDL_CreateTextureFromSurface(r, surf);
-    if (!tex)
-    {
-        SDL_FreeSurface(surf);
+// =============================================================
+// 表示用prefix込み文字列を作る
+// =============================================================
+static void build_line_with_prefix(char *out, size_t out_sz, const ChatLine *ln)
+{
+    if (!out || out_sz == 0 || !ln)
         return;
-    }
-
-    SDL_Rect dst = {x, y, surf->w, surf->h};
-    SDL_RenderCopy(r, tex, NULL, &dst);
 
-    SDL_DestroyTexture(tex);
-    SDL_FreeSurface(surf);
+    if (ln->type == CHAT_USER)
+        snprintf(out, out_sz, "You: %s", ln->text);
+    else if (ln->type == CHAT_CHAR)
+        snprintf(out, out_sz, "%s: %s", g_char_name, ln->text);
+    else
+        snprintf(out, out_sz, "%s", ln->text);
 }
 
 // =============================================================
-// 自動改行
+// 自動改行（ChatLine ごとに1回だけ組む）
+//  - 1文字ずつ送りを足し、幅を超えたらその文字の前で折る（文字列を伸ばしながら測り直さない）
 // =============================================================
-static int wrap_text_internal(SDL_Renderer *r, TTF_Font *font,
-                              int x, int y, int max_width,
-                              const char *text, int line_spacing, bool render)
+static void chat_layout_build(ChatLine *ln, TTF_Font *font, int max_width, int line_spacing)
 {
-    const char *p = text;
-    char line[1024] = {0};
-    int line_len = 0;
-    int draw_y = y;
-    int lines = 0;
-
-    while (*p)
+    ChatLineLayout *L = &ln->layout;
+    char src[600];
+    build_line_with_prefix(src, sizeof(src), ln);
+    normalize_newlines(src);
+
+    L->valid = true;
+    L->font = font;
+    L->max_width = max_width;
+    L->line_spacing = line_spacing;
+    L->lines = 0;
+    L->start[0] = 0;
+
+    int out = 0;
+    int pen = 0;
+    Uint32 prev = 0;
+    const char *p = src;
+    while (*p && out + 5 < CHAT_LAYOUT_BUF)
     {
-        int clen = utf8_char_len((unsigned char)*p);
+        const char *c0 = p;
+        Uint32 cp = ui_text_utf8_next(&p);
+        int adv = ui_text_advance(font, prev, cp);
 
-        char candidate[1024];
-        memcpy(candidate, line, (size_t)line_len);
-        memcpy(candidate + line_len, p, (size_t)clen);
-        candidate[line_len + clen] = '\0';
-
-        int w;
-        TTF_SizeUTF8(font, candidate, &w, NULL);
-
-        if (w > max_width && line_len > 0)
+        if (pen + adv > max_width && out > L->start[L->lines] && L->lines + 1 < CHAT_WRAP_MAX)
         {
-            if (render)
-                draw_text(r, font, x, draw_y, line);
-            draw_y += line_spacing;
-            lines++;
-            line_len = 0;
-            line[0] = '\0';
-            continue;
+            L->buf[out++] = '\0';
+            L->lines++;
+            L->start[L->lines] = (short)out;
+            pen = 0;
+            adv = ui_text_advance(font, 0, cp);
         }
 
-        memcpy(line, candidate, (size_t)(line_len + clen));
-        line_len += clen;
-        line[line_len] = '\0';
-        p += clen;
-    }
-
-    if (line_len > 0)
-    {
-        if (render)
-            draw_text(r, font, x, draw_y, line);
-        draw_y += line_spacing;
-        lines++;
+        memcpy(L->buf + out, c0, (size_t)(p - c0));
+        out += (int)(p - c0);
+        pen += adv;
+        prev = cp;
     }
+    L->buf[out] = '\0';
+    if (out > L->start[L->lines])
+        L->lines++;
+}
 
-    return lines * line_spacing;
+static const ChatLineLayout *chat_layout_get(ChatLine *ln, TTF_Font *font, int max_width, int line_spacing)
+{
+    ChatLineLayout *L = &ln->layout;
+    if (!L->valid || L->font != font || L->max_width != max_width || L->line_spacing != line_spacing)
+        chat_layout_build(ln, font, max_width, line_spacing);
+    return L;
 }
 
-static int draw_text_wrap(SDL_Renderer *r, TTF_Font *font,
-                          int x, int y, int max_width,
-                          const char *text, int line_spacing)
+static int chat_layout_height(const ChatLineLayout *L)
 {
-    return wrap_text_internal(r, font, x, y, max_width, text, line_spacing, true);
+    return L->lines * L->line_spacing;
 }
 
-static int measure_text_wrap_height(TTF_Font *font, int max_width,
-                                    const char *text, int line_spacing)
+static void chat_layout_draw(SDL_Renderer *r, const ChatLineLayout *L, int x, int y)
 {
-    return wrap_text_internal(NULL, font, 0, 0, max_width, text, line_spacing, false);
+    for (int i = 0; i < L->lines; i++)
+        draw_text(r, L->font, x, y + i * L->line_spacing, L->buf + L->start[i]);
 }
 
-// =============================================================
-// 表示用prefix込み文字列を作る
-// =============================================================
-static void build_line_with_prefix(char *out, size_t out_sz, const ChatLine *ln)
+// ログへ1件足す（ここで1回だけ組んで、高さをリストへ積む）
+static bool chat_append_line(ChatLineType type, const char *text)
 {
-    if (!out || out_sz == 0 || !ln)
-        return;
+    if (chat_line_count >= CHAT_MAX)
+        return false;
 
-    if (ln->type == CHAT_USER)
-        snprintf(out, out_sz, "You: %s", ln->text);
-    else if (ln->type == CHAT_CHAR)
-        snprintf(out, out_sz, "%s: %s", g_char_name, ln->text);
-    else
-        snprintf(out, out_sz, "%s", ln->text);
+    ChatLine *ln = &chat_lines[chat_line_count++];
+    *ln = (ChatLine){type, ""};
+    snprintf(ln->text, sizeof(ln->text), "%s", text ? text : "");
+
+    const ChatLineLayout *L = chat_layout_get(ln, g_font_main, CHAT_LOG_WIDTH, CHAT_LOG_LINE_SPACING);
+    ui_vlist_push(&g_log_list, chat_layout_height(L));
+    return true;
 }
 
 // =============================================================
@@ -534,12 +568,11 @@ static void add_end_notice_once(void)
     if (g_end_notice_added)
         return;
 
-    if (chat_line_count < CHAT_MAX)
-    {
-        chat_lines[chat_line_count++] =
-            (ChatLine){CHAT_SYSTEM, "── 会話終了：Enterでステータス配分へ ──"};
-    }
+    chat_append_line(CHAT_SYSTEM, "── 会話終了：Enterでステータス配分へ ──");
     g_end_notice_added = true;
+
+    // Enter を待つ間に配分画面の背景/フォントを読んでおく
+    scene_prefetch(SCENE_ALLOCATE);
 }
 
 // =============================================================
@@ -582,8 +615,7 @@ static void chat_send_message(const char *msg)
         return;
 
     // ユーザー発言
-    chat_lines[chat_line_count++] = (ChatLine){CHAT_USER, ""};
-    snprintf(chat_lines[chat_line_count - 1].text, 512, "%s", send_buf);
+    chat_append_line(CHAT_USER, send_buf);
 
     // AI呼び出し（ブロッキング）
     ChatAIReply ai = {0};
@@ -600,11 +632,7 @@ static void chat_send_message(const char *msg)
     }
 
     // AI返答
-    if (chat_line_count < CHAT_MAX)
-    {
-        chat_lines[chat_line_count++] = (ChatLine){CHAT_CHAR, ""};
-        snprintf(chat_lines[chat_line_count - 1].text, 512, "%s", ai.text);
-    }
+    chat_append_line(CHAT_CHAR, ai.text);
 
     // ★ターン消費（往復が完了したら1ターン）
     g_turn_done++;
@@ -621,6 +649,47 @@ static void chat_send_message(const char *msg)
     add_end_notice_once();
 }
 
+// =============================================================
+// build.json の girl_id（なければ false で out は触らない）
+// =============================================================
+static bool read_build_girl_id(char *out, size_t n)
+{
+    FILE *fp = fopen("build.json", "r");
+    if (!fp)
+        return false;
+
+    char json[4096] = {0};
+    size_t len = fread(json, 1, sizeof(json) - 1, fp);
+    json[len] = '\0';
+    fclose(fp);
+
+    const char *id = find_json_value(json, "girl_id");
+    if (!id || !id[0])
+        return false;
+    snprintf(out, n, "%s", id);
+    return true;
+}
+
+// =============================================================
+// Prefetch（SELECT の決定演出の間に。girl_id は決定時に書かれている）
+// =============================================================
+void scene_chat_prefetch(void)
+{
+    res_prefetch_font(CHAT_FONT, 26);
+    res_prefetch_font(CHAT_FONT, 28);
+    res_prefetch_texture(CHAT_INTRO);
+
+    char girl_id[64];
+    if (!read_build_girl_id(girl_id, sizeof(girl_id)))
+        return;
+    for (int i = 0; i < EMO_COUNT; i++)
+    {
+        char path[512];
+        portrait_path(path, sizeof(path), girl_id, i);
+        res_prefetch_texture(path);
+    }
+}
+
 // =============================================================
 // Enter
 // =============================================================
@@ -629,32 +698,20 @@ void scene_chat_enter(void)
     SDL_StartTextInput();
 
     // build.json から girl_id を読み、表示名に解決
+    if (read_build_girl_id(g_girl_id, sizeof(g_girl_id)))
     {
-        FILE *fp = fopen("build.json", "r");
-        if (fp)
-        {
-            char json[4096] = {0};
-            size_t n = fread(json, 1, sizeof(json) - 1, fp);
-            json[n] = '\0';
-            fclose(fp);
-
-            const char *id = find_json_value(json, "girl_id");
-            if (id && id[0])
-            {
-                snprintf(g_girl_id, sizeof(g_girl_id), "%s", id);
-                snprintf(g_char_name, sizeof(g_char_name), "%s",
-                         resolve_girl_name(g_girl_id));
-            }
-        }
+        snprintf(g_char_name, sizeof(g_char_name), "%s",
+                 resolve_girl_name(g_girl_id));
     }
 
-    // フォント（あなたのCHATに合わせて main.ttf）
-    g_font_main = TTF_OpenFont("assets/font/main.ttf", 26);
-    g_font_aff = TTF_OpenFont("assets/font/main.ttf", 28);
-    g_font_delta = TTF_OpenFont("assets/font/main.ttf", 28);
+    // フォント（あなたのCHATに合わせて main.ttf。同じ大きさはキャッシュで1つ）
+    g_font_main = res_font_acquire(CHAT_FONT, 26);
+    g_font_aff = res_font_acquire(CHAT_FONT, 28);
+    g_font_delta = res_font_acquire(CHAT_FONT, 28);
 
     // intro
-    tex_intro = load_texture(g_renderer, "assets/ui/chat_start.png");
+    if (!tex_intro_ref.id)
+        tex_intro_ref = res_texture_acquire(CHAT_INTRO);
     intro_timer = 0.0f;
     intro_done = false;
 
@@ -664,6 +721,9 @@ void scene_chat_enter(void)
 
     // ログ
     chat_line_count = 0;
+    ui_vlist_clear(&g_log_list);
+    g_log_scroll = 0;
+    g_log_follow = true;
 
     // ターン制初期化
     g_turn_done = 0;
@@ -675,7 +735,7 @@ void scene_chat_enter(void)
 
     // 表情差分
     snprintf(g_current_emotion, sizeof(g_current_emotion), "%s", "trust");
-    load_portraits_for_girl(g_renderer, g_girl_id);
+    load_portraits_for_girl(g_girl_id);
     set_current_emotion(g_current_emotion);
 }
 
@@ -686,17 +746,16 @@ void scene_chat_leave(void)
 {
     SDL_StopTextInput();
 
-    if (g_font_main)
-        TTF_CloseFont(g_font_main);
-    if (g_font_aff)
-        TTF_CloseFont(g_font_aff);
-    if (g_font_delta)
-        TTF_CloseFont(g_font_delta);
+    res_font_release(g_font_main);
+    res_font_release(g_font_aff);
+    res_font_release(g_font_delta);
+    g_font_main = g_font_aff = g_font_delta = NULL;
 
-    if (tex_intro)
-        SDL_DestroyTexture(tex_intro);
+    res_release(&tex_intro_ref);
+    tex_intro = NULL;
 
     unload_portraits();
+    ui_vlist_free(&g_log_list);
 }
 
 // =============================================================
@@ -704,14 +763,34 @@ void scene_chat_leave(void)
 // =============================================================
 void scene_chat_update(float dt)
 {
+    portraits_poll();
+
     if (!intro_done)
     {
+        // スライドインの絵が届くまでは時間を進めない（その間は何も出さない）
+        if (res_texture_state(tex_intro_ref) == ASSET_PENDING)
+            return;
+        tex_intro = res_texture(tex_intro_ref);
+
         intro_timer += dt;
         if (intro_timer >= INTRO_DURATION)
             intro_done = true;
         return;
     }
 
+    // ログのスクロール（PgUp/PgDn で半画面ずつ。一番下まで戻ったら新着に追従）
+    {
+        const int view_h = CHAT_LOG_BOTTOM - CHAT_LOG_TOP;
+        if (input_is_pressed(SDL_SCANCODE_PAGEUP) || input_is_pressed(SDL_SCANCODE_PAGEDOWN))
+        {
+            if (g_log_follow)
+                g_log_scroll = ui_vlist_bottom_scroll(&g_log_list, view_h);
+            g_log_scroll += input_is_pressed(SDL_SCANCODE_PAGEUP) ? -view_h / 2 : view_h / 2;
+            g_log_scroll = ui_vlist_clamp_scroll(&g_log_list, g_log_scroll, view_h);
+            g_log_follow = (g_log_scroll >= ui_vlist_bottom_scroll(&g_log_list, view_h));
+        }
+    }
+
     // 終了後：EnterでALLOCATEへ
     if (g_chat_ended)
     {
@@ -812,49 +891,31 @@ void scene_chat_render(SDL_Renderer *r)
         draw_text(r, g_font_main, 30, 330, "No portrait");
 
     // =============================================================
-    // ログ領域
+    // ログ領域（見えている分 + 上下1行ぶんだけ組んで描く）
     // =============================================================
-    const int log_x = 350;
-    const int log_top = 100;
-    const int log_bottom = 600;
-    const int visible_h = log_bottom - log_top;
-    const int max_width = 700;
-    const int line_spacing = 32;
-
-    int heights[CHAT_MAX];
-    int total_h = 0;
-
-    for (int i = 0; i < chat_line_count; i++)
     {
-        char buf[600];
-        build_line_with_prefix(buf, sizeof(buf), &chat_lines[i]);
-        normalize_newlines(buf);
-
-        heights[i] = measure_text_wrap_height(g_font_main, max_width, buf, line_spacing);
-        total_h += heights[i];
-    }
+        const int view_h = CHAT_LOG_BOTTOM - CHAT_LOG_TOP;
+        const int total_h = ui_vlist_total(&g_log_list);
 
-    int start = 0;
-    int h = 0;
+        if (g_log_follow)
+            g_log_scroll = ui_vlist_bottom_scroll(&g_log_list, view_h);
+        g_log_scroll = ui_vlist_clamp_scroll(&g_log_list, g_log_scroll, view_h);
 
-    for (int i = chat_line_count - 1; i >= 0; i--)
-    {
-        if (h + heights[i] > visible_h)
-            break;
-        h += heights[i];
-        start = i;
-    }
+        // 少ないうちは下に寄せる
+        const int base_y = CHAT_LOG_TOP + (total_h < view_h ? view_h - total_h : 0) - g_log_scroll;
 
-    int y = log_bottom - h;
+        int first, end;
+        ui_vlist_visible(&g_log_list, g_log_scroll, view_h, CHAT_LOG_LINE_SPACING, &first, &end);
 
-    for (int i = start; i < chat_line_count; i++)
-    {
-        char buf[600];
-        build_line_with_prefix(buf, sizeof(buf), &chat_lines[i]);
-        normalize_newlines(buf);
-
-        draw_text_wrap(r, g_font_main, log_x, y, max_width, buf, line_spacing);
-        y += heights[i];
+        SDL_Rect clip = {CHAT_LOG_X, CHAT_LOG_TOP, 1280 - CHAT_LOG_X, view_h};
+        SDL_RenderSetClipRect(r, &clip);
+        for (int i = first; i < end; i++)
+        {
+            const ChatLineLayout *L = chat_layout_get(&chat_lines[i], g_font_main, CHAT_LOG_WIDTH, CHAT_LOG_LINE_SPACING);
+            ui_vlist_set_height(&g_log_list, i, chat_layout_height(L));
+            chat_layout_draw(r, L, CHAT_LOG_X, base_y + ui_vlist_top(&g_log_list, i));
+        }
+        SDL_RenderSetClipRect(r, NULL);
     }
 
     // 右HUD
@@ -13,6 +13,9 @@ extern "C"
     void scene_chat_render(SDL_Renderer *r);
     void scene_chat_leave(void);
 
+    // 次に入るときの画像/フォントを先読み（scene_prefetch から）
+    void scene_chat_prefetch(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -14,14 +14,18 @@
 //   * 好感度(開始値)が50以上のときだけ選択可能
 //   * 習得コストは20（ポイントから差し引き）
 // - 保存：build.json に *_add と tag_learned を保存
+// - おすすめ配分：battle/alloc_opt をバックグラウンドで回し、上位2件を下に表示
+//   * Tab で1位の配分をそのまま適用（あとから手で直せる）
 // =============================================================
 
 #include "4_scene_allocate.h"
 #include "../core/engine.h"
 #include "../core/input.h"
 #include "../core/scene_manager.h"
-#include "../util/texture.h"
+#include "../util/res_cache.h"
 #include "../util/json.h"
+#include "../battle/alloc_rules.h"
+#include "../battle/alloc_opt.h"
 
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_ttf.h>
@@ -36,19 +40,11 @@
 #define ALLOCATE_TIME_LIMIT_SEC 30.0f
 #define REPEAT_DELAY_SEC 0.12f
 
-// ブロック単位（表示のみ）
-#define BLOCK_UNIT_HP   10
-#define BLOCK_UNIT_ATK  2
-#define BLOCK_UNIT_SPD  2
-#define BLOCK_UNIT_ST   10
+// ブロック単位・コスト・タッグ技は battle/alloc_rules.h
 
 // 横に並べる最大ブロック数（見た目上の上限）
 #define BLOCK_MAX 20
 
-// タッグ技
-#define TAG_UNLOCK_AFFECTION 50
-#define TAG_COST 20
-
 // build.json keys（トップレベル）
 #define KEY_AFFECTION   "affection"
 #define KEY_HP_BASE     "hp_base"
@@ -60,6 +56,11 @@
 #define KEY_SP_ADD      "sp_add"
 #define KEY_ST_ADD      "st_add"
 #define KEY_TAG_LEARNED "tag_learned"
+#define KEY_GIRL_ID     "girl_id"
+#define KEY_MOVE_RANGE  "move_range_base"
+
+// おすすめ表示件数
+#define SUGGEST_SHOW 2
 
 // =============================================================
 // 内部
@@ -102,6 +103,16 @@ static float g_repeat_timer = 0.0f;
 
 static TTF_Font* g_font = NULL;
 static SDL_Texture* g_bg = NULL;
+static ResRef       g_bg_ref;        // 展開中は背景なしで描く
+
+#define ALLOCATE_FONT "assets/font/main.ttf"
+#define ALLOCATE_BG   "assets/ui/allocate_bg.png"
+
+// おすすめ配分（alloc_opt）
+static AllocOpt*     g_opt = NULL;
+static uint32_t      g_opt_seen = 0;
+static AllocOptEntry g_suggest[ALLOC_OPT_TOP_MAX];
+static int           g_suggest_n = 0;
 
 // =============================================================
 // ステ別パラメータ
@@ -110,10 +121,10 @@ static int stat_cost_per_1(StatId s)
 {
     switch (s)
     {
-    case STAT_HP:  return 1;
-    case STAT_ATK: return 10;
-    case STAT_SPD: return 5;
-    case STAT_ST:  return 3;   // ST は +1 = 3
+    case STAT_HP:  return ALLOC_COST_HP;
+    case STAT_ATK: return ALLOC_COST_ATK;
+    case STAT_SPD: return ALLOC_COST_SPD;
+    case STAT_ST:  return ALLOC_COST_ST;
     default:       return 1;
     }
 }
@@ -122,10 +133,10 @@ static int stat_block_unit(StatId s)
 {
     switch (s)
     {
-    case STAT_HP:  return BLOCK_UNIT_HP;
-    case STAT_ATK: return BLOCK_UNIT_ATK;
-    case STAT_SPD: return BLOCK_UNIT_SPD;
-    case STAT_ST:  return BLOCK_UNIT_ST;
+    case STAT_HP:  return ALLOC_BLOCK_UNIT_HP;
+    case STAT_ATK: return ALLOC_BLOCK_UNIT_ATK;
+    case STAT_SPD: return ALLOC_BLOCK_UNIT_SPD;
+    case STAT_ST:  return ALLOC_BLOCK_UNIT_ST;
     default:       return 1;
     }
 }
@@ -162,14 +173,14 @@ static void load_from_build_json(void)
     g_alloc[STAT_ST]  = safe_read_int_or(KEY_ST_ADD, 0);
 
     // 好感度：読めなければ30
-    g_affection_start = safe_read_int_or(KEY_AFFECTION, 30);
+    g_affection_start = safe_read_int_or(KEY_AFFECTION, ALLOC_DEFAULT_AFFECTION);
     if (g_affection_start < 0) g_affection_start = 0;
 
     // タッグ：読めなければOFF
     g_tag_learned = (safe_read_int_or(KEY_TAG_LEARNED, 0) != 0);
 
     // 解放条件
-    g_tag_unlocked = (g_affection_start >= TAG_UNLOCK_AFFECTION);
+    g_tag_unlocked = (g_affection_start >= ALLOC_TAG_UNLOCK_AFFECTION);
     if (!g_tag_unlocked) g_tag_learned = false; // ロック中は強制OFF
 }
 
@@ -184,7 +195,7 @@ static int calc_used_cost_points(void)
         if (a < 0) a = 0;
         used += a * c;
     }
-    if (g_tag_learned) used += TAG_COST;
+    if (g_tag_learned) used += ALLOC_TAG_COST;
     return used;
 }
 
@@ -339,13 +350,85 @@ static void toggle_tag_skill(void)
     if (!g_tag_unlocked) return;
 
     if (!g_tag_learned) {
-        if (g_points_left < TAG_COST) return;
+        if (g_points_left < ALLOC_TAG_COST) return;
         g_tag_learned = true;
-        g_points_left -= TAG_COST;
+        g_points_left -= ALLOC_TAG_COST;
     } else {
         g_tag_learned = false;
-        g_points_left += TAG_COST;
+        g_points_left += ALLOC_TAG_COST;
+    }
+}
+
+// =============================================================
+// おすすめ配分
+// =============================================================
+static void opt_start(void)
+{
+    AllocOptConfig cfg;
+    memset(&cfg, 0, sizeof(cfg));
+
+    char girl_id[64] = "himari";
+    (void)json_read_string("build.json", KEY_GIRL_ID, girl_id, (int)sizeof(girl_id));
+    snprintf(cfg.self.girl_id, sizeof(cfg.self.girl_id), "%s", girl_id);
+
+    cfg.self.hp_base  = (int16_t)g_base[STAT_HP];
+    cfg.self.atk_base = (int16_t)g_base[STAT_ATK];
+    cfg.self.sp_base  = (int16_t)g_base[STAT_SPD];
+    cfg.self.st_base  = (int16_t)g_base[STAT_ST];
+
+    int mr = safe_read_int_or(KEY_MOVE_RANGE, 3);
+    if (mr < 0) mr = 0;
+    if (mr > 20) mr = 20;
+    cfg.self.move_range = (uint8_t)mr;
+
+    cfg.points = g_affection_start;
+    cfg.tag_unlocked = g_tag_unlocked;
+
+    // 描画スレッドのぶんを1つ残す
+    cfg.threads = SDL_GetCPUCount() - 1;
+    if (cfg.threads < 1) cfg.threads = 1;
+    cfg.seed = (uint32_t)SDL_GetTicks();
+
+    g_suggest_n = 0;
+    g_opt_seen = 0;
+    g_opt = alloc_opt_start(&cfg);
+    if (!g_opt) printf("[ALLOCATE] alloc_opt_start failed\n");
+}
+
+static void opt_stop(void)
+{
+    if (g_opt) { alloc_opt_stop(g_opt); g_opt = NULL; }
+}
+
+static void opt_poll(void)
+{
+    if (!g_opt) return;
+    int n = alloc_opt_poll(g_opt, &g_opt_seen, g_suggest, ALLOC_OPT_TOP_MAX);
+    if (n >= 0) g_suggest_n = n;
+}
+
+// 1位の配分を適用（ポイントが足りない配分は来ないが、念のため再計算で整合）
+static void apply_top_suggestion(void)
+{
+    if (g_suggest_n <= 0) return;
+
+    const AllocOptEntry *e = &g_suggest[0];
+    for (int i = 0; i < STAT_COUNT; i++) g_alloc[i] = e->add[i];
+    g_tag_learned = g_tag_unlocked && e->tag;
+
+    recompute_points_left();
+}
+
+// 決定ボタンの右に収まるよう、0 のステは省く（例：「1位 HP+25 SPD+1 93%」）
+static void format_suggestion(char *buf, size_t cap, int rank, const AllocOptEntry *e)
+{
+    int n = snprintf(buf, cap, "%d位", rank + 1);
+    for (int i = 0; i < STAT_COUNT && n > 0 && (size_t)n < cap; i++) {
+        if (e->add[i] <= 0) continue;
+        n += snprintf(buf + n, cap - (size_t)n, " %s+%d", g_stat_names[i], e->add[i]);
     }
+    if (e->tag && n > 0 && (size_t)n < cap) n += snprintf(buf + n, cap - (size_t)n, " タッグ");
+    if (n > 0 && (size_t)n < cap) snprintf(buf + n, cap - (size_t)n, " %d%%", (int)(e->score * 100.0f + 0.5f));
 }
 
 // =============================================================
@@ -353,6 +436,7 @@ static void toggle_tag_skill(void)
 // =============================================================
 static void finalize_and_go_next(void)
 {
+    opt_stop();
     save_to_build_json();
 
     g_locked = true;
@@ -382,19 +466,28 @@ void scene_allocate_enter(void)
     g_cursor = 0;
     if (!item_is_selectable(g_cursor)) move_cursor(+1);
 
-    g_font = TTF_OpenFont("assets/font/main.ttf", 28);
+    // CHAT と同じ main.ttf 28 はキャッシュに残っているものを使う
+    g_font = res_font_acquire(ALLOCATE_FONT, 28);
     if (!g_font) {
         printf("[ALLOCATE] TTF_OpenFont failed: %s\n", TTF_GetError());
     }
 
-    g_bg = load_texture(g_renderer, "assets/ui/allocate_bg.png");
+    if (!g_bg_ref.id) g_bg_ref = res_texture_acquire(ALLOCATE_BG);
+
+    opt_start();
 }
 
 // ※あなたの既存コード互換のため残す（scene_manager が exit を呼ぶなら exit を使う）
 void scene_allocate_leave(void)
 {
-    if (g_font) { TTF_CloseFont(g_font); g_font=NULL; }
-    if (g_bg)   { SDL_DestroyTexture(g_bg); g_bg=NULL; }
+    opt_stop();
+    res_font_release(g_font); g_font=NULL;
+    res_release(&g_bg_ref);   g_bg=NULL;
+}
+void scene_allocate_prefetch(void)
+{
+    res_prefetch_font(ALLOCATE_FONT, 28);
+    res_prefetch_texture(ALLOCATE_BG);
 }
 void scene_allocate_exit(void)
 {
@@ -403,6 +496,8 @@ void scene_allocate_exit(void)
 
 void scene_allocate_update(float dt)
 {
+    g_bg = res_texture(g_bg_ref);
+
     // タイムアウトで強制確定
     if (!g_locked) {
         g_time_left -= dt;
@@ -416,6 +511,11 @@ void scene_allocate_update(float dt)
 
     g_repeat_timer -= dt;
 
+    opt_poll();
+
+    // Tab でおすすめ1位を適用
+    if (input_is_pressed(SDL_SCANCODE_TAB)) apply_top_suggestion();
+
     // 上下でカーソル
     if (input_is_pressed(SDL_SCANCODE_UP))   move_cursor(-1);
     if (input_is_pressed(SDL_SCANCODE_DOWN)) move_cursor(+1);
@@ -541,14 +641,14 @@ void scene_allocate_render(SDL_Renderer *r)
         }
 
         if (!g_tag_unlocked) {
-            snprintf(buf, sizeof(buf), "タッグ技を習得する（好感度%d以上で解放）", TAG_UNLOCK_AFFECTION);
+            snprintf(buf, sizeof(buf), "タッグ技を習得する（好感度%d以上で解放）", ALLOC_TAG_UNLOCK_AFFECTION);
         } else {
             snprintf(buf, sizeof(buf), "タッグ技を習得する：%s", g_tag_learned ? "ON" : "OFF");
         }
         draw_text(r, base_x, y, buf, c);
 
         // コスト表示（右）
-        snprintf(buf, sizeof(buf), "(cost %d)", TAG_COST);
+        snprintf(buf, sizeof(buf), "(cost %d)", ALLOC_TAG_COST);
         draw_text(r, 1080, y, buf, (!g_tag_unlocked) ? col_dim() : col_white());
     }
 
@@ -570,6 +670,19 @@ void scene_allocate_render(SDL_Renderer *r)
         draw_text(r, btn.x + 160, btn.y + 15, "決定", sel ? col_hi() : col_white());
     }
 
+    // おすすめ配分（決定ボタンの右）
+    {
+        int y = base_y + (STAT_COUNT+1)*row_h - 15;
+        if (g_suggest_n > 0) {
+            for (int i = 0; i < g_suggest_n && i < SUGGEST_SHOW; i++) {
+                format_suggestion(buf, sizeof(buf), i, &g_suggest[i]);
+                draw_text(r, 880, y + i * 36, buf, i == 0 ? col_hi() : col_dim());
+            }
+        } else if (g_opt) {
+            draw_text(r, 880, y, "おすすめ計算中…", col_dim());
+        }
+    }
+
     // 操作説明
-    draw_text(r, 40, 690, "操作：↑↓選択  →+1  ←-1  Enter=決定（タッグは左右/EnterでON/OFF）", col_white());
+    draw_text(r, 40, 690, "操作：↑↓選択  →+1  ←-1  Enter=決定  Tab=おすすめ適用（タッグは左右/EnterでON/OFF）", col_white());
 }
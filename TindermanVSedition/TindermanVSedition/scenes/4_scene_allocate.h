@@ -8,4 +8,7 @@ void scene_allocate_leave(void);
 void scene_allocate_update(float dt);
 void scene_allocate_render(SDL_Renderer *r);
 
+// 次に入るときの画像/フォントを先読み（scene_prefetch から）
+void scene_allocate_prefetch(void);
+
 #endif
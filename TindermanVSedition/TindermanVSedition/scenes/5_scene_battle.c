@@ -4,9 +4,16 @@
 #include "../core/input.h"
 #include "../core/scene_manager.h"
 #include "../ui/ui_text.h"
+#include "../ui/ui_layer.h"
+#include "../ui/ui_batch.h"
 #include "../util/json.h"
+#include "../util/res_cache.h"
 
 #include "battle/battle_core.h"
+#include "battle/battle_ai.h"
+#include "battle/battle_threat.h"
+#include "battle/battle_replay.h"
+#include "battle/battle_defs.h"
 #include "battle/battle_skills.h"
 #include "battle/cutin.h"
 #include "battle/char_defs.h"
@@ -25,13 +32,15 @@
 // ===============================
 //  表示/フォント
 // ===============================
-static TTF_Font *g_font = NULL;
+static TTF_Font *g_font = NULL;   // キャッシュから（leave で返す）
+#define BATTLE_FONT "assets/font/main.otf"
 
 // ===============================
 //  Battle Core（純ロジック）
 // ===============================
 static BattleCore g_core;
 static bool g_inited = false;
+static BattleEventCursor g_ev_cursor; // 演出用の読み出し位置（ターン頭で取り直す）
 
 // ===============================
 //  Cutin context（演出）
@@ -75,13 +84,7 @@ static const char* choose_cutin_mp4(const char *skill_id, int target_ui, char *o
     if (access(out, R_OK) == 0) return out;
 
     // 4) 既存の解決（互換）
-    {
-        const char *p = battle_skill_movie_path(skill_id);
-        if (p && p[0]) {
-            snprintf(out, out_sz, "%s", p);
-            if (access(out, R_OK) == 0) return out;
-        }
-    }
+    if (battle_skill_movie_path(skill_id, out, out_sz) && access(out, R_OK) == 0) return out;
 
     return NULL;
 }
@@ -90,50 +93,85 @@ static const char* choose_cutin_mp4(const char *skill_id, int target_ui, char *o
 //  オンライン対戦用状態
 // ===============================
 static bool g_online_mode = false;
-static bool g_waiting_opponent_info = false;  // GAME_INFO交換待ち
+static bool g_waiting_opponent_info = false;  // GAME_INFO交換待ち（OPPONENT_INFO と MATCH_STAGE の両方）
 static NetGameInfo g_opponent_info;
+static bool g_have_opponent_info = false;
+static const BattleStage *g_match_stage = NULL;  // オンライン：サーバが決めたステージ（NULL=なし）
 static bool g_sent_turn_cmd = false;
 
-// build.jsonから自分のGAME_INFOを構築して送信
-static void send_my_game_info(void)
+// build.jsonから自分のGAME_INFOを構築（オフライン対戦・リプレイ記録も同じ値から始める）
+//   build.json に無いキーはローカル対戦と同じ既定値（版数1 までは送信だけ 0 だった → NET_PROTOCOL_VERSION）
+static void read_my_game_info(NetGameInfo *info)
 {
-    NetGameInfo info;
-    memset(&info, 0, sizeof(info));
+    memset(info, 0, sizeof(*info));
+    info->protocol = NET_PROTOCOL_VERSION;
+    info->defs_checksum = battle_defs_checksum();
 
     char girl_id[64] = "himari";
     (void)json_read_string("build.json", "girl_id", girl_id, (int)sizeof(girl_id));
-    snprintf(info.girl_id, sizeof(info.girl_id), "%s", girl_id);
-
-    int v = 0;
-    json_read_int("build.json", "hp_base",  &v); info.hp_base  = (int16_t)v; v = 0;
-    json_read_int("build.json", "atk_base", &v); info.atk_base = (int16_t)v; v = 0;
-    json_read_int("build.json", "sp_base",  &v); info.sp_base  = (int16_t)v; v = 0;
-    json_read_int("build.json", "st_base",  &v); info.st_base  = (int16_t)v; v = 0;
-    json_read_int("build.json", "hp_add",   &v); info.hp_add   = (int16_t)v; v = 0;
-    json_read_int("build.json", "atk_add",  &v); info.atk_add  = (int16_t)v; v = 0;
-    json_read_int("build.json", "sp_add",   &v); info.sp_add   = (int16_t)v; v = 0;
-    json_read_int("build.json", "st_add",   &v); info.st_add   = (int16_t)v; v = 0;
+    snprintf(info->girl_id, sizeof(info->girl_id), "%s", girl_id);
+
+    int v;
+    v = 100; json_read_int("build.json", "hp_base",  &v); info->hp_base  = (int16_t)v;
+    v = 10;  json_read_int("build.json", "atk_base", &v); info->atk_base = (int16_t)v;
+    v = 10;  json_read_int("build.json", "sp_base",  &v); info->sp_base  = (int16_t)v;
+    v = 30;  json_read_int("build.json", "st_base",  &v); info->st_base  = (int16_t)v;
+    v = 0;   json_read_int("build.json", "hp_add",   &v); info->hp_add   = (int16_t)v;
+    v = 0;   json_read_int("build.json", "atk_add",  &v); info->atk_add  = (int16_t)v;
+    v = 0;   json_read_int("build.json", "sp_add",   &v); info->sp_add   = (int16_t)v;
+    v = 0;   json_read_int("build.json", "st_add",   &v); info->st_add   = (int16_t)v;
 
     int tag = 0;
     json_read_int("build.json", "tag_learned", &tag);
-    info.tag_learned = (uint8_t)(tag ? 1 : 0);
+    info->tag_learned = (uint8_t)(tag ? 1 : 0);
 
     int mr = 3;
     json_read_int("build.json", "move_range_base", &mr);
-    info.move_range = (uint8_t)mr;
+    if (mr < 0) mr = 0;
+    if (mr > 20) mr = 20;
+    info->move_range = (uint8_t)mr;
+}
 
+// 自分のGAME_INFOを送信
+static void send_my_game_info(void)
+{
+    NetGameInfo info;
+    read_my_game_info(&info);
     net_send_game_info(&info);
 }
 
-// 受信したTurnCmdのx座標をミラーリング (20-x)
-static void mirror_turn_cmd(TurnCmd *cmd)
+// ===============================
+//  リプレイ（記録/再生）
+//   - 通常対戦は毎ターン g_replay に記録し、決着/離脱時に REPLAY_LAST_PATH へ保存
+//   - 再生：1x / 8x / 即時、カットイン省略、キーフレーム＋再シミュレートでシーク
+// ===============================
+#define REPLAY_LAST_PATH "replay_last.tvsr"
+
+typedef enum {
+    PB_SPEED_1X = 0,
+    PB_SPEED_8X,
+    PB_SPEED_INSTANT
+} PlaybackSpeed;
+
+static BattleReplay  g_replay;                 // 通常対戦中は記録先、再生中は再生元
+static bool          g_replay_saved = false;
+static bool          g_playback = false;
+static bool          g_playback_pending = false; // 次の enter で再生モードに入る
+static int           g_pb_turn = 0;            // 次に実行するターン（0..turn_count）
+static PlaybackSpeed g_pb_speed = PB_SPEED_1X;
+static bool          g_pb_skip_cutin = false;
+static bool          g_pb_paused = false;
+
+static void replay_save_last(void)
 {
-    for (int s = 0; s < 2; s++) {
-        UnitCmd *uc = &cmd->cmd[s];
-        if (uc->has_move) {
-            uc->move_to.x = 20 - uc->move_to.x;
-        }
-        uc->center.x = 20 - uc->center.x;
+    if (g_playback || g_replay_saved) return;
+    if (g_replay.turn_count <= 0) return;
+
+    g_replay_saved = true;
+    if (battle_replay_save(&g_replay, REPLAY_LAST_PATH)) {
+        printf("[BATTLE] replay saved: %s (%d turns)\n", REPLAY_LAST_PATH, g_replay.turn_count);
+    } else {
+        printf("[BATTLE] replay save FAILED: %s\n", REPLAY_LAST_PATH);
     }
 }
 
@@ -151,22 +189,7 @@ static bool g_p2_locked = false;
 #define GRID_W 21
 #define GRID_H 21
 
-// ===============================
-//  主人公固定ステ（1P/2P共通）
-// ===============================
-#define HERO_HP_MAX   150
-#define HERO_ATK      10
-#define HERO_SPD      10
-#define HERO_ST_MAX   100
-
-// 主人公固定移動距離（1P/2P共通）
-#define HERO_MOVE_RANGE 4
-
-// 初期配置（仕様固定）
-#define INIT_P1_X 0
-#define INIT_P2_X 20
-#define INIT_HERO_Y 10
-#define INIT_GIRL_Y 12
+// 主人公固定ステ/初期配置は battle_replay.h（BATTLE_HERO_* / BATTLE_INIT_*）
 
 
 // ===============================
@@ -232,6 +255,28 @@ static UnitPlan g_plan_p1[2];
 static bool g_preview_active[2] = {false, false};
 static Pos  g_preview_pos[2];
 
+// ===============================
+//  作戦プレビュー（入力中の作戦で1ターン進めた結果を予測表示）
+//   - 作戦（カーソル位置込み）が変わったときだけ battle_core_preview を呼ぶ
+//   - 相手の手：オフラインはダミーP2と同じ手、オンラインは greedy AI の手を想定（ターンごとに1回）
+// ===============================
+static BattlePreview g_pv;
+static bool    g_pv_valid = false;
+static TurnCmd g_pv_cmd;            // g_pv を出した作戦
+static TurnCmd g_pv_enemy;          // 想定した相手の手
+static int     g_pv_enemy_turn = -1;
+
+// ===============================
+//  脅威マップ（次ターンに 1P 側が各マスで受けうる最大ダメージ）
+//   - 毎フレーム sync（変わったユニットだけ差分更新）
+//   - 移動先選択中は常に、H で常時表示を切替
+// ===============================
+static BattleThreatMap g_threat;
+static bool g_threat_always = false;
+
+// 開発ビルド：技/キャラ定義 .bin の書き換え監視（この scene にいる間だけ）
+static BattleDefsWatch g_defs_watch;
+
 // ===============================
 //  Undo（ターン内1手戻し）
 // ===============================
@@ -331,7 +376,7 @@ typedef enum {
 
 static bool g_exec_active = false;
 static ExecStage g_exec_stage = EXE_NONE;
-static int g_exec_order[4];
+static int g_exec_order[BATTLE_UNIT_MAX];
 static int g_exec_n = 0;          // aliveのみの実行数
 static int g_exec_i = 0;
 
@@ -358,7 +403,6 @@ static float g_act_pause_left = 0.0f;
 // ===============================
 static float g_disp_hp[4];
 static float g_disp_st[4];
-static int   g_st_max[4];
 
 // 追従速度（大きいほど速く追従）
 static float g_bar_lerp_hp = 10.0f;
@@ -389,52 +433,14 @@ static void bars_update(float dt)
     }
 }
 
-// ===============================
-//  JSON
-// ===============================
-static int read_int_or(const char *key, int fallback)
-{
-    int v = fallback;
-    json_read_int("build.json", key, &v);
-    return v;
-}
-
 // ★このシーン内で「どの陣営がタッグ習得してるか」を保持（char_defs用）
 static bool g_p1_tag_learned = false;
 static bool g_p2_tag_learned = false;
 
-static void read_girl_info(char *out_id, size_t out_sz, bool *out_tag_learned)
-{
-    if (!out_id || out_sz == 0 || !out_tag_learned) return;
-
-    char tmp[64] = "himari";
-    (void)json_read_string("build.json", "girl_id", tmp, (int)sizeof(tmp));
-
-    if (out_sz == 1) { out_id[0] = '\0'; }
-    else {
-        snprintf(out_id, out_sz, "%.*s", (int)out_sz - 1, tmp);
-    }
-
-    int tag = 0;
-    (void)json_read_int("build.json", "tag_learned", &tag);
-    *out_tag_learned = (tag != 0);
-}
-
-
-
-// 相棒の移動距離
-static int get_partner_move_range(void)
-{
-    int mv = read_int_or("move_range_base", 3);
-    if (mv < 0) mv = 0;
-    if (mv > 20) mv = 20;
-    return mv;
-}
-
+// 移動距離（開始時に battle_replay_setup_core が core 側へ設定済み）
 static int get_move_range_for_unit(const Unit *u)
 {
-    if (u->slot == SLOT_HERO) return HERO_MOVE_RANGE;
-    return get_partner_move_range();
+    return u->move;
 }
 
 // ★ユニットに対して「タッグ習得済み扱いか」を返す
@@ -452,7 +458,7 @@ static const char* resolve_skill_id_for_unit(const Unit *u, int skill_index)
     if (!u) return NULL;
     if (skill_index < 0) return NULL;
 
-    const CharDef *cd = char_def_get(u->char_id);
+    const CharDef *cd = char_def_get_or_fallback(u->char_id);
     if (!cd) return NULL;
 
     bool tag = is_tag_learned_for_unit(u);
@@ -471,7 +477,7 @@ static const SkillDef* resolve_skill_def_for_unit(const Unit *u, int skill_index
 static int get_skill_count_for_unit(const Unit *u)
 {
     if (!u) return 0;
-    const CharDef *cd = char_def_get(u->char_id);
+    const CharDef *cd = char_def_get_or_fallback(u->char_id);
     if (!cd) {
         // 定義が無い場合は安全に0扱い（UI上は最低1にクランプする箇所あり）
         return 0;
@@ -504,7 +510,7 @@ static int calc_unit_max_st(const Unit *u)
     int ui = calc_unit_ui(u);
     if (ui < 0) return 1;
 
-    int max_st = g_st_max[ui];
+    int max_st = g_core.st_max[ui];
     if (max_st < 1) max_st = 1;
     return max_st;
 }
@@ -512,11 +518,10 @@ static int calc_unit_max_st(const Unit *u)
 // ===============================
 //  位置/距離
 // ===============================
+// ステージの距離表を1回引くだけ（壁・悪路込み。ステージなしならマンハッタン距離）
 static bool is_move_in_range(const Pos from, const Pos to, int mv)
 {
-    int dx = abs((int)to.x - (int)from.x);
-    int dy = abs((int)to.y - (int)from.y);
-    return (dx + dy) <= mv;
+    return battle_stage_can_move(g_core.stage, from, to, mv);
 }
 
 static void clamp_move_cursor(Pos *p)
@@ -557,92 +562,67 @@ static Pos get_p1_unit_draw_pos(const Unit *u)
     return u->pos;
 }
 
+// 描画座標を core の実座標に合わせる（開始時/シーク時）
+static void anim_sync_to_core(void)
+{
+    for (int i = 0; i < 4; i++) {
+        g_pre_step_pos[i] = g_core.units[i].pos;
+
+        g_anim_pos_f[i].x = (float)g_core.units[i].pos.x;
+        g_anim_pos_f[i].y = (float)g_core.units[i].pos.y;
+
+        g_pre_step_pos_f[i] = g_anim_pos_f[i];
+    }
+}
+
 // ===============================
 //  Core init
 // ===============================
 static void init_battle_core(void)
 {
-    if (!g_font) g_font = ui_load_font("assets/font/main.otf", 28);
+    if (!g_font) g_font = res_font_acquire(BATTLE_FONT, 28);
 
-    g_online_mode = net_is_online();
+    g_online_mode = !g_playback && net_is_online();
     g_sent_turn_cmd = false;
 
-    Stats p1h, p1g, p2h, p2g;
+    battle_core_free(&g_core); // 前回対戦で伸びたイベント領域
 
-    p1h.hp  = HERO_HP_MAX;
-    p1h.atk = HERO_ATK;
-    p1h.spd = HERO_SPD;
-    p1h.st  = HERO_ST_MAX;
-
-    {
-        int hp_base  = read_int_or("hp_base",  100);
-        int atk_base = read_int_or("atk_base", 10);
-        int sp_base  = read_int_or("sp_base",  10);
-        int st_base  = read_int_or("st_base",  30);
-
-        int hp_add  = read_int_or("hp_add",  0);
-        int atk_add = read_int_or("atk_add", 0);
-        int sp_add  = read_int_or("sp_add",  0);
-        int st_add  = read_int_or("st_add",  0);
-
-        p1g.hp  = hp_base  + hp_add;
-        p1g.atk = atk_base + atk_add;
-        p1g.spd = sp_base  + sp_add;
-        p1g.st  = st_base  + st_add;
-    }
-
-    char p1_girl_id[32];
-    bool p1_tag = false;
-    read_girl_info(p1_girl_id, sizeof(p1_girl_id), &p1_tag);
-
-    // P2ステータス: オンラインなら相手情報、オフラインなら自分のミラー
-    char p2_girl_id_buf[32];
-    const char *p2_girl_id;
-    bool p2_tag = false;
-
-    if (g_online_mode) {
-        p2h = p1h; // 主人公ステは共通固定
-        p2g.hp  = g_opponent_info.hp_base  + g_opponent_info.hp_add;
-        p2g.atk = g_opponent_info.atk_base + g_opponent_info.atk_add;
-        p2g.spd = g_opponent_info.sp_base  + g_opponent_info.sp_add;
-        p2g.st  = g_opponent_info.st_base  + g_opponent_info.st_add;
-        snprintf(p2_girl_id_buf, sizeof(p2_girl_id_buf), "%s", g_opponent_info.girl_id);
-        p2_girl_id = p2_girl_id_buf;
-        p2_tag = (g_opponent_info.tag_learned != 0);
+    if (g_playback) {
+        // 再生：記録された開始条件から
+        g_pb_turn = 0;
+        if (!battle_replay_seek(&g_replay, 0, &g_core)) printf("[BATTLE] replay seek FAILED\n");
     } else {
-        p2h = p1h;
-        p2g = p1g;
-        snprintf(p2_girl_id_buf, sizeof(p2_girl_id_buf), "kiritan");
-        p2_girl_id = p2_girl_id_buf;
-        p2_tag = false;
-    }
-
-    g_p1_tag_learned = p1_tag;
-    g_p2_tag_learned = p2_tag;
+        // P2: オンラインなら相手情報、オフラインなら自分のミラー（相棒は kiritan・タッグなし）
+        NetGameInfo p1_info, p2_info;
+        read_my_game_info(&p1_info);
+        if (g_online_mode) {
+            p2_info = g_opponent_info;
+        } else {
+            p2_info = p1_info;
+            snprintf(p2_info.girl_id, sizeof(p2_info.girl_id), "kiritan");
+            p2_info.tag_learned = 0;
+        }
 
-    g_st_max[0] = p1h.st;
-    g_st_max[1] = p1g.st;
-    g_st_max[2] = p2h.st;
-    g_st_max[3] = p2g.st;
+        bool ok = battle_replay_setup_core(&g_core, &p1_info, &p2_info);
+        if (!ok) printf("[BATTLE] battle_core_init FAILED\n");
 
-    bool ok = battle_core_init(&g_core,
-                              p1_girl_id, p1_tag, p1h, p1g,
-                              p2_girl_id, p2_tag, p2h, p2g);
-    if (!ok) printf("[BATTLE] battle_core_init FAILED\n");
+        // 乱数キー：両者の情報から決める（オンラインでも相手と同じ値になる）
+        uint32_t seed = battle_replay_match_seed(&p1_info, &p2_info);
+        g_core.rng_seed = seed;
 
-    g_core.units[0].pos = (Pos){ INIT_P1_X, INIT_HERO_Y };
-    g_core.units[1].pos = (Pos){ INIT_P1_X, INIT_GIRL_Y };
-    g_core.units[2].pos = (Pos){ INIT_P2_X, INIT_HERO_Y };
-    g_core.units[3].pos = (Pos){ INIT_P2_X, INIT_GIRL_Y };
+        // ステージ：オンラインはサーバが決めたもの（照合済み）、オフラインは seed から
+        g_core.stage = g_online_mode ? g_match_stage : battle_stage_for_seed(seed);
 
-    for (int i = 0; i < 4; i++) {
-        g_pre_step_pos[i] = g_core.units[i].pos;
+        battle_replay_free(&g_replay);
+        battle_replay_init(&g_replay, &p1_info, &p2_info, seed);
+        battle_replay_set_stage(&g_replay, g_core.stage);
+        g_replay_saved = false;
+    }
 
-        g_anim_pos_f[i].x = (float)g_core.units[i].pos.x;
-        g_anim_pos_f[i].y = (float)g_core.units[i].pos.y;
+    g_p1_tag_learned = g_core.p1_tag;
+    g_p2_tag_learned = g_core.p2_tag;
 
-        g_pre_step_pos_f[i] = g_anim_pos_f[i];
-    }
+    anim_sync_to_core();
 
     memset(&g_p1_cmd, 0, sizeof(g_p1_cmd));
     memset(&g_p2_cmd, 0, sizeof(g_p2_cmd));
@@ -657,6 +637,11 @@ static void init_battle_core(void)
 
     reset_p1_plan();
 
+    g_pv_valid = false;
+    g_pv_enemy_turn = -1;
+
+    battle_threat_build(&g_threat, &g_core, true);
+
     {
         int idx = unit_index(TEAM_P1, SLOT_HERO);
         g_move_to = g_core.units[idx].pos;
@@ -667,6 +652,15 @@ static void init_battle_core(void)
     g_inited = true;
 }
 
+// ===============================
+//  オフラインのダミーP2（主人公はその場で技0、相棒は待機）
+// ===============================
+static void build_offline_p2_cmd(TurnCmd *out_cmd)
+{
+    out_cmd->cmd[SLOT_HERO] = (UnitCmd){ .has_move=true,  .move_to=g_core.units[2].pos, .skill_index=0,  .target=0, .center=g_core.units[2].pos };
+    out_cmd->cmd[SLOT_GIRL] = (UnitCmd){ .has_move=true,  .move_to=g_core.units[3].pos, .skill_index=-1, .target=-1, .center=g_core.units[3].pos };
+}
+
 // ===============================
 //  P1プラン → TurnCmd
 // ===============================
@@ -689,23 +683,63 @@ static void build_p1_cmd_from_plan(TurnCmd *out_cmd)
 }
 
 // ===============================
-//  ST regen（char_defs 準拠）
-//  ターン終了後、各ユニットの st_regen_per_turn だけ回復（上限はmax_st）
+//  作戦プレビュー
 // ===============================
-static void apply_st_regen_after_step(void)
+// 決定済みのプラン + 入力中ユニットのカーソル位置から「今決定したら」の TurnCmd を作る
+static void build_p1_tentative_cmd(TurnCmd *out_cmd)
 {
-    for (int i = 0; i < 4; i++) {
-        Unit *u = &g_core.units[i];
-        if (!u->alive) continue;
+    build_p1_cmd_from_plan(out_cmd);
+    if (g_ui == UI_TURN_CONFIRM || g_ui == UI_CMD_SELECT) return;
+
+    int idx = unit_index(TEAM_P1, g_act_slot);
+    const Unit *u = &g_core.units[idx];
+    UnitCmd *uc = &out_cmd->cmd[g_act_slot];
+
+    // 移動：範囲外のカーソルはその場扱い
+    Pos to = is_move_in_range(u->pos, g_move_to, get_move_range_for_unit(u)) ? g_move_to : u->pos;
+    uc->has_move = true;
+    uc->move_to = to;
+    uc->center = to;
+    uc->skill_index = -1;
+    uc->target = -1;
+    if (g_ui == UI_MOVE_SELECT) return;
+
+    // 技：UI と同じ既定値（単体=敵主人公、範囲=敵主人公の位置、回復=自分）
+    uc->skill_index = (int8_t)g_skill_index[g_act_slot];
+    const SkillDef *sk = resolve_skill_def_for_unit(u, g_skill_index[g_act_slot]);
+    if (!sk || sk->type == SKTYPE_ATTACK) {
+        if (sk && sk->target == SKT_AOE) {
+            uc->center = (g_ui == UI_AOE_CENTER_SELECT) ? g_aoe_center_cursor
+                                                        : g_core.units[unit_index(TEAM_P2, SLOT_HERO)].pos;
+        } else {
+            uc->target = (int8_t)((g_ui == UI_TARGET_SELECT) ? g_target : 0);
+        }
+    } else if (sk->type == SKTYPE_HEAL) {
+        uc->target = (int8_t)((g_act_slot == SLOT_GIRL) ? 1 : 0);
+    }
+}
 
-        const CharDef *cd = char_def_get(u->char_id);
-        if (!cd) continue;
+static void preview_update(void)
+{
+    if (g_p1_locked || g_exec_active || g_playback || g_core.phase != BPHASE_INPUT) {
+        g_pv_valid = false;
+        return;
+    }
 
-        int max_st = calc_unit_max_st(u);
-        u->stats.st += cd->st_regen_per_turn;
-        if (u->stats.st > max_st) u->stats.st = max_st;
-        if (u->stats.st < 0) u->stats.st = 0;
+    bool enemy_changed = false;
+    if (g_pv_enemy_turn != g_core.turn) {
+        if (g_online_mode) battle_ai_greedy_cmd(&g_core, TEAM_P2, &g_pv_enemy);
+        else               build_offline_p2_cmd(&g_pv_enemy);
+        g_pv_enemy_turn = g_core.turn;
+        enemy_changed = true;
     }
+
+    TurnCmd cmd;
+    build_p1_tentative_cmd(&cmd);
+    if (g_pv_valid && !enemy_changed && memcmp(&cmd, &g_pv_cmd, sizeof(cmd)) == 0) return;
+
+    g_pv_cmd = cmd;
+    g_pv_valid = battle_core_preview(&g_core, TEAM_P1, &cmd, &g_pv_enemy, &g_pv);
 }
 
 // ===============================
@@ -726,7 +760,7 @@ static void start_exec_phase_from_cmds(void)
         g_cmd_has_move[i] = false;
         g_cmd_move_to[i]  = g_pre_step_pos[i];
 
-        g_core.units[i].pos = g_pre_step_pos[i];
+        battle_core_set_unit_pos(&g_core, i, g_pre_step_pos[i]);
     }
 
     g_cmd_has_move[0] = g_p1_cmd.cmd[SLOT_HERO].has_move;
@@ -762,10 +796,18 @@ static void try_advance_turn_local(void)
         g_pre_step_pos_f[i].y = (float)g_core.units[i].pos.y;
     }
 
+    // 記録は submit 前の局面と、このターンの命令
+    if (!g_playback && g_core.phase == BPHASE_INPUT) {
+        if (!battle_replay_record_turn(&g_replay, &g_core, &g_p1_cmd, &g_p2_cmd)) {
+            printf("[BATTLE] replay: turn %d not recorded (invalid cmd)\n", g_core.turn);
+        }
+    }
+
     battle_core_submit_cmd(&g_core, TEAM_P1, &g_p1_cmd);
     battle_core_submit_cmd(&g_core, TEAM_P2, &g_p2_cmd);
 
     if (!battle_core_begin_exec(&g_core)) return;
+    g_ev_cursor = battle_core_event_cursor_now(&g_core);
 
     start_exec_phase_from_cmds();
 }
@@ -778,10 +820,9 @@ static void exec_update(float dt)
     if (!g_exec_active) return;
 
     if (g_exec_i >= g_exec_n) {
+        // ST回復（char_defs の st_regen_per_turn）も core 側で行う
         battle_core_end_exec(&g_core);
 
-        // ★regenを char_defs に統一
-        apply_st_regen_after_step();
         memset(&g_p1_cmd, 0, sizeof(g_p1_cmd));
         memset(&g_p2_cmd, 0, sizeof(g_p2_cmd));
         g_p1_locked = false;
@@ -838,7 +879,7 @@ static void exec_update(float dt)
 
         if (fabsf(dst.x - cur.x) < 0.001f && fabsf(dst.y - cur.y) < 0.001f) {
             g_anim_pos_f[ui] = dst;
-            u->pos = g_cmd_move_to[ui];
+            battle_core_exec_move_for_unit(&g_core, ui);
 
             g_exec_stage = EXE_ACT;
             g_act_pause_left = 0.0f;
@@ -849,21 +890,21 @@ static void exec_update(float dt)
     if (g_exec_stage == EXE_ACT) {
         if (g_act_pause_left <= 0.0f) {
             // ★方針1：アクション直後に演出を流す
-            // 残りカス誤再生を防ぐ（射程外・不発では last_executed を立てない想定）
-            g_core.last_executed_skill_id = NULL;
-            g_core.last_executed_actor_ui = -1;
-            g_core.last_executed_target_ui = -1;
-
             battle_core_exec_act_for_unit(&g_core, ui);
 
-            // このアクションで成立した技があれば、ここで再生（対象キャラ差分）
-            if (g_core.last_executed_skill_id && g_cutin.renderer) {
+            // このアクションで成立した技（カウンター含む）を順に再生（対象キャラ差分）
+            // 射程外・不発では ANIM が出ないので、残りカス誤再生は起きない
+            // 再生モードでは 1x かつ省略OFF のときだけ流す
+            bool play_cutin = !g_playback || (g_pb_speed == PB_SPEED_1X && !g_pb_skip_cutin);
+            const BattleEvent *ev;
+            while ((ev = battle_core_next_event(&g_core, &g_ev_cursor)) != NULL) {
+                if (!play_cutin) continue;
+                if (ev->type != BEV_ANIM_SKILL || !ev->skill_id || !g_cutin.renderer) continue;
                 char mp4buf[256];
-                const char *mp4 = choose_cutin_mp4(g_core.last_executed_skill_id,
-                                                g_core.last_executed_target_ui,
-                                                mp4buf, sizeof(mp4buf));
+                const char *mp4 = choose_cutin_mp4(ev->skill_id, ev->target_ui,
+                                                   mp4buf, sizeof(mp4buf));
                 if (mp4 && mp4[0]) {
-                    bool flip_h = (g_core.last_executed_actor_ui >= 2);
+                    bool flip_h = (ev->actor_ui >= 2);
                     cutin_play_fullscreen_mpv_ex(&g_cutin, mp4, 200, true, flip_h);
                 }
             }
@@ -884,6 +925,88 @@ static void exec_update(float dt)
     }
 }
 
+// ===============================
+//  リプレイ再生
+// ===============================
+static void playback_seek(int turn)
+{
+    if (turn < 0) turn = 0;
+    if (turn > g_replay.turn_count) turn = g_replay.turn_count;
+
+    battle_core_free(&g_core);
+    battle_replay_seek(&g_replay, turn, &g_core);
+    g_pb_turn = turn;
+
+    // 実行中の演出は打ち切って、表示を局面に合わせる
+    g_exec_active = false;
+    g_exec_stage  = EXE_NONE;
+    g_exec_i      = 0;
+    g_exec_n      = 0;
+    g_act_pause_left = 0.0f;
+    g_p1_locked = false;
+    g_p2_locked = false;
+
+    anim_sync_to_core();
+    bars_sync_to_real();
+}
+
+// 終了画面から直前の対戦を再生（記録は保存済みのものをそのまま使う）
+static void playback_start_from_record(void)
+{
+    replay_save_last();
+    g_playback = true;
+    g_pb_paused = false;
+    playback_seek(0);
+}
+
+static void playback_update(float dt)
+{
+    // --- 操作 ---
+    if (input_is_pressed(SDL_SCANCODE_SPACE)) g_pb_paused = !g_pb_paused;
+    if (input_is_pressed(SDL_SCANCODE_1)) g_pb_speed = PB_SPEED_1X;
+    if (input_is_pressed(SDL_SCANCODE_2)) g_pb_speed = PB_SPEED_8X;
+    if (input_is_pressed(SDL_SCANCODE_3)) g_pb_speed = PB_SPEED_INSTANT;
+    if (input_is_pressed(SDL_SCANCODE_C)) g_pb_skip_cutin = !g_pb_skip_cutin;
+
+    // シーク：実行中のターンは「そのターンの頭」を基準にする
+    int base = g_exec_active ? g_pb_turn - 1 : g_pb_turn;
+    if (input_is_pressed(SDL_SCANCODE_LEFT))     { playback_seek(base - 1);  return; }
+    if (input_is_pressed(SDL_SCANCODE_RIGHT))    { playback_seek(base + 1);  return; }
+    if (input_is_pressed(SDL_SCANCODE_PAGEUP))   { playback_seek(base - 10); return; }
+    if (input_is_pressed(SDL_SCANCODE_PAGEDOWN)) { playback_seek(base + 10); return; }
+    if (input_is_pressed(SDL_SCANCODE_HOME))     { playback_seek(0);         return; }
+    if (input_is_pressed(SDL_SCANCODE_END))      { playback_seek(g_replay.turn_count); return; }
+
+    if (g_core.phase == BPHASE_END) {
+        if (input_is_pressed(SDL_SCANCODE_RETURN)) change_scene(SCENE_HOME);
+        return;
+    }
+
+    // --- 進行 ---
+    if (g_exec_active) {
+        exec_update(g_pb_speed == PB_SPEED_8X ? dt * 8.0f : dt);
+        return;
+    }
+    if (g_pb_paused || g_pb_turn >= g_replay.turn_count) return;
+
+    const BattleReplayTurn *rt = &g_replay.turns[g_pb_turn];
+    g_pb_turn++;
+
+    if (g_pb_speed == PB_SPEED_INSTANT) {
+        // 即時：演出なしで1フレーム1ターン
+        battle_core_run_turn(&g_core, &rt->cmd[TEAM_P1], &rt->cmd[TEAM_P2]);
+        anim_sync_to_core();
+        bars_sync_to_real();
+        return;
+    }
+
+    g_p1_cmd = rt->cmd[TEAM_P1];
+    g_p2_cmd = rt->cmd[TEAM_P2];
+    g_p1_locked = true;
+    g_p2_locked = true;
+    try_advance_turn_local();
+}
+
 // ===================================
 //  描画補助
 // ===================================
@@ -923,7 +1046,7 @@ static void draw_triangle_right(SDL_Renderer *r, int cx, int cy, int size,
     for (int dy = -h; dy <= h; dy++) {
         int x1 = cx - h;
         int x2 = cx + h - abs(dy);
-        SDL_RenderDrawLine(r, x1, cy + dy, x2, cy + dy);
+        ui_batch_draw_line(r, x1, cy + dy, x2, cy + dy);
     }
 
     SDL_SetRenderDrawBlendMode(r, prev);
@@ -944,10 +1067,10 @@ static void draw_unit_ghost(SDL_Renderer *r, int origin_x, int origin_y, int cel
 
     SDL_Rect rect = { px + 2, py + 2, cell - 4, cell - 4 };
     set_color(r, R, G, B, A);
-    SDL_RenderFillRect(r, &rect);
+    ui_batch_fill_rect(r, &rect);
 
     set_color(r, 255, 255, 255, A);
-    SDL_RenderDrawRect(r, &rect);
+    ui_batch_draw_rect(r, &rect);
 
     SDL_SetRenderDrawBlendMode(r, prev);
 }
@@ -973,7 +1096,7 @@ static void draw_move_highlight(SDL_Renderer *r,
 
             SDL_Rect rc = { px + 1, py + 1, cell - 2, cell - 2 };
             set_color(r, 240, 240, 240, 35);
-            SDL_RenderFillRect(r, &rc);
+            ui_batch_fill_rect(r, &rc);
         }
     }
 
@@ -984,7 +1107,7 @@ static void draw_move_highlight(SDL_Renderer *r,
             int py = origin_y + y * cell;
             SDL_Rect rc = { px + 1, py + 1, cell - 2, cell - 2 };
             set_color(r, 255, 255, 255, 60);
-            SDL_RenderFillRect(r, &rc);
+            ui_batch_fill_rect(r, &rc);
         }
     }
 
@@ -995,6 +1118,33 @@ static void draw_move_highlight(SDL_Renderer *r,
 // ===============================
 //  攻撃射程 / 範囲ハイライト（半透明赤）
 // ===============================
+// 脅威マップ（赤の濃さ = 入力中ユニットのHPに対する被弾見込みの割合）
+static void draw_threat_overlay(SDL_Renderer *r, int origin_x, int origin_y, int cell, const BattleCore *b)
+{
+    const Unit *u = &b->units[unit_index(TEAM_P1, g_act_slot)];
+    int hp = (u->alive && u->stats.hp > 0) ? u->stats.hp : 1;
+
+    SDL_BlendMode prev;
+    SDL_GetRenderDrawBlendMode(r, &prev);
+    SDL_SetRenderDrawBlendMode(r, SDL_BLENDMODE_BLEND);
+
+    for (int y = 0; y < GRID_H; y++) {
+        for (int x = 0; x < GRID_W; x++) {
+            int dmg = battle_threat_at(&g_threat, TEAM_P1, (Pos){ (int8_t)x, (int8_t)y });
+            if (dmg <= 0) continue;
+
+            int a = 20 + dmg * 120 / hp;
+            if (a > 140) a = 140;
+
+            SDL_Rect rc = { origin_x + x * cell + 1, origin_y + y * cell + 1, cell - 2, cell - 2 };
+            set_color(r, 255, 60, 30, (Uint8)a);
+            ui_batch_fill_rect(r, &rc);
+        }
+    }
+
+    SDL_SetRenderDrawBlendMode(r, prev);
+}
+
 static bool is_in_manhattan_range(Pos a, Pos b, int range)
 {
     int dx = abs((int)a.x - (int)b.x);
@@ -1002,9 +1152,10 @@ static bool is_in_manhattan_range(Pos a, Pos b, int range)
     return (dx + dy) <= range;
 }
 
+// need_los：単体技は見通せるマスだけ（壁の陰は塗らない）
 static void draw_range_highlight_red(SDL_Renderer *r,
                                      int origin_x, int origin_y, int cell,
-                                     const Pos from, int range,
+                                     const Pos from, int range, bool need_los,
                                      Uint8 R, Uint8 G, Uint8 B, Uint8 A)
 {
     if (range < 0) return; // 射程∞は表示しない（判定もスキップ扱い）
@@ -1016,12 +1167,13 @@ static void draw_range_highlight_red(SDL_Renderer *r,
         for (int x = 0; x < GRID_W; x++) {
             Pos p = {(int8_t)x, (int8_t)y};
             if (!is_in_manhattan_range(from, p, range)) continue;
+            if (need_los && !battle_stage_los(g_core.stage, from, p)) continue;
 
             int px = origin_x + x * cell;
             int py = origin_y + y * cell;
             SDL_Rect rc = { px + 1, py + 1, cell - 2, cell - 2 };
             set_color(r, R, G, B, A);
-            SDL_RenderFillRect(r, &rc);
+            ui_batch_fill_rect(r, &rc);
         }
     }
 
@@ -1047,7 +1199,7 @@ static void draw_aoe_area_red(SDL_Renderer *r,
             int py = origin_y + y * cell;
             SDL_Rect rc = { px + 1, py + 1, cell - 2, cell - 2 };
             set_color(r, R, G, B, A);
-            SDL_RenderFillRect(r, &rc);
+            ui_batch_fill_rect(r, &rc);
         }
     }
 
@@ -1070,9 +1222,9 @@ static void draw_center_box(SDL_Renderer* r, int origin_x, int origin_y, int cel
     SDL_SetRenderDrawBlendMode(r, SDL_BLENDMODE_BLEND);
 
     SDL_SetRenderDrawColor(r, R, G, B, A);
-    SDL_RenderDrawRect(r, &rc);
+    ui_batch_draw_rect(r, &rc);
     rc.x++; rc.y++; rc.w -= 2; rc.h -= 2;
-    SDL_RenderDrawRect(r, &rc);
+    ui_batch_draw_rect(r, &rc);
 
     SDL_SetRenderDrawBlendMode(r, prev);
 }
@@ -1095,24 +1247,102 @@ static void draw_target_box(SDL_Renderer* r, int origin_x, int origin_y, int cel
     SDL_SetRenderDrawColor(r, 255, 230, 80, 220);
 
     // 太枠っぽく3回描く（SDL2標準だけでできる）
-    SDL_RenderDrawRect(r, &rc);
+    ui_batch_draw_rect(r, &rc);
     rc.x++; rc.y++; rc.w -= 2; rc.h -= 2;
-    SDL_RenderDrawRect(r, &rc);
+    ui_batch_draw_rect(r, &rc);
     rc.x++; rc.y++; rc.w -= 2; rc.h -= 2;
-    SDL_RenderDrawRect(r, &rc);
+    ui_batch_draw_rect(r, &rc);
 
     SDL_SetRenderDrawBlendMode(r, prev);
 }
 
 
+// ===============================
+//  地形（壁=灰のブロック / 悪路=青み）
+// ===============================
+static void draw_stage_tiles(SDL_Renderer *r, int origin_x, int origin_y, int cell, const BattleStage *st)
+{
+    if (!st || (st->walls == 0 && st->slows == 0)) return;
+
+    for (int y = 0; y < GRID_H; y++) {
+        for (int x = 0; x < GRID_W; x++) {
+            BattleTile t = battle_stage_tile(st, (Pos){ (int8_t)x, (int8_t)y });
+            if (t == BTILE_FLOOR) continue;
+
+            SDL_Rect rc = { origin_x + x * cell, origin_y + y * cell, cell, cell };
+            if (t == BTILE_WALL) set_color(r, 70, 70, 84, 255);
+            else                 set_color(r, 26, 42, 64, 255);
+            ui_batch_fill_rect(r, &rc);
+        }
+    }
+}
+
+// ===============================
+//  静的レイヤ（盤の下地＋地形 / 格子線）
+//   毎フレーム同じなので描画先テクスチャへ1回描いて貼る。ステージ・位置・マスの大きさが変わったら描き直し
+//   格子線は範囲表示などの半透明の塗りの上に重ねるので、下地とは別の透明レイヤにする
+// ===============================
+#define GRID_PANEL_MARGIN 10
+
+static UiLayer g_layer_board;   // 下地パネル + 地形
+static UiLayer g_layer_lines;   // 格子線（透明）
+static bool g_layers_inited = false;
+
+typedef struct {
+    int cell;
+    const BattleStage *stage;
+} GridLayerPaint;
+
+static void paint_board_layer(SDL_Renderer *r, void *user)
+{
+    const GridLayerPaint *p = (const GridLayerPaint*)user;
+    set_color(r, 18, 18, 28, 255);
+    SDL_Rect panel = { 0, 0, GRID_W * p->cell + GRID_PANEL_MARGIN * 2, GRID_H * p->cell + GRID_PANEL_MARGIN * 2 };
+    ui_batch_fill_rect(r, &panel);
+
+    draw_stage_tiles(r, GRID_PANEL_MARGIN, GRID_PANEL_MARGIN, p->cell, p->stage);
+}
+
+static void paint_lines_layer(SDL_Renderer *r, void *user)
+{
+    const GridLayerPaint *p = (const GridLayerPaint*)user;
+    const int ox = GRID_PANEL_MARGIN, oy = GRID_PANEL_MARGIN, cell = p->cell;
+    set_color(r, 60, 60, 80, 255);
+    for (int x = 0; x <= GRID_W; x++) {
+        int px = ox + x * cell;
+        ui_batch_draw_line(r, px, oy, px, oy + GRID_H * cell);
+    }
+    for (int y = 0; y <= GRID_H; y++) {
+        int py = oy + y * cell;
+        ui_batch_draw_line(r, ox, py, ox + GRID_W * cell, py);
+    }
+}
+
+static void draw_grid_layer(SDL_Renderer *r, UiLayer *layer, UiLayerPaintFn paint,
+                            int origin_x, int origin_y, int cell, const BattleStage *stage)
+{
+    if (!g_layers_inited) {
+        ui_layer_init(&g_layer_board, false);
+        ui_layer_init(&g_layer_lines, true);
+        g_layers_inited = true;
+    }
+    GridLayerPaint p = { cell, stage };
+    const Uint64 key = (Uint64)(uintptr_t)stage ^ ((Uint64)cell << 48) ^ ((Uint64)(Uint16)origin_x << 32) ^ ((Uint64)(Uint16)origin_y << 16);
+    ui_layer_draw(layer, r, origin_x - GRID_PANEL_MARGIN, origin_y - GRID_PANEL_MARGIN,
+                  GRID_W * cell + GRID_PANEL_MARGIN * 2, GRID_H * cell + GRID_PANEL_MARGIN * 2,
+                  key, paint, &p);
+}
+
 // ===============================
 //  グリッド＋ユニット描画
 // ===============================
 static void draw_battle_grid(SDL_Renderer *r, int origin_x, int origin_y, int cell, const BattleCore *b)
 {
-    set_color(r, 18, 18, 28, 255);
-    SDL_Rect panel = { origin_x - 10, origin_y - 10, GRID_W * cell + 20, GRID_H * cell + 20 };
-    SDL_RenderFillRect(r, &panel);
+    draw_grid_layer(r, &g_layer_board, paint_board_layer, origin_x, origin_y, cell, b->stage);
+
+    if (!g_exec_active && !g_playback && (g_threat_always || (g_ui == UI_MOVE_SELECT && !g_p1_locked))) {
+        draw_threat_overlay(r, origin_x, origin_y, cell, b);
+    }
 
     if (g_ui == UI_MOVE_SELECT && !g_exec_active) {
         int idx = unit_index(TEAM_P1, g_act_slot);
@@ -1137,13 +1367,13 @@ static void draw_battle_grid(SDL_Renderer *r, int origin_x, int origin_y, int ce
         if (g_ui == UI_TARGET_SELECT) {
             // 単体攻撃：射程表示
             if (sk && sk->target == SKT_SINGLE && battle_skill_should_check_range(sk)) {
-                draw_range_highlight_red(r, origin_x, origin_y, cell, from, sk->range, 255, 40, 40, 70);
+                draw_range_highlight_red(r, origin_x, origin_y, cell, from, sk->range, true, 255, 40, 40, 70);
             }
         } else if (g_ui == UI_AOE_CENTER_SELECT) {
             // 範囲攻撃：中心までの射程 + 攻撃範囲
             if (sk && sk->target == SKT_AOE) {
                 if (battle_skill_should_check_range(sk)) {
-                    draw_range_highlight_red(r, origin_x, origin_y, cell, from, sk->range, 255, 40, 40, 55);
+                    draw_range_highlight_red(r, origin_x, origin_y, cell, from, sk->range, false, 255, 40, 40, 55);
                 }
                 draw_aoe_area_red(r, origin_x, origin_y, cell, g_aoe_center_cursor, sk->aoe_radius, 255, 40, 40, 90);
                 draw_center_box(r, origin_x, origin_y, cell, g_aoe_center_cursor, 255, 255, 255, 220);
@@ -1152,15 +1382,7 @@ static void draw_battle_grid(SDL_Renderer *r, int origin_x, int origin_y, int ce
     }
 
 
-    set_color(r, 60, 60, 80, 255);
-    for (int x = 0; x <= GRID_W; x++) {
-        int px = origin_x + x * cell;
-        SDL_RenderDrawLine(r, px, origin_y, px, origin_y + GRID_H * cell);
-    }
-    for (int y = 0; y <= GRID_H; y++) {
-        int py = origin_y + y * cell;
-        SDL_RenderDrawLine(r, origin_x, py, origin_x + GRID_W * cell, py);
-    }
+    draw_grid_layer(r, &g_layer_lines, paint_lines_layer, origin_x, origin_y, cell, b->stage);
 
     if (!g_exec_active && !g_p1_locked) {
         if (g_preview_active[SLOT_HERO]) {
@@ -1199,7 +1421,7 @@ static void draw_battle_grid(SDL_Renderer *r, int origin_x, int origin_y, int ce
 
         SDL_Rect rect = { px + 2, py + 2, cell - 4, cell - 4 };
         set_color(r, R, G, Bc, 255);
-        SDL_RenderFillRect(r, &rect);
+        ui_batch_fill_rect(r, &rect);
 
         bool highlight = false;
         if (!g_exec_active) {
@@ -1213,7 +1435,7 @@ static void draw_battle_grid(SDL_Renderer *r, int origin_x, int origin_y, int ce
 
         if (highlight) set_color(r, 255, 255, 255, 255);
         else set_color(r, 10, 10, 10, 255);
-        SDL_RenderDrawRect(r, &rect);
+        ui_batch_draw_rect(r, &rect);
     }
 
     if (g_ui == UI_MOVE_SELECT && !g_exec_active) {
@@ -1223,7 +1445,7 @@ static void draw_battle_grid(SDL_Renderer *r, int origin_x, int origin_y, int ce
         int py = origin_y + gy * cell;
         SDL_Rect cursor = { px + 1, py + 1, cell - 2, cell - 2 };
         set_color(r, 255, 255, 255, 255);
-        SDL_RenderDrawRect(r, &cursor);
+        ui_batch_draw_rect(r, &cursor);
     }
 
     // --- ターゲットをマップ上でハイライト ---
@@ -1246,9 +1468,9 @@ static void draw_bar(SDL_Renderer *r, int x, int y, int w, int h, int cur, int m
 {
     set_color(r, 40, 40, 55, 255);
     SDL_Rect frame = {x, y, w, h};
-    SDL_RenderFillRect(r, &frame);
+    ui_batch_fill_rect(r, &frame);
     set_color(r, 80, 80, 110, 255);
-    SDL_RenderDrawRect(r, &frame);
+    ui_batch_draw_rect(r, &frame);
 
     if (maxv < 1) maxv = 1;
     if (cur < 0) cur = 0;
@@ -1259,7 +1481,7 @@ static void draw_bar(SDL_Renderer *r, int x, int y, int w, int h, int cur, int m
 
     set_color(r, 90, 200, 120, 255);
     SDL_Rect fill = {x + 1, y + 1, (fill_w > 2 ? fill_w - 2 : 0), h - 2};
-    SDL_RenderFillRect(r, &fill);
+    ui_batch_fill_rect(r, &fill);
 }
 
 static void draw_stat_panel(SDL_Renderer *r, int x, int y, int w, int h,
@@ -1269,9 +1491,9 @@ static void draw_stat_panel(SDL_Renderer *r, int x, int y, int w, int h,
 {
     set_color(r, 20, 20, 30, 255);
     SDL_Rect panel = {x, y, w, h};
-    SDL_RenderFillRect(r, &panel);
+    ui_batch_fill_rect(r, &panel);
     set_color(r, 60, 60, 80, 255);
-    SDL_RenderDrawRect(r, &panel);
+    ui_batch_draw_rect(r, &panel);
 
     ui_text_draw(r, g_font, name, x + 10, y + 6);
 
@@ -1289,17 +1511,60 @@ static void draw_stat_panel(SDL_Renderer *r, int x, int y, int w, int h,
     ui_text_draw(r, g_font, buf, x + w - 120, y + 54);
 }
 
+static void draw_preview_line(SDL_Renderer *r, int x, int y, int ui)
+{
+    char buf[64];
+    int n = 0;
+    buf[0] = '\0';
+    if (g_pv.killed[ui])            n += snprintf(buf + n, sizeof(buf) - (size_t)n, "撃破 ");
+    else if (g_pv.hp_delta[ui])     n += snprintf(buf + n, sizeof(buf) - (size_t)n, "HP%+d ", g_pv.hp_delta[ui]);
+    if (g_pv.st_delta[ui])          n += snprintf(buf + n, sizeof(buf) - (size_t)n, "ST%+d ", g_pv.st_delta[ui]);
+    if (g_pv.countered_by[ui] >= 0) n += snprintf(buf + n, sizeof(buf) - (size_t)n, "反撃");
+    if (n == 0) return;
+
+    SDL_Color col = (SDL_Color){ 200, 200, 220, 255 };
+    if (g_pv.killed[ui] || g_pv.countered_by[ui] >= 0) col = (SDL_Color){ 255, 110, 110, 255 };
+    else if (g_pv.hp_delta[ui] < 0)                   col = (SDL_Color){ 255, 190, 120, 255 };
+    else if (g_pv.hp_delta[ui] > 0)                   col = (SDL_Color){ 140, 230, 160, 255 };
+    ui_text_draw_color(r, g_font, buf, x, y, col);
+}
+
 // ===============================
 //  Scene I/F
 // ===============================
+bool scene_battle_request_replay(const char *path)
+{
+    BattleReplay r;
+    if (!battle_replay_load(&r, path)) {
+        printf("[BATTLE] replay load FAILED: %s\n", path ? path : "(null)");
+        return false;
+    }
+    battle_replay_free(&g_replay);
+    g_replay = r;
+    g_playback_pending = true;
+    return true;
+}
+
 void scene_battle_enter(void)
 {
-    if (net_is_online()) {
+    g_playback = g_playback_pending;
+    g_playback_pending = false;
+    g_pb_paused = false;
+    battle_defs_watch_start(&g_defs_watch, battle_defs_loaded_path());
+
+    if (g_playback) {
+        // 再生はオフライン扱い（通信しない）
+        g_online_mode = false;
+        g_waiting_opponent_info = false;
+        init_battle_core();
+    } else if (net_is_online()) {
         // オンライン: GAME_INFO送信 → 相手の情報待ち
         g_online_mode = true;
         g_waiting_opponent_info = true;
+        g_have_opponent_info = false;
+        g_match_stage = NULL;
         g_inited = false;
-        if (!g_font) g_font = ui_load_font("assets/font/main.otf", 28);
+        if (!g_font) g_font = res_font_acquire(BATTLE_FONT, 28);
         send_my_game_info();
     } else {
         g_online_mode = false;
@@ -1308,8 +1573,22 @@ void scene_battle_enter(void)
     }
 }
 
+void scene_battle_prefetch(void)
+{
+    res_prefetch_font(BATTLE_FONT, 28);
+}
+
 void scene_battle_leave(void)
 {
+    replay_save_last();
+    battle_core_free(&g_core);
+    battle_defs_watch_stop(&g_defs_watch);
+    g_playback = false;
+    ui_layer_release(&g_layer_board);
+    ui_layer_release(&g_layer_lines);
+    res_font_release(g_font);
+    g_font = NULL;
+
     if (g_online_mode) {
         net_disconnect();
         g_online_mode = false;
@@ -1386,6 +1665,14 @@ static void p1_finalize_current_unit_aoe(void)
 
 
 
+// 対戦準備をやめて HOME へ（キャンセル・相手と条件が合わない）
+static void abort_online_wait(void)
+{
+    net_disconnect();
+    g_waiting_opponent_info = false;
+    change_scene(SCENE_HOME);
+}
+
 void scene_battle_update(float dt)
 {
     // オンライン: OPPONENT_INFO待ち
@@ -1396,14 +1683,38 @@ void scene_battle_update(float dt)
             change_scene(SCENE_HOME);
             return;
         }
-        if (net_received_opponent_info(&g_opponent_info)) {
+        if (!g_have_opponent_info && net_received_opponent_info(&g_opponent_info)) {
+            g_have_opponent_info = true;
+            // 対戦ルールの版数が違う相手とは戦わない（サーバでも弾くが、古いサーバ経由の保険）
+            if (g_opponent_info.protocol != NET_PROTOCOL_VERSION) {
+                printf("[BATTLE] opponent protocol %u != %d, leaving\n",
+                       g_opponent_info.protocol, NET_PROTOCOL_VERSION);
+                abort_online_wait();
+                return;
+            }
+            if (g_opponent_info.defs_checksum != battle_defs_checksum()) {
+                printf("[BATTLE] opponent battle defs %08x != %08x, leaving\n",
+                       (unsigned)g_opponent_info.defs_checksum, (unsigned)battle_defs_checksum());
+                abort_online_wait();
+                return;
+            }
+        }
+        NetMatchStage ms;
+        if (g_have_opponent_info && net_received_match_stage(&ms)) {
+            // サーバのステージが手元のカタログに同じ盤面で無ければ戦わない
+            const BattleStage *st = ms.stage_id[0] ? battle_stage_find(ms.stage_id) : NULL;
+            if (ms.stage_id[0] && (!st || st->checksum != ms.checksum)) {
+                printf("[BATTLE] stage '%s' (%08x) %s, leaving\n", ms.stage_id, (unsigned)ms.checksum,
+                       st ? "differs from the local one" : "is not installed");
+                abort_online_wait();
+                return;
+            }
+            g_match_stage = st;
             g_waiting_opponent_info = false;
             init_battle_core();
         }
         if (input_is_pressed(SDL_SCANCODE_ESCAPE)) {
-            net_disconnect();
-            g_waiting_opponent_info = false;
-            change_scene(SCENE_HOME);
+            abort_online_wait();
             return;
         }
         return;
@@ -1411,7 +1722,24 @@ void scene_battle_update(float dt)
 
     if (!g_inited) init_battle_core();
 
+    // 開発ビルド：技/キャラ定義の .bin が置き換わったら読み直す（演出中は表を触らない）
+    //   脅威マップは技表を写して持っているので作り直す
+    if (!g_exec_active && battle_defs_poll_reload(&g_defs_watch)) {
+        battle_threat_build(&g_threat, &g_core, true);
+        g_pv_valid = false;
+        // 記録中のリプレイは途中で定義が変わると再現できないので保存しない
+        if (!g_playback) {
+            if (g_replay.turn_count > 0 && !g_replay_saved) {
+                printf("[BATTLE] battle defs reloaded mid-match, replay will not be saved\n");
+                g_replay_saved = true;
+            }
+            g_replay.defs_checksum = battle_defs_checksum();
+        }
+    }
+
     bars_update(dt);
+    battle_threat_sync(&g_threat, &g_core);
+    if (input_is_pressed(SDL_SCANCODE_H)) g_threat_always = !g_threat_always;
 
     // Esc: 強制終了（いつでもHOMEへ）
     if (input_is_pressed(SDL_SCANCODE_ESCAPE)) {
@@ -1419,7 +1747,17 @@ void scene_battle_update(float dt)
         return;
     }
 
+    if (g_playback) {
+        playback_update(dt);
+        return;
+    }
+
     if (g_core.phase == BPHASE_END) {
+        replay_save_last();
+        if (input_is_pressed(SDL_SCANCODE_R) && g_replay.turn_count > 0) {
+            playback_start_from_record();
+            return;
+        }
         if (input_is_pressed(SDL_SCANCODE_RETURN)) change_scene(SCENE_HOME);
         return;
     }
@@ -1598,6 +1936,8 @@ void scene_battle_update(float dt)
         }
     }
 
+    preview_update();
+
     // ===============================
     // P2側
     // ===============================
@@ -1613,7 +1953,7 @@ void scene_battle_update(float dt)
         if (!g_p2_locked) {
             TurnCmd opp_cmd;
             if (net_received_opponent_cmd(&opp_cmd)) {
-                mirror_turn_cmd(&opp_cmd);
+                battle_cmd_mirror(&opp_cmd);
                 g_p2_cmd = opp_cmd;
                 g_p2_locked = true;
             }
@@ -1621,8 +1961,7 @@ void scene_battle_update(float dt)
     } else {
         // オフライン: ダミーP2
         if (!g_p2_locked) {
-            g_p2_cmd.cmd[SLOT_HERO] = (UnitCmd){ .has_move=true,  .move_to=g_core.units[2].pos, .skill_index=0,  .target=0, .center=g_core.units[2].pos };
-            g_p2_cmd.cmd[SLOT_GIRL] = (UnitCmd){ .has_move=true,  .move_to=g_core.units[3].pos, .skill_index=-1, .target=-1, .center=g_core.units[3].pos };
+            build_offline_p2_cmd(&g_p2_cmd);
             g_p2_locked = true;
         }
     }
@@ -1637,7 +1976,7 @@ void scene_battle_render(SDL_Renderer *r)
     if (g_waiting_opponent_info) {
         SDL_SetRenderDrawColor(r, 10, 10, 16, 255);
         SDL_RenderClear(r);
-        if (!g_font) g_font = ui_load_font("assets/font/main.otf", 28);
+        if (!g_font) g_font = res_font_acquire(BATTLE_FONT, 28);
         ui_text_draw(r, g_font, "対戦準備中...", 520, 330);
         ui_text_draw(r, g_font, "Esc: キャンセル", 510, 380);
         SDL_RenderPresent(r);
@@ -1651,7 +1990,10 @@ void scene_battle_render(SDL_Renderer *r)
     SDL_SetRenderDrawColor(r, 10, 10, 16, 255);
     SDL_RenderClear(r);
 
-    if (!g_font) g_font = ui_load_font("assets/font/main.otf", 28);
+    // ここから Present までの塗り/枠/線/文字はまとめ描き（テクスチャ/ブレンドが変わる所でだけ描画呼び出し）
+    ui_batch_begin(r);
+
+    if (!g_font) g_font = res_font_acquire(BATTLE_FONT, 28);
 
     // ===============================
     // TopBar
@@ -1659,15 +2001,22 @@ void scene_battle_render(SDL_Renderer *r)
     {
         set_color(r, 15, 15, 24, 255);
         SDL_Rect top = {0, 0, 1280, 72};
-        SDL_RenderFillRect(r, &top);
+        ui_batch_fill_rect(r, &top);
         set_color(r, 60, 60, 80, 255);
-        SDL_RenderDrawRect(r, &top);
+        ui_batch_draw_rect(r, &top);
 
         char buf[128];
         snprintf(buf, sizeof(buf), "TURN %d", g_core.turn);
         ui_text_draw(r, g_font, buf, 40, 20);
 
-        if (g_exec_active) {
+        if (g_playback) {
+            static const char *speed_label[] = { "x1", "x8", "即時" };
+            char st[256];
+            snprintf(st, sizeof(st), "REPLAY %d/%d  %s  カットイン:%s%s",
+                     g_pb_turn, g_replay.turn_count, speed_label[g_pb_speed],
+                     g_pb_skip_cutin ? "OFF" : "ON", g_pb_paused ? "  [一時停止]" : "");
+            ui_text_draw(r, g_font, st, 240, 20);
+        } else if (g_exec_active) {
             ui_text_draw(r, g_font, "実行中（SPD順）", 240, 20);
         } else if (!g_p1_locked) {
             char st[256];
@@ -1709,6 +2058,15 @@ void scene_battle_render(SDL_Renderer *r)
         draw_stat_panel(r, px + pw + gap, py + ph + gap, pw, ph, "2P相棒",
                         (int)lroundf(g_disp_hp[3]), calc_unit_max_hp(p2g),
                         (int)lroundf(g_disp_st[3]), calc_unit_max_st(p2g));
+
+        // 作戦プレビュー：名前の右に「このまま決定したら」の増減
+        if (g_pv_valid) {
+            for (int i = 0; i < 4; i++) {
+                int x = px + (i % 2) * (pw + gap) + 130;
+                int y = py + (i / 2) * (ph + gap) + 6;
+                draw_preview_line(r, x, y, i);
+            }
+        }
     }
 
     // ===============================
@@ -1730,13 +2088,16 @@ void scene_battle_render(SDL_Renderer *r)
 
         set_color(r, 15, 15, 24, 255);
         SDL_Rect bar = {bar_x, bar_y, bar_w, bar_h};
-        SDL_RenderFillRect(r, &bar);
+        ui_batch_fill_rect(r, &bar);
         set_color(r, 60, 60, 80, 255);
-        SDL_RenderDrawRect(r, &bar);
+        ui_batch_draw_rect(r, &bar);
 
         int y = 664;
 
-        if (g_exec_active) {
+        if (g_playback) {
+            ui_text_draw(r, g_font, "←→:±1  PgUp/PgDn:±10  Home/End  1/2/3:x1/x8/即時  C:カットイン  Space:停止  Esc:終了", 80, 692);
+        }
+        else if (g_exec_active) {
             ui_text_draw(r, g_font, "SPD順に実行中…（Esc:強制終了）", 80, 692);
         }
         else if (!g_p1_locked && g_ui == UI_TURN_CONFIRM) {
@@ -1753,20 +2114,20 @@ void scene_battle_render(SDL_Renderer *r)
             };
 
             set_color(r, 30, 30, 45, 255);
-            SDL_RenderFillRect(r, &yes_box);
-            SDL_RenderFillRect(r, &no_box);
+            ui_batch_fill_rect(r, &yes_box);
+            ui_batch_fill_rect(r, &no_box);
 
             if (g_confirm == CONFIRM_YES) {
                 set_color(r, 55, 55, 85, 255);
-                SDL_RenderFillRect(r, &yes_box);
+                ui_batch_fill_rect(r, &yes_box);
             } else {
                 set_color(r, 55, 55, 85, 255);
-                SDL_RenderFillRect(r, &no_box);
+                ui_batch_fill_rect(r, &no_box);
             }
 
             set_color(r, 110, 110, 150, 255);
-            SDL_RenderDrawRect(r, &yes_box);
-            SDL_RenderDrawRect(r, &no_box);
+            ui_batch_draw_rect(r, &yes_box);
+            ui_batch_draw_rect(r, &no_box);
 
             ui_text_draw(r, g_font, "はい",   yes_box.x + 70, yes_box.y + 8);
             ui_text_draw(r, g_font, "いいえ", no_box.x + 70,  no_box.y + 8);
@@ -1789,14 +2150,14 @@ void scene_battle_render(SDL_Renderer *r)
             for (int i = 0; i < max_skill; i++) {
                 SDL_Rect box = { x0, y0 + i*(h+gap), w, h };
                 SDL_SetRenderDrawColor(r, 30, 30, 35, 255);
-                SDL_RenderFillRect(r, &box);
+                ui_batch_fill_rect(r, &box);
 
                 if (i == g_skill_index[g_act_slot]) {
                     SDL_SetRenderDrawColor(r, 255, 255, 255, 255);
                 } else {
                     SDL_SetRenderDrawColor(r, 100, 100, 110, 255);
                 }
-                SDL_RenderDrawRect(r, &box);
+                ui_batch_draw_rect(r, &box);
 
                 const char *sid = resolve_skill_id_for_unit(u, i);
                 const SkillDef *sk = battle_skill_get(sid);
@@ -1836,20 +2197,20 @@ void scene_battle_render(SDL_Renderer *r)
             SDL_Rect wait_box = { wait_x   - 20, y - 6, 160, 34 };
 
             set_color(r, 30, 30, 45, 255);
-            SDL_RenderFillRect(r, &atk_box);
-            SDL_RenderFillRect(r, &wait_box);
+            ui_batch_fill_rect(r, &atk_box);
+            ui_batch_fill_rect(r, &wait_box);
 
             if (g_cmd == CMD_ATTACK) {
                 set_color(r, 55, 55, 85, 255);
-                SDL_RenderFillRect(r, &atk_box);
+                ui_batch_fill_rect(r, &atk_box);
             } else {
                 set_color(r, 55, 55, 85, 255);
-                SDL_RenderFillRect(r, &wait_box);
+                ui_batch_fill_rect(r, &wait_box);
             }
 
             set_color(r, 110, 110, 150, 255);
-            SDL_RenderDrawRect(r, &atk_box);
-            SDL_RenderDrawRect(r, &wait_box);
+            ui_batch_draw_rect(r, &atk_box);
+            ui_batch_draw_rect(r, &wait_box);
 
             ui_text_draw(r, g_font, "攻撃", attack_x + 20, y);
             ui_text_draw(r, g_font, "待機", wait_x + 20, y);
@@ -1868,7 +2229,7 @@ void scene_battle_render(SDL_Renderer *r)
                     char buf[256];
                     int idx = unit_index(TEAM_P1, g_act_slot);
                     const Unit *u = &g_core.units[idx];
-                    snprintf(buf, sizeof(buf), "矢印:移動先  Enter:確定(範囲=%d)  Q:1手戻し  Esc:強制終了",
+                    snprintf(buf, sizeof(buf), "矢印:移動先  Enter:確定(範囲=%d)  H:脅威表示  Q:1手戻し  Esc:強制終了",
                              get_move_range_for_unit(u));
                     ui_text_draw(r, g_font, buf, 80, 692);
                 } else {
@@ -1897,14 +2258,14 @@ void scene_battle_render(SDL_Renderer *r)
         set_color(r, 0, 0, 0, 160);
         SDL_Rect veil = {0, 0, 1280, 720};
         SDL_SetRenderDrawBlendMode(r, SDL_BLENDMODE_BLEND);
-        SDL_RenderFillRect(r, &veil);
+        ui_batch_fill_rect(r, &veil);
         SDL_SetRenderDrawBlendMode(r, SDL_BLENDMODE_NONE);
 
         // テキスト（ざっくり中央寄せ）
         ui_text_draw(r, g_font, msg, 560, 320);
-        ui_text_draw(r, g_font, "Enter: HOME", 520, 370);
+        ui_text_draw(r, g_font, g_playback ? "Enter: HOME  ←/Home: 巻き戻し" : "Enter: HOME  R: リプレイ", 520, 370);
     }
 
-
+    ui_batch_end();
     SDL_RenderPresent(r);
 }
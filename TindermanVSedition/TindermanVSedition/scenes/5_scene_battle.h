@@ -2,10 +2,17 @@
 #define SCENE_BATTLE_H
 
 #include <SDL2/SDL.h>
+#include <stdbool.h>
+
+// 次に入る battle シーンをリプレイ再生にする（読み込み失敗なら false）
+bool scene_battle_request_replay(const char *path);
 
 void scene_battle_enter(void);
 void scene_battle_leave(void);
 void scene_battle_update(float dt);
 void scene_battle_render(SDL_Renderer *r);
 
+// 次に入るときのフォントを先読み（scene_prefetch から）
+void scene_battle_prefetch(void);
+
 #endif
@@ -10,18 +10,12 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <netdb.h>
+#include <time.h>
+#include <sys/stat.h>
 
-// プロトコル定数のみ使用（inline関数は不要なのでサイズ定義だけ再定義）
-#define MSG_READY         0x01
-#define MSG_ASSIGN        0x02
-#define MSG_GAME_INFO     0x03
-#define MSG_OPPONENT_INFO 0x04
-#define MSG_TURN_CMD      0x05
-#define MSG_OPPONENT_CMD  0x06
-
-#define NET_GAME_INFO_BYTES 50
-#define TURNCMD_WIRE_BYTES  14
-#define NET_MSG_MAX_SIZE    51
+// プロトコル定義 + リプレイ記録（battle/ は SDL 非依存）
+#include "net/net_protocol.h"
+#include "battle/tvse_battle.h"
 
 #define MAX_CLIENTS 2
 #define RECV_BUF_SIZE 256
@@ -52,15 +46,26 @@ static int has_game_info[MAX_CLIENTS];
 static uint8_t turn_cmd[MAX_CLIENTS][TURNCMD_WIRE_BYTES];
 static int has_turn_cmd[MAX_CLIENTS];
 
+// リプレイ記録（client 0 視点 = client 0 が P1。client 1 の命令はミラーして P2 に入れる）
+static const char *replay_dir = "replays";   // NULL なら記録しない
+static const char *stage_dir = "assets/stages";   // ステージはサーバが seed から決めて MATCH_STAGE で送る
+static const BattleStage *match_stage;   // この対戦のステージ（NULL=なし）
+static BattleReplay replay;
+static BattleCore replay_core;
+static int recording = 0;
+
 static int msg_payload_size(uint8_t msg_type)
 {
     switch (msg_type) {
     case MSG_READY:         return 0;
     case MSG_ASSIGN:        return 1;
-    case MSG_GAME_INFO:     return NET_GAME_INFO_BYTES;
+    case MSG_GAME_INFO_V1:  return NET_GAME_INFO_V1_BYTES;
     case MSG_OPPONENT_INFO: return NET_GAME_INFO_BYTES;
     case MSG_TURN_CMD:      return TURNCMD_WIRE_BYTES;
     case MSG_OPPONENT_CMD:  return TURNCMD_WIRE_BYTES;
+    case MSG_GAME_INFO:     return NET_GAME_INFO_BYTES;
+    case MSG_REJECT:        return 1;
+    case MSG_MATCH_STAGE:   return NET_MATCH_STAGE_BYTES;
     default:                return -1;
     }
 }
@@ -77,8 +82,80 @@ static int send_all(int fd, const uint8_t *data, int len)
     return 0;
 }
 
+// ===============================
+//  リプレイ記録
+// ===============================
+static void replay_begin(void)
+{
+    if (!replay_dir) return;
+
+    NetGameInfo info[MAX_CLIENTS];
+    net_game_info_unpack(game_info[0], &info[0]);
+    net_game_info_unpack(game_info[1], &info[1]);
+
+    // サーバの定義がクライアントと違えば再シミュレートが合わないので、この対戦は記録しない
+    if (info[0].defs_checksum != battle_defs_checksum()) {
+        printf("[server] battle defs differ from clients (server=%08x clients=%08x), replay not recorded\n",
+               (unsigned)battle_defs_checksum(), (unsigned)info[0].defs_checksum);
+        return;
+    }
+
+    uint32_t seed = battle_replay_match_seed(&info[0], &info[1]);
+    battle_replay_init(&replay, &info[0], &info[1], seed);
+    battle_core_free(&replay_core);
+    recording = battle_replay_setup_core(&replay_core, &info[0], &info[1]);
+    replay_core.rng_seed = seed;
+    replay_core.stage = match_stage;
+    battle_replay_set_stage(&replay, replay_core.stage);
+}
+
+static void replay_finish(void)
+{
+    if (!recording) return;
+    recording = 0;
+
+    if (replay.turn_count > 0) {
+        mkdir(replay_dir, 0755);   // 既にあれば失敗するだけ
+
+        char stamp[32];
+        time_t now = time(NULL);
+        struct tm tmv;
+        localtime_r(&now, &tmv);
+        strftime(stamp, sizeof(stamp), "%Y%m%d_%H%M%S", &tmv);
+
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s.tvsr", replay_dir, stamp);
+        if (battle_replay_save(&replay, path)) {
+            printf("[server] Replay saved: %s (%d turns)\n", path, replay.turn_count);
+        } else {
+            printf("[server] Replay save failed: %s\n", path);
+        }
+    }
+    battle_replay_free(&replay);
+    battle_core_free(&replay_core);
+}
+
+static void replay_turn(void)
+{
+    if (!recording) return;
+
+    TurnCmd c0, c1;
+    if (!battle_cmd_unpack(turn_cmd[0], &c0) || !battle_cmd_unpack(turn_cmd[1], &c1)) {
+        printf("[server] Replay: invalid TURN_CMD, recording stopped\n");
+        replay_finish();
+        return;
+    }
+    battle_cmd_mirror(&c1);
+
+    battle_replay_record_turn(&replay, &replay_core, &c0, &c1);
+    battle_core_run_turn(&replay_core, &c0, &c1);
+    if (replay_core.phase == BPHASE_END) replay_finish();
+}
+
 static void reset_session(void)
 {
+    replay_finish();
+
     state = STATE_WAITING;
     for (int i = 0; i < MAX_CLIENTS; i++) {
         ready[i] = 0;
@@ -101,6 +178,16 @@ static void disconnect_client(int i, fd_set *mask)
     reset_session();
 }
 
+// 理由を送ってから切断（マッチさせない相手）
+static void reject_client(int i, uint8_t reason, fd_set *mask)
+{
+    if (client_sock[i] >= 0) {
+        uint8_t msg[MSG_REJECT_SIZE] = { MSG_REJECT, reason };
+        send_all(client_sock[i], msg, sizeof(msg));
+    }
+    disconnect_client(i, mask);
+}
+
 // 1メッセージを処理
 static void handle_message(int i, uint8_t msg_type, const uint8_t *payload, int payload_len, fd_set *mask)
 {
@@ -129,6 +216,12 @@ static void handle_message(int i, uint8_t msg_type, const uint8_t *payload, int
         }
         break;
 
+    case MSG_GAME_INFO_V1:
+        // 版数なしの旧クライアント（対戦ルールが違うので同期しない）
+        printf("[server] Client %d sent GAME_INFO without protocol version, rejected\n", i);
+        reject_client(i, NET_REJECT_PROTOCOL, mask);
+        break;
+
     case MSG_GAME_INFO:
         if (state != STATE_INFO_EXCHANGE) break;
         if (payload_len != NET_GAME_INFO_BYTES) break;
@@ -138,6 +231,26 @@ static void handle_message(int i, uint8_t msg_type, const uint8_t *payload, int
         printf("[server] Client %d GAME_INFO received\n", i);
 
         if (has_game_info[0] && has_game_info[1]) {
+            // 対戦ルールの版数が揃わなければマッチさせない（リプレイの再シミュレートもこのサーバの版で行う）
+            NetGameInfo info[MAX_CLIENTS];
+            net_game_info_unpack(game_info[0], &info[0]);
+            net_game_info_unpack(game_info[1], &info[1]);
+            if (info[0].protocol != NET_PROTOCOL_VERSION || info[1].protocol != NET_PROTOCOL_VERSION) {
+                printf("[server] protocol mismatch (client0=%u client1=%u server=%d), rejected\n",
+                       info[0].protocol, info[1].protocol, NET_PROTOCOL_VERSION);
+                reject_client(0, NET_REJECT_PROTOCOL, mask);
+                reject_client(1, NET_REJECT_PROTOCOL, mask);
+                break;
+            }
+            // 技/キャラ定義が違えば同じ命令でも結果が変わる（同期しない）
+            if (info[0].defs_checksum != info[1].defs_checksum) {
+                printf("[server] battle defs mismatch (client0=%08x client1=%08x), rejected\n",
+                       (unsigned)info[0].defs_checksum, (unsigned)info[1].defs_checksum);
+                reject_client(0, NET_REJECT_DEFS, mask);
+                reject_client(1, NET_REJECT_DEFS, mask);
+                break;
+            }
+
             // 両者のGAME_INFOを相手にOPPONENT_INFOとして転送
             uint8_t msg[1 + NET_GAME_INFO_BYTES];
 
@@ -149,10 +262,27 @@ static void handle_message(int i, uint8_t msg_type, const uint8_t *payload, int
             memcpy(msg + 1, game_info[0], NET_GAME_INFO_BYTES);
             send_all(client_sock[1], msg, sizeof(msg));
 
+            // ステージはサーバが決めて両者に送る（各自のカタログの並びに依らない）
+            match_stage = battle_stage_for_seed(battle_replay_match_seed(&info[0], &info[1]));
+            NetMatchStage ms;
+            memset(&ms, 0, sizeof(ms));
+            if (match_stage) {
+                snprintf(ms.stage_id, sizeof(ms.stage_id), "%s", match_stage->id);
+                ms.checksum = match_stage->checksum;
+            }
+            uint8_t smsg[MSG_MATCH_STAGE_SIZE];
+            smsg[0] = MSG_MATCH_STAGE;
+            net_match_stage_pack(&ms, smsg + 1);
+            send_all(client_sock[0], smsg, sizeof(smsg));
+            send_all(client_sock[1], smsg, sizeof(smsg));
+            printf("[server] stage: %s\n", match_stage ? match_stage->id : "(none)");
+
             state = STATE_BATTLE;
             has_turn_cmd[0] = 0;
             has_turn_cmd[1] = 0;
             printf("[server] INFO exchanged -> BATTLE\n");
+
+            replay_begin();
         }
         break;
 
@@ -179,6 +309,8 @@ static void handle_message(int i, uint8_t msg_type, const uint8_t *payload, int
             has_turn_cmd[0] = 0;
             has_turn_cmd[1] = 0;
             printf("[server] TURN_CMD exchanged\n");
+
+            replay_turn();
         }
         break;
 
@@ -205,6 +337,7 @@ static void process_recv_buf(int i, fd_set *mask)
         if (recv_len[i] < total) break; // まだ足りない
 
         handle_message(i, msg_type, recv_buf[i] + 1, psize, mask);
+        if (client_sock[i] < 0) return;   // 処理中に切断した
 
         // 消費した分をシフト
         int remain = recv_len[i] - total;
@@ -225,9 +358,22 @@ int main(int argc, char *argv[])
     for (int i = 1; i < argc; i++) {
         if ((strcmp(argv[i], "--port") == 0 || strcmp(argv[i], "-p") == 0) && i + 1 < argc) {
             port = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--replay-dir") == 0 && i + 1 < argc) {
+            replay_dir = argv[++i];
+        } else if (strcmp(argv[i], "--no-replay") == 0) {
+            replay_dir = NULL;
+        } else if (strcmp(argv[i], "--stage-dir") == 0 && i + 1 < argc) {
+            stage_dir = argv[++i];
         }
     }
 
+    // リプレイの再シミュレートに技/キャラ定義が要る（読めなければ記録しない）
+    if (replay_dir && !battle_defs_load(BATTLE_DEFS_PATH)) {
+        printf("[server] battle defs not found, replay recording disabled\n");
+        replay_dir = NULL;
+    }
+    printf("[server] stages: %d\n", battle_stage_catalog_load(stage_dir));
+
     // ホスト名表示
     char hostname[256];
     if (gethostname(hostname, sizeof(hostname)) == 0)
@@ -0,0 +1,717 @@
+// tools/asset_pack.c — assets/ の画像/フォント/音声を1つの .tvsp にまとめる（SDL/SDL_image が要る。make pack）
+//
+//   ./tools/asset_pack [--out PATH] [--format native|argb|abgr] [--half] [--no-resize] [DIR...]
+//   ./tools/asset_pack --bench [--out PATH] [DIR...]
+//
+//   - DIR の既定は assets/bg assets/ui assets/girls assets/effects assets/voice assets/font（ない所は飛ばす）
+//     パスは実行時と同じ "assets/..." で入れるので、リポジトリの直下で走らせる
+//   - .png は展開して --format のピクセルにし、LZ4 で縮めて入れる（縮まなければそのまま）
+//     native（既定）：この環境の既定 renderer が最初に挙げる 32bit 形式（作れなければ ARGB8888）
+//   - 画像は k_size_rules の大きさ（論理 1280x720 で描く先の最大）まで面積平均で縮める（拡大はしない）
+//     透明のある画像は premultiplied alpha にして入れる（縮めるのも premultiplied のまま）
+//     --half : 半分の大きさも "<path>@half" で入れる（--low-end/小さい窓で実行時に選ぶ）
+//     --no-resize : 元の大きさのまま（縮める前との比較用）。最後に画像ごと/合計のテクスチャの大きさを出す
+//   - .ttf/.otf/.wav はファイルのまま
+//   - 書いたあと開き直して、全部の項目が引けて展開できることを確かめる
+//
+//   --bench : 同じ画像を PNG から（IMG_Load + 形式変換）とパックから（asset_pack_surface）で
+//             読んだ時間を比べる。コールド（ページキャッシュなし）は先に
+//             sync; echo 3 | sudo tee /proc/sys/vm/drop_caches してから1回目を見る
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include <dirent.h>
+#include <fnmatch.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "util/asset_pack.h"
+#include "util/lz4_mini.h"
+
+#define PACK_PATH_MAX 512
+
+static const char *const k_default_dirs[] = {
+    "assets/bg", "assets/ui", "assets/girls", "assets/effects", "assets/voice", "assets/font",
+};
+
+// ===============================
+//  画面に出る最大の大きさ（上から最初に合ったもの。ないものは縮めない）
+//   STRETCH : 決まった矩形に引き伸ばして描くもの → その大きさに
+//   FIT     : 縦横比を保って矩形に収めるもの     → 収まる大きさに
+// ===============================
+typedef enum { SIZE_STRETCH, SIZE_FIT } SizeMode;
+
+typedef struct {
+    const char *pattern;    // fnmatch（FNM_PATHNAME）
+    int w, h;
+    SizeMode mode;
+} SizeRule;
+
+static const SizeRule k_size_rules[] = {
+    { "assets/bg/*",                     1280, 720, SIZE_STRETCH },   // HOME の全画面
+    { "assets/ui/allocate_bg.png",       1280, 720, SIZE_STRETCH },   // ALLOCATE の全画面
+    { "assets/ui/chat_start.png",         500, 500, SIZE_STRETCH },   // CHAT の intro
+    { "assets/ui/selected.png",           120, 120, SIZE_STRETCH },   // SELECT の決定アイコン
+    { "assets/effects/spark.png",          42,  42, SIZE_STRETCH },   // SELECT の枠の火花（最大 42px）
+    { "assets/girls/*/portrait.png",      343, 514, SIZE_STRETCH },   // SELECT（320x480、フォーカスで 1.07 倍）
+    { "assets/girls/*/portrait/*.png",    300, 500, SIZE_FIT },       // CHAT の左ペイン
+};
+
+// ===============================
+//  ファイル集め
+// ===============================
+typedef struct {
+    char **paths;
+    int count, cap;
+} PathList;
+
+static bool has_ext(const char *path, const char *ext)
+{
+    const size_t n = strlen(path), e = strlen(ext);
+    if (n < e) return false;
+    for (size_t i = 0; i < e; i++) {
+        char c = path[n - e + i];
+        if (c >= 'A' && c <= 'Z') c = (char)(c - 'A' + 'a');
+        if (c != ext[i]) return false;
+    }
+    return true;
+}
+
+static bool is_image(const char *path) { return has_ext(path, ".png"); }
+static bool is_packed(const char *path)
+{
+    return is_image(path) || has_ext(path, ".ttf") || has_ext(path, ".otf") || has_ext(path, ".wav");
+}
+
+static void list_push(PathList *l, const char *path)
+{
+    if (l->count == l->cap) {
+        l->cap = l->cap ? l->cap * 2 : 64;
+        l->paths = (char**)realloc(l->paths, sizeof(char*) * (size_t)l->cap);
+        if (!l->paths) exit(1);
+    }
+    l->paths[l->count++] = strdup(path);
+}
+
+static void collect(PathList *l, const char *dir)
+{
+    DIR *d = opendir(dir);
+    if (!d) return;
+    struct dirent *ent;
+    while ((ent = readdir(d)) != NULL) {
+        if (ent->d_name[0] == '.') continue;
+        char path[PACK_PATH_MAX];
+        if (snprintf(path, sizeof(path), "%s/%s", dir, ent->d_name) >= (int)sizeof(path)) continue;
+        struct stat st;
+        if (stat(path, &st) != 0) continue;
+        if (S_ISDIR(st.st_mode)) collect(l, path);
+        else if (S_ISREG(st.st_mode) && is_packed(path)) list_push(l, path);
+    }
+    closedir(d);
+}
+
+static int cmp_path(const void *a, const void *b)
+{
+    return strcmp(*(char *const*)a, *(char *const*)b);
+}
+
+// ===============================
+//  画像の下ごしらえ（ARGB8888 で扱い、最後に出力の形式へ）
+// ===============================
+typedef struct {
+    uint32_t w, h;
+    Uint32 *px;             // ARGB8888（premultiplied なら RGB に A を掛けたもの）
+} Image;
+
+static bool has_alpha(const Image *im)
+{
+    const size_t n = (size_t)im->w * im->h;
+    for (size_t i = 0; i < n; i++) {
+        if ((im->px[i] >> 24) != 255) return true;
+    }
+    return false;
+}
+
+static void premultiply(Image *im)
+{
+    const size_t n = (size_t)im->w * im->h;
+    for (size_t i = 0; i < n; i++) {
+        const Uint32 v = im->px[i], a = v >> 24;
+        if (a == 255) continue;
+        const Uint32 r = (((v >> 16) & 255) * a + 127) / 255;
+        const Uint32 g = (((v >> 8) & 255) * a + 127) / 255;
+        const Uint32 b = ((v & 255) * a + 127) / 255;
+        im->px[i] = (a << 24) | (r << 16) | (g << 8) | b;
+    }
+}
+
+// 1軸ぶんの面積平均の重み：dst の i 番目は src の [first[i], first[i]+count[i]) に w[] を掛けた和 / scale
+typedef struct {
+    int *first, *count;
+    float *w;               // dst 1画素あたり最大 ceil(sn/dn)+1 個
+    int stride;
+    float scale;
+} AxisWeights;
+
+static bool axis_weights(AxisWeights *a, int sn, int dn)
+{
+    a->stride = sn / dn + 2;
+    a->scale = (float)sn / (float)dn;
+    a->first = (int*)malloc(sizeof(int) * (size_t)dn);
+    a->count = (int*)malloc(sizeof(int) * (size_t)dn);
+    a->w = (float*)malloc(sizeof(float) * (size_t)dn * (size_t)a->stride);
+    if (!a->first || !a->count || !a->w) return false;
+    for (int i = 0; i < dn; i++) {
+        const double s0 = (double)i * sn / dn, s1 = (double)(i + 1) * sn / dn;
+        int k = (int)s0, n = 0;
+        for (; k + n < sn && (double)(k + n) < s1; n++) {
+            const double lo = (k + n) > s0 ? (double)(k + n) : s0;
+            const double hi = (k + n + 1) < s1 ? (double)(k + n + 1) : s1;
+            a->w[(size_t)i * (size_t)a->stride + (size_t)n] = (float)(hi - lo);
+        }
+        a->first[i] = k;
+        a->count[i] = n;
+    }
+    return true;
+}
+
+static void axis_free(AxisWeights *a)
+{
+    free(a->first);
+    free(a->count);
+    free(a->w);
+}
+
+// 面積平均で dw x dh に（横 → 縦の2回。premultiplied のまま平均するので縁が黒ずまない）
+static bool downscale(const Image *src, Image *dst, uint32_t dw, uint32_t dh)
+{
+    const int sw = (int)src->w, sh = (int)src->h;
+    AxisWeights ax = {0}, ay = {0};
+    float *tmp = (float*)malloc(sizeof(float) * 4 * (size_t)dw * (size_t)sh);
+    dst->w = dw;
+    dst->h = dh;
+    dst->px = (Uint32*)malloc(sizeof(Uint32) * (size_t)dw * dh);
+    bool ok = tmp && dst->px && axis_weights(&ax, sw, (int)dw) && axis_weights(&ay, sh, (int)dh);
+
+    for (int y = 0; ok && y < sh; y++) {
+        const Uint32 *row = src->px + (size_t)y * (size_t)sw;
+        for (uint32_t x = 0; x < dw; x++) {
+            float acc[4] = {0};
+            const float *w = ax.w + (size_t)x * (size_t)ax.stride;
+            for (int k = 0; k < ax.count[x]; k++) {
+                const Uint32 v = row[ax.first[x] + k];
+                for (int c = 0; c < 4; c++) acc[c] += w[k] * (float)((v >> (c * 8)) & 255);
+            }
+            float *t = tmp + ((size_t)y * dw + x) * 4;
+            for (int c = 0; c < 4; c++) t[c] = acc[c] / ax.scale;
+        }
+    }
+    for (uint32_t y = 0; ok && y < dh; y++) {
+        const float *w = ay.w + (size_t)y * (size_t)ay.stride;
+        for (uint32_t x = 0; x < dw; x++) {
+            float acc[4] = {0};
+            for (int k = 0; k < ay.count[y]; k++) {
+                const float *t = tmp + ((size_t)(ay.first[y] + k) * dw + x) * 4;
+                for (int c = 0; c < 4; c++) acc[c] += w[k] * t[c];
+            }
+            Uint32 v = 0;
+            for (int c = 0; c < 4; c++) {
+                float f = acc[c] / ay.scale + 0.5f;
+                v |= (Uint32)(f < 0.0f ? 0.0f : f > 255.0f ? 255.0f : f) << (c * 8);
+            }
+            dst->px[(size_t)y * dw + x] = v;
+        }
+    }
+    free(tmp);
+    axis_free(&ax);
+    axis_free(&ay);
+    if (!ok) {
+        free(dst->px);
+        dst->px = NULL;
+    }
+    return ok;
+}
+
+// k_size_rules で決まる大きさ（拡大はしない）
+static void target_size(const char *path, uint32_t w, uint32_t h, uint32_t *tw, uint32_t *th)
+{
+    *tw = w;
+    *th = h;
+    for (size_t i = 0; i < sizeof(k_size_rules) / sizeof(k_size_rules[0]); i++) {
+        const SizeRule *r = &k_size_rules[i];
+        if (fnmatch(r->pattern, path, FNM_PATHNAME) != 0) continue;
+        if (r->mode == SIZE_STRETCH) {
+            if ((uint32_t)r->w < w) *tw = (uint32_t)r->w;
+            if ((uint32_t)r->h < h) *th = (uint32_t)r->h;
+        } else {
+            const double sx = (double)r->w / w, sy = (double)r->h / h;
+            const double s = sx < sy ? sx : sy;
+            if (s < 1.0) {
+                *tw = (uint32_t)(w * s + 0.5);
+                *th = (uint32_t)(h * s + 0.5);
+                if (*tw == 0) *tw = 1;
+                if (*th == 0) *th = 1;
+            }
+        }
+        return;
+    }
+}
+
+// PNG → 縮めた（+ 半分の）ARGB8888。src_w/src_h に元の大きさ
+static bool prepare_image(const char *path, bool resize, bool want_half, Image *full, Image *half,
+                          bool *premultiplied, uint32_t *src_w, uint32_t *src_h)
+{
+    SDL_Surface *s = IMG_Load(path);
+    if (!s) {
+        fprintf(stderr, "[PACK] %s: %s\n", path, IMG_GetError());
+        return false;
+    }
+    SDL_Surface *c = SDL_ConvertSurfaceFormat(s, SDL_PIXELFORMAT_ARGB8888, 0);
+    SDL_FreeSurface(s);
+    if (!c) {
+        fprintf(stderr, "[PACK] %s: convert failed: %s\n", path, SDL_GetError());
+        return false;
+    }
+    Image orig = { (uint32_t)c->w, (uint32_t)c->h, (Uint32*)malloc((size_t)c->w * 4 * (size_t)c->h) };
+    if (orig.px) {
+        for (int y = 0; y < c->h; y++)
+            memcpy(orig.px + (size_t)y * orig.w, (const uint8_t*)c->pixels + (size_t)c->pitch * (size_t)y, (size_t)c->w * 4);
+    }
+    SDL_FreeSurface(c);
+    if (!orig.px) return false;
+    *src_w = orig.w;
+    *src_h = orig.h;
+
+    *premultiplied = has_alpha(&orig);
+    if (*premultiplied) premultiply(&orig);
+
+    uint32_t tw = orig.w, th = orig.h;
+    if (resize) target_size(path, orig.w, orig.h, &tw, &th);
+    if (tw == orig.w && th == orig.h) {
+        *full = orig;
+    } else {
+        const bool ok = downscale(&orig, full, tw, th);
+        free(orig.px);
+        if (!ok) return false;
+    }
+
+    half->px = NULL;
+    if (want_half && !downscale(full, half, (full->w + 1) / 2, (full->h + 1) / 2)) {
+        free(full->px);
+        full->px = NULL;
+        return false;
+    }
+    return true;
+}
+
+// ===============================
+//  書き出し
+// ===============================
+typedef struct {
+    const char *name;       // 表に入る名前（半分は "<src>@half"）
+    const char *src;        // 読むファイル
+    bool half;              // src の半分（直前の項目と同じ src）
+    uint32_t name_off;
+    AssetPackKind kind;
+    uint8_t flags;
+    uint32_t w, h, size, raw_size;
+    uint64_t data_off;
+} PackEntry;
+
+static void put_u32(uint8_t *p, uint32_t v) { p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); p[2] = (uint8_t)(v >> 16); p[3] = (uint8_t)(v >> 24); }
+static void put_u64(uint8_t *p, uint64_t v) { put_u32(p, (uint32_t)v); put_u32(p + 4, (uint32_t)(v >> 32)); }
+static uint32_t get_u32(const uint8_t *p) { return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24); }
+
+static bool write_pad(FILE *out, long *pos)
+{
+    static const uint8_t zero[ASSET_PACK_ALIGN];
+    const long pad = (ASSET_PACK_ALIGN - *pos % ASSET_PACK_ALIGN) % ASSET_PACK_ALIGN;
+    *pos += pad;
+    return fwrite(zero, 1, (size_t)pad, out) == (size_t)pad;
+}
+
+static uint8_t* read_file(const char *path, size_t *size)
+{
+    FILE *fp = fopen(path, "rb");
+    if (!fp) return NULL;
+    fseek(fp, 0, SEEK_END);
+    long n = ftell(fp);
+    rewind(fp);
+    uint8_t *buf = (n >= 0) ? (uint8_t*)malloc((size_t)n + 1) : NULL;
+    if (buf && fread(buf, 1, (size_t)n, fp) != (size_t)n) {
+        free(buf);
+        buf = NULL;
+    }
+    fclose(fp);
+    *size = (size_t)n;
+    return buf;
+}
+
+static bool write_data(FILE *out, long *pos, PackEntry *e, const uint8_t *data, size_t size, size_t raw_size)
+{
+    bool ok = size <= UINT32_MAX && raw_size <= UINT32_MAX && write_pad(out, pos);
+    e->data_off = (uint64_t)*pos;
+    e->size = (uint32_t)size;
+    e->raw_size = (uint32_t)raw_size;
+    ok = ok && fwrite(data, 1, size, out) == size;
+    *pos += (long)size;
+    return ok;
+}
+
+// 画像1枚ぶん：format に並べ替えて、1割以上縮まれば LZ4
+static bool write_pixels(FILE *out, long *pos, PackEntry *e, const Image *im, Uint32 format)
+{
+    const size_t raw_size = (size_t)im->w * 4 * im->h;
+    uint8_t *raw = (uint8_t*)malloc(raw_size);
+    const size_t cap = LZ4M_BOUND(raw_size);
+    uint8_t *comp = (uint8_t*)malloc(cap);
+    bool ok = raw && comp &&
+              SDL_ConvertPixels((int)im->w, (int)im->h, SDL_PIXELFORMAT_ARGB8888, im->px, (int)im->w * 4,
+                                format, raw, (int)im->w * 4) == 0;
+    if (ok) {
+        e->w = im->w;
+        e->h = im->h;
+        const size_t n = lz4m_compress(raw, raw_size, comp, cap);
+        if (n && n < raw_size - raw_size / 10) {
+            e->kind = ASSET_PACK_PIXELS_LZ4;
+            ok = write_data(out, pos, e, comp, n, raw_size);
+        } else {
+            e->kind = ASSET_PACK_PIXELS;
+            ok = write_data(out, pos, e, raw, raw_size, raw_size);
+        }
+    }
+    free(raw);
+    free(comp);
+    return ok;
+}
+
+static bool write_file(FILE *out, long *pos, PackEntry *e)
+{
+    size_t size = 0;
+    uint8_t *raw = read_file(e->src, &size);
+    if (!raw) {
+        fprintf(stderr, "[PACK] %s: cannot read\n", e->src);
+        return false;
+    }
+    e->kind = ASSET_PACK_FILE;
+    const bool ok = write_data(out, pos, e, raw, size, size);
+    free(raw);
+    return ok;
+}
+
+// テクスチャの大きさ（w*h*4）の元 → パック。ディレクトリ（assets/<dir>）ごとと合計
+typedef struct {
+    char dir[64];
+    size_t src, full, half;
+    int images;
+} SizeReport;
+
+static void report_add(SizeReport *rep, int *nrep, const char *path, size_t src, size_t full, size_t half)
+{
+    char dir[64];
+    const char *p = strchr(path, '/');
+    const char *q = p ? strchr(p + 1, '/') : NULL;
+    snprintf(dir, sizeof(dir), "%.*s", q ? (int)(q - path) : (int)strlen(path), path);
+    int i = 0;
+    while (i < *nrep && strcmp(rep[i].dir, dir) != 0) i++;
+    if (i == *nrep) {
+        memset(&rep[i], 0, sizeof(rep[i]));
+        snprintf(rep[i].dir, sizeof(rep[i].dir), "%s", dir);
+        (*nrep)++;
+    }
+    rep[i].src += src;
+    rep[i].full += full;
+    rep[i].half += half;
+    rep[i].images++;
+}
+
+static bool pack_write(const char *out_path, const PathList *files, Uint32 format, bool resize, bool with_half)
+{
+    int n = 0;
+    PackEntry *ents = (PackEntry*)calloc((size_t)files->count * 2 + 1, sizeof(PackEntry));
+    if (!ents) return false;
+    for (int i = 0; i < files->count; i++) {
+        const char *p = files->paths[i];
+        ents[n].name = p;
+        ents[n].src = p;
+        n++;
+        if (with_half && is_image(p)) {
+            char *name = (char*)malloc(strlen(p) + sizeof(ASSET_PACK_HALF_SUFFIX));
+            if (!name) exit(1);
+            sprintf(name, "%s" ASSET_PACK_HALF_SUFFIX, p);
+            ents[n].name = name;
+            ents[n].src = p;
+            ents[n].half = true;
+            n++;
+        }
+    }
+
+    uint32_t slots = 16;
+    while (slots < (uint32_t)n * 2) slots *= 2;
+    size_t names_size = 0;
+    for (int i = 0; i < n; i++) {
+        ents[i].name_off = (uint32_t)names_size;
+        names_size += strlen(ents[i].name) + 1;
+    }
+
+    const uint32_t dir_off = ASSET_PACK_HEADER_BYTES;
+    const uint32_t names_off = dir_off + slots * ASSET_PACK_SLOT_BYTES + (uint32_t)n * ASSET_PACK_ENTRY_BYTES;
+
+    // 一時ファイルに書いて rename（ゲームが書きかけを開かないように）
+    char tmp[PACK_PATH_MAX + 8];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", out_path);
+    FILE *out = fopen(tmp, "wb");
+    bool ok = out != NULL;
+
+    // 中身を先に（表は大きさが決まってから頭へ書き戻す）
+    long pos = (long)names_off + (long)names_size;
+    ok = ok && fseek(out, pos, SEEK_SET) == 0;
+    size_t raw_total = 0, packed_total = 0;
+    SizeReport rep[16];
+    int nrep = 0;
+    for (int i = 0; ok && i < n; i++) {
+        PackEntry *e = &ents[i];
+        if (!is_image(e->src)) {
+            ok = write_file(out, &pos, e);
+        } else {
+            Image full = {0}, half = {0};
+            bool premul = false;
+            uint32_t sw = 0, sh = 0;
+            const bool next_half = i + 1 < n && ents[i + 1].half;
+            ok = prepare_image(e->src, resize, next_half, &full, &half, &premul, &sw, &sh);
+            if (ok) {
+                e->flags = premul ? ASSET_PACK_PREMULTIPLIED : 0;
+                ok = write_pixels(out, &pos, e, &full, format);
+                printf("[PACK] %-48s %5ux%-5u -> %4ux%-4u%s\n", e->src, (unsigned)sw, (unsigned)sh,
+                       (unsigned)full.w, (unsigned)full.h, premul ? "  premultiplied" : "");
+                report_add(rep, &nrep, e->src, (size_t)sw * 4 * sh, (size_t)full.w * 4 * full.h,
+                           next_half ? (size_t)half.w * 4 * half.h : 0);
+            }
+            if (ok && next_half) {
+                raw_total += e->raw_size;
+                packed_total += e->size;
+                e = &ents[++i];
+                e->flags = (uint8_t)((premul ? ASSET_PACK_PREMULTIPLIED : 0) | ASSET_PACK_HALF);
+                ok = write_pixels(out, &pos, e, &half, format);
+            }
+            free(full.px);
+            free(half.px);
+        }
+        raw_total += e->raw_size;
+        packed_total += e->size;
+    }
+
+    uint8_t *head = ok ? (uint8_t*)calloc(1, names_off + names_size) : NULL;
+    ok = ok && head;
+    if (ok) {
+        memcpy(head, ASSET_PACK_MAGIC, 4);
+        head[4] = (uint8_t)ASSET_PACK_VERSION;
+        head[5] = (uint8_t)(ASSET_PACK_VERSION >> 8);
+        put_u32(head + 8, format);
+        put_u32(head + 12, (uint32_t)n);
+        put_u32(head + 16, slots);
+        put_u32(head + 20, dir_off);
+        put_u32(head + 24, names_off);
+
+        uint8_t *dir = head + dir_off;
+        uint8_t *ent = dir + (size_t)slots * ASSET_PACK_SLOT_BYTES;
+        for (int i = 0; i < n; i++) {
+            const PackEntry *e = &ents[i];
+            const uint32_t h = asset_pack_hash(e->name);
+            uint32_t s = h & (slots - 1);
+            while (get_u32(dir + (size_t)s * ASSET_PACK_SLOT_BYTES + 4) != 0) s = (s + 1) & (slots - 1);
+            put_u32(dir + (size_t)s * ASSET_PACK_SLOT_BYTES, h);
+            put_u32(dir + (size_t)s * ASSET_PACK_SLOT_BYTES + 4, (uint32_t)i + 1);
+
+            uint8_t *q = ent + (size_t)i * ASSET_PACK_ENTRY_BYTES;
+            put_u32(q, e->name_off);
+            q[4] = (uint8_t)e->kind;
+            q[5] = e->flags;
+            put_u32(q + 8, e->w);
+            put_u32(q + 12, e->h);
+            put_u32(q + 16, e->size);
+            put_u32(q + 20, e->raw_size);
+            put_u64(q + 24, e->data_off);
+            memcpy(head + names_off + e->name_off, e->name, strlen(e->name) + 1);
+        }
+        ok = fseek(out, 0, SEEK_SET) == 0 && fwrite(head, 1, names_off + names_size, out) == names_off + names_size;
+    }
+    free(head);
+    for (int i = 0; i < n; i++) {
+        if (ents[i].half) free((char*)ents[i].name);
+    }
+    free(ents);
+    if (out) ok = (fclose(out) == 0) && ok;
+    if (ok && rename(tmp, out_path) != 0) ok = false;
+    if (!ok) {
+        fprintf(stderr, "[PACK] %s: write failed\n", out_path);
+        remove(tmp);
+        return false;
+    }
+
+    size_t src_all = 0, full_all = 0, half_all = 0;
+    for (int i = 0; i < nrep; i++) {
+        printf("[PACK] texture %-16s %3d image(s)  %7.1f MB -> %6.1f MB  (half %5.1f MB)\n", rep[i].dir, rep[i].images,
+               rep[i].src / 1048576.0, rep[i].full / 1048576.0, rep[i].half / 1048576.0);
+        src_all += rep[i].src;
+        full_all += rep[i].full;
+        half_all += rep[i].half;
+    }
+    printf("[PACK] texture total                        %7.1f MB -> %6.1f MB  (half %5.1f MB)\n",
+           src_all / 1048576.0, full_all / 1048576.0, half_all / 1048576.0);
+    printf("[PACK] %s: %d entries, %s, %.1f MB → %.1f MB (%.1f MB on disk)\n",
+           out_path, n, SDL_GetPixelFormatName(format), raw_total / 1048576.0, packed_total / 1048576.0,
+           pos / 1048576.0);
+    return true;
+}
+
+// 開き直して全部引けるか（半分があるなら半分も）
+static bool pack_verify(const char *out_path, const PathList *files, bool with_half)
+{
+    if (!asset_pack_open(out_path)) return false;
+    int bad = 0, checked = 0;
+    for (int i = 0; i < files->count; i++) {
+        const char *p = files->paths[i];
+        if (is_image(p)) {
+            for (int v = 0; v <= (with_half ? 1 : 0); v++) {
+                Uint32 flags = 0;
+                asset_pack_set_variant(v ? ASSET_VARIANT_HALF : ASSET_VARIANT_FULL);
+                SDL_Surface *s = asset_pack_surface(p, &flags);
+                if (!s || (v == 1) != ((flags & ASSET_PACK_HALF) != 0)) bad++;
+                if (s) SDL_FreeSurface(s);
+                checked++;
+            }
+            asset_pack_set_variant(ASSET_VARIANT_FULL);
+        } else {
+            SDL_RWops *rw = asset_open_rw(p);
+            if (!rw) bad++;
+            else SDL_RWclose(rw);
+            checked++;
+        }
+    }
+    asset_pack_close();
+    if (bad) fprintf(stderr, "[PACK] verify: %d of %d entries unreadable\n", bad, checked);
+    else printf("[PACK] verified: %d entries\n", checked);
+    return bad == 0;
+}
+
+// ===============================
+//  計測
+// ===============================
+static double now_ms(void)
+{
+    return (double)SDL_GetPerformanceCounter() * 1000.0 / (double)SDL_GetPerformanceFrequency();
+}
+
+static void bench(const char *pack_path, const PathList *files)
+{
+    if (!asset_pack_open(pack_path)) return;
+    const Uint32 format = asset_pack_pixel_format();
+
+    for (int pass = 0; pass < 2; pass++) {
+        double t_png = 0.0, t_pack = 0.0;
+        int images = 0;
+        for (int i = 0; i < files->count; i++) {
+            const char *p = files->paths[i];
+            if (!is_image(p)) continue;
+
+            double t0 = now_ms();
+            SDL_Surface *s = IMG_Load(p);
+            SDL_Surface *c = s ? SDL_ConvertSurfaceFormat(s, format, 0) : NULL;
+            t_png += now_ms() - t0;
+            if (s) SDL_FreeSurface(s);
+            if (c) SDL_FreeSurface(c);
+
+            t0 = now_ms();
+            SDL_Surface *q = asset_pack_surface(p, NULL);
+            t_pack += now_ms() - t0;
+            if (q) SDL_FreeSurface(q);
+            images++;
+        }
+        printf("[BENCH] %s: %d images  png %.1f ms  pack %.1f ms  (x%.1f)\n",
+               pass == 0 ? "first (cold if caches were dropped)" : "warm", images, t_png, t_pack,
+               t_pack > 0.0 ? t_png / t_pack : 0.0);
+    }
+    asset_pack_close();
+}
+
+// ===============================
+//  main
+// ===============================
+// この環境の既定 renderer がそのまま受け取れる 32bit 形式
+static Uint32 native_format(void)
+{
+    Uint32 format = SDL_PIXELFORMAT_ARGB8888;
+    if (SDL_InitSubSystem(SDL_INIT_VIDEO) != 0) return format;
+    SDL_Window *w = SDL_CreateWindow("asset_pack", 0, 0, 16, 16, SDL_WINDOW_HIDDEN);
+    SDL_Renderer *r = w ? SDL_CreateRenderer(w, -1, 0) : NULL;
+    SDL_RendererInfo info;
+    if (r && SDL_GetRendererInfo(r, &info) == 0) {
+        for (Uint32 i = 0; i < info.num_texture_formats; i++) {
+            const Uint32 f = info.texture_formats[i];
+            if (!SDL_ISPIXELFORMAT_FOURCC(f) && SDL_BYTESPERPIXEL(f) == 4 && SDL_ISPIXELFORMAT_ALPHA(f)) {
+                format = f;
+                break;
+            }
+        }
+    }
+    if (r) SDL_DestroyRenderer(r);
+    if (w) SDL_DestroyWindow(w);
+    SDL_QuitSubSystem(SDL_INIT_VIDEO);
+    return format;
+}
+
+int main(int argc, char **argv)
+{
+    const char *out_path = ASSET_PACK_PATH;
+    const char *format_name = "native";
+    bool do_bench = false, with_half = false, resize = true;
+    PathList files = {0};
+    int dirs = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) out_path = argv[++i];
+        else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) format_name = argv[++i];
+        else if (strcmp(argv[i], "--bench") == 0) do_bench = true;
+        else if (strcmp(argv[i], "--half") == 0) with_half = true;
+        else if (strcmp(argv[i], "--no-resize") == 0) resize = false;
+        else {
+            collect(&files, argv[i]);
+            dirs++;
+        }
+    }
+    if (dirs == 0) {
+        for (size_t i = 0; i < sizeof(k_default_dirs) / sizeof(k_default_dirs[0]); i++) collect(&files, k_default_dirs[i]);
+    }
+    if (files.count == 0) {
+        fprintf(stderr, "[PACK] nothing to pack (run from the repository root)\n");
+        return 1;
+    }
+    qsort(files.paths, (size_t)files.count, sizeof(char*), cmp_path);
+
+    if (SDL_Init(0) < 0 || !(IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG)) {
+        fprintf(stderr, "SDL/IMG init failed: %s\n", SDL_GetError());
+        return 1;
+    }
+
+    int rc = 0;
+    if (do_bench) {
+        bench(out_path, &files);
+    } else {
+        Uint32 format = SDL_PIXELFORMAT_ARGB8888;
+        if (strcmp(format_name, "abgr") == 0) format = SDL_PIXELFORMAT_ABGR8888;
+        else if (strcmp(format_name, "native") == 0) format = native_format();
+        else if (strcmp(format_name, "argb") != 0) {
+            fprintf(stderr, "unknown --format %s (native|argb|abgr)\n", format_name);
+            return 2;
+        }
+        if (!pack_write(out_path, &files, format, resize, with_half) || !pack_verify(out_path, &files, with_half)) rc = 1;
+    }
+
+    for (int i = 0; i < files.count; i++) free(files.paths[i]);
+    free(files.paths);
+    IMG_Quit();
+    SDL_Quit();
+    return rc;
+}
@@ -0,0 +1,670 @@
+// tools/balance_sweep.c — girl 同士の勝率マトリクス（バランス検証）
+//
+//   ./tools/balance_sweep [--girls himari,kiritan,sayo,girl] [--points N] [--games N]
+//                         [--threads N] [--depth N] [--tt-mb N] [--eps PERCENT] [--max-turns N]
+//                         [--seed N] [--csv PATH] [--json PATH] [--checkpoint PATH] [--defs PATH]
+//                         [--stages DIR] [--analytics PREFIX]
+//
+//   - 配分グリッド：--points の配分ポイントを alloc_rules.h のブロック単位で
+//     使い切った配分（残りでどのブロックも買えないもの）。好感度50以上ならタッグ技あり/なしも
+//   - セル = (girlA, 配分i) vs (girlB, 配分j)。A/B を入れ替えたセルは勝率を反転すればよいので1回だけ回す
+//     1セル --games 戦、先手（P1）/後手を交互に入れ替える
+//   - ステージは --stages のカタログ（既定 assets/stages）を対戦番号で順に回す（先後を入れ替えた2戦は同じステージ）。
+//     対戦の乱数キーは本番と同じ（battle_replay_match_seed）。カタログの中身が変わればチェックポイントは別物
+//   - AI 同士（greedy。--depth>=1 で先読み探索）。--eps % の確率でそのターンの手を候補からランダムに選ぶ
+//     乱数はセル番号と対戦番号から決めるので、スレッド数や再開の有無で結果は変わらない
+//   - 勝率は引き分けを 0.5 勝として数え、Wilson スコア区間（95%）を付ける
+//   - セルが終わるたびに --checkpoint に1行追記する。同じ設定で再実行すると続きから回す
+//   - 技/キャラ定義は --defs の .bin（既定 assets/data/battle_defs.bin）。txt を直して make defs すれば
+//     再ビルドなしで回し直せる（定義の中身が変わればチェックポイントは別物として扱う）
+//   - --analytics を付けると全対戦のイベントを PREFIX.<スレッド番号>.tvsa に書く（tools/battle_query で集計）
+//     対戦番号 = セル番号 × --games + 対戦番号（結果には影響しないのでチェックポイントの設定には含めない）
+//     途中のチェックポイントから再開するときは付けられない（ファイルを作り直すと前回の分が消え、欠けた集計になるため）
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "battle/tvse_battle.h"
+
+#define SWEEP_GIRL_MAX 8
+
+// ===============================
+//  配分グリッド
+// ===============================
+enum { ST_HP = 0, ST_ATK, ST_SPD, ST_ST, ST_COUNT };
+
+typedef struct {
+    int blocks[ST_COUNT];
+    bool tag;
+    char label[32];
+} Alloc;
+
+static int block_cost(int s)
+{
+    switch (s) {
+    case ST_HP:  return ALLOC_BLOCK_UNIT_HP  * ALLOC_COST_HP;
+    case ST_ATK: return ALLOC_BLOCK_UNIT_ATK * ALLOC_COST_ATK;
+    case ST_SPD: return ALLOC_BLOCK_UNIT_SPD * ALLOC_COST_SPD;
+    default:     return ALLOC_BLOCK_UNIT_ST  * ALLOC_COST_ST;
+    }
+}
+
+// budget を使い切る配分を列挙（out=NULL なら数えるだけ）
+static int enum_allocs_rec(int s, int budget, int blocks[ST_COUNT], bool tag, Alloc *out, int n)
+{
+    if (s == ST_COUNT) {
+        int min_cost = block_cost(0);
+        for (int k = 1; k < ST_COUNT; k++) if (block_cost(k) < min_cost) min_cost = block_cost(k);
+        if (budget >= min_cost) return n;   // まだ買える＝使い切っていない
+
+        if (out) {
+            Alloc *a = &out[n];
+            memcpy(a->blocks, blocks, sizeof(a->blocks));
+            a->tag = tag;
+            snprintf(a->label, sizeof(a->label), "H%dA%dS%dT%d%s",
+                     blocks[ST_HP], blocks[ST_ATK], blocks[ST_SPD], blocks[ST_ST], tag ? "+tag" : "");
+        }
+        return n + 1;
+    }
+    for (int k = 0; k * block_cost(s) <= budget; k++) {
+        blocks[s] = k;
+        n = enum_allocs_rec(s + 1, budget - k * block_cost(s), blocks, tag, out, n);
+    }
+    blocks[s] = 0;
+    return n;
+}
+
+static int enum_allocs(int points, Alloc *out)
+{
+    int blocks[ST_COUNT] = { 0 };
+    int n = enum_allocs_rec(0, points, blocks, false, out, 0);
+    if (points >= ALLOC_TAG_UNLOCK_AFFECTION) {
+        n = enum_allocs_rec(0, points - ALLOC_TAG_COST, blocks, true, out, n);
+    }
+    return n;
+}
+
+static void make_info(const GirlBase *g, const Alloc *a, NetGameInfo *out)
+{
+    memset(out, 0, sizeof(*out));
+    snprintf(out->girl_id, sizeof(out->girl_id), "%s", g->girl_id);
+    out->hp_base  = (int16_t)g->hp;
+    out->atk_base = (int16_t)g->atk;
+    out->sp_base  = (int16_t)g->sp;
+    out->st_base  = (int16_t)g->st;
+    out->hp_add  = (int16_t)(a->blocks[ST_HP]  * ALLOC_BLOCK_UNIT_HP);
+    out->atk_add = (int16_t)(a->blocks[ST_ATK] * ALLOC_BLOCK_UNIT_ATK);
+    out->sp_add  = (int16_t)(a->blocks[ST_SPD] * ALLOC_BLOCK_UNIT_SPD);
+    out->st_add  = (int16_t)(a->blocks[ST_ST]  * ALLOC_BLOCK_UNIT_ST);
+    out->tag_learned = a->tag ? 1 : 0;
+    out->move_range = (uint8_t)g->move_range;
+}
+
+// ===============================
+//  設定 / 結果
+// ===============================
+typedef struct {
+    const GirlBase *girls[SWEEP_GIRL_MAX];
+    int girl_count;
+    int points;
+    int games;
+    int threads;
+    int depth;
+    int tt_mb;
+    int eps_pct;
+    int max_turns;
+    unsigned seed;
+    const char *csv_path;
+    const char *json_path;
+    const char *ckpt_path;
+    const char *analytics_prefix;   // NULL = 記録しない
+} SweepConfig;
+
+typedef struct {
+    int ga, ia, gb, ib;     // (girl, 配分)。(ga,ia) <= (gb,ib)
+    bool done;
+    int games, wins_a, wins_b, draws;
+    long long turns_sum;
+} Cell;
+
+typedef struct {
+    const SweepConfig *cfg;
+    const Alloc *allocs;
+    int alloc_count;
+
+    Cell *cells;
+    int cell_count;
+
+    pthread_mutex_t mu;
+    int next;            // 次に配るセル（cells の index）
+    int finished;        // 今回の実行で終えたセル数
+    int pending;         // 今回の実行で回すセル数
+    int workers;         // 立ち上がったスレッド数（分析ファイルの番号）
+    bool analytics_failed;
+    FILE *ckpt;
+    double t_start;
+} Sweep;
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// Wilson スコア区間（z=1.96）
+static void wilson(double score, int n, double *lo, double *hi)
+{
+    if (n <= 0) { *lo = 0.0; *hi = 1.0; return; }
+    const double z = 1.96;
+    double p = score / n;
+    double d = 1.0 + z * z / n;
+    double c = (p + z * z / (2.0 * n)) / d;
+    double h = z * sqrt(p * (1.0 - p) / n + z * z / (4.0 * n * (double)n)) / d;
+    *lo = c - h < 0.0 ? 0.0 : c - h;
+    *hi = c + h > 1.0 ? 1.0 : c + h;
+}
+
+// ===============================
+//  対戦
+// ===============================
+typedef struct {
+    BattleTT tt;
+    bool has_tt;
+    TurnCmd *cand;       // BATTLE_AI_CAND_MAX
+    BattleAnalytics *an; // --analytics のときだけ
+} Worker;
+
+// ランダム手は (seed, ターン, チーム) で引く（どのスレッド/順番で回しても同じ対戦になる）
+static void choose_cmd(const SweepConfig *cfg, Worker *w, const BattleCore *b, Team team,
+                       uint64_t seed, TurnCmd *out)
+{
+    if (battle_rng_chance(seed, b->turn, team, BRNG_AI, 0, cfg->eps_pct)) {
+        int n = battle_ai_gen_candidates(b, team, w->cand, BATTLE_AI_CAND_MAX);
+        if (n > 0) {
+            *out = w->cand[battle_rng_below(seed, b->turn, team, BRNG_AI, 1, (uint32_t)n)];
+            return;
+        }
+    }
+    if (cfg->depth >= 1) {
+        BattleAiParams p = { .depth = cfg->depth, .tt = w->has_tt ? &w->tt : NULL };
+        battle_ai_search(b, team, &p, NULL, out);
+    } else {
+        battle_ai_greedy_cmd(b, team, out);
+    }
+}
+
+// 戻り値：0=P1勝ち 1=P2勝ち 2=引き分け（相打ち/ターン上限）
+static int play_game(const SweepConfig *cfg, Worker *w, const NetGameInfo *p1, const NetGameInfo *p2,
+                     int game, uint64_t seed, uint32_t battle_id, int *out_turns)
+{
+    BattleCore b;
+    battle_replay_setup_core(&b, p1, p2);
+    b.rng_seed = battle_replay_match_seed(p1, p2);
+    b.stage = battle_stage_rotation(game);
+    if (w->an) battle_analytics_begin_battle(w->an, &b, battle_id);
+
+    int t = 0;
+    while (t < cfg->max_turns && b.phase != BPHASE_END) {
+        TurnCmd c1, c2;
+        choose_cmd(cfg, w, &b, TEAM_P1, seed, &c1);
+        choose_cmd(cfg, w, &b, TEAM_P2, seed, &c2);
+        if (!battle_core_run_turn(&b, &c1, &c2)) break;
+        if (w->an) battle_analytics_collect(w->an, &b);
+        t++;
+    }
+
+    int r = 2;
+    if (b.phase == BPHASE_END) {
+        bool d1 = !b.units[0].alive && !b.units[1].alive;
+        bool d2 = !b.units[2].alive && !b.units[3].alive;
+        if (d2 && !d1) r = 0;
+        else if (d1 && !d2) r = 1;
+    }
+    battle_core_free(&b);
+    *out_turns = t;
+    return r;
+}
+
+static void run_cell(Sweep *sw, Worker *w, int ci, Cell *res)
+{
+    const SweepConfig *cfg = sw->cfg;
+    NetGameInfo ia, ib;
+    make_info(cfg->girls[res->ga], &sw->allocs[res->ia], &ia);
+    make_info(cfg->girls[res->gb], &sw->allocs[res->ib], &ib);
+
+    res->games = res->wins_a = res->wins_b = res->draws = 0;
+    res->turns_sum = 0;
+    for (int g = 0; g < cfg->games; g++) {
+        uint64_t seed = ((uint64_t)cfg->seed << 32) ^ ((uint64_t)(unsigned)ci * 0x100000001B3ull) ^ (uint64_t)g;
+        bool a_first = (g % 2) == 0;
+        uint32_t id = (uint32_t)ci * (uint32_t)cfg->games + (uint32_t)g;
+        int turns = 0;
+        int r = a_first ? play_game(cfg, w, &ia, &ib, g, seed, id, &turns)
+                        : play_game(cfg, w, &ib, &ia, g, seed, id, &turns);
+        if (r == 2) res->draws++;
+        else if ((r == 0) == a_first) res->wins_a++;
+        else res->wins_b++;
+        res->games++;
+        res->turns_sum += turns;
+    }
+}
+
+static void* sweep_worker(void *arg)
+{
+    Sweep *sw = (Sweep*)arg;
+    const SweepConfig *cfg = sw->cfg;
+
+    Worker w;
+    memset(&w, 0, sizeof(w));
+    w.cand = (TurnCmd*)malloc(sizeof(TurnCmd) * BATTLE_AI_CAND_MAX);
+    if (!w.cand) return NULL;
+    if (cfg->depth >= 1 && cfg->tt_mb > 0) w.has_tt = battle_tt_init(&w.tt, (size_t)cfg->tt_mb);
+
+    pthread_mutex_lock(&sw->mu);
+    int wi = sw->workers++;
+    pthread_mutex_unlock(&sw->mu);
+    if (cfg->analytics_prefix) {
+        char path[512];
+        snprintf(path, sizeof(path), "%s.%d.tvsa", cfg->analytics_prefix, wi);
+        w.an = battle_analytics_open(path, 0);
+        if (!w.an) {
+            fprintf(stderr, "cannot open analytics file: %s\n", path);
+            pthread_mutex_lock(&sw->mu);
+            sw->analytics_failed = true;
+            pthread_mutex_unlock(&sw->mu);
+        }
+    }
+
+    for (;;) {
+        pthread_mutex_lock(&sw->mu);
+        while (sw->next < sw->cell_count && sw->cells[sw->next].done) sw->next++;
+        int ci = sw->next++;
+        pthread_mutex_unlock(&sw->mu);
+        if (ci >= sw->cell_count) break;
+
+        Cell res = sw->cells[ci];
+        if (w.has_tt) battle_tt_clear(&w.tt);
+        run_cell(sw, &w, ci, &res);
+        res.done = true;
+
+        pthread_mutex_lock(&sw->mu);
+        sw->cells[ci] = res;
+        sw->finished++;
+        if (sw->ckpt) {
+            fprintf(sw->ckpt, "cell %d %d %d %d %d %lld\n",
+                    ci, res.games, res.wins_a, res.wins_b, res.draws, res.turns_sum);
+            fflush(sw->ckpt);
+        }
+        double el = now_sec() - sw->t_start;
+        fprintf(stderr, "\r[sweep] %d/%d cells  %.0fs elapsed  ~%.0fs left   ",
+                sw->finished, sw->pending, el,
+                el / sw->finished * (sw->pending - sw->finished));
+        pthread_mutex_unlock(&sw->mu);
+    }
+
+    if (w.an) {
+        BattleAnalyticsStats st;
+        bool ok = battle_analytics_close(w.an, &st);
+        pthread_mutex_lock(&sw->mu);
+        if (!ok || st.lost) sw->analytics_failed = true;
+        pthread_mutex_unlock(&sw->mu);
+    }
+    if (w.has_tt) battle_tt_free(&w.tt);
+    free(w.cand);
+    return NULL;
+}
+
+// ===============================
+//  チェックポイント
+// ===============================
+// 結果に効く設定だけを並べる（threads 等は含めない）
+static void config_signature(const SweepConfig *cfg, char *out, size_t cap)
+{
+    int n = snprintf(out, cap, "v4 defs=%08x stages=%08x points=%d games=%d depth=%d eps=%d max_turns=%d seed=%u girls=",
+                     (unsigned)battle_defs_checksum(), (unsigned)battle_stage_catalog_checksum(),
+                     cfg->points, cfg->games, cfg->depth, cfg->eps_pct, cfg->max_turns, cfg->seed);
+    for (int g = 0; g < cfg->girl_count && n > 0 && (size_t)n < cap; g++) {
+        n += snprintf(out + n, cap - (size_t)n, "%s%s", g ? "," : "", cfg->girls[g]->girl_id);
+    }
+}
+
+// 戻り値：読み込んだセル数（-1=設定が違う）
+static int checkpoint_load(Sweep *sw, const char *sig)
+{
+    FILE *fp = fopen(sw->cfg->ckpt_path, "r");
+    if (!fp) return 0;
+
+    char line[512];
+    int loaded = 0;
+    if (!fgets(line, sizeof(line), fp)) { fclose(fp); return 0; }
+    line[strcspn(line, "\r\n")] = '\0';
+    if (strncmp(line, "# ", 2) != 0 || strcmp(line + 2, sig) != 0) { fclose(fp); return -1; }
+
+    while (fgets(line, sizeof(line), fp)) {
+        int ci, games, wa, wb, dr;
+        long long ts;
+        // 書きかけの行（中断時）は読み捨てる
+        if (sscanf(line, "cell %d %d %d %d %d %lld", &ci, &games, &wa, &wb, &dr, &ts) != 6) continue;
+        if (!strchr(line, '\n')) continue;
+        if (ci < 0 || ci >= sw->cell_count || games != sw->cfg->games) continue;
+
+        Cell *c = &sw->cells[ci];
+        if (!c->done) loaded++;
+        c->done = true;
+        c->games = games;
+        c->wins_a = wa;
+        c->wins_b = wb;
+        c->draws = dr;
+        c->turns_sum = ts;
+    }
+    fclose(fp);
+    return loaded;
+}
+
+// ===============================
+//  出力
+// ===============================
+static double cell_score_a(const Cell *c)
+{
+    return c->wins_a + 0.5 * c->draws;
+}
+
+static bool write_csv(const Sweep *sw, const char *path)
+{
+    FILE *fp = fopen(path, "w");
+    if (!fp) return false;
+    fprintf(fp, "girl_a,alloc_a,girl_b,alloc_b,games,wins_a,wins_b,draws,score_a,ci95_lo,ci95_hi,avg_turns\n");
+    for (int i = 0; i < sw->cell_count; i++) {
+        const Cell *c = &sw->cells[i];
+        if (!c->done) continue;
+        double lo, hi;
+        wilson(cell_score_a(c), c->games, &lo, &hi);
+        fprintf(fp, "%s,%s,%s,%s,%d,%d,%d,%d,%.4f,%.4f,%.4f,%.1f\n",
+                sw->cfg->girls[c->ga]->girl_id, sw->allocs[c->ia].label,
+                sw->cfg->girls[c->gb]->girl_id, sw->allocs[c->ib].label,
+                c->games, c->wins_a, c->wins_b, c->draws,
+                c->games ? cell_score_a(c) / c->games : 0.0, lo, hi,
+                c->games ? (double)c->turns_sum / c->games : 0.0);
+    }
+    fclose(fp);
+    return true;
+}
+
+// girl × girl の集計（配分はすべて合算。行 girl から見たスコア）
+static void girl_matrix(const Sweep *sw, double score[SWEEP_GIRL_MAX][SWEEP_GIRL_MAX],
+                        int games[SWEEP_GIRL_MAX][SWEEP_GIRL_MAX])
+{
+    memset(score, 0, sizeof(double) * SWEEP_GIRL_MAX * SWEEP_GIRL_MAX);
+    memset(games, 0, sizeof(int) * SWEEP_GIRL_MAX * SWEEP_GIRL_MAX);
+    for (int i = 0; i < sw->cell_count; i++) {
+        const Cell *c = &sw->cells[i];
+        if (!c->done) continue;
+        double sa = cell_score_a(c);
+        score[c->ga][c->gb] += sa;
+        games[c->ga][c->gb] += c->games;
+        score[c->gb][c->ga] += c->games - sa;
+        games[c->gb][c->ga] += c->games;
+    }
+}
+
+static bool write_json(const Sweep *sw, const char *path)
+{
+    const SweepConfig *cfg = sw->cfg;
+    FILE *fp = fopen(path, "w");
+    if (!fp) return false;
+
+    fprintf(fp, "{\n  \"config\": {\"points\": %d, \"games\": %d, \"depth\": %d, \"eps_pct\": %d, "
+                "\"max_turns\": %d, \"seed\": %u},\n",
+            cfg->points, cfg->games, cfg->depth, cfg->eps_pct, cfg->max_turns, cfg->seed);
+
+    fprintf(fp, "  \"girls\": [");
+    for (int g = 0; g < cfg->girl_count; g++) fprintf(fp, "%s\"%s\"", g ? ", " : "", cfg->girls[g]->girl_id);
+    fprintf(fp, "],\n  \"allocs\": [");
+    for (int a = 0; a < sw->alloc_count; a++) fprintf(fp, "%s\"%s\"", a ? ", " : "", sw->allocs[a].label);
+    fprintf(fp, "],\n");
+
+    double score[SWEEP_GIRL_MAX][SWEEP_GIRL_MAX];
+    int games[SWEEP_GIRL_MAX][SWEEP_GIRL_MAX];
+    girl_matrix(sw, score, games);
+    fprintf(fp, "  \"matrix\": {\"score\": [");
+    for (int r = 0; r < cfg->girl_count; r++) {
+        fprintf(fp, "%s[", r ? ", " : "");
+        for (int c = 0; c < cfg->girl_count; c++) {
+            fprintf(fp, "%s%.4f", c ? ", " : "", games[r][c] ? score[r][c] / games[r][c] : 0.0);
+        }
+        fprintf(fp, "]");
+    }
+    fprintf(fp, "], \"ci95\": [");
+    for (int r = 0; r < cfg->girl_count; r++) {
+        fprintf(fp, "%s[", r ? ", " : "");
+        for (int c = 0; c < cfg->girl_count; c++) {
+            double lo, hi;
+            wilson(score[r][c], games[r][c], &lo, &hi);
+            fprintf(fp, "%s[%.4f, %.4f]", c ? ", " : "", lo, hi);
+        }
+        fprintf(fp, "]");
+    }
+    fprintf(fp, "], \"games\": [");
+    for (int r = 0; r < cfg->girl_count; r++) {
+        fprintf(fp, "%s[", r ? ", " : "");
+        for (int c = 0; c < cfg->girl_count; c++) fprintf(fp, "%s%d", c ? ", " : "", games[r][c]);
+        fprintf(fp, "]");
+    }
+    fprintf(fp, "]},\n");
+
+    fprintf(fp, "  \"cells\": [\n");
+    bool first = true;
+    for (int i = 0; i < sw->cell_count; i++) {
+        const Cell *c = &sw->cells[i];
+        if (!c->done) continue;
+        double lo, hi;
+        wilson(cell_score_a(c), c->games, &lo, &hi);
+        fprintf(fp, "%s    {\"a\": \"%s\", \"alloc_a\": \"%s\", \"b\": \"%s\", \"alloc_b\": \"%s\", "
+                    "\"games\": %d, \"wins_a\": %d, \"wins_b\": %d, \"draws\": %d, "
+                    "\"score_a\": %.4f, \"ci95\": [%.4f, %.4f], \"avg_turns\": %.1f}",
+                first ? "" : ",\n",
+                cfg->girls[c->ga]->girl_id, sw->allocs[c->ia].label,
+                cfg->girls[c->gb]->girl_id, sw->allocs[c->ib].label,
+                c->games, c->wins_a, c->wins_b, c->draws,
+                c->games ? cell_score_a(c) / c->games : 0.0, lo, hi,
+                c->games ? (double)c->turns_sum / c->games : 0.0);
+        first = false;
+    }
+    fprintf(fp, "\n  ]\n}\n");
+    fclose(fp);
+    return true;
+}
+
+static void print_summary(const Sweep *sw)
+{
+    const SweepConfig *cfg = sw->cfg;
+    double score[SWEEP_GIRL_MAX][SWEEP_GIRL_MAX];
+    int games[SWEEP_GIRL_MAX][SWEEP_GIRL_MAX];
+    girl_matrix(sw, score, games);
+
+    printf("score (row vs col, draw=0.5, 95%% CI)\n%-10s", "");
+    for (int c = 0; c < cfg->girl_count; c++) printf(" %-20s", cfg->girls[c]->girl_id);
+    printf("\n");
+    for (int r = 0; r < cfg->girl_count; r++) {
+        printf("%-10s", cfg->girls[r]->girl_id);
+        for (int c = 0; c < cfg->girl_count; c++) {
+            double lo, hi;
+            wilson(score[r][c], games[r][c], &lo, &hi);
+            char buf[32];
+            snprintf(buf, sizeof(buf), "%.3f [%.3f,%.3f]", games[r][c] ? score[r][c] / games[r][c] : 0.0, lo, hi);
+            printf(" %-20s", buf);
+        }
+        printf("\n");
+    }
+}
+
+// ===============================
+//  main
+// ===============================
+static int arg_int(int argc, char **argv, const char *name, int fallback)
+{
+    for (int i = 0; i + 1 < argc; i++) {
+        if (strcmp(argv[i], name) == 0) return atoi(argv[i + 1]);
+    }
+    return fallback;
+}
+
+static const char* arg_str(int argc, char **argv, const char *name, const char *fallback)
+{
+    for (int i = 0; i + 1 < argc; i++) {
+        if (strcmp(argv[i], name) == 0) return argv[i + 1];
+    }
+    return fallback;
+}
+
+static bool parse_girls(const char *list, SweepConfig *cfg)
+{
+    char buf[256];
+    snprintf(buf, sizeof(buf), "%s", list);
+    cfg->girl_count = 0;
+    for (char *tok = strtok(buf, ","); tok; tok = strtok(NULL, ",")) {
+        const GirlBase *hit = NULL;
+        for (int i = 0; i < girl_base_count(); i++) {
+            if (strcmp(girl_base_at(i)->girl_id, tok) == 0) hit = girl_base_at(i);
+        }
+        if (!hit) {
+            fprintf(stderr, "unknown girl: %s\n", tok);
+            return false;
+        }
+        if (cfg->girl_count >= SWEEP_GIRL_MAX) return false;
+        cfg->girls[cfg->girl_count++] = hit;
+    }
+    return cfg->girl_count > 0;
+}
+
+int main(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            fprintf(stderr,
+                    "usage: %s [--girls himari,kiritan,sayo,girl] [--points N] [--games N]\n"
+                    "          [--threads N] [--depth N] [--tt-mb N] [--eps PERCENT] [--max-turns N]\n"
+                    "          [--seed N] [--csv PATH] [--json PATH] [--checkpoint PATH] [--defs PATH]\n"
+                    "          [--stages DIR] [--analytics PREFIX]\n",
+                    argv[0]);
+            return 2;
+        }
+    }
+
+    if (!battle_defs_load(arg_str(argc, argv, "--defs", BATTLE_DEFS_PATH))) return 1;
+    int stage_count = battle_stage_catalog_load(arg_str(argc, argv, "--stages", "assets/stages"));
+
+    SweepConfig cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    if (!parse_girls(arg_str(argc, argv, "--girls", "himari,kiritan,sayo," CHAR_DEF_FALLBACK_ID), &cfg)) return 2;
+    cfg.points    = arg_int(argc, argv, "--points", ALLOC_DEFAULT_AFFECTION);
+    cfg.games     = arg_int(argc, argv, "--games", 200);
+    cfg.threads   = arg_int(argc, argv, "--threads", (int)sysconf(_SC_NPROCESSORS_ONLN));
+    cfg.depth     = arg_int(argc, argv, "--depth", 0);
+    cfg.tt_mb     = arg_int(argc, argv, "--tt-mb", 16);
+    cfg.eps_pct   = arg_int(argc, argv, "--eps", 15);
+    cfg.max_turns = arg_int(argc, argv, "--max-turns", 200);
+    cfg.seed      = (unsigned)arg_int(argc, argv, "--seed", 1);
+    cfg.csv_path  = arg_str(argc, argv, "--csv", "balance_sweep.csv");
+    cfg.json_path = arg_str(argc, argv, "--json", "balance_sweep.json");
+    cfg.ckpt_path = arg_str(argc, argv, "--checkpoint", "balance_sweep.ckpt");
+    cfg.analytics_prefix = arg_str(argc, argv, "--analytics", NULL);
+    if (cfg.points < 0) cfg.points = 0;
+    if (cfg.games < 1) cfg.games = 1;
+    if (cfg.threads < 1) cfg.threads = 1;
+    if (cfg.max_turns < 1) cfg.max_turns = 1;
+
+    Sweep sw;
+    memset(&sw, 0, sizeof(sw));
+    sw.cfg = &cfg;
+    sw.alloc_count = enum_allocs(cfg.points, NULL);
+    Alloc *allocs = (Alloc*)calloc((size_t)sw.alloc_count, sizeof(Alloc));
+    if (!allocs) return 1;
+    enum_allocs(cfg.points, allocs);
+    sw.allocs = allocs;
+
+    // (girl, 配分) を1つの番号にして、番号の小さい側を A にしたペアだけを並べる
+    int keys = cfg.girl_count * sw.alloc_count;
+    sw.cell_count = keys * (keys + 1) / 2;
+    sw.cells = (Cell*)calloc((size_t)sw.cell_count, sizeof(Cell));
+    if (!sw.cells) return 1;
+    for (int ka = 0, ci = 0; ka < keys; ka++) {
+        for (int kb = ka; kb < keys; kb++, ci++) {
+            Cell *c = &sw.cells[ci];
+            c->ga = ka / sw.alloc_count;
+            c->ia = ka % sw.alloc_count;
+            c->gb = kb / sw.alloc_count;
+            c->ib = kb % sw.alloc_count;
+        }
+    }
+
+    char sig[256];
+    config_signature(&cfg, sig, sizeof(sig));
+    int resumed = checkpoint_load(&sw, sig);
+    if (resumed < 0) {
+        fprintf(stderr, "checkpoint %s was written with different settings (delete it or use --checkpoint)\n",
+                cfg.ckpt_path);
+        return 1;
+    }
+    if (resumed > 0 && cfg.analytics_prefix) {
+        fprintf(stderr, "checkpoint %s already has %d cells; --analytics needs a fresh run "
+                        "(delete it or use another --checkpoint)\n", cfg.ckpt_path, resumed);
+        return 1;
+    }
+
+    sw.pending = 0;
+    for (int i = 0; i < sw.cell_count; i++) sw.pending += !sw.cells[i].done;
+
+    printf("[sweep] girls=%d allocs=%d (points=%d) cells=%d games/cell=%d stages=%d threads=%d depth=%d eps=%d%%\n",
+           cfg.girl_count, sw.alloc_count, cfg.points, sw.cell_count, cfg.games, stage_count,
+           cfg.threads, cfg.depth, cfg.eps_pct);
+    if (resumed > 0) printf("  resumed %d cells from %s\n", resumed, cfg.ckpt_path);
+
+    if (sw.pending > 0) {
+        bool fresh = (resumed == 0);
+        sw.ckpt = fopen(cfg.ckpt_path, fresh ? "w" : "a");
+        if (!sw.ckpt) {
+            fprintf(stderr, "cannot open checkpoint: %s\n", cfg.ckpt_path);
+            return 1;
+        }
+        if (fresh) {
+            fprintf(sw.ckpt, "# %s\n", sig);
+            fflush(sw.ckpt);
+        }
+
+        pthread_mutex_init(&sw.mu, NULL);
+        sw.t_start = now_sec();
+        pthread_t *th = (pthread_t*)calloc((size_t)cfg.threads, sizeof(pthread_t));
+        if (!th) return 1;
+        for (int i = 0; i < cfg.threads; i++) pthread_create(&th[i], NULL, sweep_worker, &sw);
+        for (int i = 0; i < cfg.threads; i++) pthread_join(th[i], NULL);
+        free(th);
+        pthread_mutex_destroy(&sw.mu);
+        fclose(sw.ckpt);
+
+        double el = now_sec() - sw.t_start;
+        fprintf(stderr, "\n");
+        printf("  %d cells in %.1fs (%.0f games/s)\n",
+               sw.finished, el, el > 0.0 ? (double)sw.finished * cfg.games / el : 0.0);
+        if (cfg.analytics_prefix) {
+            printf("  analytics: %s.0..%d.tvsa%s\n", cfg.analytics_prefix, sw.workers - 1,
+                   sw.analytics_failed ? " (write failed or events lost)" : "");
+        }
+    }
+
+    print_summary(&sw);
+
+    bool ok = true;
+    if (!write_csv(&sw, cfg.csv_path)) { fprintf(stderr, "write failed: %s\n", cfg.csv_path); ok = false; }
+    if (!write_json(&sw, cfg.json_path)) { fprintf(stderr, "write failed: %s\n", cfg.json_path); ok = false; }
+    if (ok) printf("  wrote %s, %s\n", cfg.csv_path, cfg.json_path);
+
+    free(sw.cells);
+    free(allocs);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,1957 @@
+// tools/battle_bench.c — battle/ のヘッドレスベンチマーク
+//
+//   ./tools/battle_bench search [--depth N] [--positions N] [--tt-mb N] [--threads N]
+//   ./tools/battle_bench replay [--turns N] [--seeks N] [--out PATH]
+//   ./tools/battle_bench batch  [--battles N] [--turns N]
+//   ./tools/battle_bench alloc  [--girl ID] [--points N] [--generations N] [--threads N]
+//   ./tools/battle_bench rng    [--draws N] [--threads N]
+//   ./tools/battle_bench preview [--positions N]
+//   ./tools/battle_bench threat [--positions N]
+//   ./tools/battle_bench stage  [--dir PATH] [--queries N] [--battles N]
+//   ./tools/battle_bench defs   [--src PATH] [--lookups N]
+//   ./tools/battle_bench stress [--cores N] [--threads N] [--live N] [--turns N]
+//   ./tools/battle_bench units  [--battles N] [--turns N] [--queries N]
+//   ./tools/battle_bench analytics [--battles N] [--turns N] [--out PATH]
+//   ./tools/battle_bench undo   [--positions N] [--turns N]
+//
+//   search : greedy 同士の対戦から局面を集め、AI探索を 置換表なし/あり で比較する
+//   replay : 長い対戦を記録→保存→読込し、全ターンのシーク結果を照合してシーク時間を測る
+//   batch  : ランダムな対戦を battle_core_run_turn とバッチ解決で並走させ、毎ターン全状態を照合して
+//            対戦/秒 を比較する
+//   alloc  : 配分最適化を指定世代ぶん回し、世代ごとの1位とスレッド数による速度を見る
+//   rng    : Philox の既知解照合、引く速さ、スレッド数/引く順を変えても値が一致するかの確認
+//   preview: 作戦プレビューを実際のターン解決と照合し、1回あたりの時間（目標 50us 未満）を測る
+//   threat : 脅威マップの差分更新（ターン送り / 1体だけ移動）を全作り直しと照合して速さを比べる
+//   stage  : ステージの前計算時間、到達判定（距離表 vs 毎回 BFS）/見通し判定の照合と速さ、
+//            greedy 同士の対戦で AI の移動が壁に阻まれないかの確認
+//   defs   : 技/キャラ定義の .bin の読み込み時間、引く速さ、読み直し（値が変わり、ポインタは動かない）の確認
+//   stress : 多数の対戦（コア・脅威マップ・リプレイ記録つき）をスレッドごとに複数同時に進め、
+//            1スレッド1対戦ずつの結果と照合する。置換表は全スレッドで共有。make tsan は TSan 付きでこれを回す
+//   units  : 4/8/32 体の対戦で 行動順（旧：選択ソート vs ネットワーク/基数ソート）と AOE の対象探し
+//            （全走査 vs バケット）を照合して速さを比べ、ターン/秒 を測る
+//            32 体は BATTLE_TEAM_MAX>=16 のビルドだけ（make bench-wide）
+//   analytics: ランダムな対戦を 記録なし/あり で回して記録の重さを測り、書いた .tvsa を読み直して
+//            技ごとの集計を、対戦中にイベントから直接数えた値と照合する（集計の速さも測る）
+//   undo   : 長い対戦の逆再生（scrub）を、ターンごとのスナップショットと 変更の記録（battle_core_undo_to）で
+//            比べ、戻した局面を照合する。探索の戻り（1ターン進めて戻す。深さ1/2）も参考に測る
+//            （こちらは値コピーの方が速い。battle_ai_search が値コピーのままなのはこのため）
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "battle/tvse_battle.h"
+
+// ===============================
+//  共通
+// ===============================
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static int arg_int(int argc, char **argv, const char *name, int fallback)
+{
+    for (int i = 0; i + 1 < argc; i++) {
+        if (strcmp(argv[i], name) == 0) return atoi(argv[i + 1]);
+    }
+    return fallback;
+}
+
+// scene の既定値（主人公固定ステ + build.json の初期値）に合わせた標準対戦
+static void init_standard_battle(BattleCore *b)
+{
+    Stats hero = { .hp = 150, .atk = 10, .spd = 10, .st = 100 };
+    Stats himari  = { .hp = 120, .atk = 20, .spd = 14, .st = 80 };
+    Stats kiritan = { .hp = 110, .atk = 18, .spd = 12, .st = 90 };
+
+    battle_core_init(b, "himari", true, hero, himari, "kiritan", true, hero, kiritan);
+    battle_core_set_unit_pos(b, 0, (Pos){ 0, 10 });
+    battle_core_set_unit_pos(b, 1, (Pos){ 0, 12 });
+    battle_core_set_unit_pos(b, 2, (Pos){ 20, 10 });
+    battle_core_set_unit_pos(b, 3, (Pos){ 20, 12 });
+    b->units[1].move = 6;
+    b->units[3].move = 3;
+}
+
+// greedy 同士で進めた局面を最大 n 個集める（終局したら初期局面からやり直し）
+static int collect_positions(BattleCore *out, int n)
+{
+    BattleCore b;
+    init_standard_battle(&b);
+
+    int k = 0;
+    while (k < n) {
+        if (b.phase == BPHASE_END) {
+            battle_core_free(&b);
+            init_standard_battle(&b);
+        }
+        battle_core_copy(&out[k++], &b);
+
+        TurnCmd c1, c2;
+        battle_ai_greedy_cmd(&b, TEAM_P1, &c1);
+        battle_ai_greedy_cmd(&b, TEAM_P2, &c2);
+        battle_core_run_turn(&b, &c1, &c2);
+    }
+    battle_core_free(&b);
+    return k;
+}
+
+// collect_positions で集めた局面を解放する（配列そのものは呼ぶ側で free）
+static void free_positions(BattleCore *pos, int n)
+{
+    for (int i = 0; i < n; i++) battle_core_free(&pos[i]);
+}
+
+// ===============================
+//  search
+// ===============================
+typedef struct {
+    const BattleCore *pos;
+    int npos;
+    int depth;
+    BattleTT *tt;
+    int *next;               // 共有カウンタ（次に担当する局面）
+    pthread_mutex_t *lock;
+    int *values;             // 局面ごとの評価値（TTあり/なしの一致確認用）
+    BattleAiStats stats;
+} SearchJob;
+
+static void* search_worker(void *arg)
+{
+    SearchJob *j = (SearchJob*)arg;
+    BattleAiParams p = { .depth = j->depth, .tt = j->tt };
+
+    for (;;) {
+        pthread_mutex_lock(j->lock);
+        int i = (*j->next)++;
+        pthread_mutex_unlock(j->lock);
+        if (i >= j->npos) break;
+
+        TurnCmd best;
+        j->values[i] = battle_ai_search(&j->pos[i], TEAM_P1, &p, &j->stats, &best);
+    }
+    return NULL;
+}
+
+static double run_search(const BattleCore *pos, int npos, int depth, int threads,
+                         BattleTT *tt, int *values, BattleAiStats *total)
+{
+    pthread_t th[64];
+    SearchJob jobs[64];
+    pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+    int next = 0;
+
+    memset(total, 0, sizeof(*total));
+    double t0 = now_sec();
+    for (int t = 0; t < threads; t++) {
+        jobs[t] = (SearchJob){ .pos = pos, .npos = npos, .depth = depth, .tt = tt,
+                               .next = &next, .lock = &lock, .values = values };
+        pthread_create(&th[t], NULL, search_worker, &jobs[t]);
+    }
+    for (int t = 0; t < threads; t++) {
+        pthread_join(th[t], NULL);
+        total->nodes     += jobs[t].stats.nodes;
+        total->tt_probes += jobs[t].stats.tt_probes;
+        total->tt_hits   += jobs[t].stats.tt_hits;
+    }
+    return now_sec() - t0;
+}
+
+static int cmd_search(int argc, char **argv)
+{
+    int depth   = arg_int(argc, argv, "--depth", 3);   // 置換表が当たるのは 3 ターン先読みから
+    int npos    = arg_int(argc, argv, "--positions", 8);
+    int tt_mb   = arg_int(argc, argv, "--tt-mb", 64);
+    int threads = arg_int(argc, argv, "--threads", 1);
+    if (npos < 1) npos = 1;
+    if (threads < 1) threads = 1;
+    if (threads > 64) threads = 64;
+
+    BattleCore *pos = (BattleCore*)calloc((size_t)npos, sizeof(BattleCore));
+    int *v_off = (int*)calloc((size_t)npos, sizeof(int));
+    int *v_on  = (int*)calloc((size_t)npos, sizeof(int));
+    if (!pos || !v_off || !v_on) return 1;
+    npos = collect_positions(pos, npos);
+
+    printf("[search] depth=%d positions=%d threads=%d\n", depth, npos, threads);
+    if (depth < 3) printf("  (depth < 3 : battle_ai_search does not probe the tt)\n");
+
+    BattleAiStats s_off, s_on;
+    double t_off = run_search(pos, npos, depth, threads, NULL, v_off, &s_off);
+    printf("  tt=off     : nodes=%llu  time=%.3fs  nodes/s=%.0f  pos/s=%.2f\n",
+           (unsigned long long)s_off.nodes, t_off, (double)s_off.nodes / t_off, npos / t_off);
+
+    BattleTT tt;
+    if (!battle_tt_init(&tt, (size_t)tt_mb)) {
+        fprintf(stderr, "tt alloc failed (%d MB)\n", tt_mb);
+        return 1;
+    }
+    double t_on = run_search(pos, npos, depth, threads, &tt, v_on, &s_on);
+    double hit = s_on.tt_probes ? 100.0 * (double)s_on.tt_hits / (double)s_on.tt_probes : 0.0;
+    char label[16];
+    snprintf(label, sizeof(label), "%dMB", tt_mb);
+    printf("  tt=%-7s : nodes=%llu  time=%.3fs  nodes/s=%.0f  pos/s=%.2f  probes=%llu hits=%llu (%.1f%%)\n",
+           label, (unsigned long long)s_on.nodes, t_on, (double)s_on.nodes / t_on, npos / t_on,
+           (unsigned long long)s_on.tt_probes, (unsigned long long)s_on.tt_hits, hit);
+    // 置換表なしで展開する木（s_off.nodes）を何秒で覆えたか＝実効レート
+    printf("  effective  : nodes/s=%.0f (x%.2f)\n",
+           (double)s_off.nodes / t_on, t_off / t_on);
+
+    int mismatch = 0;
+    for (int i = 0; i < npos; i++) if (v_off[i] != v_on[i]) mismatch++;
+    printf("  values     : %s\n", mismatch ? "MISMATCH" : "identical");
+
+    battle_tt_free(&tt);
+    free_positions(pos, npos);
+    free(pos);
+    free(v_off);
+    free(v_on);
+    return mismatch ? 1 : 0;
+}
+
+// ===============================
+//  replay
+// ===============================
+static uint32_t lcg_next(uint32_t *s)
+{
+    *s = *s * 1664525u + 1013904223u;
+    return *s >> 8;
+}
+
+// 決着しにくいランダム命令（移動は射程内のランダム、技はたまに）
+static void random_cmd(const BattleCore *b, Team team, uint32_t *rng, TurnCmd *out)
+{
+    for (int s = 0; s < 2; s++) {
+        const Unit *u = &b->units[unit_index(team, (Slot)s)];
+        int mv = u->move;
+        int dx = mv ? (int)(lcg_next(rng) % (uint32_t)(2 * mv + 1)) - mv : 0;
+        int rest = mv - (dx < 0 ? -dx : dx);
+        int dy = rest ? (int)(lcg_next(rng) % (uint32_t)(2 * rest + 1)) - rest : 0;
+
+        int x = u->pos.x + dx, y = u->pos.y + dy;
+        if (x < 0) x = 0;
+        if (x > 20) x = 20;
+        if (y < 0) y = 0;
+        if (y > 20) y = 20;
+
+        UnitCmd *c = &out->cmd[s];
+        c->has_move = true;
+        c->move_to = (Pos){ (int8_t)x, (int8_t)y };
+        c->skill_index = (lcg_next(rng) % 10 == 0) ? (int8_t)(lcg_next(rng) % 3) : -1;
+        c->target = (int8_t)(lcg_next(rng) % 2);
+        c->center = c->move_to;
+    }
+}
+
+// turns ターン続く対戦を記録する（決着したら種を変えてやり直し、最長のものを使う）
+static void record_long_battle(BattleReplay *best, int turns)
+{
+    NetGameInfo p1 = { .girl_id = "himari",  .hp_base = 120, .atk_base = 20, .sp_base = 14, .st_base = 80,
+                       .tag_learned = 1, .move_range = 6 };
+    NetGameInfo p2 = { .girl_id = "kiritan", .hp_base = 110, .atk_base = 18, .sp_base = 12, .st_base = 90,
+                       .tag_learned = 1, .move_range = 3 };
+
+    memset(best, 0, sizeof(*best));
+    for (uint32_t seed = 1; seed <= 200; seed++) {
+        BattleReplay r;
+        BattleCore b;
+        battle_replay_init(&r, &p1, &p2, seed);
+        battle_replay_setup_core(&b, &p1, &p2);
+
+        uint32_t rng = seed;
+        while (r.turn_count < turns && b.phase != BPHASE_END) {
+            TurnCmd c1, c2;
+            random_cmd(&b, TEAM_P1, &rng, &c1);
+            random_cmd(&b, TEAM_P2, &rng, &c2);
+            battle_replay_record_turn(&r, &b, &c1, &c2);
+            battle_core_run_turn(&b, &c1, &c2);
+        }
+        battle_core_free(&b);
+
+        if (r.turn_count > best->turn_count) {
+            battle_replay_free(best);
+            *best = r;
+        } else {
+            battle_replay_free(&r);
+        }
+        if (best->turn_count >= turns) break;
+    }
+}
+
+static int cmd_replay(int argc, char **argv)
+{
+    int turns = arg_int(argc, argv, "--turns", 200);
+    int seeks = arg_int(argc, argv, "--seeks", 2000);
+    const char *out = "/tmp/battle_bench.tvsr";
+    for (int i = 0; i + 1 < argc; i++) if (strcmp(argv[i], "--out") == 0) out = argv[i + 1];
+    if (turns < 1) turns = 1;
+    if (seeks < 1) seeks = 1;
+
+    BattleReplay rec;
+    record_long_battle(&rec, turns);
+    turns = rec.turn_count;
+
+    // 記録時の各ターン頭のハッシュ（照合用）
+    uint64_t *live = (uint64_t*)calloc((size_t)turns + 1, sizeof(uint64_t));
+    if (!live) return 1;
+    {
+        BattleCore b;
+        battle_replay_setup_core(&b, &rec.info[TEAM_P1], &rec.info[TEAM_P2]);
+        for (int t = 0; t <= turns; t++) {
+            live[t] = b.hash;
+            if (t < turns) battle_core_run_turn(&b, &rec.turns[t].cmd[TEAM_P1], &rec.turns[t].cmd[TEAM_P2]);
+        }
+        battle_core_free(&b);
+    }
+
+    if (!battle_replay_save(&rec, out)) {
+        fprintf(stderr, "save failed: %s\n", out);
+        return 1;
+    }
+    FILE *fp = fopen(out, "rb");
+    long fsz = 0;
+    if (fp) { fseek(fp, 0, SEEK_END); fsz = ftell(fp); fclose(fp); }
+
+    BattleReplay rp;
+    double t0 = now_sec();
+    bool ok = battle_replay_load(&rp, out);
+    double t_load = now_sec() - t0;
+    if (!ok || rp.turn_count != turns) {
+        fprintf(stderr, "load failed: %s\n", out);
+        return 1;
+    }
+
+    printf("[replay] turns=%d keyframes=%d file=%ldB (%s) load=%.3fms\n",
+           turns, rp.key_count, fsz, out, t_load * 1e3);
+
+    // 全ターンを照合
+    int mismatch = 0;
+    for (int t = 0; t <= turns; t++) {
+        BattleCore b;
+        battle_replay_seek(&rp, t, &b);
+        if (b.hash != live[t] || b.hash != battle_core_compute_hash(&b)) mismatch++;
+        battle_core_free(&b);
+    }
+    printf("  verify     : %d/%d turns %s\n", turns + 1 - mismatch, turns + 1,
+           mismatch ? "MISMATCH" : "identical");
+
+    // ランダムシークの時間（キーフレームあり / 先頭から再シミュレート）
+    BattleReplay nokey = rp;
+    nokey.key_count = 0;
+
+    for (int pass = 0; pass < 2; pass++) {
+        const BattleReplay *r = pass == 0 ? &rp : &nokey;
+        uint32_t rng = 12345;
+        double worst = 0.0, total = 0.0;
+        for (int i = 0; i < seeks; i++) {
+            int t = (int)(lcg_next(&rng) % (uint32_t)(turns + 1));
+            BattleCore b;
+            double s0 = now_sec();
+            battle_replay_seek(r, t, &b);
+            double dt = now_sec() - s0;
+            battle_core_free(&b);
+            total += dt;
+            if (dt > worst) worst = dt;
+        }
+        printf("  seek %-6s: avg=%.1fus  max=%.1fus  (%d seeks)\n",
+               pass == 0 ? "key" : "nokey", total / seeks * 1e6, worst * 1e6, seeks);
+    }
+
+    battle_replay_free(&rec);
+    battle_replay_free(&rp);
+    free(live);
+    return mismatch ? 1 : 0;
+}
+
+// ===============================
+//  batch
+// ===============================
+// 対戦ごとにばらけた開始条件（未定義キャラ＝技なし/回復なし も混ぜる）
+static void random_info(uint32_t *rng, NetGameInfo *out)
+{
+    static const char *girls[] = { "himari", "kiritan", "sayo" };
+    memset(out, 0, sizeof(*out));
+    snprintf(out->girl_id, sizeof(out->girl_id), "%s", girls[lcg_next(rng) % 3]);
+    out->hp_base  = (int16_t)(60 + lcg_next(rng) % 80);
+    out->atk_base = (int16_t)(5 + lcg_next(rng) % 25);
+    out->sp_base  = (int16_t)(5 + lcg_next(rng) % 15);
+    out->st_base  = (int16_t)(30 + lcg_next(rng) % 90);
+    out->tag_learned = (uint8_t)(lcg_next(rng) % 2);
+    out->move_range  = (uint8_t)(lcg_next(rng) % 8);
+}
+
+// 技を多めに撃つランダム命令（範囲外の技index/盤外の座標も混ぜる）
+static void random_cmd_active(const BattleCore *b, Team team, uint32_t *rng, TurnCmd *out)
+{
+    random_cmd(b, team, rng, out);
+    Team enemy = (team == TEAM_P1) ? TEAM_P2 : TEAM_P1;
+    for (int s = 0; s < 2; s++) {
+        UnitCmd *c = &out->cmd[s];
+        uint32_t r = lcg_next(rng) % 16;
+        if (r < 9) c->skill_index = (int8_t)(lcg_next(rng) % 4);
+        else if (r == 9) c->skill_index = 5;
+        if (lcg_next(rng) % 8 == 0) c->has_move = false;
+        if (lcg_next(rng) % 32 == 0) c->move_to = (Pos){ (int8_t)(lcg_next(rng) % 30) - 5, 25 };
+
+        Pos e = b->units[unit_index(enemy, (Slot)(lcg_next(rng) % 2))].pos;
+        c->center = (Pos){ (int8_t)(e.x + (int)(lcg_next(rng) % 3) - 1),
+                           (int8_t)(e.y + (int)(lcg_next(rng) % 3) - 1) };
+    }
+}
+
+static void setup_batch_battles(BattleCore *cores, int n, uint32_t seed)
+{
+    uint32_t rng = seed;
+    for (int i = 0; i < n; i++) {
+        NetGameInfo p1, p2;
+        random_info(&rng, &p1);
+        random_info(&rng, &p2);
+        battle_replay_setup_core(&cores[i], &p1, &p2);
+    }
+}
+
+// バッチ側の i 番目を b と比べる（store した結果のハッシュまで一致するか）
+static bool batch_matches(const BattleBatch *bb, int i, const BattleCore *b)
+{
+    BattleCore tmp;
+    battle_core_copy(&tmp, b);   // store は units/構え/phase/turn/hash だけ書く（イベントには触らない）
+    battle_batch_store(bb, i, &tmp);
+    bool same = tmp.phase == b->phase && tmp.turn == b->turn && tmp.hash == b->hash;
+
+    for (int u = 0; u < 4 && same; u++) {
+        const Unit *x = &tmp.units[u], *y = &b->units[u];
+        same = x->pos.x == y->pos.x && x->pos.y == y->pos.y
+            && x->stats.hp == y->stats.hp && x->stats.st == y->stats.st
+            && x->alive == y->alive
+            && tmp.counter_ready[u] == b->counter_ready[u]
+            && tmp.counter_range[u] == b->counter_range[u]
+            && battle_skill_index_of(tmp.counter_skill_id[u]) == battle_skill_index_of(b->counter_skill_id[u]);
+    }
+    battle_core_free(&tmp);
+    return same;
+}
+
+static int cmd_batch(int argc, char **argv)
+{
+    int n = arg_int(argc, argv, "--battles", 4096);
+    int turns = arg_int(argc, argv, "--turns", 64);
+    if (n < 1) n = 1;
+    if (turns < 1) turns = 1;
+
+    BattleCore *cores = (BattleCore*)calloc((size_t)n, sizeof(BattleCore));
+    TurnCmd *cmds = (TurnCmd*)calloc((size_t)n * 2 * (size_t)turns, sizeof(TurnCmd));
+    BattleBatch bb;
+    if (!cores || !cmds || !battle_batch_init(&bb, n)) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    // --- 照合：命令列を作りながら毎ターン比べる ---
+    setup_batch_battles(cores, n, 777u);
+    for (int i = 0; i < n; i++) {
+        if (!battle_batch_load(&bb, i, &cores[i])) {
+            fprintf(stderr, "battle %d cannot be loaded into the batch\n", i);
+            return 1;
+        }
+    }
+
+    uint32_t rng = 4242u;
+    int mismatch = 0, first_bad = -1, first_turn = -1;
+    for (int t = 0; t < turns; t++) {
+        TurnCmd *tc = cmds + (size_t)t * (size_t)n * 2;
+        for (int i = 0; i < n; i++) {
+            random_cmd_active(&cores[i], TEAM_P1, &rng, &tc[i * 2 + TEAM_P1]);
+            random_cmd_active(&cores[i], TEAM_P2, &rng, &tc[i * 2 + TEAM_P2]);
+            battle_core_run_turn(&cores[i], &tc[i * 2 + TEAM_P1], &tc[i * 2 + TEAM_P2]);
+        }
+        battle_batch_run_turn(&bb, tc);
+
+        for (int i = 0; i < n; i++) {
+            if (batch_matches(&bb, i, &cores[i])) continue;
+            if (first_bad < 0) { first_bad = i; first_turn = t; }
+            mismatch++;
+            if (!battle_batch_load(&bb, i, &cores[i])) {   // 以降のターンも比べられるよう同期し直す
+                fprintf(stderr, "battle %d cannot be reloaded at turn %d\n", i, t);
+                return 1;
+            }
+        }
+    }
+    int ended = 0;
+    for (int i = 0; i < n; i++) ended += (cores[i].phase == BPHASE_END);
+
+    printf("[batch] battles=%d turns=%d kernel=%s ended=%d/%d\n",
+           n, turns, battle_batch_kernel_name(), battle_batch_count_ended(&bb), n);
+    if (mismatch) {
+        printf("  verify : MISMATCH %d (first: battle %d turn %d)\n", mismatch, first_bad, first_turn);
+    } else {
+        printf("  verify : %d battle-turns identical (ended=%d)\n", n * turns, ended);
+    }
+
+    // --- 計測：同じ命令列を流し直す ---
+    double t_scalar, t_batch;
+    {
+        for (int i = 0; i < n; i++) battle_core_free(&cores[i]);
+        setup_batch_battles(cores, n, 777u);
+        double t0 = now_sec();
+        for (int t = 0; t < turns; t++) {
+            const TurnCmd *tc = cmds + (size_t)t * (size_t)n * 2;
+            for (int i = 0; i < n; i++) {
+                battle_core_run_turn(&cores[i], &tc[i * 2 + TEAM_P1], &tc[i * 2 + TEAM_P2]);
+            }
+        }
+        t_scalar = now_sec() - t0;
+    }
+    {
+        for (int i = 0; i < n; i++) battle_core_free(&cores[i]);
+        setup_batch_battles(cores, n, 777u);
+        for (int i = 0; i < n; i++) {
+            if (!battle_batch_load(&bb, i, &cores[i])) return 1;   // 照合で通った局面と同じ
+        }
+        double t0 = now_sec();
+        for (int t = 0; t < turns; t++) {
+            battle_batch_run_turn(&bb, cmds + (size_t)t * (size_t)n * 2);
+        }
+        t_batch = now_sec() - t0;
+    }
+
+    printf("  scalar : %8.3f ms  %10.0f battles/s (x%d turns)\n",
+           t_scalar * 1e3, n / t_scalar, turns);
+    printf("  batch  : %8.3f ms  %10.0f battles/s  speedup x%.2f\n",
+           t_batch * 1e3, n / t_batch, t_scalar / t_batch);
+
+    for (int i = 0; i < n; i++) battle_core_free(&cores[i]);
+    battle_batch_free(&bb);
+    free(cores);
+    free(cmds);
+    return mismatch ? 1 : 0;
+}
+
+// ===============================
+//  alloc
+// ===============================
+static void print_alloc_entry(const char *head, const AllocOptEntry *e)
+{
+    printf("%sHP+%-3d ATK+%-2d SPD+%-2d ST+%-2d %s score=%.3f (lo %.3f, %d games)\n",
+           head, e->add[0], e->add[1], e->add[2], e->add[3], e->tag ? "tag" : "   ",
+           e->score, e->score_lo, e->games);
+}
+
+static int cmd_alloc(int argc, char **argv)
+{
+    const char *girl = "himari";
+    for (int i = 0; i + 1 < argc; i++) if (strcmp(argv[i], "--girl") == 0) girl = argv[i + 1];
+    int points = arg_int(argc, argv, "--points", 30);
+    int gens = arg_int(argc, argv, "--generations", 12);
+    int threads = arg_int(argc, argv, "--threads", 1);
+    if (gens < 1) gens = 1;
+
+    const GirlBase *gb = girl_base_get(girl);
+    AllocOptConfig cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    snprintf(cfg.self.girl_id, sizeof(cfg.self.girl_id), "%s", gb->girl_id);
+    cfg.self.hp_base  = (int16_t)gb->hp;
+    cfg.self.atk_base = (int16_t)gb->atk;
+    cfg.self.sp_base  = (int16_t)gb->sp;
+    cfg.self.st_base  = (int16_t)gb->st;
+    cfg.self.move_range = (uint8_t)gb->move_range;
+    cfg.points = points;
+    cfg.tag_unlocked = points >= 50;
+    cfg.threads = threads;
+    cfg.max_generations = gens;
+    cfg.seed = 1;
+
+    printf("[alloc] girl=%s points=%d generations=%d threads=%d\n", gb->girl_id, points, gens, threads);
+
+    double t0 = now_sec();
+    AllocOpt *o = alloc_opt_start(&cfg);
+    if (!o) return 1;
+
+    // 版が上がるたびに1位を出す（scene と同じ取り出し方）
+    uint32_t seen = 0;
+    AllocOptEntry top[ALLOC_OPT_TOP_MAX];
+    int n = 0, gen = 0;
+    uint64_t games = 0;
+    while (gen < gens) {
+        int got = alloc_opt_poll(o, &seen, top, ALLOC_OPT_TOP_MAX);
+        alloc_opt_progress(o, &gen, &games);
+        if (got > 0) {
+            n = got;
+            char head[32];
+            snprintf(head, sizeof(head), "  gen %3d: ", gen);
+            print_alloc_entry(head, &top[0]);
+        } else {
+            struct timespec ts = { 0, 2000000 };
+            nanosleep(&ts, NULL);
+        }
+    }
+    double dt = now_sec() - t0;
+    alloc_opt_stop(o);
+
+    printf("  %llu games in %.2fs (%.0f games/s)\n", (unsigned long long)games, dt, games / dt);
+    for (int i = 0; i < n; i++) {
+        char head[16];
+        snprintf(head, sizeof(head), "  #%d ", i + 1);
+        print_alloc_entry(head, &top[i]);
+    }
+    return 0;
+}
+
+// ===============================
+//  rng
+// ===============================
+// Random123 の既知解（philox4x32_10）
+static const struct {
+    uint32_t ctr[4], key[2], out[4];
+} k_philox_kat[] = {
+    { { 0, 0, 0, 0 }, { 0, 0 },
+      { 0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8 } },
+    { { 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff }, { 0xffffffff, 0xffffffff },
+      { 0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd } },
+    { { 0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344 }, { 0xa4093822, 0x299f31d0 },
+      { 0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1 } },
+};
+
+// 照合用の格子：ターン×ユニット×用途×通し番号
+#define RNG_GRID_TURNS 64
+#define RNG_GRID_UNITS 4
+#define RNG_GRID_PURPOSES 3
+#define RNG_GRID_N 256
+#define RNG_GRID_SIZE (RNG_GRID_TURNS * RNG_GRID_UNITS * RNG_GRID_PURPOSES * RNG_GRID_N)
+
+static uint32_t rng_grid_draw(uint64_t seed, int idx)
+{
+    int n = idx % RNG_GRID_N;       idx /= RNG_GRID_N;
+    int p = idx % RNG_GRID_PURPOSES; idx /= RNG_GRID_PURPOSES;
+    int u = idx % RNG_GRID_UNITS;   idx /= RNG_GRID_UNITS;
+    return battle_rng_u32(seed, idx + 1, u, (BattleRngPurpose)(BRNG_CRIT + p), (uint32_t)n);
+}
+
+typedef struct {
+    uint64_t seed;
+    uint32_t *out;
+    int t, threads;
+} RngJob;
+
+// スレッド t は idx % threads == t の升目を後ろから埋める（参照とは順番も担当も違う）
+static void* rng_worker(void *arg)
+{
+    RngJob *j = (RngJob*)arg;
+    for (int idx = RNG_GRID_SIZE - 1; idx >= 0; idx--) {
+        if (idx % j->threads != j->t) continue;
+        j->out[idx] = rng_grid_draw(j->seed, idx);
+    }
+    return NULL;
+}
+
+static int cmd_rng(int argc, char **argv)
+{
+    long draws = arg_int(argc, argv, "--draws", 1 << 24);
+    int threads = arg_int(argc, argv, "--threads", 4);
+    if (draws < 4) draws = 4;
+    draws &= ~3L;
+    if (threads < 1) threads = 1;
+    if (threads > 64) threads = 64;
+    int fail = 0;
+
+    // --- 既知解 ---
+    for (size_t i = 0; i < sizeof(k_philox_kat) / sizeof(k_philox_kat[0]); i++) {
+        uint32_t o[4];
+        battle_rng_philox4x32(k_philox_kat[i].ctr, k_philox_kat[i].key, o);
+        if (memcmp(o, k_philox_kat[i].out, sizeof(o)) != 0) {
+            printf("[rng] KAT %zu MISMATCH: %08x %08x %08x %08x\n", i, o[0], o[1], o[2], o[3]);
+            fail = 1;
+        }
+    }
+    printf("[rng] philox4x32-10 KAT: %s\n", fail ? "FAIL" : "ok");
+
+    // --- 速さ（1個ずつ / 4個まとめて） ---
+    const uint64_t seed = 0x0123456789ABCDEFull;
+    uint32_t sink1 = 0, sink4 = 0;   // 同じ値を引くので両者は一致する
+    double t0 = now_sec();
+    for (long n = 0; n < draws; n++) sink1 ^= battle_rng_u32(seed, 1, 0, BRNG_AI, (uint32_t)n);
+    double dt1 = now_sec() - t0;
+
+    t0 = now_sec();
+    for (long n = 0; n < draws / 4; n++) {
+        uint32_t v[4];
+        battle_rng_block(seed, 1, 0, BRNG_AI, (uint32_t)n, v);
+        sink4 ^= v[0] ^ v[1] ^ v[2] ^ v[3];
+    }
+    double dt4 = now_sec() - t0;
+    printf("[rng] %ld draws: u32 %.1f M/s (%.1f ns)  block %.1f M/s (%.1f ns/draw)  [%08x %s]\n",
+           draws, draws / dt1 * 1e-6, dt1 / draws * 1e9, draws / dt4 * 1e-6, dt4 / draws * 1e9,
+           sink1, sink1 == sink4 ? "same" : "DIFF");
+    if (sink1 != sink4) fail = 1;
+
+    // --- スレッド間の再現性 ---
+    uint32_t *ref = (uint32_t*)malloc(sizeof(uint32_t) * RNG_GRID_SIZE);
+    uint32_t *par = (uint32_t*)calloc(RNG_GRID_SIZE, sizeof(uint32_t));
+    if (!ref || !par) { free(ref); free(par); return 1; }
+
+    for (int idx = 0; idx < RNG_GRID_SIZE; idx++) ref[idx] = rng_grid_draw(seed, idx);
+
+    pthread_t th[64];
+    RngJob jobs[64];
+    for (int t = 0; t < threads; t++) {
+        jobs[t] = (RngJob){ .seed = seed, .out = par, .t = t, .threads = threads };
+        pthread_create(&th[t], NULL, rng_worker, &jobs[t]);
+    }
+    for (int t = 0; t < threads; t++) pthread_join(th[t], NULL);
+
+    int diff = 0;
+    for (int idx = 0; idx < RNG_GRID_SIZE; idx++) if (ref[idx] != par[idx]) diff++;
+    printf("[rng] %d draws on %d threads (strided, reversed) vs 1 thread: %d mismatches\n",
+           RNG_GRID_SIZE, threads, diff);
+    if (diff) fail = 1;
+
+    // 0/1 の偏りをざっと（格子全体のビット平均）
+    uint64_t ones = 0;
+    for (int idx = 0; idx < RNG_GRID_SIZE; idx++) ones += (uint64_t)__builtin_popcount(ref[idx]);
+    printf("[rng] bit mean %.5f (expect 0.5)\n", (double)ones / (32.0 * RNG_GRID_SIZE));
+    free(ref);
+    free(par);
+
+    // --- 対戦seed：両クライアント（自分がP1）とサーバ（接続順）で一致するか ---
+    NetGameInfo a, b;
+    memset(&a, 0, sizeof(a));
+    memset(&b, 0, sizeof(b));
+    snprintf(a.girl_id, sizeof(a.girl_id), "himari");
+    snprintf(b.girl_id, sizeof(b.girl_id), "kiritan");
+    a.hp_base = 120; a.hp_add = 25; a.move_range = 6;
+    b.hp_base = 100; b.st_add = 7;  b.move_range = 3; b.tag_learned = 1;
+    uint32_t sab = battle_replay_match_seed(&a, &b);
+    uint32_t sba = battle_replay_match_seed(&b, &a);
+    printf("[rng] match seed %08x / %08x: %s\n", sab, sba, sab == sba ? "ok" : "MISMATCH");
+    if (sab != sba) fail = 1;
+
+    return fail;
+}
+
+// ===============================
+//  preview
+// ===============================
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static int cmd_preview(int argc, char **argv)
+{
+    int npos = arg_int(argc, argv, "--positions", 2000);
+    if (npos < 1) npos = 1;
+
+    BattleCore *pos = (BattleCore*)malloc(sizeof(BattleCore) * (size_t)npos);
+    TurnCmd *cand = (TurnCmd*)malloc(sizeof(TurnCmd) * BATTLE_AI_CAND_MAX);
+    int times_cap = npos * (BATTLE_AI_CAND_MAX / 7 + 1);
+    double *times = (double*)malloc(sizeof(double) * (size_t)times_cap);
+    if (!pos || !cand || !times) { free(pos); free(cand); free(times); return 1; }
+    npos = collect_positions(pos, npos);
+
+    // 作戦UIで試しそうな手：P1 は候補手を順に（構え/範囲/回復も混ざる）、P2 は greedy を想定
+    int calls = 0, diff = 0, touched = 0, counters = 0, kills = 0;
+    double total = 0.0, worst = 0.0;
+    for (int i = 0; i < npos; i++) {
+        const BattleCore *b = &pos[i];
+        if (b->phase != BPHASE_INPUT) continue;
+
+        TurnCmd enemy;
+        battle_ai_greedy_cmd(b, TEAM_P2, &enemy);
+        int n = battle_ai_gen_candidates(b, TEAM_P1, cand, BATTLE_AI_CAND_MAX);
+
+        for (int k = 0; k < n; k += 7) {
+            BattleCore before;
+            memcpy(&before, b, sizeof(before));   // 比べるだけのバイト列の写し
+            BattlePreview pv;
+
+            double t0 = now_sec();
+            battle_core_preview(b, TEAM_P1, &cand[k], &enemy, &pv);
+            double dt = now_sec() - t0;
+            total += dt;
+            if (dt > worst) worst = dt;
+            if (calls < times_cap) times[calls] = dt;
+            calls++;
+
+            if (memcmp(&before, b, sizeof(before)) != 0) touched++;
+            counters += pv.counter_count;
+
+            // 実際に解決した結果と照合
+            BattleCore real;
+            battle_core_copy(&real, b);
+            battle_core_run_turn(&real, &cand[k], &enemy);
+            bool ok = (pv.ends == (real.phase == BPHASE_END));
+            for (int u = 0; u < 4; u++) {
+                ok = ok && pv.hp_delta[u] == real.units[u].stats.hp - b->units[u].stats.hp;
+                ok = ok && pv.st_delta[u] == real.units[u].stats.st - b->units[u].stats.st;
+                ok = ok && pv.killed[u] == (b->units[u].alive && !real.units[u].alive);
+                if (pv.killed[u]) kills++;
+            }
+            if (!ok) diff++;
+            battle_core_free(&real);
+        }
+    }
+
+    int nt = calls < times_cap ? calls : times_cap;
+    qsort(times, (size_t)nt, sizeof(double), cmp_double);
+    double p99 = nt ? times[(nt - 1) * 99 / 100] : 0.0;
+    printf("[preview] %d calls on %d positions: avg=%.2fus p99=%.2fus max=%.2fus  (counters %d, kills %d)\n",
+           calls, npos, calls ? total / calls * 1e6 : 0.0, p99 * 1e6, worst * 1e6, counters, kills);
+    printf("  verify : %d mismatches vs battle_core_run_turn, live core modified %d times\n", diff, touched);
+
+    free(times);
+    free(cand);
+    free_positions(pos, npos);
+    free(pos);
+    return (diff || touched) ? 1 : 0;
+}
+
+// ===============================
+//  threat
+// ===============================
+static int cmd_threat(int argc, char **argv)
+{
+    int npos = arg_int(argc, argv, "--positions", 4000);
+    if (npos < 2) npos = 2;
+
+    BattleCore *pos = (BattleCore*)malloc(sizeof(BattleCore) * (size_t)npos);
+    BattleThreatMap *inc = (BattleThreatMap*)malloc(sizeof(BattleThreatMap));
+    BattleThreatMap *full = (BattleThreatMap*)malloc(sizeof(BattleThreatMap));
+    if (!pos || !inc || !full) { free(pos); free(inc); free(full); return 1; }
+    npos = collect_positions(pos, npos);
+
+    // --- ターン送り：連続局面を順に sync（対戦が切り替わったら build し直す） ---
+    int diff = 0;
+    double t_full = 0.0, t_inc = 0.0;
+    battle_threat_build(inc, &pos[0], true);
+    for (int i = 1; i < npos; i++) {
+        double t0 = now_sec();
+        battle_threat_build(full, &pos[i], true);
+        t_full += now_sec() - t0;
+
+        t0 = now_sec();
+        if (pos[i].turn < pos[i - 1].turn) battle_threat_build(inc, &pos[i], true);
+        else                               battle_threat_sync(inc, &pos[i]);
+        t_inc += now_sec() - t0;
+
+        if (memcmp(inc->cell, full->cell, sizeof(full->cell)) != 0) diff++;
+    }
+    printf("[threat] turn steps : %d  full=%.2fus  sync=%.2fus  (x%.1f)  profile rebuilds=%u unit updates=%u\n",
+           npos - 1, t_full / (npos - 1) * 1e6, t_inc / (npos - 1) * 1e6, t_full / (t_inc > 0 ? t_inc : 1e-12),
+           inc->profile_rebuilds, inc->unit_updates);
+
+    // --- 1体だけ移動（作戦UIのカーソル移動 / AI の候補手1つ分） ---
+    int moves = 0;
+    double m_full = 0.0, m_inc = 0.0;
+    for (int i = 0; i < npos; i += 4) {
+        BattleCore b;
+        battle_core_copy(&b, &pos[i]);
+        battle_threat_build(inc, &b, true);
+        for (int k = 0; k < 8; k++) {
+            int ui = k % 4;
+            Pos p = { (int8_t)((b.units[ui].pos.x + 3 + k) % MAP_W), (int8_t)((b.units[ui].pos.y + 5) % MAP_H) };
+            battle_core_set_unit_pos(&b, ui, p);
+
+            double t0 = now_sec();
+            battle_threat_sync(inc, &b);
+            m_inc += now_sec() - t0;
+
+            t0 = now_sec();
+            battle_threat_build(full, &b, true);
+            m_full += now_sec() - t0;
+
+            if (memcmp(inc->cell, full->cell, sizeof(full->cell)) != 0) diff++;
+            moves++;
+        }
+        battle_core_free(&b);
+    }
+    printf("[threat] unit moves : %d  full=%.2fus  sync=%.2fus  (x%.1f)\n",
+           moves, m_full / moves * 1e6, m_inc / moves * 1e6, m_full / (m_inc > 0 ? m_inc : 1e-12));
+
+    // --- 1マス参照：cell 表 vs profile から計算（AI 評価はこちら） ---
+    int pdiff = 0;
+    for (int y = 0; y < MAP_H; y++) {
+        for (int x = 0; x < MAP_W; x++) {
+            Pos p = { (int8_t)x, (int8_t)y };
+            for (int t = 0; t < 2; t++) {
+                if (battle_threat_at(full, (Team)t, p) != battle_threat_point(full, (Team)t, p)) pdiff++;
+            }
+        }
+    }
+    printf("  verify : %d map mismatches vs full rebuild, %d point/cell mismatches\n", diff, pdiff);
+
+    free(full);
+    free(inc);
+    free_positions(pos, npos);
+    free(pos);
+    return (diff || pdiff) ? 1 : 0;
+}
+
+// ===============================
+//  stage
+// ===============================
+// 比較用：移動力 mv の範囲だけ毎回解く（距離表を持たない場合のやり方）
+static bool stage_bfs_reach(const BattleStage *st, Pos from, Pos to, int mv)
+{
+    int cost[BATTLE_STAGE_CELLS];
+    int q[BATTLE_STAGE_CELLS * 4];
+    int qh = 0, qt = 0;
+    for (int i = 0; i < BATTLE_STAGE_CELLS; i++) cost[i] = 1 << 20;
+
+    int c0 = battle_stage_cell(from);
+    if (st->tile[c0] == BTILE_WALL) return false;
+    cost[c0] = 0;
+    q[qt++] = c0;
+    while (qh < qt) {
+        int c = q[qh++];
+        int x = c % MAP_W, y = c / MAP_W;
+        const int nb[4][2] = { { x + 1, y }, { x - 1, y }, { x, y + 1 }, { x, y - 1 } };
+        for (int k = 0; k < 4; k++) {
+            int nx = nb[k][0], ny = nb[k][1];
+            if (nx < 0 || nx >= MAP_W || ny < 0 || ny >= MAP_H) continue;
+            int nc = ny * MAP_W + nx;
+            if (st->tile[nc] == BTILE_WALL) continue;
+            int nd = cost[c] + ((st->tile[nc] == BTILE_SLOW) ? 2 : 1);
+            if (nd > mv || nd >= cost[nc]) continue;
+            cost[nc] = nd;
+            if (qt < BATTLE_STAGE_CELLS * 4) q[qt++] = nc;
+        }
+    }
+    return cost[battle_stage_cell(to)] <= mv;
+}
+
+static int cmd_stage(int argc, char **argv)
+{
+    const char *dir = "assets/stages";
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "--dir") == 0) dir = argv[i + 1];
+    }
+    int queries = arg_int(argc, argv, "--queries", 200000);
+    int battles = arg_int(argc, argv, "--battles", 50);
+    if (queries < 1) queries = 1;
+
+    double t0 = now_sec();
+    int n = battle_stage_catalog_load(dir);
+    printf("[stage] %d stage(s) from %s  load+precompute=%.1fms\n", n, dir, (now_sec() - t0) * 1e3);
+    if (n == 0) return 1;
+
+    int bad = 0;
+    for (int si = 0; si < n; si++) {
+        const BattleStage *st = battle_stage_catalog_at(si);
+
+        // --- 到達判定：距離表（1回引く） vs 毎回 BFS ---
+        uint32_t rng = 12345u + (uint32_t)si;
+        Pos *qf = (Pos*)malloc(sizeof(Pos) * (size_t)queries * 2);
+        int *qm = (int*)malloc(sizeof(int) * (size_t)queries);
+        if (!qf || !qm) { free(qf); free(qm); return 1; }
+        for (int i = 0; i < queries; i++) {
+            qf[i * 2]     = (Pos){ (int8_t)(lcg_next(&rng) % MAP_W), (int8_t)(lcg_next(&rng) % MAP_H) };
+            qf[i * 2 + 1] = (Pos){ (int8_t)(lcg_next(&rng) % MAP_W), (int8_t)(lcg_next(&rng) % MAP_H) };
+            qm[i] = 2 + (int)(lcg_next(&rng) % 5);
+        }
+
+        int mism = 0, yes = 0;
+        double tb = now_sec();
+        for (int i = 0; i < queries; i++) yes += battle_stage_can_move(st, qf[i * 2], qf[i * 2 + 1], qm[i]);
+        double t_table = now_sec() - tb;
+
+        int bfs_n = queries < 20000 ? queries : 20000;   // BFS は遅いので一部だけ
+        tb = now_sec();
+        for (int i = 0; i < bfs_n; i++) {
+            bool ref = stage_bfs_reach(st, qf[i * 2], qf[i * 2 + 1], qm[i]);
+            if (ref != battle_stage_can_move(st, qf[i * 2], qf[i * 2 + 1], qm[i])) mism++;
+        }
+        double t_bfs = now_sec() - tb;
+
+        // --- 見通し：対称性と速さ ---
+        int asym = 0, vis = 0;
+        tb = now_sec();
+        for (int i = 0; i < queries; i++) vis += battle_stage_los(st, qf[i * 2], qf[i * 2 + 1]);
+        double t_los = now_sec() - tb;
+        for (int a = 0; a < BATTLE_STAGE_CELLS; a++) {
+            for (int c = 0; c < BATTLE_STAGE_CELLS; c++) {
+                Pos pa = { (int8_t)(a % MAP_W), (int8_t)(a / MAP_W) };
+                Pos pc = { (int8_t)(c % MAP_W), (int8_t)(c / MAP_W) };
+                if (battle_stage_los(st, pa, pc) != battle_stage_los(st, pc, pa)) asym++;
+            }
+        }
+        free(qf);
+        free(qm);
+
+        printf("[stage] %-8s walls=%-3d slow=%-3d  reach: table=%.1fns bfs=%.2fus (x%.0f) yes=%d%%  los=%.1fns visible=%d%%\n",
+               st->id, st->walls, st->slows,
+               t_table / queries * 1e9, t_bfs / bfs_n * 1e6,
+               (t_bfs / bfs_n) / (t_table / queries > 0 ? t_table / queries : 1e-12),
+               yes * 100 / queries, t_los / queries * 1e9, vis * 100 / queries);
+
+        // --- greedy 同士：AI の移動が不成立にならないか / 壁の上に立たないか ---
+        int rejected = 0, on_wall = 0, ended = 0, turns = 0;
+        for (int g = 0; g < battles; g++) {
+            BattleCore b;
+            init_standard_battle(&b);
+            b.stage = st;
+            b.rng_seed = (uint64_t)g;
+            while (b.phase != BPHASE_END && b.turn <= 200) {
+                TurnCmd c[2];
+                battle_ai_greedy_cmd(&b, TEAM_P1, &c[0]);
+                if (g & 1) {
+                    battle_ai_greedy_cmd(&b, TEAM_P2, &c[1]);
+                } else {
+                    // 候補手からも1つ（探索が使う移動先の検証）
+                    TurnCmd cand[64];
+                    int nc = battle_ai_gen_candidates(&b, TEAM_P2, cand, 64);
+                    c[1] = cand[(uint32_t)b.turn * 7u % (uint32_t)(nc > 0 ? nc : 1)];
+                }
+                Unit before[4];
+                memcpy(before, b.units, sizeof(before));
+                battle_core_run_turn(&b, &c[0], &c[1]);
+                for (int t = 0; t < 2; t++) {
+                    for (int sl = 0; sl < 2; sl++) {
+                        int ui = unit_index((Team)t, (Slot)sl);
+                        const UnitCmd *uc = &c[t].cmd[sl];
+                        if (uc->has_move && before[ui].alive && b.units[ui].alive &&
+                            (b.units[ui].pos.x != uc->move_to.x || b.units[ui].pos.y != uc->move_to.y)) rejected++;
+                        if (battle_stage_tile(st, b.units[ui].pos) == BTILE_WALL) on_wall++;
+                    }
+                }
+                turns++;
+            }
+            if (b.phase == BPHASE_END) ended++;
+            battle_core_free(&b);
+        }
+        printf("         greedy: %d battles, %d ended, avg %.1f turns, rejected moves=%d, on wall=%d\n",
+               battles, ended, battles ? (double)turns / battles : 0.0, rejected, on_wall);
+
+        if (mism || asym || rejected || on_wall) bad++;
+        if (mism || asym) printf("  verify : %d reach mismatches, %d asymmetric los pairs\n", mism, asym);
+    }
+    printf("  verify : %d stage(s) with problems\n", bad);
+    return bad ? 1 : 0;
+}
+
+// ===============================
+//  defs
+// ===============================
+// src の「skill <id> ...」行の power= を書き換えた写しを dst に作る
+static bool write_defs_variant(const char *src, const char *dst, const char *skill_id, int power)
+{
+    FILE *in = fopen(src, "r");
+    FILE *out = fopen(dst, "w");
+    if (!in || !out) {
+        if (in) fclose(in);
+        if (out) fclose(out);
+        return false;
+    }
+    char line[512], key[64];
+    snprintf(key, sizeof(key), "skill %s ", skill_id);
+    while (fgets(line, sizeof(line), in)) {
+        char *pw = strstr(line, "power=");
+        if (strncmp(line, key, strlen(key)) == 0 && pw) {
+            fwrite(line, 1, (size_t)(pw - line), out);
+            fprintf(out, "power=%d", power);
+            pw += 6;
+            while (*pw == '-' || (*pw >= '0' && *pw <= '9')) pw++;
+            fputs(pw, out);
+        } else {
+            fputs(line, out);
+        }
+    }
+    fclose(in);
+    return fclose(out) == 0;
+}
+
+static int cmd_defs(int argc, char **argv)
+{
+    const char *src = "assets/data/battle_defs.txt";
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "--src") == 0) src = argv[i + 1];
+    }
+    int lookups = arg_int(argc, argv, "--lookups", 2000000);
+    if (lookups < 1) lookups = 1;
+
+    // --- 読み込み（mmap → 検証 → 表へ） ---
+    const int loads = 2000;
+    double t0 = now_sec();
+    for (int i = 0; i < loads; i++) battle_defs_load(BATTLE_DEFS_PATH);
+    double t_load = (now_sec() - t0) / loads;
+    printf("[defs] %s: %d skills, %d chars, load=%.1fus  checksum=%08x\n",
+           BATTLE_DEFS_PATH, battle_skill_count(), char_def_count(), t_load * 1e6, (unsigned)battle_defs_checksum());
+
+    // --- 引く速さ（全 id を順に。scene/AI と同じ関数） ---
+    int ns = battle_skill_count();
+    const char *ids[BATTLE_SKILL_MAX];
+    for (int i = 0; i < ns; i++) ids[i] = battle_skill_at(i)->id;
+    uint64_t sink = 0;
+    t0 = now_sec();
+    for (int i = 0; i < lookups; i++) {
+        const SkillDef *sk = battle_skill_get(ids[i % ns]);
+        sink += (uint64_t)sk->power;
+    }
+    double t_skill = (now_sec() - t0) / lookups;
+    const char *cids[] = { "hero", "himari", "kiritan", "sayo" };
+    t0 = now_sec();
+    for (int i = 0; i < lookups; i++) sink += (uint64_t)char_def_get_or_fallback(cids[i & 3])->skill_count;
+    double t_char = (now_sec() - t0) / lookups;
+    printf("[defs] lookup: skill=%.1fns char=%.1fns  (sink %llu)\n",
+           t_skill * 1e9, t_char * 1e9, (unsigned long long)sink);
+
+    // --- 読み直し：値が変わる / 表の要素の場所は変わらない / 壊れた .bin は表を変えない ---
+    const char *tmp_txt = "battle_bench_defs.tmp.txt";
+    const char *tmp_bin = "battle_bench_defs.tmp.bin";
+    int bad = 0;
+    const SkillDef *before = battle_skill_get("himari_1");
+    const CharDef *cbefore = char_def_get("himari");
+    int old_power = before ? before->power : 0;
+    if (!before || !write_defs_variant(src, tmp_txt, "himari_1", old_power + 7) ||
+        !battle_defs_compile(tmp_txt, tmp_bin)) {
+        printf("  verify : could not build a variant from %s\n", src);
+        return 1;
+    }
+    t0 = now_sec();
+    bool ok = battle_defs_load(tmp_bin);
+    double t_reload = now_sec() - t0;
+    const SkillDef *after = battle_skill_get("himari_1");
+    if (!ok || after != before || after->power != old_power + 7 || char_def_get("himari") != cbefore ||
+        cbefore->skill_ids[0] != after->id) bad++;
+    printf("[defs] reload: %.1fus  himari_1 power %d -> %d  same address=%s\n",
+           t_reload * 1e6, old_power, after->power, (after == before) ? "yes" : "NO");
+
+    FILE *fp = fopen(tmp_bin, "r+b");
+    if (fp) { fseek(fp, 40, SEEK_SET); fputc(0x5A, fp); fclose(fp); }
+    uint32_t sum = battle_defs_checksum();
+    if (battle_defs_load(tmp_bin) || battle_defs_checksum() != sum || after->power != old_power + 7) bad++;
+
+    if (!battle_defs_load(BATTLE_DEFS_PATH) || battle_skill_get("himari_1")->power != old_power) bad++;
+    remove(tmp_txt);
+    remove(tmp_bin);
+    printf("  verify : %d problems (reload, corrupt blob rejected, restore)\n", bad);
+    return bad ? 1 : 0;
+}
+
+// ===============================
+//  stress
+// ===============================
+// 1対戦ぶんの状態（どれも呼ぶ側持ち。スレッド間で共有するのは置換表とステージ/技表だけ）
+typedef struct {
+    int id;
+    BattleCore core;
+    BattleThreatMap threat;
+    BattleReplay rep;
+    uint32_t rng;
+    uint64_t digest;         // 途中経過（プレビュー・脅威・イベント）を畳み込んだもの
+    int bad;                 // プレビュー/リプレイの食い違い
+} StressBattle;
+
+typedef struct {
+    int cores, live, turns;
+    BattleTT *tt;
+    int *next;
+    pthread_mutex_t *lock;
+    uint64_t *results;       // 対戦ごとの最終ダイジェスト
+    int bad;
+    uint64_t tt_nodes;
+} StressJob;
+
+static uint64_t stress_mix(uint64_t h, uint64_t v)
+{
+    h ^= v + 0x9E3779B97F4A7C15ull + (h << 6) + (h >> 2);
+    return h;
+}
+
+static void stress_begin(StressBattle *s, int id)
+{
+    memset(s, 0, sizeof(*s));
+    s->id = id;
+    s->rng = 0x51EDu ^ ((uint32_t)id * 2654435761u);
+
+    NetGameInfo p1, p2;
+    random_info(&s->rng, &p1);
+    random_info(&s->rng, &p2);
+    battle_replay_setup_core(&s->core, &p1, &p2);
+
+    uint32_t seed = battle_replay_match_seed(&p1, &p2) ^ (uint32_t)id;
+    int ns = battle_stage_catalog_count();
+    s->core.rng_seed = seed;
+    s->core.stage = (ns > 0 && id % 3 != 0) ? battle_stage_catalog_at(id % ns) : NULL;
+    battle_replay_init(&s->rep, &p1, &p2, seed);
+    battle_replay_set_stage(&s->rep, s->core.stage);
+    battle_threat_build(&s->threat, &s->core, true);
+}
+
+// 1ターン進める。終わったら true
+static bool stress_step(StressBattle *s, StressJob *j)
+{
+    BattleCore *b = &s->core;
+    TurnCmd c1, c2;
+    battle_ai_greedy_cmd(b, TEAM_P1, &c1);
+    random_cmd(b, TEAM_P2, &s->rng, &c2);
+
+    // 共有置換表での探索（手は使わない：他スレッドの書き込みで同点の選び方が変わりうるため）
+    if (s->id % 16 == 0 && b->turn == 1) {
+        BattleAiParams p = { .depth = 1, .tt = j->tt };
+        BattleAiStats st = { 0 };
+        TurnCmd best;
+        battle_ai_search(b, TEAM_P2, &p, &st, &best);
+        j->tt_nodes += st.nodes;
+    }
+
+    battle_threat_sync(&s->threat, b);
+    for (int ui = 0; ui < 4; ui++) {
+        s->digest = stress_mix(s->digest, (uint64_t)battle_threat_point(&s->threat, TEAM_P1, b->units[ui].pos));
+    }
+
+    BattlePreview pv;
+    bool has_pv = battle_core_preview(b, TEAM_P1, &c1, &c2, &pv);
+    int hp0[4];
+    for (int ui = 0; ui < 4; ui++) hp0[ui] = b->units[ui].stats.hp;
+
+    battle_replay_record_turn(&s->rep, b, &c1, &c2);
+    BattleEventCursor cur = battle_core_event_cursor_now(b);
+    battle_core_run_turn(b, &c1, &c2);
+    for (const BattleEvent *ev; (ev = battle_core_next_event(b, &cur)) != NULL; ) {
+        s->digest = stress_mix(s->digest, ((uint64_t)ev->type << 32) ^ (uint64_t)(uint32_t)ev->value ^ ((uint64_t)ev->actor_ui << 40));
+        if (ev->type == BEV_ANIM_SKILL && ev->skill_id) {
+            char path[128];
+            if (battle_skill_movie_path(ev->skill_id, path, sizeof(path))) s->digest = stress_mix(s->digest, strlen(path));
+        }
+    }
+    if (has_pv) {
+        for (int ui = 0; ui < 4; ui++) {
+            if (pv.hp_delta[ui] != b->units[ui].stats.hp - hp0[ui]) s->bad++;
+        }
+    }
+    s->digest = stress_mix(s->digest, b->hash);
+    return b->phase == BPHASE_END || b->turn >= j->turns;
+}
+
+// 終局：リプレイの最終局面がライブのコアと一致するか
+static uint64_t stress_finish(StressBattle *s)
+{
+    BattleCore seek;
+    memset(&seek, 0, sizeof(seek));
+    if (!battle_replay_seek(&s->rep, s->rep.turn_count, &seek) || seek.hash != s->core.hash) s->bad++;
+    battle_core_free(&seek);
+
+    uint64_t r = stress_mix(s->digest, (uint64_t)s->core.turn);
+    battle_replay_free(&s->rep);
+    battle_core_free(&s->core);
+    return r;
+}
+
+static int stress_take(StressJob *j)
+{
+    pthread_mutex_lock(j->lock);
+    int i = (*j->next)++;
+    pthread_mutex_unlock(j->lock);
+    return i < j->cores ? i : -1;
+}
+
+// live 個の対戦を同時に持ち、1ターンずつ順番に進める（終わった枠には次の対戦を入れる）
+static void* stress_worker(void *arg)
+{
+    StressJob *j = (StressJob*)arg;
+    StressBattle *slot = (StressBattle*)calloc((size_t)j->live, sizeof(StressBattle));
+    bool *busy = (bool*)calloc((size_t)j->live, sizeof(bool));
+    if (!slot || !busy) {
+        free(slot);
+        free(busy);
+        j->bad++;
+        return NULL;
+    }
+
+    int running = 0;
+    for (int k = 0; k < j->live; k++) {
+        int id = stress_take(j);
+        if (id < 0) break;
+        stress_begin(&slot[k], id);
+        busy[k] = true;
+        running++;
+    }
+    while (running > 0) {
+        for (int k = 0; k < j->live; k++) {
+            if (!busy[k] || !stress_step(&slot[k], j)) continue;
+
+            j->results[slot[k].id] = stress_finish(&slot[k]);
+            j->bad += slot[k].bad;
+            busy[k] = false;
+            running--;
+
+            int id = stress_take(j);
+            if (id >= 0) {
+                stress_begin(&slot[k], id);
+                busy[k] = true;
+                running++;
+            }
+        }
+    }
+    free(slot);
+    free(busy);
+    return NULL;
+}
+
+static double run_stress(int cores, int threads, int live, int turns, BattleTT *tt,
+                         uint64_t *results, int *bad, uint64_t *tt_nodes)
+{
+    pthread_t th[64];
+    StressJob job[64];
+    pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+    int next = 0;
+    if (threads > 64) threads = 64;
+
+    double t0 = now_sec();
+    int started = 0;
+    for (int t = 0; t < threads; t++) {
+        job[t] = (StressJob){ .cores = cores, .live = live, .turns = turns, .tt = tt,
+                              .next = &next, .lock = &lock, .results = results };
+        if (pthread_create(&th[t], NULL, stress_worker, &job[t]) == 0) started++;
+        else break;
+    }
+    if (started == 0) stress_worker(&job[0]);
+    for (int t = 0; t < started; t++) pthread_join(th[t], NULL);
+    double dt = now_sec() - t0;
+
+    *bad = 0;
+    *tt_nodes = 0;
+    for (int t = 0; t < (started ? started : 1); t++) {
+        *bad += job[t].bad;
+        *tt_nodes += job[t].tt_nodes;
+    }
+    return dt;
+}
+
+static int cmd_stress(int argc, char **argv)
+{
+    int cores   = arg_int(argc, argv, "--cores", 10000);
+    int threads = arg_int(argc, argv, "--threads", 8);
+    int live    = arg_int(argc, argv, "--live", 4);
+    int turns   = arg_int(argc, argv, "--turns", 40);
+    if (cores < 1) cores = 1;
+    if (threads < 1) threads = 1;
+    if (live < 1) live = 1;
+    if (turns < 1) turns = 1;
+
+    // プロセス共通データはスレッドを立てる前に
+    int nst = battle_stage_catalog_load("assets/stages");
+
+    BattleTT tt;
+    if (!battle_tt_init(&tt, 16)) return 1;
+    uint64_t *ref = (uint64_t*)calloc((size_t)cores, sizeof(uint64_t));
+    uint64_t *got = (uint64_t*)calloc((size_t)cores, sizeof(uint64_t));
+    if (!ref || !got) {
+        free(ref);
+        free(got);
+        battle_tt_free(&tt);
+        return 1;
+    }
+
+    int bad_ref = 0, bad = 0;
+    uint64_t nodes_ref = 0, nodes = 0;
+    double t_ref = run_stress(cores, 1, 1, turns, &tt, ref, &bad_ref, &nodes_ref);
+    battle_tt_clear(&tt);
+    double t_mt = run_stress(cores, threads, live, turns, &tt, got, &bad, &nodes);
+
+    int mism = 0;
+    for (int i = 0; i < cores; i++) mism += (ref[i] != got[i]);
+
+    printf("[stress] %d cores (%d stages, turn cap %d)  shared TT %zu entries\n",
+           cores, nst, turns, battle_tt_entry_count(&tt));
+    printf("  1 thread x 1 live  : %8.1f ms  %8.0f cores/s  search nodes %llu\n",
+           t_ref * 1e3, cores / t_ref, (unsigned long long)nodes_ref);
+    printf("  %d thread x %d live : %8.1f ms  %8.0f cores/s  search nodes %llu\n",
+           threads, live, t_mt * 1e3, cores / t_mt, (unsigned long long)nodes);
+    printf("  verify : %d/%d cores identical, preview/replay problems=%d\n",
+           cores - mism, cores, bad_ref + bad);
+
+    free(ref);
+    free(got);
+    battle_tt_free(&tt);
+    return (mism || bad_ref || bad) ? 1 : 0;
+}
+
+// ===============================
+//  units
+// ===============================
+// 旧実装の行動順（選択ソート。SPD 降順・同値は index 昇順）
+static void ref_action_order(const BattleCore *b, int *out, int *out_n)
+{
+    int tmp[BATTLE_UNIT_MAX], n = 0;
+    for (int i = 0; i < b->unit_count; i++) if (b->units[i].alive) tmp[n++] = i;
+    for (int i = 0; i < n; i++) {
+        for (int j = i + 1; j < n; j++) {
+            int a = tmp[i], c = tmp[j];
+            int sa = b->units[a].stats.spd, sc = b->units[c].stats.spd;
+            if (sc > sa || (sc == sa && c < a)) { int t = tmp[i]; tmp[i] = tmp[j]; tmp[j] = t; }
+        }
+    }
+    for (int i = 0; i < n; i++) out[i] = tmp[i];
+    *out_n = n;
+}
+
+// 旧実装の AOE 対象（全員を順に見る）
+static int ref_units_in_radius(const BattleCore *b, Pos c, int r, int *out)
+{
+    int n = 0;
+    for (int i = 0; i < b->unit_count; i++) {
+        const Unit *u = &b->units[i];
+        if (u->alive && manhattan(u->pos, c) <= r) out[n++] = i;
+    }
+    return n;
+}
+
+static void setup_team_battle(BattleCore *b, int team_size, uint32_t *rng)
+{
+    static const char *chars[] = { "himari", "kiritan", "sayo", "girl" };
+    BattleUnitSpec sp[2][BATTLE_TEAM_MAX];
+    for (int t = 0; t < 2; t++) {
+        for (int s = 0; s < team_size; s++) {
+            sp[t][s] = (BattleUnitSpec){
+                .char_id = (s == 0) ? "hero" : chars[lcg_next(rng) % 4],
+                .stats = { .hp = 60 + (int)(lcg_next(rng) % 80), .atk = 5 + (int)(lcg_next(rng) % 25),
+                           .spd = 5 + (int)(lcg_next(rng) % 15), .st = 30 + (int)(lcg_next(rng) % 90) },
+                .move = 2 + (int)(lcg_next(rng) % 4)
+            };
+        }
+    }
+    battle_core_init_teams(b, team_size, sp[0], true, sp[1], false);
+}
+
+// 技多め・AOE は敵の近くへ
+static void random_unit_cmds(const BattleCore *b, Team team, uint32_t *rng, UnitCmd *out)
+{
+    Team enemy = (team == TEAM_P1) ? TEAM_P2 : TEAM_P1;
+    for (int s = 0; s < b->team_size; s++) {
+        const Unit *u = &b->units[battle_core_unit_index(b, team, s)];
+        UnitCmd *c = &out[s];
+        int dx = (int)(lcg_next(rng) % (unsigned)(2 * u->move + 1)) - u->move;
+        int rest = u->move - abs(dx);
+        int dy = (int)(lcg_next(rng) % (unsigned)(2 * rest + 1)) - rest;
+        c->has_move = lcg_next(rng) % 4 != 0;
+        c->move_to = (Pos){ (int8_t)(u->pos.x + dx), (int8_t)(u->pos.y + dy) };
+        c->skill_index = (int8_t)((int)(lcg_next(rng) % 5) - 1);
+        c->target = (int8_t)(lcg_next(rng) % (unsigned)b->team_size);
+        Pos e = b->units[battle_core_unit_index(b, enemy, (int)(lcg_next(rng) % (unsigned)b->team_size))].pos;
+        c->center = (Pos){ (int8_t)(e.x + (int)(lcg_next(rng) % 3) - 1), (int8_t)(e.y + (int)(lcg_next(rng) % 3) - 1) };
+    }
+}
+
+static int cmd_units(int argc, char **argv)
+{
+    int battles = arg_int(argc, argv, "--battles", 500);
+    int turns   = arg_int(argc, argv, "--turns", 40);
+    int queries = arg_int(argc, argv, "--queries", 200000);
+    if (battles < 1) battles = 1;
+    if (turns < 1) turns = 1;
+    if (queries < 1) queries = 1;
+
+    static const int k_sizes[] = { 4, 8, 32 };
+    int bad = 0;
+
+    // 2v2 は init_teams でも従来の init と同じ局面になること
+    {
+        Stats h = { 100, 10, 8, 50 }, g = { 80, 12, 11, 60 };
+        BattleCore a, c;
+        battle_core_init(&a, "kiritan", false, h, g, "sayo", true, h, g);
+        BattleUnitSpec p1[2] = { { "hero", h, 0 }, { "kiritan", g, 0 } };
+        BattleUnitSpec p2[2] = { { "hero", h, 0 }, { "sayo", g, 0 } };
+        battle_core_init_teams(&c, 2, p1, false, p2, true);
+        if (a.hash != c.hash || a.units[3].pos.x != c.units[3].pos.x || a.units[1].move != c.units[1].move) bad++;
+    }
+
+    printf("[units] sizeof(BattleCore)=%zu  BATTLE_TEAM_MAX=%d\n", sizeof(BattleCore), BATTLE_TEAM_MAX);
+    for (size_t si = 0; si < sizeof(k_sizes) / sizeof(k_sizes[0]); si++) {
+        int units = k_sizes[si];
+        if (units > BATTLE_UNIT_MAX) {
+            printf("  %2d units: skipped (BATTLE_TEAM_MAX=%d; make bench-wide)\n", units, BATTLE_TEAM_MAX);
+            continue;
+        }
+        int team = units / 2;
+
+        // --- 局面を作る（対戦を進めながら途中局面を集める） ---
+        const int npos = 256;
+        BattleCore *pos = (BattleCore*)calloc((size_t)npos, sizeof(BattleCore));
+        if (!pos) return 1;
+        uint32_t rng = 777u + (uint32_t)units;
+        UnitCmd c1[BATTLE_TEAM_MAX], c2[BATTLE_TEAM_MAX];
+        int mism = 0;
+        for (int p = 0; p < npos; p++) {
+            setup_team_battle(&pos[p], team, &rng);
+            int steps = (int)(lcg_next(&rng) % 12);
+            for (int t = 0; t < steps && pos[p].phase != BPHASE_END; t++) {
+                random_unit_cmds(&pos[p], TEAM_P1, &rng, c1);
+                random_unit_cmds(&pos[p], TEAM_P2, &rng, c2);
+                battle_core_run_turn_units(&pos[p], c1, c2);
+            }
+            battle_core_free(&pos[p]);
+            // SPD の同値を多めに
+            for (int u = 0; u < units; u++) {
+                if (lcg_next(&rng) % 3 == 0) pos[p].units[u].stats.spd = 10;
+            }
+        }
+
+        // --- 行動順 ---
+        int o1[BATTLE_UNIT_MAX], o2[BATTLE_UNIT_MAX], n1 = 0, n2 = 0;
+        for (int p = 0; p < npos; p++) {
+            ref_action_order(&pos[p], o1, &n1);
+            battle_core_build_action_order(&pos[p], o2, &n2);
+            if (n1 != n2 || memcmp(o1, o2, sizeof(int) * (size_t)n1) != 0) mism++;
+        }
+        const int reps = 2000000 / units;
+        int sink = 0;
+        double t0 = now_sec();
+        for (int r = 0; r < reps; r++) {
+            ref_action_order(&pos[r & (npos - 1)], o1, &n1);
+            sink += o1[0];
+        }
+        double t_ref = (now_sec() - t0) / reps;
+        t0 = now_sec();
+        for (int r = 0; r < reps; r++) {
+            battle_core_build_action_order(&pos[r & (npos - 1)], o2, &n2);
+            sink += o2[0];
+        }
+        double t_new = (now_sec() - t0) / reps;
+
+        // --- AOE の対象探し ---
+        Pos *qc = (Pos*)malloc(sizeof(Pos) * (size_t)queries);
+        int *qr = (int*)malloc(sizeof(int) * (size_t)queries);
+        if (!qc || !qr) { free(qc); free(qr); free(pos); return 1; }
+        for (int i = 0; i < queries; i++) {
+            qc[i] = (Pos){ (int8_t)(lcg_next(&rng) % MAP_W), (int8_t)(lcg_next(&rng) % MAP_H) };
+            qr[i] = 1 + (int)(lcg_next(&rng) % 3);
+        }
+        int a1[BATTLE_UNIT_MAX], a2[BATTLE_UNIT_MAX], hits = 0;
+        for (int i = 0; i < queries; i++) {
+            const BattleCore *b = &pos[i & (npos - 1)];
+            int m1 = ref_units_in_radius(b, qc[i], qr[i], a1);
+            int m2 = battle_core_units_in_radius(b, qc[i], qr[i], a2);
+            if (m1 != m2 || memcmp(a1, a2, sizeof(int) * (size_t)m1) != 0) mism++;
+            hits += m1;
+        }
+        t0 = now_sec();
+        for (int i = 0; i < queries; i++) sink += ref_units_in_radius(&pos[i & (npos - 1)], qc[i], qr[i], a1);
+        double t_aref = (now_sec() - t0) / queries;
+        t0 = now_sec();
+        for (int i = 0; i < queries; i++) sink += battle_core_units_in_radius(&pos[i & (npos - 1)], qc[i], qr[i], a2);
+        double t_anew = (now_sec() - t0) / queries;
+        free(qc);
+        free(qr);
+        free(pos);
+
+        // --- 対戦を回す（毎ターン hash を全計算と照合） ---
+        long long turn_count = 0;
+        int ended = 0;
+        double t_run = 0.0;
+        for (int g = 0; g < battles; g++) {
+            BattleCore b;
+            setup_team_battle(&b, team, &rng);
+            for (int t = 0; t < turns && b.phase != BPHASE_END; t++) {
+                random_unit_cmds(&b, TEAM_P1, &rng, c1);
+                random_unit_cmds(&b, TEAM_P2, &rng, c2);
+                double ts = now_sec();
+                battle_core_run_turn_units(&b, c1, c2);
+                t_run += now_sec() - ts;
+                turn_count++;
+                if (b.hash != battle_core_compute_hash(&b)) mism++;
+            }
+            ended += (b.phase == BPHASE_END);
+            battle_core_free(&b);
+        }
+
+        printf("  %2d units: order  old=%6.1fns new=%6.1fns (x%.2f, %s)\n",
+               units, t_ref * 1e9, t_new * 1e9, t_ref / t_new, units <= 4 ? "network" : "radix");
+        printf("            aoe    scan=%5.1fns new=%5.1fns (x%.2f, %s)  avg hits %.2f\n",
+               t_aref * 1e9, t_anew * 1e9, t_aref / t_anew,
+               units > BATTLE_AOE_SCAN_MAX ? "bucket" : "scan", (double)hits / queries);
+        printf("            turns  %lld in %.1fms  %.0f turns/s  ended %d/%d  (sink %d)\n",
+               turn_count, t_run * 1e3, turn_count / t_run, ended, battles, sink & 1);
+        printf("            verify %d mismatches\n", mism);
+        bad += mism;
+    }
+    printf("  verify : %d problems\n", bad);
+    return bad ? 1 : 0;
+}
+
+// ===============================
+//  analytics
+// ===============================
+// 記録とは別に、イベントストリームから直接数えた技ごとの集計（照合用。技は id で持つ）
+typedef struct {
+    const char *cur_id;     // 直近の演出の技
+    bool cur_counter;
+    struct { const char *id; BattleAnalyticsSkillSum s; } row[BATTLE_SKILL_MAX + 1];
+    int n;
+} AnaRef;
+
+static BattleAnalyticsSkillSum* ana_ref_row(AnaRef *r, const char *id)
+{
+    for (int i = 0; i < r->n; i++) {
+        if (r->row[i].id == id || (id && r->row[i].id && strcmp(r->row[i].id, id) == 0)) return &r->row[i].s;
+    }
+    if (r->n > BATTLE_SKILL_MAX) return &r->row[BATTLE_SKILL_MAX].s;
+    r->row[r->n].id = id;
+    return &r->row[r->n++].s;
+}
+
+static void ana_ref_collect(AnaRef *r, const BattleCore *b, BattleEventCursor *cur)
+{
+    const BattleEvent *ev;
+    while ((ev = battle_core_next_event(b, cur)) != NULL) {
+        if (ev->type == BEV_ANIM_SKILL) {
+            const SkillDef *sk = ev->skill_id ? battle_skill_get(ev->skill_id) : NULL;
+            r->cur_id = sk ? sk->id : NULL;
+            r->cur_counter = !sk || sk->type == SKTYPE_COUNTER;
+            BattleAnalyticsSkillSum *s = ana_ref_row(r, r->cur_id);
+            s->uses++;
+            s->counter_triggers += r->cur_counter;
+        } else if (ev->type == BEV_EFFECT_DAMAGE) {
+            BattleAnalyticsSkillSum *s = ana_ref_row(r, r->cur_id);
+            s->damage_rows++;
+            s->damage += (uint64_t)ev->value;
+            s->counter_hits += r->cur_counter;
+        } else if (ev->type == BEV_EFFECT_HEAL) {
+            BattleAnalyticsSkillSum *s = ana_ref_row(r, r->cur_id);
+            s->heal_rows++;
+            s->heal += (uint64_t)ev->value;
+        }
+    }
+}
+
+// 1戦（記録先 an / 照合用 ref は NULL 可）。戻り値はターン数
+static int ana_play(uint32_t id, int turns, BattleAnalytics *an, AnaRef *ref)
+{
+    uint32_t rng = 0x9E3779B9u ^ (id * 2654435761u);
+    NetGameInfo p1, p2;
+    random_info(&rng, &p1);
+    random_info(&rng, &p2);
+    BattleCore b;
+    battle_replay_setup_core(&b, &p1, &p2);
+    if (an) battle_analytics_begin_battle(an, &b, id);
+    BattleEventCursor cur = battle_core_event_cursor_now(&b);
+
+    int t = 0;
+    for (; t < turns && b.phase != BPHASE_END; t++) {
+        TurnCmd c1, c2;
+        random_cmd_active(&b, TEAM_P1, &rng, &c1);
+        random_cmd_active(&b, TEAM_P2, &rng, &c2);
+        battle_core_run_turn(&b, &c1, &c2);
+        if (an) battle_analytics_collect(an, &b);
+        if (ref) ana_ref_collect(ref, &b, &cur);
+    }
+    battle_core_free(&b);
+    return t;
+}
+
+static int cmd_analytics(int argc, char **argv)
+{
+    int battles = arg_int(argc, argv, "--battles", 50000);
+    int turns   = arg_int(argc, argv, "--turns", 60);
+    const char *out = "/tmp/battle_bench.tvsa";
+    for (int i = 0; i + 1 < argc; i++) if (strcmp(argv[i], "--out") == 0) out = argv[i + 1];
+    if (battles < 1) battles = 1;
+    if (turns < 1) turns = 1;
+
+    printf("[analytics] battles=%d turns<=%d out=%s\n", battles, turns, out);
+
+    // --- 記録なし ---
+    long long turn_sum = 0;
+    double t0 = now_sec();
+    for (int i = 0; i < battles; i++) turn_sum += ana_play((uint32_t)i, turns, NULL, NULL);
+    double t_plain = now_sec() - t0;
+
+    // --- 記録あり ---
+    BattleAnalytics *an = battle_analytics_open(out, 0);
+    if (!an) {
+        fprintf(stderr, "cannot open %s\n", out);
+        return 1;
+    }
+    t0 = now_sec();
+    for (int i = 0; i < battles; i++) ana_play((uint32_t)i, turns, an, NULL);
+    BattleAnalyticsStats st;
+    bool wrote = battle_analytics_close(an, &st);
+    double t_rec = now_sec() - t0;
+
+    printf("  plain    : %7.1f ms  %9.0f battles/s  (%lld turns)\n",
+           t_plain * 1e3, battles / t_plain, turn_sum);
+    printf("  recorded : %7.1f ms  %9.0f battles/s  overhead %+.1f%%  (write wait %.1f ms)\n",
+           t_rec * 1e3, battles / t_rec, 100.0 * (t_rec / t_plain - 1.0), st.wait_sec * 1e3);
+    printf("  file     : %llu rows  %llu chunks  %.1f MB  (%.1f B/row, lost %llu)\n",
+           (unsigned long long)st.rows, (unsigned long long)st.chunks, st.bytes / 1048576.0,
+           st.rows ? (double)st.bytes / st.rows : 0.0, (unsigned long long)st.lost);
+
+    // --- 読み直して集計 ---
+    BattleAnalyticsFile f;
+    t0 = now_sec();
+    if (!battle_analytics_map(&f, out)) {
+        fprintf(stderr, "cannot map %s\n", out);
+        return 1;
+    }
+    double t_map = now_sec() - t0;
+    BattleAnalyticsSkillSum sum[BATTLE_SKILL_MAX + 1];
+    memset(sum, 0, sizeof(sum));
+    t0 = now_sec();
+    for (int c = 0; c < f.chunk_count; c++) battle_analytics_sum_skills(&f.chunks[c], sum);
+    double t_scan = now_sec() - t0;
+    printf("  query    : map %.2f ms  scan %.1f ms  (%.0f Mrows/s, %.0f battles/s)\n",
+           t_map * 1e3, t_scan * 1e3, f.rows / t_scan / 1e6, battles / t_scan);
+
+    // --- 照合（記録とは別にイベントから直接数える） ---
+    static AnaRef ref;
+    memset(&ref, 0, sizeof(ref));
+    for (int i = 0; i < battles; i++) ana_play((uint32_t)i, turns, NULL, &ref);
+
+    int bad = (!wrote || st.lost || f.rows != st.rows) ? 1 : 0;
+    uint64_t trig = 0, hits = 0, events = 0;
+    for (int i = 0; i < ref.n; i++) {
+        events += ref.row[i].s.uses + ref.row[i].s.damage_rows + ref.row[i].s.heal_rows;
+        int k = 0;      // ファイル側の番号（+1。0 = 技なし）
+        if (ref.row[i].id) {
+            for (k = 1; k <= f.skill_count; k++) if (strcmp(f.skill_ids[k - 1], ref.row[i].id) == 0) break;
+        }
+        if (k > f.skill_count || memcmp(&sum[k], &ref.row[i].s, sizeof(BattleAnalyticsSkillSum)) != 0) bad++;
+        trig += ref.row[i].s.counter_triggers;
+        hits += ref.row[i].s.counter_hits;
+    }
+    if (events != f.rows) bad++;
+    printf("  counters : %llu triggers, %llu hit (%.1f%%)\n",
+           (unsigned long long)trig, (unsigned long long)hits, trig ? 100.0 * hits / trig : 0.0);
+    printf("  verify   : %d skills checked, %d mismatches\n", ref.n, bad);
+
+    battle_analytics_unmap(&f);
+    return bad ? 1 : 0;
+}
+
+// ===============================
+//  undo
+// ===============================
+// 戻したときに一致すべき部分（イベントストリームは戻さないので比べない）
+static bool core_state_equal(const BattleCore *a, const BattleCore *b)
+{
+    return a->hash == b->hash && a->phase == b->phase && a->turn == b->turn
+        && a->_has_cmd[0] == b->_has_cmd[0] && a->_has_cmd[1] == b->_has_cmd[1]
+        && a->_exec_active == b->_exec_active
+        && a->last_executed_skill_id == b->last_executed_skill_id
+        && a->last_executed_actor_ui == b->last_executed_actor_ui
+        && a->last_executed_target_ui == b->last_executed_target_ui
+        && memcmp(a->units, b->units, sizeof(a->units)) == 0
+        && memcmp(a->hp_max, b->hp_max, sizeof(a->hp_max)) == 0
+        && memcmp(a->_pending_cmd, b->_pending_cmd, sizeof(a->_pending_cmd)) == 0
+        && memcmp(a->counter_ready, b->counter_ready, sizeof(a->counter_ready)) == 0
+        && memcmp(a->counter_range, b->counter_range, sizeof(a->counter_range)) == 0
+        && memcmp(a->counter_skill_id, b->counter_skill_id, sizeof(a->counter_skill_id)) == 0
+        && memcmp(a->aoe_bucket, b->aoe_bucket, sizeof(a->aoe_bucket)) == 0;
+}
+
+static void run_for(BattleCore *b, Team team, const TurnCmd *mine, const TurnCmd *enemy)
+{
+    if (team == TEAM_P1) battle_core_run_turn(b, mine, enemy);
+    else                 battle_core_run_turn(b, enemy, mine);
+}
+
+static int cmd_undo(int argc, char **argv)
+{
+    int npos  = arg_int(argc, argv, "--positions", 300);
+    int turns = arg_int(argc, argv, "--turns", 2000);
+    if (npos < 1) npos = 1;
+    if (turns < 1) turns = 1;
+
+    BattleCore *pos = (BattleCore*)calloc((size_t)npos, sizeof(BattleCore));
+    TurnCmd *cands = (TurnCmd*)malloc(sizeof(TurnCmd) * BATTLE_AI_CAND_MAX);
+    if (!pos || !cands) return 1;
+    npos = collect_positions(pos, npos);
+    printf("[undo] sizeof(BattleCore)=%zu  entry=%zuB  positions=%d\n",
+           sizeof(BattleCore), sizeof(BattleJournalEntry), npos);
+
+    BattleJournal jr;
+    memset(&jr, 0, sizeof(jr));
+    int bad = 0;
+
+    // --- 探索の戻り（深さ1 / 深さ2） ---
+    for (int depth = 1; depth <= 2; depth++) {
+        uint64_t sum_copy = 0, sum_undo = 0;
+        long long nodes = 0, entries = 0;
+        double t_copy = 0.0, t_undo = 0.0;
+
+        for (int p = 0; p < npos; p++) {
+            const BattleCore *root = &pos[p];
+            if (root->phase == BPHASE_END) continue;
+            Team team = (p & 1) ? TEAM_P2 : TEAM_P1;
+            Team enemy = (team == TEAM_P1) ? TEAM_P2 : TEAM_P1;
+            int n = battle_ai_gen_candidates(root, team, cands, BATTLE_AI_CAND_MAX);
+            if (n > 16) n = 16;
+            TurnCmd ecmd;
+            battle_ai_greedy_cmd(root, enemy, &ecmd);
+
+            // 丸ごとコピー（今の探索と同じ）
+            double t0 = now_sec();
+            for (int i = 0; i < n; i++) {
+                BattleCore c1;
+                battle_core_copy(&c1, root);
+                run_for(&c1, team, &cands[i], &ecmd);
+                sum_copy += c1.hash;
+                if (depth == 2) {
+                    for (int k = 0; k < n; k++) {
+                        BattleCore c2;
+                        battle_core_copy(&c2, &c1);
+                        run_for(&c2, team, &cands[k], &ecmd);
+                        sum_copy += c2.hash;
+                        battle_core_free(&c2);
+                    }
+                }
+                battle_core_free(&c1);
+            }
+            t_copy += now_sec() - t0;
+
+            // 記録して戻す（作業用のコピーは局面ごとに1回）
+            t0 = now_sec();
+            BattleCore w;
+            battle_core_copy(&w, root);
+            battle_core_journal_attach(&w, &jr);
+            for (int i = 0; i < n; i++) {
+                int m1 = battle_core_journal_mark(&w);
+                run_for(&w, team, &cands[i], &ecmd);
+                sum_undo += w.hash;
+                if (depth == 2) {
+                    for (int k = 0; k < n; k++) {
+                        int m2 = battle_core_journal_mark(&w);
+                        run_for(&w, team, &cands[k], &ecmd);
+                        sum_undo += w.hash;
+                        entries += jr.count - m2;
+                        if (!battle_core_undo_to(&w, m2)) bad++;
+                    }
+                }
+                entries += jr.count - m1;
+                if (!battle_core_undo_to(&w, m1)) bad++;
+            }
+            t_undo += now_sec() - t0;
+            nodes += (depth == 2) ? (long long)n * (n + 1) : n;
+
+            if (!core_state_equal(&w, root)) bad++;
+            battle_core_journal_attach(&w, NULL);
+            battle_core_free(&w);
+        }
+        if (sum_copy != sum_undo) bad++;
+        printf("  search d%d : %lld nodes  copy %6.0f ns/node  undo %6.0f ns/node  (x%.2f, %.1f entries/turn)\n",
+               depth, nodes, t_copy / nodes * 1e9, t_undo / nodes * 1e9, t_copy / t_undo,
+               (double)entries / nodes);
+    }
+
+    // --- 逆再生（毎ターンの印 vs 毎ターンのスナップショット） ---
+    {
+        BattleReplay rec;
+        record_long_battle(&rec, turns);
+        int T = rec.turn_count;
+        BattleCore *snap = (BattleCore*)malloc(sizeof(BattleCore) * (size_t)(T + 1));
+        int *marks = (int*)malloc(sizeof(int) * (size_t)(T + 1));
+        if (!snap || !marks) return 1;
+
+        // 1回目は時間だけ、2回目は1ターン戻すたびにスナップショットと照合
+        BattleCore b;
+        BattleCore tmp;
+        size_t jr_bytes = 0;
+        double t_copy = 0.0, t_undo = 0.0;
+        int mism = 0;
+        for (int pass = 0; pass < 2; pass++) {
+            battle_replay_setup_core(&b, &rec.info[TEAM_P1], &rec.info[TEAM_P2]);
+            battle_core_journal_attach(&b, &jr);
+            for (int t = 0; t < T; t++) {
+                snap[t] = b;
+                marks[t] = battle_core_journal_mark(&b);
+                battle_core_run_turn(&b, &rec.turns[t].cmd[TEAM_P1], &rec.turns[t].cmd[TEAM_P2]);
+            }
+            jr_bytes = (size_t)jr.count * sizeof(BattleJournalEntry);
+
+            if (pass == 0) {
+                double t0 = now_sec();
+                for (int t = T - 1; t >= 0; t--) {
+                    memcpy(&tmp, &snap[t], sizeof(BattleCore));
+                    __asm__ volatile("" : : "r"(&tmp) : "memory");
+                }
+                t_copy = now_sec() - t0;
+                t0 = now_sec();
+                for (int t = T - 1; t >= 0; t--) {
+                    if (!battle_core_undo_to(&b, marks[t])) mism++;
+                }
+                t_undo = now_sec() - t0;
+            } else {
+                for (int t = T - 1; t >= 0; t--) {
+                    if (!battle_core_undo_to(&b, marks[t]) || !core_state_equal(&b, &snap[t])) mism++;
+                }
+            }
+            battle_core_journal_attach(&b, NULL);
+            battle_core_free(&b);
+        }
+        printf("  scrub     : %d turns back  snapshots %.1f KB %.0f ns/turn  journal %.1f KB %.0f ns/turn  mismatches %d\n",
+               T, (double)T * sizeof(BattleCore) / 1024.0, t_copy / T * 1e9,
+               jr_bytes / 1024.0, t_undo / T * 1e9, mism);
+        bad += mism;
+
+        battle_replay_free(&rec);
+        free(snap);
+        free(marks);
+    }
+
+    // 写し（battle_core_copy）は記録しない
+    {
+        BattleCore w;
+        battle_core_copy(&w, &pos[0]);
+        battle_core_journal_attach(&w, &jr);
+        BattleCore c;
+        battle_core_copy(&c, &w);
+        TurnCmd c1, c2;
+        battle_ai_greedy_cmd(&c, TEAM_P1, &c1);
+        battle_ai_greedy_cmd(&c, TEAM_P2, &c2);
+        battle_core_run_turn(&c, &c1, &c2);
+        if (jr.count != 0) bad++;
+        battle_core_free(&c);
+        battle_core_free(&w);
+    }
+
+    printf("  verify    : %d problems\n", bad);
+    battle_journal_free(&jr);
+    free(cands);
+    free_positions(pos, npos);
+    free(pos);
+    return bad ? 1 : 0;
+}
+
+// ===============================
+//  main
+// ===============================
+int main(int argc, char **argv)
+{
+    if (argc >= 2 && !battle_defs_load(BATTLE_DEFS_PATH)) return 1;
+
+    if (argc >= 2 && strcmp(argv[1], "search") == 0) return cmd_search(argc - 1, argv + 1);
+    if (argc >= 2 && strcmp(argv[1], "replay") == 0) return cmd_replay(argc - 1, argv + 1);
+    if (argc >= 2 && strcmp(argv[1], "batch") == 0) return cmd_batch(argc - 1, argv + 1);
+    if (argc >= 2 && strcmp(argv[1], "alloc") == 0) return cmd_alloc(argc - 1, argv + 1);
+    if (argc >= 2 && strcmp(argv[1], "rng") == 0) return cmd_rng(argc - 1, argv + 1);
+    if (argc >= 2 && strcmp(argv[1], "preview") == 0) return cmd_preview(argc - 1, argv + 1);
+    if (argc >= 2 && strcmp(argv[1], "threat") == 0) return cmd_threat(argc - 1, argv + 1);
+    if (argc >= 2 && strcmp(argv[1], "stage") == 0) return cmd_stage(argc - 1, argv + 1);
+    if (argc >= 2 && strcmp(argv[1], "defs") == 0) return cmd_defs(argc - 1, argv + 1);
+    if (argc >= 2 && strcmp(argv[1], "stress") == 0) return cmd_stress(argc - 1, argv + 1);
+    if (argc >= 2 && strcmp(argv[1], "units") == 0) return cmd_units(argc - 1, argv + 1);
+    if (argc >= 2 && strcmp(argv[1], "analytics") == 0) return cmd_analytics(argc - 1, argv + 1);
+    if (argc >= 2 && strcmp(argv[1], "undo") == 0) return cmd_undo(argc - 1, argv + 1);
+
+    fprintf(stderr,
+            "usage: %s <command> [options]\n"
+            "  search [--depth N] [--positions N] [--tt-mb N] [--threads N]\n"
+            "  replay [--turns N] [--seeks N] [--out PATH]\n"
+            "  batch  [--battles N] [--turns N]\n"
+            "  alloc  [--girl ID] [--points N] [--generations N] [--threads N]\n"
+            "  rng    [--draws N] [--threads N]\n"
+            "  preview [--positions N]\n"
+            "  threat [--positions N]\n"
+            "  stage  [--dir PATH] [--queries N] [--battles N]\n"
+            "  defs   [--src PATH] [--lookups N]\n"
+            "  stress [--cores N] [--threads N] [--live N] [--turns N]\n"
+            "  units  [--battles N] [--turns N] [--queries N]\n"
+            "  analytics [--battles N] [--turns N] [--out PATH]\n"
+            "  undo   [--positions N] [--turns N]\n",
+            argv[0]);
+    return 2;
+}
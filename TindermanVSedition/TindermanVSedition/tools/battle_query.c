@@ -0,0 +1,276 @@
+// tools/battle_query.c — 対戦分析ファイル（.tvsa）の集計
+//
+//   ./tools/battle_query [--threads N] [--csv PATH] FILE.tvsa...
+//
+//   - balance_sweep --analytics / battle_bench analytics が書いた .tvsa を mmap して列をなめる
+//   - 技ごと：使用回数 / ダメージ回数・合計・1回あたり / 回復 / カウンターの発動回数と命中率
+//     （命中 = 構えが発動して反撃が射程内に届いた）
+//   - 複数ファイルは技id で突き合わせて合算する。チャンク単位で --threads 本に分けて集計
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "battle/tvse_battle.h"
+
+#define QUERY_SKILL_MAX 256     // 全ファイルの技id の種類（足りなければ以降は "(other)" へ）
+
+// ===============================
+//  集計
+// ===============================
+typedef struct {
+    const BattleAnalyticsChunk *chunk;
+    int file;
+} QueryChunk;
+
+typedef struct {
+    BattleAnalyticsFile *files;
+    int file_count;
+    QueryChunk *chunks;
+    int chunk_count;
+    atomic_int next;
+} Query;
+
+typedef struct {
+    Query *q;
+    // [file][技]（ファイルの技表の番号のまま。突き合わせは最後に）
+    BattleAnalyticsSkillSum *sum;
+    uint64_t battles;       // 対戦番号が前の行から変わった回数（1つの .tvsa には1対戦ずつ並んでいる）
+} QueryWorker;
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void* query_worker(void *arg)
+{
+    QueryWorker *w = (QueryWorker*)arg;
+    Query *q = w->q;
+    for (;;) {
+        int i = atomic_fetch_add(&q->next, 1);
+        if (i >= q->chunk_count) break;
+        const QueryChunk *qc = &q->chunks[i];
+        const BattleAnalyticsChunk *c = qc->chunk;
+        battle_analytics_sum_skills(c, &w->sum[(size_t)qc->file * (BATTLE_SKILL_MAX + 1)]);
+
+        // チャンクをまたぐ対戦は、前のチャンクの最後の行と同じなら数えない
+        uint64_t n = 0;
+        uint32_t prev = c->battle[0];
+        if (c != &q->files[qc->file].chunks[0]) {
+            const BattleAnalyticsChunk *pc = c - 1;
+            n += (pc->battle[pc->rows - 1] != prev);
+        } else {
+            n++;
+        }
+        for (uint32_t r = 1; r < c->rows; r++) {
+            n += (c->battle[r] != prev);
+            prev = c->battle[r];
+        }
+        w->battles += n;
+    }
+    return NULL;
+}
+
+// ===============================
+//  出力
+// ===============================
+typedef struct {
+    char id[BATTLE_SKILL_ID_MAX];
+    BattleAnalyticsSkillSum s;
+} SkillRow;
+
+static int find_or_add(SkillRow *rows, int *n, const char *id)
+{
+    for (int i = 0; i < *n; i++) if (strcmp(rows[i].id, id) == 0) return i;
+    if (*n >= QUERY_SKILL_MAX) return QUERY_SKILL_MAX - 1;
+    snprintf(rows[*n].id, sizeof(rows[*n].id), "%s", id);
+    return (*n)++;
+}
+
+static void add_sum(BattleAnalyticsSkillSum *d, const BattleAnalyticsSkillSum *s)
+{
+    d->uses += s->uses;
+    d->damage_rows += s->damage_rows;
+    d->damage += s->damage;
+    d->heal_rows += s->heal_rows;
+    d->heal += s->heal;
+    d->counter_triggers += s->counter_triggers;
+    d->counter_hits += s->counter_hits;
+}
+
+static int cmp_damage_desc(const void *a, const void *b)
+{
+    const SkillRow *x = (const SkillRow*)a, *y = (const SkillRow*)b;
+    if (x->s.damage != y->s.damage) return (x->s.damage < y->s.damage) ? 1 : -1;
+    return strcmp(x->id, y->id);
+}
+
+static double ratio(uint64_t a, uint64_t b)
+{
+    return b ? (double)a / (double)b : 0.0;
+}
+
+static bool write_csv(const SkillRow *rows, int n, const char *path)
+{
+    FILE *fp = fopen(path, "w");
+    if (!fp) return false;
+    fprintf(fp, "skill,uses,damage_hits,damage,damage_per_use,heal_hits,heal,counter_triggers,counter_hits,counter_hit_rate\n");
+    for (int i = 0; i < n; i++) {
+        const BattleAnalyticsSkillSum *s = &rows[i].s;
+        fprintf(fp, "%s,%llu,%llu,%llu,%.3f,%llu,%llu,%llu,%llu,%.4f\n", rows[i].id,
+                (unsigned long long)s->uses, (unsigned long long)s->damage_rows,
+                (unsigned long long)s->damage, ratio(s->damage, s->uses),
+                (unsigned long long)s->heal_rows, (unsigned long long)s->heal,
+                (unsigned long long)s->counter_triggers, (unsigned long long)s->counter_hits,
+                ratio(s->counter_hits, s->counter_triggers));
+    }
+    return fclose(fp) == 0;
+}
+
+// ===============================
+//  main
+// ===============================
+int main(int argc, char **argv)
+{
+    int threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    const char *csv = NULL;
+    const char **paths = (const char**)calloc((size_t)argc, sizeof(char*));
+    int npaths = 0;
+    if (!paths) return 1;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--csv") == 0 && i + 1 < argc) csv = argv[++i];
+        else if (argv[i][0] == '-') { npaths = 0; break; }
+        else paths[npaths++] = argv[i];
+    }
+    if (npaths <= 0) {
+        fprintf(stderr, "usage: %s [--threads N] [--csv PATH] FILE.tvsa...\n", argv[0]);
+        free(paths);
+        return 2;
+    }
+    if (threads < 1) threads = 1;
+
+    double t0 = now_sec();
+    Query q;
+    memset(&q, 0, sizeof(q));
+    q.files = (BattleAnalyticsFile*)calloc((size_t)npaths, sizeof(BattleAnalyticsFile));
+    if (!q.files) return 1;
+    uint64_t rows = 0, bytes = 0;
+    for (int i = 0; i < npaths; i++) {
+        if (!battle_analytics_map(&q.files[q.file_count], paths[i])) {
+            fprintf(stderr, "skip %s: not a readable .tvsa\n", paths[i]);
+            continue;
+        }
+        const BattleAnalyticsFile *f = &q.files[q.file_count++];
+        q.chunk_count += f->chunk_count;
+        rows += f->rows;
+        bytes += f->map_size;
+    }
+    if (q.file_count == 0) return 1;
+    if (q.file_count > 1) {
+        for (int i = 1; i < q.file_count; i++) {
+            if (q.files[i].defs_checksum != q.files[0].defs_checksum) {
+                fprintf(stderr, "warning: files were written with different skill/char definitions\n");
+                break;
+            }
+        }
+    }
+
+    q.chunks = (QueryChunk*)malloc(sizeof(QueryChunk) * (size_t)q.chunk_count);
+    if (!q.chunks) return 1;
+    for (int i = 0, k = 0; i < q.file_count; i++) {
+        for (int c = 0; c < q.files[i].chunk_count; c++, k++) {
+            q.chunks[k] = (QueryChunk){ &q.files[i].chunks[c], i };
+        }
+    }
+    double t_map = now_sec() - t0;
+
+    // --- 列をなめる ---
+    if (threads > q.chunk_count) threads = q.chunk_count;
+    QueryWorker *w = (QueryWorker*)calloc((size_t)threads, sizeof(QueryWorker));
+    pthread_t *th = (pthread_t*)calloc((size_t)threads, sizeof(pthread_t));
+    if (!w || !th) return 1;
+    t0 = now_sec();
+    for (int t = 0; t < threads; t++) {
+        w[t].q = &q;
+        w[t].sum = (BattleAnalyticsSkillSum*)calloc((size_t)q.file_count * (BATTLE_SKILL_MAX + 1),
+                                                   sizeof(BattleAnalyticsSkillSum));
+        if (!w[t].sum) return 1;
+    }
+    for (int t = 1; t < threads; t++) pthread_create(&th[t], NULL, query_worker, &w[t]);
+    query_worker(&w[0]);
+    for (int t = 1; t < threads; t++) pthread_join(th[t], NULL);
+    double t_scan = now_sec() - t0;
+
+    // --- 技id で突き合わせる ---
+    SkillRow *out = (SkillRow*)calloc(QUERY_SKILL_MAX, sizeof(SkillRow));
+    if (!out) return 1;
+    int nout = 0;
+    uint64_t battles = 0;
+    for (int t = 0; t < threads; t++) {
+        battles += w[t].battles;
+        for (int i = 0; i < q.file_count; i++) {
+            const BattleAnalyticsFile *f = &q.files[i];
+            const BattleAnalyticsSkillSum *s = &w[t].sum[(size_t)i * (BATTLE_SKILL_MAX + 1)];
+            for (int k = 0; k <= BATTLE_SKILL_MAX; k++) {
+                if (!s[k].uses && !s[k].damage_rows && !s[k].heal_rows) continue;
+                const char *id = (k == 0) ? "(none)" : (k - 1 < f->skill_count) ? f->skill_ids[k - 1] : "(other)";
+                add_sum(&out[find_or_add(out, &nout, id)].s, &s[k]);
+            }
+        }
+    }
+    qsort(out, (size_t)nout, sizeof(SkillRow), cmp_damage_desc);
+
+    printf("[query] %d files  %d chunks  %llu rows  %llu battles  %.1f MB\n",
+           q.file_count, q.chunk_count, (unsigned long long)rows, (unsigned long long)battles, bytes / 1048576.0);
+    printf("  map %.1fms  scan %.1fms (%d threads, %.0f Mrows/s, %.0f battles/s)\n",
+           t_map * 1e3, t_scan * 1e3, threads,
+           t_scan > 0.0 ? rows / t_scan / 1e6 : 0.0, t_scan > 0.0 ? battles / t_scan : 0.0);
+
+    printf("\n  %-20s %10s %10s %12s %8s %10s %10s\n",
+           "skill", "uses", "dmg hits", "damage", "dmg/use", "heal hits", "heal");
+    for (int i = 0; i < nout; i++) {
+        const BattleAnalyticsSkillSum *s = &out[i].s;
+        printf("  %-20s %10llu %10llu %12llu %8.1f %10llu %10llu\n", out[i].id,
+               (unsigned long long)s->uses, (unsigned long long)s->damage_rows,
+               (unsigned long long)s->damage, ratio(s->damage, s->uses),
+               (unsigned long long)s->heal_rows, (unsigned long long)s->heal);
+    }
+
+    uint64_t trig = 0, hits = 0;
+    printf("\n  %-20s %10s %10s %8s\n", "counter", "triggers", "hits", "rate");
+    for (int i = 0; i < nout; i++) {
+        const BattleAnalyticsSkillSum *s = &out[i].s;
+        if (!s->counter_triggers) continue;
+        trig += s->counter_triggers;
+        hits += s->counter_hits;
+        printf("  %-20s %10llu %10llu %7.1f%%\n", out[i].id,
+               (unsigned long long)s->counter_triggers, (unsigned long long)s->counter_hits,
+               100.0 * ratio(s->counter_hits, s->counter_triggers));
+    }
+    printf("  %-20s %10llu %10llu %7.1f%%\n", "(all)",
+           (unsigned long long)trig, (unsigned long long)hits, 100.0 * ratio(hits, trig));
+
+    bool ok = true;
+    if (csv) {
+        ok = write_csv(out, nout, csv);
+        if (ok) printf("\n  wrote %s\n", csv);
+        else fprintf(stderr, "write failed: %s\n", csv);
+    }
+
+    for (int t = 0; t < threads; t++) free(w[t].sum);
+    free(w);
+    free(th);
+    free(out);
+    for (int i = 0; i < q.file_count; i++) battle_analytics_unmap(&q.files[i]);
+    free(q.files);
+    free(q.chunks);
+    free(paths);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,23 @@
+// tools/defs_pack.c — 技/キャラ定義のテキストを実行時に読む .bin にする（make defs）
+//
+//   ./tools/defs_pack [IN.txt] [OUT.bin]
+//     既定：assets/data/battle_defs.txt → assets/data/battle_defs.bin
+//
+//   書いた .bin を読み直して、表に入ることまで確かめる
+#include <stdio.h>
+
+#include "battle/battle_defs.h"
+#include "battle/battle_skills.h"
+#include "battle/char_defs.h"
+
+int main(int argc, char **argv)
+{
+    const char *in  = (argc >= 2) ? argv[1] : "assets/data/battle_defs.txt";
+    const char *out = (argc >= 3) ? argv[2] : BATTLE_DEFS_PATH;
+
+    if (!battle_defs_compile(in, out)) return 1;
+    if (!battle_defs_load(out)) return 1;
+
+    printf("[DEFS] verified: %d skills, %d chars\n", battle_skill_count(), char_def_count());
+    return 0;
+}
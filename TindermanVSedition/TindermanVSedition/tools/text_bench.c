@@ -0,0 +1,122 @@
+// tools/text_bench.c — ui_text の描画キャッシュのマイクロベンチ（SDL/SDL_ttf が要る。make text-bench）
+//
+//   ./tools/text_bench [--font PATH] [--size N] [--strings N] [--frames N]
+//
+//   ウィンドウは作らず、ソフトウェアレンダラ（小さい surface）へ描く。描く位置は画面外なので
+//   RenderCopy の転送はほぼ0で、キャッシュを引く重さ・テクスチャを作る重さが見える
+//
+//   repeat : 毎フレーム同じ N 個（既定 1000）の文字列を描く（2フレーム目からは全部当たるはず）
+//   churn  : 毎フレーム新しい N 個の文字列を描く（全部外れ。追い出しが回り続ける）
+//   それぞれ 文字列テクスチャのキャッシュ と グリフアトラス で測る
+//
+//   キャッシュの大きさは make の TEXT_BENCH_CACHE（既定 2048。ゲーム本体は 256）
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ui/ui_text.h"
+#include "ui/ui_glyph_atlas.h"
+
+static const char *arg_str(int argc, char **argv, const char *name, const char *fallback)
+{
+    for (int i = 0; i + 1 < argc; i++) {
+        if (strcmp(argv[i], name) == 0) return argv[i + 1];
+    }
+    return fallback;
+}
+
+static int arg_int(int argc, char **argv, const char *name, int fallback)
+{
+    const char *s = arg_str(argc, argv, name, NULL);
+    return s ? atoi(s) : fallback;
+}
+
+static double now_sec(void)
+{
+    return (double)SDL_GetPerformanceCounter() / (double)SDL_GetPerformanceFrequency();
+}
+
+// i 番目の文字列（HP 表示・タイマー・ログ行に近いもの）。salt を変えると別の文字列になる
+static void make_text(char *buf, size_t n, int i, int salt)
+{
+    switch (i % 3) {
+    case 0:  snprintf(buf, n, "HP %d/%d", (i * 7 + salt) % 1000, 100 + i); break;
+    case 1:  snprintf(buf, n, "00:%02d  %d", i % 60, i + salt * 100000); break;
+    default: snprintf(buf, n, "ログ %d: 攻撃 %d ダメージ", i + salt * 100000, i % 97); break;
+    }
+}
+
+// frames フレームぶん描いて 1フレームあたりの ms を返す（1フレーム目は数えない）
+static double run(SDL_Renderer *r, TTF_Font *font, int strings, int frames, bool churn)
+{
+    char buf[96];
+    double t0 = 0.0;
+    for (int f = 0; f <= frames; f++) {
+        if (f == 1) {
+            ui_text_cache_reset_stats();
+            t0 = now_sec();
+        }
+        for (int i = 0; i < strings; i++) {
+            make_text(buf, sizeof(buf), i, churn ? f : 0);
+            ui_text_draw(r, font, buf, -4096, -4096);
+        }
+    }
+    return (now_sec() - t0) * 1e3 / frames;
+}
+
+static void report(const char *name, double ms, int strings)
+{
+    UiTextCacheStats st;
+    ui_text_cache_get_stats(&st);
+    UiGlyphAtlasStats as;
+    ui_glyph_atlas_get_stats(&as);
+    printf("  %-16s %8.3f ms/frame  %7.0f ns/draw  hits %llu  misses %llu  evict %llu  "
+           "cache %d/%d (%.1f MB)  atlas %d pages %d glyphs\n",
+           name, ms, ms * 1e6 / strings,
+           (unsigned long long)st.hits, (unsigned long long)st.misses, (unsigned long long)st.evictions,
+           st.entries, st.capacity, st.texture_bytes / 1048576.0, as.pages, as.glyphs);
+}
+
+int main(int argc, char **argv)
+{
+    const char *font_path = arg_str(argc, argv, "--font", "assets/font/main.otf");
+    const int size = arg_int(argc, argv, "--size", 28);
+    const int strings = arg_int(argc, argv, "--strings", 1000);
+    const int frames = arg_int(argc, argv, "--frames", 20);
+    if (strings <= 0 || frames <= 0) return 2;
+
+    if (SDL_Init(0) < 0 || TTF_Init() < 0) {
+        fprintf(stderr, "SDL/TTF init failed: %s\n", SDL_GetError());
+        return 1;
+    }
+    SDL_Surface *target = SDL_CreateRGBSurfaceWithFormat(0, 64, 64, 32, SDL_PIXELFORMAT_ARGB8888);
+    SDL_Renderer *r = target ? SDL_CreateSoftwareRenderer(target) : NULL;
+    TTF_Font *font = ui_load_font(font_path, size);
+    if (!r || !font) {
+        fprintf(stderr, "setup failed (font %s): %s\n", font_path, SDL_GetError());
+        return 1;
+    }
+
+    printf("[text] %d strings/frame  %d frames  font %s %dpx\n", strings, frames, font_path, size);
+
+    ui_text_set_glyph_atlas(false);
+    ui_text_cache_init(r);
+    report("cache repeat", run(r, font, strings, frames, false), strings);
+    ui_text_cache_clear();
+    report("cache churn", run(r, font, strings, frames, true), strings);
+
+    ui_text_set_glyph_atlas(true);
+    ui_text_cache_clear();
+    report("atlas repeat", run(r, font, strings, frames, false), strings);
+    report("atlas churn", run(r, font, strings, frames, true), strings);
+
+    ui_close_font(font);
+    ui_text_cache_shutdown();
+    SDL_DestroyRenderer(r);
+    SDL_FreeSurface(target);
+    TTF_Quit();
+    SDL_Quit();
+    return 0;
+}
@@ -0,0 +1,172 @@
+#include "ui_batch.h"
+#include "ui_glyph_atlas.h"
+#include "../core/frame_stats.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    SDL_Renderer *r;
+    bool active;
+
+    SDL_Texture *tex;           // 今溜めている分のテクスチャ/ブレンド
+    SDL_BlendMode blend;
+    SDL_Vertex *v;
+    int *idx;
+    int quads, cap;
+
+    SDL_Texture *white_tex;     // アトラスの白い画素
+    SDL_FPoint white_uv;
+
+    UiBatchStats cur, last;
+} UiBatch;
+
+static UiBatch g_batch;
+
+static bool batch_reserve(int quads)
+{
+    if (g_batch.quads + quads <= g_batch.cap) return true;
+    int cap = g_batch.cap ? g_batch.cap : 256;
+    while (cap < g_batch.quads + quads) cap *= 2;
+    SDL_Vertex *v = (SDL_Vertex*)realloc(g_batch.v, sizeof(SDL_Vertex) * 4 * (size_t)cap);
+    if (!v) return false;
+    g_batch.v = v;
+    int *idx = (int*)realloc(g_batch.idx, sizeof(int) * 6 * (size_t)cap);
+    if (!idx) return false;
+    // 添字は四角形ごとに同じ形なので、伸ばした分だけ埋めておく
+    for (int q = g_batch.cap; q < cap; q++) {
+        const int b = q * 4;
+        int *ix = &idx[q * 6];
+        ix[0] = b; ix[1] = b + 1; ix[2] = b + 2;
+        ix[3] = b; ix[4] = b + 2; ix[5] = b + 3;
+    }
+    g_batch.idx = idx;
+    g_batch.cap = cap;
+    return true;
+}
+
+void ui_batch_flush(void)
+{
+    if (!g_batch.active || g_batch.quads == 0) return;
+    SDL_SetTextureBlendMode(g_batch.tex, g_batch.blend);
+    SDL_RenderGeometry(g_batch.r, g_batch.tex, g_batch.v, g_batch.quads * 4, g_batch.idx, g_batch.quads * 6);
+    frame_stats_count_draw(1);
+    g_batch.cur.flushes++;
+    g_batch.quads = 0;
+}
+
+bool ui_batch_begin(SDL_Renderer *r)
+{
+    if (g_batch.active) ui_batch_end();
+    if (!r) return false;
+    if (!ui_glyph_atlas_white(r, &g_batch.white_tex, &g_batch.white_uv)) return false;
+    g_batch.r = r;
+    g_batch.active = true;
+    g_batch.tex = NULL;
+    g_batch.quads = 0;
+    memset(&g_batch.cur, 0, sizeof(g_batch.cur));
+    return true;
+}
+
+void ui_batch_end(void)
+{
+    if (!g_batch.active) return;
+    ui_batch_flush();
+    g_batch.active = false;
+    g_batch.last = g_batch.cur;
+}
+
+bool ui_batch_active(void)
+{
+    return g_batch.active;
+}
+
+bool ui_batch_push_quads(SDL_Texture *tex, SDL_BlendMode blend, const SDL_Vertex *v, int quads)
+{
+    if (!g_batch.active) return false;
+    if (quads <= 0) return true;
+    if (g_batch.quads && (g_batch.tex != tex || g_batch.blend != blend)) ui_batch_flush();
+    if (!batch_reserve(quads)) return false;
+    g_batch.tex = tex;
+    g_batch.blend = blend;
+    memcpy(&g_batch.v[g_batch.quads * 4], v, sizeof(SDL_Vertex) * 4 * (size_t)quads);
+    g_batch.quads += quads;
+    g_batch.cur.quads += quads;
+    return true;
+}
+
+// 単色の四角（renderer の今の描画色/ブレンドで）
+static void push_solid(SDL_Renderer *r, float x, float y, float w, float h)
+{
+    SDL_Color c;
+    SDL_BlendMode bm;
+    SDL_GetRenderDrawColor(r, &c.r, &c.g, &c.b, &c.a);
+    SDL_GetRenderDrawBlendMode(r, &bm);
+    // 不透明色は NONE でも BLEND でも結果が同じ。BLEND に寄せて、文字や半透明の強調と同じ回に入れる
+    if (bm == SDL_BLENDMODE_NONE && c.a == 255) bm = SDL_BLENDMODE_BLEND;
+    const SDL_FPoint uv = g_batch.white_uv;
+    const SDL_Vertex q[4] = {
+        { {x,     y    }, c, uv },
+        { {x + w, y    }, c, uv },
+        { {x + w, y + h}, c, uv },
+        { {x,     y + h}, c, uv },
+    };
+    ui_batch_push_quads(g_batch.white_tex, bm, q, 1);
+}
+
+static bool batch_usable(SDL_Renderer *r)
+{
+    if (!g_batch.active) return false;
+    if (r == g_batch.r) return true;
+    ui_batch_flush();
+    return false;
+}
+
+void ui_batch_fill_rect(SDL_Renderer *r, const SDL_Rect *rc)
+{
+    if (!rc || !batch_usable(r)) {
+        ui_batch_flush();       // 全面（rc=NULL）は描画先の大きさを SDL に任せる
+        SDL_RenderFillRect(r, rc);
+        frame_stats_count_draw(1);
+        return;
+    }
+    if (rc->w <= 0 || rc->h <= 0) return;
+    push_solid(r, (float)rc->x, (float)rc->y, (float)rc->w, (float)rc->h);
+}
+
+void ui_batch_draw_rect(SDL_Renderer *r, const SDL_Rect *rc)
+{
+    if (!rc || !batch_usable(r)) {
+        ui_batch_flush();
+        SDL_RenderDrawRect(r, rc);
+        frame_stats_count_draw(1);
+        return;
+    }
+    if (rc->w <= 0 || rc->h <= 0) return;
+    const float x = (float)rc->x, y = (float)rc->y, w = (float)rc->w, h = (float)rc->h;
+    // 上下の辺は全幅、左右の辺は角を重ねない（半透明でも角だけ濃くならない）
+    push_solid(r, x, y, w, 1.0f);
+    if (rc->h > 1) push_solid(r, x, y + h - 1.0f, w, 1.0f);
+    if (rc->h > 2) {
+        push_solid(r, x, y + 1.0f, 1.0f, h - 2.0f);
+        if (rc->w > 1) push_solid(r, x + w - 1.0f, y + 1.0f, 1.0f, h - 2.0f);
+    }
+}
+
+void ui_batch_draw_line(SDL_Renderer *r, int x1, int y1, int x2, int y2)
+{
+    if (!batch_usable(r) || (x1 != x2 && y1 != y2)) {
+        ui_batch_flush();
+        SDL_RenderDrawLine(r, x1, y1, x2, y2);
+        frame_stats_count_draw(1);
+        return;
+    }
+    // 水平/垂直線は端点を含む 1px 幅の四角
+    const int x = x1 < x2 ? x1 : x2, y = y1 < y2 ? y1 : y2;
+    push_solid(r, (float)x, (float)y, (float)(abs(x2 - x1) + 1), (float)(abs(y2 - y1) + 1));
+}
+
+void ui_batch_get_stats(UiBatchStats *out)
+{
+    if (out) *out = g_batch.active ? g_batch.cur : g_batch.last;
+}
@@ -0,0 +1,36 @@
+#ifndef UI_BATCH_H
+#define UI_BATCH_H
+
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+
+// ===============================
+//  まとめ描き（即時モード）
+//   - ui_batch_begin 〜 ui_batch_end の間、塗り/枠/水平垂直の線と ui_text の文字を
+//     頂点バッファへ溜め、(テクスチャ, ブレンド) が変わるときと end でだけ SDL_RenderGeometry を出す
+//   - 単色の四角はグリフアトラスの白い画素を使うので、文字と同じテクスチャ＝同じ1回の描画に入る
+//   - 色/ブレンドは呼んだ時点の renderer の描画色/描画ブレンド（SDL_RenderFillRect と同じ）
+//   - 溜めている間に SDL を直接呼んで描く所は、先に ui_batch_flush（ui_layer / ui_text の直描きは自分で呼ぶ）
+//   - begin していない/アトラスが使えないときは、そのまま SDL_Render* を呼ぶ
+// ===============================
+bool ui_batch_begin(SDL_Renderer *r);
+void ui_batch_end(void);
+void ui_batch_flush(void);
+bool ui_batch_active(void);
+
+void ui_batch_fill_rect(SDL_Renderer *r, const SDL_Rect *rc);
+void ui_batch_draw_rect(SDL_Renderer *r, const SDL_Rect *rc);
+void ui_batch_draw_line(SDL_Renderer *r, int x1, int y1, int x2, int y2);   // 斜めは直描き
+
+// テクスチャ付きの四角形（4頂点ずつ。左上→右上→右下→左下）。begin していなければ false
+bool ui_batch_push_quads(SDL_Texture *tex, SDL_BlendMode blend, const SDL_Vertex *v, int quads);
+
+typedef struct {
+    int flushes;        // begin 〜 end で出した SDL_RenderGeometry の回数
+    int quads;
+} UiBatchStats;
+
+// 直前の begin 〜 end の分
+void ui_batch_get_stats(UiBatchStats *out);
+
+#endif
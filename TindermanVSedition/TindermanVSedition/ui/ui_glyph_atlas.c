@@ -0,0 +1,449 @@
+#include "ui_glyph_atlas.h"
+#include "ui_text.h"           // ui_text_utf8_next
+#include "ui_batch.h"
+#include "../core/frame_stats.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// RenderGeometry は SDL 2.0.18、グリフ単位の描画/寸法は SDL_ttf 2.0.18 から
+#if SDL_VERSION_ATLEAST(2, 0, 18) && defined(SDL_TTF_VERSION_ATLEAST)
+#if SDL_TTF_VERSION_ATLEAST(2, 0, 18)
+#define UI_GLYPH_ATLAS_ENABLED 1
+#endif
+#endif
+
+#define UI_GLYPH_TABLE_SIZE 8192    // 2の累乗。3/4 埋まったら詰め直し
+#define UI_GLYPH_SHELF_MAX  128
+#define UI_GLYPH_PAD        1       // グリフの間のすき間（拡大時のにじみ止め）
+#define UI_GLYPH_WHITE      4       // ページ0 の左上に取っておく白い四角（ui_batch の単色塗り用）
+
+typedef struct {
+    TTF_Font *font;     // NULL = 空き
+    Uint32 cp;
+    Sint16 ox;          // 置く位置のずらし（左へはみ出すグリフ）
+    Sint16 advance;
+    Uint16 x, y, w, h;  // ページ内の位置（w=0 = 描くものなし：空白など）
+    Uint8 page;
+} UiGlyph;
+
+typedef struct {
+    int y, h;
+    int x;              // 次に置く位置
+} UiGlyphShelf;
+
+typedef struct {
+    SDL_Texture *tex;
+    UiGlyphShelf shelves[UI_GLYPH_SHELF_MAX];
+    int shelf_count;
+    int bottom;         // 棚を足す位置
+
+    // 描く文字列ごとに溜める頂点（4頂点 + 6インデックス / 文字）
+    SDL_Vertex *v;
+    int *idx;
+    int quads, cap;
+} UiGlyphPage;
+
+static UiGlyph g_table[UI_GLYPH_TABLE_SIZE];
+static int g_glyph_count = 0;
+static UiGlyphPage g_pages[UI_GLYPH_PAGE_MAX];
+static int g_page_count = 0;
+static SDL_Renderer *g_atlas_renderer = NULL;
+static bool g_geometry_failed = false;
+static Uint32 g_generation = 0;     // 詰め直すたびに +1
+static UiGlyphAtlasStats g_stats;
+
+// ===============================
+//  グリフ表（開番地法。消すのは全消しか font 単位の作り直しだけ）
+// ===============================
+static uint32_t glyph_hash(const TTF_Font *font, Uint32 cp)
+{
+    uint64_t k = (uint64_t)(uintptr_t)font ^ ((uint64_t)cp * 0x9E3779B97F4A7C15ull);
+    k ^= k >> 29;
+    k *= 0xBF58476D1CE4E5B9ull;
+    k ^= k >> 32;
+    return (uint32_t)k;
+}
+
+static UiGlyph* glyph_slot(TTF_Font *font, Uint32 cp)
+{
+    uint32_t i = glyph_hash(font, cp) & (UI_GLYPH_TABLE_SIZE - 1);
+    for (;;) {
+        UiGlyph *g = &g_table[i];
+        if (!g->font || (g->font == font && g->cp == cp)) return g;
+        i = (i + 1) & (UI_GLYPH_TABLE_SIZE - 1);
+    }
+}
+
+#ifdef UI_GLYPH_ATLAS_ENABLED
+static void atlas_reset(void)
+{
+    // 溜めてある頂点は今の配置を指しているので、詰め直す前に描いてしまう
+    ui_batch_flush();
+    memset(g_table, 0, sizeof(g_table));
+    g_glyph_count = 0;
+    for (int p = 0; p < g_page_count; p++) {
+        g_pages[p].shelf_count = 0;
+        g_pages[p].bottom = p == 0 ? UI_GLYPH_WHITE : 0;
+    }
+    g_generation++;
+    g_stats.resets++;
+}
+
+// ===============================
+//  ページ
+// ===============================
+static bool page_create(SDL_Renderer *r)
+{
+    if (g_page_count >= UI_GLYPH_PAGE_MAX) return false;
+    SDL_Texture *tex = SDL_CreateTexture(r, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC,
+                                         UI_GLYPH_PAGE_SIZE, UI_GLYPH_PAGE_SIZE);
+    if (!tex) {
+        SDL_Log("glyph atlas: create page failed: %s", SDL_GetError());
+        return false;
+    }
+    // 中身は不定なので一度だけ透明で埋める（ページ0 は左上に白い四角も）
+    Uint32 *zero = (Uint32*)calloc((size_t)UI_GLYPH_PAGE_SIZE * UI_GLYPH_PAGE_SIZE, 4);
+    if (!zero) {
+        SDL_DestroyTexture(tex);
+        return false;
+    }
+    const int top = g_page_count == 0 ? UI_GLYPH_WHITE : 0;
+    for (int y = 0; y < top; y++) {
+        for (int x = 0; x < UI_GLYPH_WHITE; x++) zero[y * UI_GLYPH_PAGE_SIZE + x] = 0xFFFFFFFFu;
+    }
+    SDL_UpdateTexture(tex, NULL, zero, UI_GLYPH_PAGE_SIZE * 4);
+    free(zero);
+    frame_stats_count_upload(UI_GLYPH_PAGE_SIZE * UI_GLYPH_PAGE_SIZE * 4);
+    SDL_SetTextureBlendMode(tex, SDL_BLENDMODE_BLEND);
+
+    UiGlyphPage *pg = &g_pages[g_page_count++];
+    pg->tex = tex;
+    pg->shelf_count = 0;
+    pg->bottom = top;
+    return true;
+}
+
+// w x h（すき間込み）を置ける場所を探す。高さの近い棚 → 新しい棚 → 新しいページ
+static bool page_pack(SDL_Renderer *r, int w, int h, int *out_page, int *out_x, int *out_y)
+{
+    for (int pass = 0; pass < 2; pass++) {
+        for (int p = 0; p < g_page_count; p++) {
+            UiGlyphPage *pg = &g_pages[p];
+            for (int s = 0; s < pg->shelf_count; s++) {
+                UiGlyphShelf *sh = &pg->shelves[s];
+                if (sh->h < h || sh->h > h + h / 4 + 2) continue;
+                if (sh->x + w > UI_GLYPH_PAGE_SIZE) continue;
+                *out_page = p;
+                *out_x = sh->x;
+                *out_y = sh->y;
+                sh->x += w;
+                return true;
+            }
+            if (pg->shelf_count < UI_GLYPH_SHELF_MAX && pg->bottom + h <= UI_GLYPH_PAGE_SIZE) {
+                UiGlyphShelf *sh = &pg->shelves[pg->shelf_count++];
+                sh->y = pg->bottom;
+                sh->h = h;
+                sh->x = w;
+                pg->bottom += h;
+                *out_page = p;
+                *out_x = 0;
+                *out_y = sh->y;
+                return true;
+            }
+        }
+        if (pass == 0 && !page_create(r)) return false;
+    }
+    return false;
+}
+
+// 白で描いてページへ書き込む。置き場がなければ false（呼ぶ側で詰め直し）
+static bool glyph_rasterize(SDL_Renderer *r, TTF_Font *font, Uint32 cp, UiGlyph *g)
+{
+    int minx = 0, maxx = 0, miny = 0, maxy = 0, adv = 0;
+    if (TTF_GlyphMetrics32(font, cp, &minx, &maxx, &miny, &maxy, &adv) != 0) {
+        minx = maxx = adv = 0;
+    }
+    g->advance = (Sint16)adv;
+    g->ox = (Sint16)(minx < 0 ? minx : 0);
+    g->w = g->h = 0;
+    if (maxx <= minx) return true;      // 空白
+
+    SDL_Color white = {255, 255, 255, 255};
+    SDL_Surface *s = TTF_RenderGlyph32_Blended(font, cp, white);
+    if (!s) return true;                // 描けない文字は送りだけ
+    g_stats.rasterized++;
+    if (s->format->format != SDL_PIXELFORMAT_ARGB8888) {
+        SDL_Surface *c = SDL_ConvertSurfaceFormat(s, SDL_PIXELFORMAT_ARGB8888, 0);
+        SDL_FreeSurface(s);
+        if (!c) return true;
+        s = c;
+    }
+    if (s->w <= 0 || s->h <= 0 ||
+        s->w + UI_GLYPH_PAD > UI_GLYPH_PAGE_SIZE || s->h + UI_GLYPH_PAD > UI_GLYPH_PAGE_SIZE) {
+        SDL_FreeSurface(s);
+        return true;
+    }
+
+    int page, px, py;
+    if (!page_pack(r, s->w + UI_GLYPH_PAD, s->h + UI_GLYPH_PAD, &page, &px, &py)) {
+        SDL_FreeSurface(s);
+        return false;
+    }
+    SDL_Rect dst = {px, py, s->w, s->h};
+    SDL_UpdateTexture(g_pages[page].tex, &dst, s->pixels, s->pitch);
+    frame_stats_count_upload(s->w * s->h * 4);
+
+    g->page = (Uint8)page;
+    g->x = (Uint16)px;
+    g->y = (Uint16)py;
+    g->w = (Uint16)s->w;
+    g->h = (Uint16)s->h;
+    SDL_FreeSurface(s);
+    return true;
+}
+
+// 表になければ描いて足す。詰め直しが起きたら NULL（それまでに並べた頂点は使えない）
+static const UiGlyph* glyph_get(SDL_Renderer *r, TTF_Font *font, Uint32 cp)
+{
+    UiGlyph *g = glyph_slot(font, cp);
+    if (g->font) return g;
+
+    if (g_glyph_count >= UI_GLYPH_TABLE_SIZE * 3 / 4) {
+        atlas_reset();
+        return NULL;
+    }
+    g->font = font;
+    g->cp = cp;
+    if (!glyph_rasterize(r, font, cp, g)) {
+        atlas_reset();
+        return NULL;
+    }
+    g_glyph_count++;
+    return g;
+}
+
+static bool page_reserve(UiGlyphPage *pg)
+{
+    if (pg->quads < pg->cap) return true;
+    int cap = pg->cap ? pg->cap * 2 : 128;
+    SDL_Vertex *v = (SDL_Vertex*)realloc(pg->v, sizeof(SDL_Vertex) * 4 * (size_t)cap);
+    if (!v) return false;
+    pg->v = v;
+    int *idx = (int*)realloc(pg->idx, sizeof(int) * 6 * (size_t)cap);
+    if (!idx) return false;
+    pg->idx = idx;
+    pg->cap = cap;
+    return true;
+}
+
+static void push_quad(const UiGlyph *g, float x, float y, SDL_Color col)
+{
+    UiGlyphPage *pg = &g_pages[g->page];
+    if (!page_reserve(pg)) return;
+
+    const float inv = 1.0f / (float)UI_GLYPH_PAGE_SIZE;
+    const float u0 = g->x * inv, v0 = g->y * inv;
+    const float u1 = (g->x + g->w) * inv, v1 = (g->y + g->h) * inv;
+    const float x1 = x + g->w, y1 = y + g->h;
+
+    SDL_Vertex *v = &pg->v[pg->quads * 4];
+    v[0] = (SDL_Vertex){ {x,  y },  col, {u0, v0} };
+    v[1] = (SDL_Vertex){ {x1, y },  col, {u1, v0} };
+    v[2] = (SDL_Vertex){ {x1, y1},  col, {u1, v1} };
+    v[3] = (SDL_Vertex){ {x,  y1},  col, {u0, v1} };
+
+    const int b = pg->quads * 4;
+    int *ix = &pg->idx[pg->quads * 6];
+    ix[0] = b; ix[1] = b + 1; ix[2] = b + 2;
+    ix[3] = b; ix[4] = b + 2; ix[5] = b + 3;
+    pg->quads++;
+}
+
+// 頂点を並べる。途中で詰め直しが起きたら false
+static bool layout(SDL_Renderer *r, TTF_Font *font, const char *text, int x, int y, SDL_Color col)
+{
+    const Uint32 gen = g_generation;
+    const int line_skip = TTF_FontLineSkip(font);
+    int pen_x = x, pen_y = y;
+    Uint32 prev = 0;
+
+    for (int p = 0; p < g_page_count; p++) g_pages[p].quads = 0;
+
+    const char *s = text;
+    while (*s) {
+        Uint32 cp = ui_text_utf8_next(&s);
+        if (cp == '\n') {
+            pen_x = x;
+            pen_y += line_skip;
+            prev = 0;
+            continue;
+        }
+        if (prev) pen_x += TTF_GetFontKerningSizeGlyphs32(font, prev, cp);
+        const UiGlyph *g = glyph_get(r, font, cp);
+        if (!g || g_generation != gen) return false;
+        if (g->w) push_quad(g, (float)(pen_x + g->ox), (float)pen_y, col);
+        pen_x += g->advance;
+        prev = cp;
+    }
+    return true;
+}
+#endif
+
+// ===============================
+//  公開
+// ===============================
+bool ui_glyph_atlas_draw(SDL_Renderer *r, TTF_Font *font, const char *text,
+                         int x, int y, SDL_Color col)
+{
+#ifdef UI_GLYPH_ATLAS_ENABLED
+    if (!r || !font || !text) return false;
+    if (!text[0]) return true;
+    if (g_geometry_failed) return false;
+
+    // renderer が変わったら作り直し（別 renderer のテクスチャは使えない）
+    if (g_atlas_renderer != r) {
+        ui_glyph_atlas_clear();
+        g_atlas_renderer = r;
+    }
+
+    // 途中で詰め直しになったら、空のアトラスでもう一度だけ並べる
+    if (!layout(r, font, text, x, y, col) && !layout(r, font, text, x, y, col)) return false;
+
+    for (int p = 0; p < g_page_count; p++) {
+        UiGlyphPage *pg = &g_pages[p];
+        if (!pg->quads) continue;
+        // まとめ描きの途中なら頂点を渡すだけ（同じページの塗りと一緒に1回で描かれる）
+        if (ui_batch_push_quads(pg->tex, SDL_BLENDMODE_BLEND, pg->v, pg->quads)) continue;
+        SDL_SetTextureBlendMode(pg->tex, SDL_BLENDMODE_BLEND);     // ui_batch が変えていることがある
+        if (SDL_RenderGeometry(r, pg->tex, pg->v, pg->quads * 4, pg->idx, pg->quads * 6) != 0) {
+            SDL_Log("glyph atlas: SDL_RenderGeometry failed, falling back: %s", SDL_GetError());
+            g_geometry_failed = true;
+            return false;
+        }
+        frame_stats_count_draw(1);
+    }
+    return true;
+#else
+    (void)r; (void)font; (void)text; (void)x; (void)y; (void)col;
+    return false;
+#endif
+}
+
+#ifdef UI_GLYPH_ATLAS_ENABLED
+static int glyph_advance(TTF_Font *font, Uint32 prev, Uint32 cp)
+{
+    int adv = 0;
+    const UiGlyph *g = glyph_slot(font, cp);
+    if (g->font) adv = g->advance;
+    else TTF_GlyphMetrics32(font, cp, NULL, NULL, NULL, NULL, &adv);
+    if (prev) adv += TTF_GetFontKerningSizeGlyphs32(font, prev, cp);
+    return adv;
+}
+#endif
+
+bool ui_glyph_atlas_advance(TTF_Font *font, Uint32 prev, Uint32 cp, int *adv)
+{
+#ifdef UI_GLYPH_ATLAS_ENABLED
+    if (!font) return false;
+    *adv = glyph_advance(font, prev, cp);
+    return true;
+#else
+    (void)font; (void)prev; (void)cp; (void)adv;
+    return false;
+#endif
+}
+
+bool ui_glyph_atlas_measure(TTF_Font *font, const char *text, int *w, int *h)
+{
+#ifdef UI_GLYPH_ATLAS_ENABLED
+    if (!font || !text) return false;
+    int pen = 0, best = 0, lines = 1;
+    Uint32 prev = 0;
+    const char *s = text;
+    while (*s) {
+        Uint32 cp = ui_text_utf8_next(&s);
+        if (cp == '\n') {
+            if (pen > best) best = pen;
+            pen = 0;
+            prev = 0;
+            lines++;
+            continue;
+        }
+        pen += glyph_advance(font, prev, cp);
+        prev = cp;
+    }
+    if (pen > best) best = pen;
+    if (w) *w = best;
+    if (h) *h = (lines - 1) * TTF_FontLineSkip(font) + TTF_FontHeight(font);
+    return true;
+#else
+    (void)font; (void)text; (void)w; (void)h;
+    return false;
+#endif
+}
+
+void ui_glyph_atlas_forget_font(TTF_Font *font)
+{
+    if (!font || g_glyph_count == 0) return;
+
+    // 開番地法なので抜くと探索が切れる：残すものだけで作り直す（ページ上の場所はそのまま）
+    static UiGlyph keep[UI_GLYPH_TABLE_SIZE];
+    int n = 0;
+    for (int i = 0; i < UI_GLYPH_TABLE_SIZE; i++) {
+        if (g_table[i].font && g_table[i].font != font) keep[n++] = g_table[i];
+    }
+    memset(g_table, 0, sizeof(g_table));
+    for (int i = 0; i < n; i++) *glyph_slot(keep[i].font, keep[i].cp) = keep[i];
+    g_glyph_count = n;
+}
+
+bool ui_glyph_atlas_white(SDL_Renderer *r, SDL_Texture **tex, SDL_FPoint *uv)
+{
+#ifdef UI_GLYPH_ATLAS_ENABLED
+    if (!r || g_geometry_failed) return false;
+    if (g_atlas_renderer != r) {
+        ui_glyph_atlas_clear();
+        g_atlas_renderer = r;
+    }
+    if (g_page_count == 0 && !page_create(r)) return false;
+    if (tex) *tex = g_pages[0].tex;
+    if (uv) {
+        // 四角の真ん中を取る（線形補間でも周りの透明が混ざらない）
+        uv->x = (float)(UI_GLYPH_WHITE / 2) / (float)UI_GLYPH_PAGE_SIZE;
+        uv->y = uv->x;
+    }
+    return true;
+#else
+    (void)r; (void)tex; (void)uv;
+    return false;
+#endif
+}
+
+void ui_glyph_atlas_clear(void)
+{
+    // テクスチャを捨てるので、それを指している溜め描きも終わらせる
+    ui_batch_end();
+    for (int p = 0; p < g_page_count; p++) {
+        UiGlyphPage *pg = &g_pages[p];
+        if (pg->tex) SDL_DestroyTexture(pg->tex);
+        free(pg->v);
+        free(pg->idx);
+        memset(pg, 0, sizeof(*pg));
+    }
+    g_page_count = 0;
+    memset(g_table, 0, sizeof(g_table));
+    g_glyph_count = 0;
+    g_generation++;
+    g_atlas_renderer = NULL;
+    g_geometry_failed = false;
+}
+
+void ui_glyph_atlas_get_stats(UiGlyphAtlasStats *out)
+{
+    if (!out) return;
+    *out = g_stats;
+    out->pages = g_page_count;
+    out->glyphs = g_glyph_count;
+}
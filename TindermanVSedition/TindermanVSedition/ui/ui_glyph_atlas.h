@@ -0,0 +1,50 @@
+#ifndef UI_GLYPH_ATLAS_H
+#define UI_GLYPH_ATLAS_H
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include <stdbool.h>
+
+// ===============================
+//  グリフアトラス（ui_text_draw の中身）
+//   - (font, 文字) ごとに1回だけ白で TTF_RenderGlyph32_Blended し、アトラスのページ（1024x1024）へ詰める
+//     サイズ違いは別の TTF_Font なので font ポインタがサイズも兼ねる
+//   - 詰め方は棚（同じ高さの行）方式。漢字/かなも使われた時点で足していく
+//     ページが全部埋まったら全部捨てて詰め直す（次のフレームから描き直しになるだけ）
+//   - 文字列は頂点に並べ、ページごとに SDL_RenderGeometry 1回で描く。色は頂点色で掛ける
+//   - 使えないとき（SDL/SDL_ttf が 2.0.18 より古い・RenderGeometry が失敗する）は false を返す
+//     → ui_text 側が従来の文字列テクスチャで描く
+// ===============================
+#define UI_GLYPH_PAGE_SIZE 1024
+#define UI_GLYPH_PAGE_MAX  4
+
+// text を (x, y) を左上として描く。'\n' で改行。描けなかったら false（何も描いていない）
+bool ui_glyph_atlas_draw(SDL_Renderer *r, TTF_Font *font, const char *text,
+                         int x, int y, SDL_Color col);
+
+// 描いたときの大きさ（w = 一番長い行、h = 行数 * 行送り）。false = アトラスが使えない
+bool ui_glyph_atlas_measure(TTF_Font *font, const char *text, int *w, int *h);
+
+// 1文字ぶんの送り（prev との詰めを含む。prev=0 で行頭）。false = アトラスが使えない
+bool ui_glyph_atlas_advance(TTF_Font *font, Uint32 prev, Uint32 cp, int *adv);
+
+// font を閉じる前に呼ぶ（同じアドレスに別の font が来ても古いグリフを使わないように）
+void ui_glyph_atlas_forget_font(TTF_Font *font);
+
+// ページ0 の白い画素（単色の四角をグリフと同じテクスチャで描くため。ui_batch が使う）
+// ページがなければ作る。false = アトラスが使えない
+bool ui_glyph_atlas_white(SDL_Renderer *r, SDL_Texture **tex, SDL_FPoint *uv);
+
+// 全部捨てる（ページのテクスチャも解放）
+void ui_glyph_atlas_clear(void);
+
+typedef struct {
+    int pages;              // 作ったページ数
+    int glyphs;             // 登録済みグリフ数
+    int resets;             // 埋まって詰め直した回数
+    long long rasterized;   // TTF で描いた回数（累計）
+} UiGlyphAtlasStats;
+
+void ui_glyph_atlas_get_stats(UiGlyphAtlasStats *out);
+
+#endif
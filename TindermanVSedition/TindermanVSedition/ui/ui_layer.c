@@ -0,0 +1,102 @@
+#include "ui_layer.h"
+#include "ui_batch.h"
+#include "../core/frame_stats.h"
+
+#include <string.h>
+
+static Uint32 g_layer_epoch = 1;
+
+void ui_layer_init(UiLayer *l, bool transparent)
+{
+    memset(l, 0, sizeof(*l));
+    l->transparent = transparent;
+}
+
+void ui_layer_release(UiLayer *l)
+{
+    if (l->tex) SDL_DestroyTexture(l->tex);
+    l->tex = NULL;
+    l->owner = NULL;
+    l->valid = false;
+}
+
+void ui_layer_invalidate_all(void)
+{
+    g_layer_epoch++;
+}
+
+void ui_layer_handle_event(const SDL_Event *e)
+{
+    if (e->type == SDL_RENDER_TARGETS_RESET || e->type == SDL_RENDER_DEVICE_RESET) {
+        ui_layer_invalidate_all();
+    } else if (e->type == SDL_WINDOWEVENT && e->window.event == SDL_WINDOWEVENT_SIZE_CHANGED) {
+        ui_layer_invalidate_all();
+    }
+}
+
+static bool layer_ensure_texture(UiLayer *l, SDL_Renderer *r, int w, int h)
+{
+    if (l->tex && l->owner == r && l->w == w && l->h == h) return true;
+    if (l->tex && l->owner == r) SDL_DestroyTexture(l->tex);   // 別 renderer のものは renderer と一緒に消えている
+    l->tex = SDL_CreateTexture(r, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, w, h);
+    l->owner = r;
+    l->w = w;
+    l->h = h;
+    l->valid = false;
+    if (!l->tex) return false;
+    SDL_SetTextureBlendMode(l->tex, l->transparent ? SDL_BLENDMODE_BLEND : SDL_BLENDMODE_NONE);
+    return true;
+}
+
+static bool layer_repaint(UiLayer *l, SDL_Renderer *r, UiLayerPaintFn paint, void *user)
+{
+    SDL_Texture *prev_target = SDL_GetRenderTarget(r);
+    if (SDL_SetRenderTarget(r, l->tex) != 0) return false;
+
+    Uint8 cr, cg, cb, ca;
+    SDL_BlendMode bm;
+    SDL_GetRenderDrawColor(r, &cr, &cg, &cb, &ca);
+    SDL_GetRenderDrawBlendMode(r, &bm);
+
+    SDL_SetRenderDrawColor(r, 0, 0, 0, 0);
+    SDL_RenderClear(r);
+    paint(r, user);
+    ui_batch_flush();       // paint の中で溜めた分は、この描画先にいるうちに出す
+
+    SDL_SetRenderTarget(r, prev_target);
+    SDL_SetRenderDrawColor(r, cr, cg, cb, ca);
+    SDL_SetRenderDrawBlendMode(r, bm);
+    l->repaints++;
+    return true;
+}
+
+void ui_layer_draw(UiLayer *l, SDL_Renderer *r, int x, int y, int w, int h,
+                   Uint64 key, UiLayerPaintFn paint, void *user)
+{
+    if (!r || !paint || w <= 0 || h <= 0) return;
+    ui_batch_flush();       // 溜めてある分（この層より奥）を先に
+
+    bool ok = SDL_RenderTargetSupported(r) && layer_ensure_texture(l, r, w, h);
+    if (ok && (!l->valid || l->key != key || l->epoch != g_layer_epoch)) {
+        ok = layer_repaint(l, r, paint, user);
+        l->valid = ok;
+        l->key = key;
+        l->epoch = g_layer_epoch;
+    }
+
+    if (!ok) {
+        // 描画先テクスチャなし：その場で描く（paint は (0,0) 基準なので viewport をずらす）
+        SDL_Rect prev_vp;
+        SDL_RenderGetViewport(r, &prev_vp);
+        SDL_Rect vp = { prev_vp.x + x, prev_vp.y + y, w, h };
+        SDL_RenderSetViewport(r, &vp);
+        paint(r, user);
+        ui_batch_flush();
+        SDL_RenderSetViewport(r, &prev_vp);
+        return;
+    }
+
+    SDL_Rect dst = { x, y, w, h };
+    SDL_RenderCopy(r, l->tex, NULL, &dst);
+    frame_stats_count_draw(1);
+}
@@ -0,0 +1,40 @@
+#ifndef UI_LAYER_H
+#define UI_LAYER_H
+
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+
+// ===============================
+//  静的レイヤ（毎フレーム同じ絵になる部分を SDL_TEXTUREACCESS_TARGET のテクスチャへ1回だけ描く）
+//   - ui_layer_draw は、key（中身を決める値：ステージ・原点・マスの大きさなど）が変わったとき・
+//     描画先が作り直されたとき（リサイズ/デバイスロスト）だけ paint を呼んで描き直し、あとは1回貼るだけ
+//   - paint はレイヤの左上を (0,0) として描く。transparent のレイヤは透明で消してから描く
+//     （下の動的な絵の上に重ねる線などに使う）
+//   - 描画先テクスチャが使えない renderer では、毎回 paint を画面へ直接呼ぶ（見た目は同じ）
+// ===============================
+typedef void (*UiLayerPaintFn)(SDL_Renderer *r, void *user);
+
+typedef struct {
+    SDL_Texture *tex;
+    SDL_Renderer *owner;
+    int w, h;
+    Uint64 key;
+    Uint32 epoch;
+    bool transparent;
+    bool valid;
+    int repaints;       // 描き直した回数（計測用）
+} UiLayer;
+
+void ui_layer_init(UiLayer *l, bool transparent);
+void ui_layer_release(UiLayer *l);
+
+void ui_layer_draw(UiLayer *l, SDL_Renderer *r, int x, int y, int w, int h,
+                   Uint64 key, UiLayerPaintFn paint, void *user);
+
+// 全レイヤを次の ui_layer_draw で描き直させる
+void ui_layer_invalidate_all(void);
+
+// main の PollEvent から：描画先の作り直し/サイズ変更なら ui_layer_invalidate_all
+void ui_layer_handle_event(const SDL_Event *e);
+
+#endif
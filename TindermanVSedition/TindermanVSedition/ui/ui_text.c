@@ -1,23 +1,42 @@
 #include "ui_text.h"
+#include "ui_glyph_atlas.h"
+#include "ui_batch.h"
+#include "../util/asset_pack.h"
+#include "../core/frame_stats.h"
+#include <stdint.h>
 #include <string.h>
 #include <stdio.h>
 
-#define UI_TEXT_CACHE_MAX 256
+// 文字列テクスチャのキャッシュ（アトラスが使えない環境/ui_text_set_glyph_atlas(false) のとき）
+//   - (font, 色, 文字列) のハッシュで開番地法の表を引く（線形探索なし）
+//   - 追い出しは LRU リスト（エントリに前後の番号を持たせる）の末尾から
+#ifndef UI_TEXT_CACHE_MAX
+#define UI_TEXT_CACHE_MAX 256       // 2の累乗
+#endif
+#define UI_TEXT_HASH_SIZE (UI_TEXT_CACHE_MAX * 2)
 #define UI_TEXT_KEY_MAX   192
 
+_Static_assert((UI_TEXT_CACHE_MAX & (UI_TEXT_CACHE_MAX - 1)) == 0, "UI_TEXT_CACHE_MAX must be a power of two");
+
 typedef struct {
     bool used;
     TTF_Font *font;
     SDL_Color col;
+    Uint64 hash;
     char key[UI_TEXT_KEY_MAX];   // text のコピー
     SDL_Texture *tex;
     int w, h;
-    Uint32 last_used_tick;
+    int prev, next;              // LRU（prev 側が新しい）。未使用なら next で空きリスト
 } UiTextCacheEntry;
 
 static UiTextCacheEntry g_cache[UI_TEXT_CACHE_MAX];
+static int g_slots[UI_TEXT_HASH_SIZE];     // g_cache の番号。-1 = 空き
+static int g_lru_head = -1, g_lru_tail = -1;
+static int g_free_head = -1;
+static bool g_cache_ready = false;
 static SDL_Renderer *g_renderer_for_cache = NULL;
-static Uint32 g_tick = 1;
+static bool g_use_atlas = true;
+static UiTextCacheStats g_stats;
 
 static bool color_equal(SDL_Color a, SDL_Color b){
     return a.r==b.r && a.g==b.g && a.b==b.b && a.a==b.a;
@@ -25,68 +44,168 @@ static bool color_equal(SDL_Color a, SDL_Color b){
 
 TTF_Font *ui_load_font(const char *path, int size)
 {
-    TTF_Font *f = TTF_OpenFont(path, size);
+    // パックにあれば mmap を直接読む（なければファイル）
+    SDL_RWops *rw = asset_open_rw(path);
+    TTF_Font *f = rw ? TTF_OpenFontRW(rw, 1, size) : NULL;
     if (!f) SDL_Log("Failed to load font %s : %s", path, TTF_GetError());
     return f;
 }
 
-void ui_text_cache_init(SDL_Renderer *r)
+// ===============================
+//  表と LRU
+// ===============================
+static void cache_reset(void)
 {
-    g_renderer_for_cache = r;
     memset(g_cache, 0, sizeof(g_cache));
-    g_tick = 1;
+    for (int i = 0; i < UI_TEXT_HASH_SIZE; i++) g_slots[i] = -1;
+    for (int i = 0; i < UI_TEXT_CACHE_MAX; i++) g_cache[i].next = (i + 1 < UI_TEXT_CACHE_MAX) ? i + 1 : -1;
+    g_free_head = 0;
+    g_lru_head = g_lru_tail = -1;
+    g_stats.entries = 0;
+    g_stats.texture_bytes = 0;
+    g_cache_ready = true;
+}
+
+// FNV-1a（font と色も混ぜる）。len に文字列長を返す
+static Uint64 text_hash(TTF_Font *font, SDL_Color col, const char *text, size_t *len)
+{
+    Uint64 h = 1469598103934665603ull;
+    const unsigned char *p = (const unsigned char*)text;
+    while (*p) {
+        h ^= *p++;
+        h *= 1099511628211ull;
+    }
+    *len = (size_t)(p - (const unsigned char*)text);
+    h ^= (Uint64)(uintptr_t)font;
+    h *= 1099511628211ull;
+    h ^= ((Uint64)col.r << 24) | ((Uint64)col.g << 16) | ((Uint64)col.b << 8) | col.a;
+    h *= 1099511628211ull;
+    return h ^ (h >> 31);
+}
+
+static void lru_unlink(int i)
+{
+    UiTextCacheEntry *e = &g_cache[i];
+    if (e->prev >= 0) g_cache[e->prev].next = e->next; else g_lru_head = e->next;
+    if (e->next >= 0) g_cache[e->next].prev = e->prev; else g_lru_tail = e->prev;
+    e->prev = e->next = -1;
+}
+
+static void lru_push_front(int i)
+{
+    UiTextCacheEntry *e = &g_cache[i];
+    e->prev = -1;
+    e->next = g_lru_head;
+    if (g_lru_head >= 0) g_cache[g_lru_head].prev = i; else g_lru_tail = i;
+    g_lru_head = i;
+}
+
+// 見つかれば g_slots の位置、なければ -1（*insert_at に入れる位置）
+static int slot_find(Uint64 hash, TTF_Font *font, SDL_Color col, const char *text, int *insert_at)
+{
+    int s = (int)(hash & (UI_TEXT_HASH_SIZE - 1));
+    for (;;) {
+        const int i = g_slots[s];
+        if (i < 0) {
+            if (insert_at) *insert_at = s;
+            return -1;
+        }
+        const UiTextCacheEntry *e = &g_cache[i];
+        if (e->hash == hash && e->font == font && color_equal(e->col, col) && strcmp(e->key, text) == 0) return s;
+        s = (s + 1) & (UI_TEXT_HASH_SIZE - 1);
+    }
+}
+
+// 線形探索の表から抜く（後ろの詰め直しで、墓標を残さない）
+static void slot_remove(int s)
+{
+    g_slots[s] = -1;
+    int j = s;
+    for (;;) {
+        j = (j + 1) & (UI_TEXT_HASH_SIZE - 1);
+        const int i = g_slots[j];
+        if (i < 0) return;
+        const int home = (int)(g_cache[i].hash & (UI_TEXT_HASH_SIZE - 1));
+        // home が (s, j] の外にあるなら s へ動かせる
+        const bool in_range = (s <= j) ? (home > s && home <= j) : (home > s || home <= j);
+        if (!in_range) {
+            g_slots[s] = i;
+            g_slots[j] = -1;
+            s = j;
+        }
+    }
 }
 
-static void entry_destroy(UiTextCacheEntry *e)
+static void entry_destroy(int i)
 {
+    UiTextCacheEntry *e = &g_cache[i];
+    if (!e->used) return;
+    int s = slot_find(e->hash, e->font, e->col, e->key, NULL);
+    if (s >= 0) slot_remove(s);
+    lru_unlink(i);
     if (e->tex) SDL_DestroyTexture(e->tex);
+    g_stats.texture_bytes -= (size_t)e->w * (size_t)e->h * 4;
+    g_stats.entries--;
     e->tex = NULL;
     e->used = false;
+    e->next = g_free_head;
+    g_free_head = i;
+}
+
+void ui_text_cache_init(SDL_Renderer *r)
+{
+    if (g_cache_ready) ui_text_cache_clear();
+    g_renderer_for_cache = r;
+    cache_reset();
+}
+
+void ui_close_font(TTF_Font *font)
+{
+    if (!font) return;
+    ui_glyph_atlas_forget_font(font);
+    if (g_cache_ready) {
+        for (int i = 0; i < UI_TEXT_CACHE_MAX; i++) {
+            if (g_cache[i].used && g_cache[i].font == font) entry_destroy(i);
+        }
+    }
+    TTF_CloseFont(font);
 }
 
 void ui_text_cache_clear(void)
 {
+    if (!g_cache_ready) return;
     for (int i = 0; i < UI_TEXT_CACHE_MAX; i++) {
-        if (g_cache[i].used) entry_destroy(&g_cache[i]);
+        if (g_cache[i].used && g_cache[i].tex) SDL_DestroyTexture(g_cache[i].tex);
     }
+    cache_reset();
 }
 
 void ui_text_cache_shutdown(void)
 {
     ui_text_cache_clear();
+    ui_glyph_atlas_clear();
     g_renderer_for_cache = NULL;
 }
 
-static int find_entry(TTF_Font *font, const char *text, SDL_Color col)
+void ui_text_set_glyph_atlas(bool enabled)
 {
-    for (int i = 0; i < UI_TEXT_CACHE_MAX; i++) {
-        UiTextCacheEntry *e = &g_cache[i];
-        if (!e->used) continue;
-        if (e->font != font) continue;
-        if (!color_equal(e->col, col)) continue;
-        if (strcmp(e->key, text) != 0) continue;
-        return i;
-    }
-    return -1;
+    g_use_atlas = enabled;
 }
 
-static int alloc_entry_slot(void)
+void ui_text_cache_get_stats(UiTextCacheStats *out)
 {
-    // 空きを探す
-    for (int i = 0; i < UI_TEXT_CACHE_MAX; i++) {
-        if (!g_cache[i].used) return i;
-    }
-    // 無ければ最も古いものを追い出す（簡易LRU）
-    int oldest = 0;
-    Uint32 best = g_cache[0].last_used_tick;
-    for (int i = 1; i < UI_TEXT_CACHE_MAX; i++) {
-        if (g_cache[i].last_used_tick < best) {
-            best = g_cache[i].last_used_tick;
-            oldest = i;
-        }
-    }
-    entry_destroy(&g_cache[oldest]);
-    return oldest;
+    if (!out) return;
+    *out = g_stats;
+    out->capacity = UI_TEXT_CACHE_MAX;
+}
+
+void ui_text_cache_reset_stats(void)
+{
+    const int entries = g_stats.entries;
+    const size_t bytes = g_stats.texture_bytes;
+    memset(&g_stats, 0, sizeof(g_stats));
+    g_stats.entries = entries;
+    g_stats.texture_bytes = bytes;
 }
 
 static SDL_Texture* build_texture(SDL_Renderer *r, TTF_Font *font,
@@ -99,6 +218,7 @@ static SDL_Texture* build_texture(SDL_Renderer *r, TTF_Font *font,
     if (tex) {
         *out_w = surf->w;
         *out_h = surf->h;
+        frame_stats_count_upload(surf->w * surf->h * 4);
     }
     SDL_FreeSurface(surf);
     return tex;
@@ -109,46 +229,79 @@ void ui_text_draw_color(SDL_Renderer *r, TTF_Font *font, const char *text,
 {
     if (!r || !font || !text || !text[0]) return;
 
+    // グリフアトラスで描ければそれで終わり（文字列ごとのテクスチャは作らない）
+    if (g_use_atlas && ui_glyph_atlas_draw(r, font, text, x, y, col)) return;
+
+    // ここから先は SDL_RenderCopy で直に描くので、溜めてある分（奥のもの）を先に出す
+    ui_batch_flush();
+
     // renderer が変わったらキャッシュ破棄（別rendererのtextureは使えない）
-    if (g_renderer_for_cache != r) {
+    if (!g_cache_ready || g_renderer_for_cache != r) {
         ui_text_cache_clear();
+        if (!g_cache_ready) cache_reset();
         g_renderer_for_cache = r;
     }
 
+    size_t len = 0;
+    const Uint64 hash = text_hash(font, col, text, &len);
+
     // 長すぎる text はキャッシュせず直描き（安全策）
-    if ((int)strlen(text) >= UI_TEXT_KEY_MAX - 1) {
+    if (len >= UI_TEXT_KEY_MAX - 1) {
         int w=0,h=0;
         SDL_Texture *tmp = build_texture(r, font, text, col, &w, &h);
+        g_stats.uncached++;
         if (!tmp) return;
         SDL_Rect dst = {x, y, w, h};
         SDL_RenderCopy(r, tmp, NULL, &dst);
+        frame_stats_count_draw(1);
         SDL_DestroyTexture(tmp);
         return;
     }
 
-    int idx = find_entry(font, text, col);
-    if (idx < 0) {
-        idx = alloc_entry_slot();
-        UiTextCacheEntry *e = &g_cache[idx];
-
+    int insert_at = -1;
+    int s = slot_find(hash, font, col, text, &insert_at);
+    int idx;
+    if (s >= 0) {
+        idx = g_slots[s];
+        g_stats.hits++;
+        if (idx != g_lru_head) {
+            lru_unlink(idx);
+            lru_push_front(idx);
+        }
+    } else {
+        g_stats.misses++;
         int w=0,h=0;
         SDL_Texture *tex = build_texture(r, font, text, col, &w, &h);
         if (!tex) return;
 
+        // 空きがなければ一番古いものを追い出す（抜いた分だけ表が動くので入れる位置は引き直す）
+        if (g_free_head < 0) {
+            entry_destroy(g_lru_tail);
+            g_stats.evictions++;
+            slot_find(hash, font, col, text, &insert_at);
+        }
+        idx = g_free_head;
+        g_free_head = g_cache[idx].next;
+
+        UiTextCacheEntry *e = &g_cache[idx];
         e->used = true;
         e->font = font;
         e->col = col;
-        strcpy(e->key, text);
+        e->hash = hash;
+        memcpy(e->key, text, len + 1);
         e->tex = tex;
         e->w = w;
         e->h = h;
+        g_slots[insert_at] = idx;
+        lru_push_front(idx);
+        g_stats.entries++;
+        g_stats.texture_bytes += (size_t)w * (size_t)h * 4;
     }
 
     UiTextCacheEntry *e = &g_cache[idx];
-    e->last_used_tick = g_tick++;
-
     SDL_Rect dst = {x, y, e->w, e->h};
     SDL_RenderCopy(r, e->tex, NULL, &dst);
+    frame_stats_count_draw(1);
 }
 
 void ui_text_draw(SDL_Renderer *r, TTF_Font *font, const char *text, int x, int y)
@@ -156,3 +309,42 @@ void ui_text_draw(SDL_Renderer *r, TTF_Font *font, const char *text, int x, int
     SDL_Color white = {255,255,255,255};
     ui_text_draw_color(r, font, text, x, y, white);
 }
+
+void ui_text_measure(TTF_Font *font, const char *text, int *w, int *h)
+{
+    if (w) *w = 0;
+    if (h) *h = 0;
+    if (!font || !text || !text[0]) return;
+    if (ui_glyph_atlas_measure(font, text, w, h)) return;
+    TTF_SizeUTF8(font, text, w, h);
+}
+
+int ui_text_advance(TTF_Font *font, Uint32 prev, Uint32 cp)
+{
+    int adv = 0;
+    if (!font) return 0;
+    if (ui_glyph_atlas_advance(font, prev, cp, &adv)) return adv;
+    // 古い SDL_ttf：BMP の外は送りなし扱い、詰めなし
+    if (cp <= 0xFFFF) TTF_GlyphMetrics(font, (Uint16)cp, NULL, NULL, NULL, NULL, &adv);
+    return adv;
+}
+
+Uint32 ui_text_utf8_next(const char **s)
+{
+    const unsigned char *p = (const unsigned char*)*s;
+    Uint32 c = p[0];
+    int n = 0;
+    if (c < 0x80) n = 0;
+    else if ((c >> 5) == 0x6) { c &= 0x1F; n = 1; }
+    else if ((c >> 4) == 0xE) { c &= 0x0F; n = 2; }
+    else if ((c >> 3) == 0x1E) { c &= 0x07; n = 3; }
+    else { *s = (const char*)(p + 1); return 0xFFFD; }
+
+    p++;
+    for (int i = 0; i < n; i++, p++) {
+        if ((*p & 0xC0) != 0x80) { *s = (const char*)p; return 0xFFFD; }   // 途中で切れている
+        c = (c << 6) | (*p & 0x3F);
+    }
+    *s = (const char*)p;
+    return c;
+}
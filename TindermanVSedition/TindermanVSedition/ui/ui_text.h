@@ -6,22 +6,51 @@
 #include <stdbool.h>
 
 TTF_Font *ui_load_font(const char *path, int size);
+// ui_load_font で開いた font を閉じる（アトラス/キャッシュからその font の分を外す）
+void ui_close_font(TTF_Font *font);
 
 // 旧：毎回生成（重い）
 // void ui_text_draw(SDL_Renderer *r, TTF_Font *font, const char *text, int x, int y);
 
-// 新：キャッシュ付き（推奨）
+// 新：グリフアトラス（ui_glyph_atlas）で1文字ずつ詰めて描く（推奨）
+//     アトラスが使えない環境では、文字列ごとのテクスチャをキャッシュして描く
 void ui_text_cache_init(SDL_Renderer *r);
 void ui_text_cache_shutdown(void);
 
-// 文字を描く（同じ text は使い回し）
+// 文字を描く（同じ文字は使い回し）
 void ui_text_draw(SDL_Renderer *r, TTF_Font *font, const char *text, int x, int y);
 
 // 色付きが必要ならこちらも使える
 void ui_text_draw_color(SDL_Renderer *r, TTF_Font *font, const char *text,
                         int x, int y, SDL_Color col);
 
-// キャッシュを全部捨てたい時（シーン切替など）
+// 文字列テクスチャのキャッシュを全部捨てたい時（シーン切替など。アトラスは残す）
 void ui_text_cache_clear(void);
 
+// 描いたときの大きさ
+void ui_text_measure(TTF_Font *font, const char *text, int *w, int *h);
+
+// 1文字ぶんの送り（prev との詰めを含む。prev=0 で行頭）。折り返しを1文字ずつ足して決める用
+int ui_text_advance(TTF_Font *font, Uint32 prev, Uint32 cp);
+
+// UTF-8 を1文字読んで進める（壊れたバイトは U+FFFD で1バイト進む）
+Uint32 ui_text_utf8_next(const char **s);
+
+// false でアトラスを使わず、文字列テクスチャのキャッシュだけで描く（比較計測用。./tvse --no-glyph-atlas）
+void ui_text_set_glyph_atlas(bool enabled);
+
+// 文字列テクスチャのキャッシュの統計（アトラスで描けた分は数えない）
+typedef struct {
+    Uint64 hits;
+    Uint64 misses;          // テクスチャを作った回数
+    Uint64 evictions;       // 満杯で追い出した回数
+    Uint64 uncached;        // 長すぎてキャッシュせずに描いた回数
+    size_t texture_bytes;   // 今持っているテクスチャの大きさ（w*h*4 の合計）
+    int entries;
+    int capacity;
+} UiTextCacheStats;
+
+void ui_text_cache_get_stats(UiTextCacheStats *out);
+void ui_text_cache_reset_stats(void);   // 回数だけ 0 に（entries/texture_bytes はそのまま）
+
 #endif
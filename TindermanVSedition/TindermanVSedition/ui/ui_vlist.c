@@ -0,0 +1,79 @@
+#include "ui_vlist.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+void ui_vlist_init(UiVList *l)
+{
+    memset(l, 0, sizeof(*l));
+}
+
+void ui_vlist_free(UiVList *l)
+{
+    free(l->top);
+    memset(l, 0, sizeof(*l));
+}
+
+void ui_vlist_clear(UiVList *l)
+{
+    l->count = 0;
+    if (l->top) l->top[0] = 0;
+}
+
+bool ui_vlist_push(UiVList *l, int height)
+{
+    if (l->count + 2 > l->cap) {
+        int cap = l->cap ? l->cap * 2 : 64;
+        int *t = (int*)realloc(l->top, sizeof(int) * (size_t)cap);
+        if (!t) return false;
+        if (!l->top) t[0] = 0;
+        l->top = t;
+        l->cap = cap;
+    }
+    if (height < 0) height = 0;
+    l->top[l->count + 1] = l->top[l->count] + height;
+    l->count++;
+    return true;
+}
+
+void ui_vlist_set_height(UiVList *l, int i, int height)
+{
+    if (i < 0 || i >= l->count) return;
+    if (height < 0) height = 0;
+    const int d = height - ui_vlist_height(l, i);
+    if (!d) return;
+    for (int k = i + 1; k <= l->count; k++) l->top[k] += d;
+}
+
+int ui_vlist_find(const UiVList *l, int y)
+{
+    if (l->count <= 0) return -1;
+    // top[i] <= y を満たす最大の i
+    int lo = 0, hi = l->count - 1;
+    while (lo < hi) {
+        const int mid = (lo + hi + 1) / 2;
+        if (l->top[mid] <= y) lo = mid;
+        else hi = mid - 1;
+    }
+    return lo;
+}
+
+void ui_vlist_visible(const UiVList *l, int scroll, int view_h, int margin, int *first, int *end)
+{
+    *first = *end = 0;
+    if (l->count <= 0 || view_h <= 0) return;
+    const int y0 = scroll - margin;
+    const int y1 = scroll + view_h + margin;   // ここより下は見えない
+    if (y1 <= 0 || y0 >= ui_vlist_total(l)) return;
+
+    *first = ui_vlist_find(l, y0);
+    *end = ui_vlist_find(l, y1 - 1) + 1;
+}
+
+int ui_vlist_clamp_scroll(const UiVList *l, int scroll, int view_h)
+{
+    const int max_scroll = ui_vlist_bottom_scroll(l, view_h);
+    if (scroll > max_scroll) scroll = max_scroll;
+    if (scroll < 0) scroll = 0;
+    return scroll;
+}
@@ -0,0 +1,46 @@
+#ifndef UI_VLIST_H
+#define UI_VLIST_H
+
+#include <stdbool.h>
+
+// ===============================
+//  仮想化リスト（縦に並ぶ高さバラバラの項目のうち、見えている分だけを描く）
+//   - 項目の高さの累積（top[i] = i 番の上端）を持ち、見える先頭を二分探索で引く
+//   - 末尾への追加は O(1)（配列は倍々で伸ばす）。途中の高さ変更はそれより後ろを足し直す
+//   - 描くのは呼ぶ側：ui_vlist_visible で範囲をもらい、その分だけ組んで描く
+//   - 中身（文字列や行の組み）は持たない。チャットログ・対戦ログ・リプレイ一覧などで共用
+// ===============================
+typedef struct {
+    int *top;       // top[0..count]（top[count] = 全体の高さ）
+    int count;
+    int cap;
+} UiVList;
+
+void ui_vlist_init(UiVList *l);
+void ui_vlist_free(UiVList *l);
+void ui_vlist_clear(UiVList *l);           // 項目だけ捨てる（配列は残す）
+
+bool ui_vlist_push(UiVList *l, int height);
+void ui_vlist_set_height(UiVList *l, int i, int height);
+
+static inline int ui_vlist_total(const UiVList *l) { return l->count ? l->top[l->count] : 0; }
+static inline int ui_vlist_top(const UiVList *l, int i) { return l->top[i]; }
+static inline int ui_vlist_height(const UiVList *l, int i) { return l->top[i + 1] - l->top[i]; }
+
+// y（リスト内の座標）を含む項目。範囲外は 0 / count-1 に丸める。空なら -1
+int ui_vlist_find(const UiVList *l, int y);
+
+// [scroll - margin, scroll + view_h + margin) にかかる項目を [*first, *end) で返す
+void ui_vlist_visible(const UiVList *l, int scroll, int view_h, int margin, int *first, int *end);
+
+// スクロール位置を 0..(全体 - view_h) に収める
+int ui_vlist_clamp_scroll(const UiVList *l, int scroll, int view_h);
+
+// 一番下が見える位置
+static inline int ui_vlist_bottom_scroll(const UiVList *l, int view_h)
+{
+    int s = ui_vlist_total(l) - view_h;
+    return s > 0 ? s : 0;
+}
+
+#endif
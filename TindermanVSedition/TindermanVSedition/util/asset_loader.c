@@ -0,0 +1,365 @@
+#include "asset_loader.h"
+#include "texture.h"
+#include "asset_pack.h"
+#include "../core/frame_stats.h"
+
+#include <SDL2/SDL_image.h>
+#include <stdio.h>
+#include <string.h>
+
+#define ASSET_WORKER_MAX 4
+#define ASSET_PATH_MAX   256
+
+typedef enum {
+    JOB_FREE = 0,
+    JOB_QUEUED,         // ワーカー待ち
+    JOB_DECODING,       // ワーカーが展開中
+    JOB_DECODED,        // surface あり・転送待ち（ここから先はメインスレッドだけが触る）
+    JOB_READY,
+    JOB_FAILED,
+} AssetJobState;
+
+typedef struct {
+    AssetJobState state;
+    Uint32 gen;         // 使い回すたびに +1（古い future を見分ける）
+    Uint32 seq;         // 頼んだ順（転送もこの順）
+    bool cancelled;     // 展開中に取り消された → ワーカーが片付ける
+    char path[ASSET_PATH_MAX];
+    SDL_Surface *surf;
+    Uint32 pack_flags;  // asset_pack_surface の flags（テクスチャにしたあと反映）
+    SDL_Texture *tex;
+} AssetJob;
+
+// g_jobs の state/surf/cancelled・キュー・進み具合は g_mu で守る
+static AssetJob g_jobs[ASSET_JOB_MAX];
+static int g_queue[ASSET_JOB_MAX];
+static int g_queue_head = 0, g_queue_count = 0;
+static Uint32 g_seq = 0;
+static int g_done = 0, g_total = 0;
+static Uint64 g_batch_start = 0;     // 0/0 から数え始めた時刻（全部揃うまでの時間をログに出す）
+
+static SDL_mutex *g_mu = NULL;
+static SDL_cond *g_cv = NULL;
+static SDL_Thread *g_workers[ASSET_WORKER_MAX];
+static int g_worker_count = 0;
+static bool g_quit = false;
+
+static void lock(void)   { if (g_mu) SDL_LockMutex(g_mu); }
+static void unlock(void) { if (g_mu) SDL_UnlockMutex(g_mu); }
+
+// ===============================
+//  ジョブ（呼ぶ側が lock 済み）
+// ===============================
+static void job_release(AssetJob *j)
+{
+    if (j->surf) SDL_FreeSurface(j->surf);
+    if (j->tex) SDL_DestroyTexture(j->tex);
+    j->surf = NULL;
+    j->pack_flags = 0;
+    j->tex = NULL;
+    j->cancelled = false;
+    j->state = JOB_FREE;
+    j->gen++;
+}
+
+// 1つ終わった（取り消しも）。全部揃ったら、頼み始めてからの時間を出す
+static void progress_advance(void)
+{
+    if (++g_done == g_total && g_batch_start) {
+        const double ms = (double)(SDL_GetPerformanceCounter() - g_batch_start) * 1000.0
+                        / (double)SDL_GetPerformanceFrequency();
+        SDL_Log("[ASSET] %d image(s) ready in %.1f ms", g_total, ms);
+        g_batch_start = 0;
+    }
+}
+
+static void job_finish(AssetJob *j, SDL_Texture *tex)
+{
+    j->tex = tex;
+    j->state = tex ? JOB_READY : JOB_FAILED;
+    progress_advance();
+}
+
+static AssetJob* job_from_future(AssetFuture f)
+{
+    const Uint32 slot = f.id & 0xFFu;
+    if (slot == 0 || slot > ASSET_JOB_MAX) return NULL;
+    AssetJob *j = &g_jobs[slot - 1];
+    if (j->state == JOB_FREE || j->cancelled || (j->gen & 0xFFFFFFu) != (f.id >> 8)) return NULL;
+    return j;
+}
+
+static AssetFuture job_future(const AssetJob *j)
+{
+    AssetFuture f = { ((j->gen & 0xFFFFFFu) << 8) | (Uint32)(j - g_jobs + 1) };
+    return f;
+}
+
+// ===============================
+//  ワーカー
+// ===============================
+// 転送でそのまま memcpy できるよう、テクスチャと同じ並びにしておく
+// パックに入っていれば LZ4 の展開だけ（パックの形式のまま。premultiplied/半分かは flags に）
+static SDL_Surface* decode_png(const char *path, Uint32 *flags)
+{
+    SDL_Surface *s = asset_pack_surface(path, flags);
+    if (s) return s;
+
+    s = IMG_Load(path);
+    if (!s) {
+        SDL_Log("Failed to load texture %s : %s", path, IMG_GetError());
+        return NULL;
+    }
+    if (s->format->format != SDL_PIXELFORMAT_ARGB8888) {
+        SDL_Surface *c = SDL_ConvertSurfaceFormat(s, SDL_PIXELFORMAT_ARGB8888, 0);
+        SDL_FreeSurface(s);
+        s = c;
+        if (!s) SDL_Log("Failed to convert %s : %s", path, SDL_GetError());
+    }
+    return s;
+}
+
+static int worker_main(void *arg)
+{
+    (void)arg;
+    char path[ASSET_PATH_MAX];
+
+    SDL_LockMutex(g_mu);
+    for (;;) {
+        while (!g_quit && g_queue_count == 0) SDL_CondWait(g_cv, g_mu);
+        if (g_quit) break;
+
+        const int i = g_queue[g_queue_head];
+        g_queue_head = (g_queue_head + 1) % ASSET_JOB_MAX;
+        g_queue_count--;
+
+        AssetJob *j = &g_jobs[i];
+        if (j->cancelled) {
+            job_release(j);
+            continue;
+        }
+        j->state = JOB_DECODING;
+        memcpy(path, j->path, sizeof(path));
+
+        Uint32 flags = 0;
+        SDL_UnlockMutex(g_mu);
+        SDL_Surface *s = decode_png(path, &flags);
+        SDL_LockMutex(g_mu);
+
+        if (j->cancelled) {
+            if (s) SDL_FreeSurface(s);
+            job_release(j);
+            continue;
+        }
+        if (s) {
+            j->surf = s;
+            j->pack_flags = flags;
+            j->state = JOB_DECODED;
+        } else {
+            job_finish(j, NULL);
+        }
+    }
+    SDL_UnlockMutex(g_mu);
+    return 0;
+}
+
+// ===============================
+//  公開
+// ===============================
+bool asset_loader_init(int workers)
+{
+    if (g_mu) return g_worker_count > 0;
+    if (workers <= 0) workers = SDL_GetCPUCount() - 1;     // 1つはメインスレッドに残す
+    if (workers < 1) workers = 1;
+    if (workers > ASSET_WORKER_MAX) workers = ASSET_WORKER_MAX;
+
+    g_mu = SDL_CreateMutex();
+    g_cv = SDL_CreateCond();
+    if (!g_mu || !g_cv) {
+        SDL_Log("asset loader: no mutex/cond, loading synchronously: %s", SDL_GetError());
+        if (g_mu) SDL_DestroyMutex(g_mu);
+        if (g_cv) SDL_DestroyCond(g_cv);
+        g_mu = NULL;
+        g_cv = NULL;
+        return false;
+    }
+
+    g_quit = false;
+    for (int i = 0; i < workers; i++) {
+        SDL_Thread *t = SDL_CreateThread(worker_main, "asset_decode", NULL);
+        if (!t) {
+            SDL_Log("asset loader: worker %d failed: %s", i, SDL_GetError());
+            break;
+        }
+        g_workers[g_worker_count++] = t;
+    }
+    SDL_Log("[ASSET] %d decode worker(s)", g_worker_count);
+    return g_worker_count > 0;
+}
+
+void asset_loader_shutdown(void)
+{
+    if (g_mu) {
+        SDL_LockMutex(g_mu);
+        g_quit = true;
+        SDL_CondBroadcast(g_cv);
+        SDL_UnlockMutex(g_mu);
+        for (int i = 0; i < g_worker_count; i++) SDL_WaitThread(g_workers[i], NULL);
+        g_worker_count = 0;
+    }
+
+    // 受け取られなかった分（ワーカーは止まっているので lock なしでよい）
+    for (int i = 0; i < ASSET_JOB_MAX; i++) {
+        if (g_jobs[i].state != JOB_FREE) job_release(&g_jobs[i]);
+    }
+    g_queue_head = g_queue_count = 0;
+    g_done = g_total = 0;
+
+    if (g_cv) SDL_DestroyCond(g_cv);
+    if (g_mu) SDL_DestroyMutex(g_mu);
+    g_cv = NULL;
+    g_mu = NULL;
+}
+
+void asset_loader_pump(SDL_Renderer *r, double budget_ms)
+{
+    if (!r || g_worker_count == 0) return;
+
+    const double freq = (double)SDL_GetPerformanceFrequency();
+    const Uint64 t0 = SDL_GetPerformanceCounter();
+
+    // 予算を超えても1枚は進める（大きい画像1枚で止まらないように）
+    for (int n = 0; ; n++) {
+        if (n > 0 && (double)(SDL_GetPerformanceCounter() - t0) * 1000.0 / freq >= budget_ms) break;
+
+        AssetJob *j = NULL;
+        lock();
+        for (int i = 0; i < ASSET_JOB_MAX; i++) {
+            AssetJob *c = &g_jobs[i];
+            if (c->state == JOB_DECODED && (!j || (Sint32)(c->seq - j->seq) < 0)) j = c;
+        }
+        unlock();
+        if (!j) break;
+
+        // DECODED から先はワーカーが触らないので、転送は lock の外で
+        SDL_Surface *s = j->surf;
+        j->surf = NULL;
+        SDL_Texture *tex = SDL_CreateTextureFromSurface(r, s);
+        texture_apply_pack_flags(tex, j->pack_flags);
+        if (tex) frame_stats_count_upload(s->w * s->h * 4);
+        else SDL_Log("Failed to create texture %s : %s", j->path, SDL_GetError());
+        SDL_FreeSurface(s);
+
+        lock();
+        job_finish(j, tex);
+        unlock();
+    }
+}
+
+AssetFuture asset_load_texture_async(SDL_Renderer *r, const char *path)
+{
+    AssetFuture none = { 0 };
+    if (!path || !path[0]) return none;
+
+    lock();
+    AssetJob *j = NULL;
+    for (int i = 0; i < ASSET_JOB_MAX; i++) {
+        if (g_jobs[i].state == JOB_FREE) {
+            j = &g_jobs[i];
+            break;
+        }
+    }
+    if (!j) {
+        unlock();
+        SDL_Log("asset loader: too many pending loads (%d), skipped %s", ASSET_JOB_MAX, path);
+        return none;
+    }
+
+    if (g_done == g_total) {
+        g_done = g_total = 0;
+        g_batch_start = SDL_GetPerformanceCounter();
+    }
+    g_total++;
+    snprintf(j->path, sizeof(j->path), "%s", path);
+    j->seq = g_seq++;
+    j->cancelled = false;
+
+    if (g_worker_count == 0) {
+        // ワーカーなし：ここで読む（従来の load_texture と同じ）
+        j->state = JOB_DECODING;
+        unlock();
+        SDL_Texture *tex = load_texture(r, path);
+        lock();
+        job_finish(j, tex);
+    } else {
+        j->state = JOB_QUEUED;
+        g_queue[(g_queue_head + g_queue_count) % ASSET_JOB_MAX] = (int)(j - g_jobs);
+        g_queue_count++;
+        SDL_CondSignal(g_cv);
+    }
+    AssetFuture f = job_future(j);
+    unlock();
+    return f;
+}
+
+AssetState asset_future_state(AssetFuture f)
+{
+    AssetState st = ASSET_NONE;
+    lock();
+    const AssetJob *j = job_from_future(f);
+    if (j) {
+        if (j->state == JOB_READY) st = ASSET_READY;
+        else if (j->state == JOB_FAILED) st = ASSET_FAILED;
+        else st = ASSET_PENDING;
+    }
+    unlock();
+    return st;
+}
+
+bool asset_future_poll(AssetFuture *f, SDL_Texture **out)
+{
+    if (!f || f->id == 0) return true;
+
+    bool finished = false;
+    lock();
+    AssetJob *j = job_from_future(*f);
+    if (!j) {
+        finished = true;
+    } else if (j->state == JOB_READY || j->state == JOB_FAILED) {
+        if (out) *out = j->tex;
+        else if (j->tex) SDL_DestroyTexture(j->tex);
+        j->tex = NULL;          // 所有権は呼ぶ側へ
+        job_release(j);
+        finished = true;
+    }
+    unlock();
+    if (finished) f->id = 0;
+    return finished;
+}
+
+void asset_future_cancel(AssetFuture *f)
+{
+    if (!f || f->id == 0) return;
+
+    lock();
+    AssetJob *j = job_from_future(*f);
+    if (j) {
+        if (j->state == JOB_QUEUED || j->state == JOB_DECODING) {
+            j->cancelled = true;    // キューから抜く代わりに、ワーカーが取り出したときに捨てる
+            progress_advance();
+        } else {
+            if (j->state == JOB_DECODED) progress_advance();
+            job_release(j);
+        }
+    }
+    unlock();
+    f->id = 0;
+}
+
+void asset_loader_progress(int *done, int *total)
+{
+    lock();
+    if (done) *done = g_done;
+    if (total) *total = g_total;
+    unlock();
+}
@@ -0,0 +1,54 @@
+#ifndef ASSET_LOADER_H
+#define ASSET_LOADER_H
+
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+
+// ===============================
+//  画像の非同期読み込み（load_texture の裏で待たない版）
+//   - PNG の展開（IMG_Load + ARGB8888 への変換）はワーカースレッド、
+//     テクスチャ作成（GPU への転送）はメインスレッドの asset_loader_pump で1フレームの予算内だけ
+//   - 頼むと AssetFuture が返る。出来るまでシーンは代わりの絵（塗りつぶし/読み込み中表示）を出す
+//       enter  : f = asset_load_texture_async(path)
+//       update : asset_future_poll(&f, &tex)   // 出来ていたら tex に入る（以後 tex はシーンのもの）
+//       leave  : asset_future_cancel(&f)       // まだなら取り消し（出来ていた分も捨てる）
+//   - ワーカーを作れなかったときは、頼んだその場で同期読み込み（future はすぐ READY/FAILED）
+//   - 受け取られていない future が ASSET_JOB_MAX 個あるときは頼めない（ログを出して無効な future）
+// ===============================
+#ifndef ASSET_UPLOAD_BUDGET_MS
+#define ASSET_UPLOAD_BUDGET_MS 4.0      // 1フレームでテクスチャ作成に使ってよい時間
+#endif
+#define ASSET_JOB_MAX 64
+
+typedef struct {
+    Uint32 id;      // 0 = 無効（頼んでいない/受け取り済み/取り消し済み）
+} AssetFuture;
+
+typedef enum {
+    ASSET_NONE = 0,     // 無効な future
+    ASSET_PENDING,      // 展開中 or 転送待ち
+    ASSET_READY,        // テクスチャあり（asset_future_poll で受け取る）
+    ASSET_FAILED,       // 読めなかった（ログは出し済み）
+} AssetState;
+
+// workers <= 0 で CPU 数から決める（1〜4）。失敗しても false で、以後は同期読み込み
+bool asset_loader_init(int workers);
+void asset_loader_shutdown(void);   // renderer を消す前に
+
+// メインスレッドから毎フレーム（描画の前に）。展開済みの分を budget_ms までテクスチャにする
+void asset_loader_pump(SDL_Renderer *r, double budget_ms);
+
+AssetFuture asset_load_texture_async(SDL_Renderer *r, const char *path);
+AssetState asset_future_state(AssetFuture f);
+
+// 終わっていたら true（失敗でも true で *out = NULL）。f は無効になる
+// 終わっていなければ false（*out は触らない）。無効な f は true で *out を触らない
+bool asset_future_poll(AssetFuture *f, SDL_Texture **out);
+
+// 要らなくなった（シーンを抜けるときなど）。f は無効になる
+void asset_future_cancel(AssetFuture *f);
+
+// 今の読み込みの進み具合（取り消しも done に数える。全部終わったあと次を頼むと 0 から数え直す）
+void asset_loader_progress(int *done, int *total);
+
+#endif
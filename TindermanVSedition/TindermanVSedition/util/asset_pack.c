@@ -0,0 +1,264 @@
+#include "asset_pack.h"
+#include "lz4_mini.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+typedef struct {
+    const uint8_t *map;
+    size_t size;
+    Uint32 pixel_format;
+    uint32_t entries;
+    uint32_t slots;             // 2の累乗
+    const uint8_t *dir;         // slot 表
+    const uint8_t *entry;       // entry 表
+    const char *names;
+    size_t names_size;
+} AssetPack;
+
+static AssetPack g_pack;
+static SDL_atomic_t g_variant;              // AssetVariant
+static SDL_atomic_t g_premultiplied_ng;     // 1 = renderer が premultiplied のブレンドを使えない
+
+static uint32_t get_u32(const uint8_t *p) { return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24); }
+static uint64_t get_u64(const uint8_t *p) { return (uint64_t)get_u32(p) | ((uint64_t)get_u32(p + 4) << 32); }
+
+uint32_t asset_pack_hash(const char *path)
+{
+    uint32_t h = 2166136261u;
+    for (const unsigned char *s = (const unsigned char*)path; *s; s++) {
+        h ^= *s;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// ===============================
+//  open / close
+// ===============================
+// 表の形が壊れていないか（中身のデータは引いたときに範囲を確かめる）
+static bool pack_validate(const uint8_t *p, size_t size, const char *path)
+{
+    if (size < ASSET_PACK_HEADER_BYTES || memcmp(p, ASSET_PACK_MAGIC, 4) != 0) {
+        SDL_Log("[PACK] %s: not an asset pack", path);
+        return false;
+    }
+    const unsigned ver = (unsigned)(p[4] | (p[5] << 8));
+    if (ver != ASSET_PACK_VERSION) {
+        SDL_Log("[PACK] %s: version %u (expected %d). run make pack", path, ver, ASSET_PACK_VERSION);
+        return false;
+    }
+    const uint32_t entries = get_u32(p + 12), slots = get_u32(p + 16);
+    const uint32_t dir_off = get_u32(p + 20), names_off = get_u32(p + 24);
+    const uint64_t dir_end = (uint64_t)dir_off + (uint64_t)slots * ASSET_PACK_SLOT_BYTES
+                           + (uint64_t)entries * ASSET_PACK_ENTRY_BYTES;
+    if (slots == 0 || (slots & (slots - 1)) != 0 || entries >= slots ||
+        dir_end > names_off || names_off > size) {
+        SDL_Log("[PACK] %s: broken directory", path);
+        return false;
+    }
+    return true;
+}
+
+bool asset_pack_open(const char *path)
+{
+    asset_pack_close();
+    if (!path) return false;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        SDL_Log("[PACK] %s: not found, loading loose files (make pack)", path);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        SDL_Log("[PACK] %s: empty", path);
+        return false;
+    }
+    const size_t size = (size_t)st.st_size;
+    void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        SDL_Log("[PACK] %s: mmap failed", path);
+        return false;
+    }
+
+    const uint8_t *p = (const uint8_t*)map;
+    if (!pack_validate(p, size, path)) {
+        munmap(map, size);
+        return false;
+    }
+
+    g_pack.map = p;
+    g_pack.size = size;
+    g_pack.pixel_format = get_u32(p + 8);
+    g_pack.entries = get_u32(p + 12);
+    g_pack.slots = get_u32(p + 16);
+    g_pack.dir = p + get_u32(p + 20);
+    g_pack.entry = g_pack.dir + (size_t)g_pack.slots * ASSET_PACK_SLOT_BYTES;
+    g_pack.names = (const char*)p + get_u32(p + 24);
+    g_pack.names_size = size - get_u32(p + 24);
+    SDL_Log("[PACK] %s: %u entries, %.1f MB", path, (unsigned)g_pack.entries, size / 1048576.0);
+    return true;
+}
+
+void asset_pack_close(void)
+{
+    if (g_pack.map) munmap((void*)g_pack.map, g_pack.size);
+    memset(&g_pack, 0, sizeof(g_pack));
+}
+
+bool asset_pack_is_open(void)
+{
+    return g_pack.map != NULL;
+}
+
+Uint32 asset_pack_pixel_format(void)
+{
+    return g_pack.map ? g_pack.pixel_format : 0;
+}
+
+// ===============================
+//  引く
+// ===============================
+typedef struct {
+    AssetPackKind kind;
+    Uint32 flags;
+    uint32_t w, h;
+    const uint8_t *data;
+    size_t size, raw_size;
+} AssetPackEntry;
+
+static bool pack_find(const char *path, AssetPackEntry *out)
+{
+    if (!g_pack.map || !path) return false;
+
+    const uint32_t h = asset_pack_hash(path);
+    for (uint32_t i = h & (g_pack.slots - 1), n = 0; n < g_pack.slots; i = (i + 1) & (g_pack.slots - 1), n++) {
+        const uint8_t *slot = g_pack.dir + (size_t)i * ASSET_PACK_SLOT_BYTES;
+        const uint32_t idx = get_u32(slot + 4);
+        if (idx == 0) return false;
+        if (get_u32(slot) != h || idx > g_pack.entries) continue;
+
+        const uint8_t *e = g_pack.entry + (size_t)(idx - 1) * ASSET_PACK_ENTRY_BYTES;
+        const uint32_t name_off = get_u32(e);
+        if (name_off >= g_pack.names_size) return false;
+        const char *name = g_pack.names + name_off;
+        if (strncmp(name, path, g_pack.names_size - name_off) != 0) continue;
+
+        const uint64_t off = get_u64(e + 24);
+        const uint32_t size = get_u32(e + 16);
+        if (off > g_pack.size || size > g_pack.size - off) return false;
+        out->kind = (AssetPackKind)e[4];
+        out->flags = e[5];
+        out->w = get_u32(e + 8);
+        out->h = get_u32(e + 12);
+        out->size = size;
+        out->raw_size = get_u32(e + 20);
+        out->data = g_pack.map + off;
+        return true;
+    }
+    return false;
+}
+
+// mmap の画素はそのまま指す（copy = false）。書き換えるなら copy = true で展開/コピーした surface
+static SDL_Surface* entry_surface(const AssetPackEntry *e, const char *path, bool copy)
+{
+    const size_t pitch = (size_t)e->w * 4;
+    if (e->w == 0 || e->h == 0 || e->raw_size != pitch * e->h) return NULL;
+    if (e->kind == ASSET_PACK_PIXELS && e->size != e->raw_size) return NULL;
+
+    if (e->kind == ASSET_PACK_PIXELS && !copy) {
+        // mmap を直接指す（SDL は持ち主でない画素を書き換えない。読むだけ）
+        return SDL_CreateRGBSurfaceWithFormatFrom((void*)e->data, (int)e->w, (int)e->h, 32, (int)pitch,
+                                                  g_pack.pixel_format);
+    }
+
+    SDL_Surface *s = SDL_CreateRGBSurfaceWithFormat(0, (int)e->w, (int)e->h, 32, g_pack.pixel_format);
+    if (!s) return NULL;
+    bool ok = (size_t)s->pitch == pitch;
+    if (ok && e->kind == ASSET_PACK_PIXELS) memcpy(s->pixels, e->data, e->raw_size);
+    else if (ok) ok = lz4m_decompress(e->data, e->size, (uint8_t*)s->pixels, e->raw_size) == e->raw_size;
+    if (!ok) {
+        SDL_Log("[PACK] %s: broken pixels", path);
+        SDL_FreeSurface(s);
+        return NULL;
+    }
+    return s;
+}
+
+// premultiplied → ふつうの alpha（A で割り戻す。A=0 の画素は黒のまま）
+static void unpremultiply(SDL_Surface *s)
+{
+    const SDL_PixelFormat *f = s->format;
+    for (int y = 0; y < s->h; y++) {
+        Uint32 *row = (Uint32*)((Uint8*)s->pixels + (size_t)s->pitch * (size_t)y);
+        for (int x = 0; x < s->w; x++) {
+            const Uint32 v = row[x];
+            const Uint32 a = (v & f->Amask) >> f->Ashift;
+            if (a == 0 || a == 255) continue;
+            Uint32 r = (((v & f->Rmask) >> f->Rshift) * 255 + a / 2) / a;
+            Uint32 g = (((v & f->Gmask) >> f->Gshift) * 255 + a / 2) / a;
+            Uint32 b = (((v & f->Bmask) >> f->Bshift) * 255 + a / 2) / a;
+            if (r > 255) r = 255;
+            if (g > 255) g = 255;
+            if (b > 255) b = 255;
+            row[x] = (v & f->Amask) | (r << f->Rshift) | (g << f->Gshift) | (b << f->Bshift);
+        }
+    }
+}
+
+SDL_Surface* asset_pack_surface(const char *path, Uint32 *flags)
+{
+    if (flags) *flags = 0;
+    if (!g_pack.map || !path) return NULL;
+
+    AssetPackEntry e;
+    bool found = false;
+    if (SDL_AtomicGet(&g_variant) == ASSET_VARIANT_HALF) {
+        char half[512];
+        if (snprintf(half, sizeof(half), "%s" ASSET_PACK_HALF_SUFFIX, path) < (int)sizeof(half))
+            found = pack_find(half, &e);
+    }
+    if (!found && !pack_find(path, &e)) return NULL;
+    if (e.kind == ASSET_PACK_FILE) return NULL;
+
+    const bool unpremul = (e.flags & ASSET_PACK_PREMULTIPLIED) && SDL_AtomicGet(&g_premultiplied_ng);
+    SDL_Surface *s = entry_surface(&e, path, unpremul);
+    if (!s) return NULL;
+    if (unpremul) {
+        unpremultiply(s);
+        e.flags &= ~ASSET_PACK_PREMULTIPLIED;
+    }
+    if (flags) *flags = e.flags;
+    return s;
+}
+
+void asset_pack_set_variant(AssetVariant v)
+{
+    SDL_AtomicSet(&g_variant, (int)v);
+}
+
+AssetVariant asset_pack_variant(void)
+{
+    return (AssetVariant)SDL_AtomicGet(&g_variant);
+}
+
+void asset_pack_set_premultiplied(bool supported)
+{
+    SDL_AtomicSet(&g_premultiplied_ng, supported ? 0 : 1);
+}
+
+SDL_RWops* asset_open_rw(const char *path)
+{
+    AssetPackEntry e;
+    if (pack_find(path, &e) && e.kind == ASSET_PACK_FILE && e.size <= (size_t)SDL_MAX_SINT32) {
+        return SDL_RWFromConstMem(e.data, (int)e.size);
+    }
+    return SDL_RWFromFile(path, "rb");
+}
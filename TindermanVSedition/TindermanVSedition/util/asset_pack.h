@@ -0,0 +1,79 @@
+#ifndef ASSET_PACK_H
+#define ASSET_PACK_H
+
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// ===============================
+//  アセットパック（.tvsp。make pack → tools/asset_pack が assets/ から作る）
+//   - PNG は展開済みのピクセル（パック作成時の形式。既定 ARGB8888）を LZ4 で縮めて入れる
+//     → 実行時は PNG の展開（zlib + フィルタ）の代わりに LZ4 の展開だけ。縮まない画像はそのまま入れる
+//   - 画像は画面に出る最大の大きさ（論理 1280x720 での描画先）まで縮めて入れる。
+//     透明のある画像は premultiplied alpha（flags）。--half で半分の大きさ（"<path>@half"）も入れる
+//   - TTF/OTF/WAV はファイルのまま入れる（mmap した所を SDL_RWFromConstMem で直接読む。コピーなし）
+//   - 起動時に1回 mmap して、パスのハッシュ表で引く。入っていないパスは従来どおりファイルから
+//   - 開いたあとは読むだけなので、どのスレッドから引いてもよい（開く/閉じるのはメインスレッドで）
+//
+//   .tvsp（リトルエンディアン）
+//     header 32 : magic[4] ver u16 pad u16 pixel_format u32 entries u32 slots u32
+//                 dir_off u32 names_off u32 pad u32
+//     slot    8 : path_fnv u32  entry+1 u32（0=空き。slots は2の累乗、線形探索）
+//     entry  32 : name_off u32 kind u8 flags u8 pad[2] w u32 h u32 size u32 raw_size u32 data_off u64
+//     names     : NUL 終端のパス（"assets/bg/home.png" のように実行時と同じ書き方。半分は末尾に "@half"）
+//     data      : 16 バイト境界。画像は w*4 バイト/行
+// ===============================
+#define ASSET_PACK_PATH    "assets/data/assets.tvsp"
+#define ASSET_PACK_MAGIC   "TVSP"
+#define ASSET_PACK_VERSION 2
+
+#define ASSET_PACK_HEADER_BYTES 32
+#define ASSET_PACK_SLOT_BYTES   8
+#define ASSET_PACK_ENTRY_BYTES  32
+#define ASSET_PACK_ALIGN        16
+
+#define ASSET_PACK_HALF_SUFFIX  "@half"
+
+// entry の flags（asset_pack_surface が返す。texture_apply_pack_flags に渡す）
+#define ASSET_PACK_PREMULTIPLIED 0x01u  // RGB に A を掛けてある
+#define ASSET_PACK_HALF          0x02u  // 半分の大きさ（描くときに2倍に引き伸ばされる）
+
+typedef enum {
+    ASSET_PACK_FILE = 0,        // ファイルそのまま
+    ASSET_PACK_PIXELS,          // ピクセルそのまま（縮まなかった画像）
+    ASSET_PACK_PIXELS_LZ4,      // ピクセルを LZ4 ブロックで
+} AssetPackKind;
+
+// パスのハッシュ（パック作成側と同じもの）
+uint32_t asset_pack_hash(const char *path);
+
+// 開けなければ false（ログを出す。以後は全部ファイルから）
+bool asset_pack_open(const char *path);
+void asset_pack_close(void);
+bool asset_pack_is_open(void);
+
+// 画像を surface にする（PIXELS は mmap を直接指す surface。LZ4 は展開した surface）
+// 入っていない/画像でないなら NULL。SDL_FreeSurface で捨てる（パックを閉じる前に）
+// flags（NULL 可）に ASSET_PACK_PREMULTIPLIED/HALF。ASSET_VARIANT_HALF なら半分のものを先に引く
+SDL_Surface* asset_pack_surface(const char *path, Uint32 *flags);
+
+// どちらの大きさを読むか（ワーカーからも読むので atomic。切り替えはこれから読む分から）
+typedef enum {
+    ASSET_VARIANT_FULL = 0,
+    ASSET_VARIANT_HALF,         // 描画先が論理サイズの半分以下/低スペック（--low-end）
+} AssetVariant;
+
+void asset_pack_set_variant(AssetVariant v);
+AssetVariant asset_pack_variant(void);
+
+// premultiplied のブレンドを renderer が使えないとき false にする（展開時に A で割り戻して返す）
+void asset_pack_set_premultiplied(bool supported);
+
+// path を読む RWops（パックにあれば mmap を直接、なければ SDL_RWFromFile）
+// TTF_OpenFontRW / Mix_LoadWAV_RW / IMG_Load_RW に freesrc=1 で渡す
+SDL_RWops* asset_open_rw(const char *path);
+
+// パックの画像のピクセル形式（SDL_PIXELFORMAT_*）。開いていなければ 0
+Uint32 asset_pack_pixel_format(void);
+
+#endif
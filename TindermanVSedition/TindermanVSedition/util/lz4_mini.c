@@ -0,0 +1,153 @@
+#include "lz4_mini.h"
+
+#include <string.h>
+
+#define LZ4M_HASH_BITS  12
+#define LZ4M_MIN_MATCH  4
+#define LZ4M_LAST_LIT   5       // 最後の 5 バイトは必ずリテラル
+#define LZ4M_MF_LIMIT   12      // 一致はブロック末尾の 12 バイトより前から始める
+#define LZ4M_MAX_OFFSET 65535
+
+static uint32_t rd32(const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static uint32_t hash4(uint32_t v)
+{
+    return (v * 2654435761u) >> (32 - LZ4M_HASH_BITS);
+}
+
+// 長さの続き（15 以上の分を 255 刻みで）
+static uint8_t* put_len(uint8_t *op, size_t len)
+{
+    while (len >= 255) {
+        *op++ = 255;
+        len -= 255;
+    }
+    *op++ = (uint8_t)len;
+    return op;
+}
+
+// リテラル lit 個 + 一致（ml=0 なら最後のリテラルだけ）を1つ書く
+static uint8_t* put_sequence(uint8_t *op, uint8_t *op_end, const uint8_t *lit, size_t nlit,
+                             size_t offset, size_t ml)
+{
+    // 最悪の長さ：トークン + リテラル長 + リテラル + オフセット + 一致長
+    const size_t need = 1 + nlit / 255 + 1 + nlit + 2 + (ml ? (ml - LZ4M_MIN_MATCH) / 255 + 1 : 0);
+    if ((size_t)(op_end - op) < need) return NULL;
+
+    uint8_t *token = op++;
+    *token = (uint8_t)((nlit < 15 ? nlit : 15) << 4);
+    if (nlit >= 15) op = put_len(op, nlit - 15);
+    memcpy(op, lit, nlit);
+    op += nlit;
+    if (!ml) return op;
+
+    *op++ = (uint8_t)offset;
+    *op++ = (uint8_t)(offset >> 8);
+    const size_t m = ml - LZ4M_MIN_MATCH;
+    *token |= (uint8_t)(m < 15 ? m : 15);
+    if (m >= 15) op = put_len(op, m - 15);
+    return op;
+}
+
+size_t lz4m_compress(const uint8_t *src, size_t n, uint8_t *dst, size_t dst_cap)
+{
+    uint32_t table[1u << LZ4M_HASH_BITS];
+    memset(table, 0, sizeof(table));
+
+    const uint8_t *ip = src;
+    const uint8_t *anchor = src;
+    const uint8_t *const end = src + n;
+    uint8_t *op = dst;
+    uint8_t *const op_end = dst + dst_cap;
+
+    if (n > LZ4M_MF_LIMIT) {
+        const uint8_t *const mf_limit = end - LZ4M_MF_LIMIT;
+        const uint8_t *const match_limit = end - LZ4M_LAST_LIT;
+        ip++;
+        while (ip < mf_limit) {
+            const uint32_t h = hash4(rd32(ip));
+            const uint8_t *ref = src + table[h];
+            table[h] = (uint32_t)(ip - src);
+            if (ref >= ip || ip - ref > LZ4M_MAX_OFFSET || rd32(ref) != rd32(ip)) {
+                ip++;
+                continue;
+            }
+            // 後ろへも伸ばす（前のリテラルを一致に食わせる）
+            while (ip > anchor && ref > src && ip[-1] == ref[-1]) {
+                ip--;
+                ref--;
+            }
+            const uint8_t *p = ip + LZ4M_MIN_MATCH;
+            const uint8_t *q = ref + LZ4M_MIN_MATCH;
+            while (p < match_limit && *p == *q) {
+                p++;
+                q++;
+            }
+
+            op = put_sequence(op, op_end, anchor, (size_t)(ip - anchor), (size_t)(ip - ref), (size_t)(p - ip));
+            if (!op) return 0;
+            ip = anchor = p;
+            if (ip - 2 > src) table[hash4(rd32(ip - 2))] = (uint32_t)(ip - 2 - src);
+        }
+    }
+
+    op = put_sequence(op, op_end, anchor, (size_t)(end - anchor), 0, 0);
+    return op ? (size_t)(op - dst) : 0;
+}
+
+// 長さの続きを読む。入力が尽きたら false
+static int get_len(const uint8_t **ip, const uint8_t *end, size_t *len)
+{
+    uint8_t b;
+    do {
+        if (*ip >= end) return 0;
+        b = *(*ip)++;
+        *len += b;
+    } while (b == 255);
+    return 1;
+}
+
+size_t lz4m_decompress(const uint8_t *src, size_t n, uint8_t *dst, size_t dst_cap)
+{
+    const uint8_t *ip = src;
+    const uint8_t *const end = src + n;
+    uint8_t *op = dst;
+    uint8_t *const op_end = dst + dst_cap;
+
+    while (ip < end) {
+        const uint8_t token = *ip++;
+
+        size_t nlit = token >> 4;
+        if (nlit == 15 && !get_len(&ip, end, &nlit)) return (size_t)-1;
+        if ((size_t)(end - ip) < nlit || (size_t)(op_end - op) < nlit) return (size_t)-1;
+        memcpy(op, ip, nlit);
+        ip += nlit;
+        op += nlit;
+        if (ip == end) break;       // 最後のシーケンスはリテラルだけ
+
+        if (end - ip < 2) return (size_t)-1;
+        const size_t offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > (size_t)(op - dst)) return (size_t)-1;
+
+        size_t ml = token & 15;
+        if (ml == 15 && !get_len(&ip, end, &ml)) return (size_t)-1;
+        ml += LZ4M_MIN_MATCH;
+        if ((size_t)(op_end - op) < ml) return (size_t)-1;
+
+        const uint8_t *ref = op - offset;
+        if (offset >= ml) {
+            memcpy(op, ref, ml);
+            op += ml;
+        } else {
+            // 重なる一致（同じ模様の繰り返し）は1バイトずつ
+            for (size_t i = 0; i < ml; i++) *op++ = *ref++;
+        }
+    }
+    return (size_t)(op - dst);
+}
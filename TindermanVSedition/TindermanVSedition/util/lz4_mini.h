@@ -0,0 +1,23 @@
+#ifndef LZ4_MINI_H
+#define LZ4_MINI_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ===============================
+//  LZ4 ブロック形式の圧縮/展開（フレーム/チェックサムなし。SDL 不要）
+//   - 形式は本家 LZ4 のブロックと同じ（本家の LZ4_decompress_safe で展開できる）
+//   - 圧縮は 4096 項目のハッシュ表で貪欲に一致を取るだけ（速さ優先。圧縮はパック作成時のみ）
+//   - 展開は入力/出力の範囲を全部確かめる（壊れたパックでも範囲外を読まない/書かない）
+// ===============================
+
+// 圧縮後の最大サイズ（dst はこれだけ用意する）
+#define LZ4M_BOUND(n) ((n) + (n) / 255 + 16)
+
+// 圧縮したバイト数を返す。dst_cap が足りなければ 0
+size_t lz4m_compress(const uint8_t *src, size_t n, uint8_t *dst, size_t dst_cap);
+
+// 展開したバイト数を返す。壊れている/dst_cap を超えるなら (size_t)-1
+size_t lz4m_decompress(const uint8_t *src, size_t n, uint8_t *dst, size_t dst_cap);
+
+#endif
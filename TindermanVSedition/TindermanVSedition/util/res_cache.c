@@ -0,0 +1,406 @@
+#include "res_cache.h"
+#include "asset_pack.h"
+#include "../ui/ui_text.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define RES_PATH_MAX 256
+
+typedef enum {
+    RES_TEXTURE = 0,
+    RES_FONT,
+    RES_CHUNK,
+} ResKind;
+
+typedef struct {
+    bool used;
+    ResKind kind;
+    int size;               // フォントの大きさ（他は 0）
+    Uint32 hash;
+    Uint32 gen;             // 使い回すたびに +1（古い ResRef を見分ける）
+    char path[RES_PATH_MAX];
+
+    int refs;
+    Uint64 last_use;        // 大きいほど新しい（追い出しは参照 0 の中で一番小さいもの）
+    size_t bytes;
+
+    AssetState state;       // 画像：PENDING → READY/FAILED（フォント/効果音は開けたものだけ入れるので READY）
+    AssetFuture fut;
+    SDL_Texture *tex;
+    TTF_Font *font;
+    Mix_Chunk *chunk;
+} ResEntry;
+
+static ResEntry g_res[RES_CACHE_MAX];
+static SDL_Renderer *g_res_renderer = NULL;
+static Uint64 g_use_clock = 0;
+static size_t g_bytes = 0;
+static size_t g_budget = (size_t)RES_CACHE_BUDGET_MB * 1024 * 1024;
+static Uint64 g_hits = 0, g_misses = 0, g_evictions = 0;
+
+// FNV-1a（種類と大きさも混ぜる）
+static Uint32 res_hash(ResKind kind, const char *path, int size)
+{
+    Uint32 h = 2166136261u;
+    h = (h ^ (Uint32)kind) * 16777619u;
+    h = (h ^ (Uint32)size) * 16777619u;
+    for (const unsigned char *s = (const unsigned char*)path; *s; s++) h = (h ^ *s) * 16777619u;
+    return h;
+}
+
+// ===============================
+//  表
+// ===============================
+static ResEntry* entry_find(ResKind kind, const char *path, int size)
+{
+    const Uint32 h = res_hash(kind, path, size);
+    for (int i = 0; i < RES_CACHE_MAX; i++) {
+        ResEntry *e = &g_res[i];
+        if (e->used && e->hash == h && e->kind == kind && e->size == size && strcmp(e->path, path) == 0) return e;
+    }
+    return NULL;
+}
+
+static void entry_touch(ResEntry *e)
+{
+    e->last_use = ++g_use_clock;
+}
+
+static void entry_destroy(ResEntry *e)
+{
+    asset_future_cancel(&e->fut);
+    if (e->tex) SDL_DestroyTexture(e->tex);
+    if (e->font) ui_close_font(e->font);      // アトラスからその font の分も外す
+    if (e->chunk) Mix_FreeChunk(e->chunk);    // 鳴っていればそのチャンネルは止まる
+    g_bytes -= e->bytes;
+
+    const Uint32 gen = e->gen + 1;
+    memset(e, 0, sizeof(*e));
+    e->gen = gen;
+}
+
+// 参照 0 で一番古いもの（読み込み中は捨てない）。なければ NULL
+static ResEntry* entry_lru_victim(void)
+{
+    ResEntry *v = NULL;
+    for (int i = 0; i < RES_CACHE_MAX; i++) {
+        ResEntry *e = &g_res[i];
+        if (!e->used || e->refs > 0 || e->state == ASSET_PENDING) continue;
+        if (!v || e->last_use < v->last_use) v = e;
+    }
+    return v;
+}
+
+static void evict_over_budget(void)
+{
+    while (g_bytes > g_budget) {
+        ResEntry *v = entry_lru_victim();
+        if (!v) return;
+        entry_destroy(v);
+        g_evictions++;
+    }
+}
+
+// 空きがなければ予算に関係なく、参照 0 の一番古いものを捨てて空ける
+static ResEntry* entry_alloc(ResKind kind, const char *path, int size)
+{
+    if (strlen(path) >= RES_PATH_MAX) {
+        SDL_Log("[RES] path too long: %s", path);
+        return NULL;
+    }
+
+    ResEntry *e = NULL;
+    for (int i = 0; i < RES_CACHE_MAX && !e; i++) {
+        if (!g_res[i].used) e = &g_res[i];
+    }
+    if (!e) {
+        e = entry_lru_victim();
+        if (!e) {
+            SDL_Log("[RES] all %d entries are in use, skipped %s", RES_CACHE_MAX, path);
+            return NULL;
+        }
+        entry_destroy(e);
+        g_evictions++;
+    }
+
+    e->used = true;
+    e->kind = kind;
+    e->size = size;
+    e->hash = res_hash(kind, path, size);
+    snprintf(e->path, sizeof(e->path), "%s", path);
+    entry_touch(e);
+    return e;
+}
+
+static void entry_set_bytes(ResEntry *e, size_t bytes)
+{
+    g_bytes += bytes - e->bytes;
+    e->bytes = bytes;
+}
+
+static ResEntry* entry_from_ref(ResRef ref)
+{
+    const Uint32 slot = ref.id & 0xFFu;
+    if (slot == 0 || slot > RES_CACHE_MAX) return NULL;
+    ResEntry *e = &g_res[slot - 1];
+    if (!e->used || (e->gen & 0xFFFFFFu) != (ref.id >> 8)) return NULL;
+    return e;
+}
+
+static ResRef entry_ref(const ResEntry *e)
+{
+    ResRef ref = { ((e->gen & 0xFFFFFFu) << 8) | (Uint32)(e - g_res + 1) };
+    return ref;
+}
+
+// 画像が届いていれば受け取る
+static void entry_poll(ResEntry *e)
+{
+    if (e->kind != RES_TEXTURE || e->state != ASSET_PENDING) return;
+
+    SDL_Texture *tex = NULL;
+    if (!asset_future_poll(&e->fut, &tex)) return;
+    e->tex = tex;
+    e->state = tex ? ASSET_READY : ASSET_FAILED;
+    if (tex) {
+        int w = 0, h = 0;
+        SDL_QueryTexture(tex, NULL, NULL, &w, &h);
+        entry_set_bytes(e, (size_t)w * (size_t)h * 4);
+    }
+}
+
+// ===============================
+//  読む（なければ作る。prefetch は参照を増やさない）
+// ===============================
+static ResEntry* get_texture(const char *path)
+{
+    if (!path || !path[0]) return NULL;
+
+    ResEntry *e = entry_find(RES_TEXTURE, path, 0);
+    if (e) {
+        g_hits++;
+        entry_touch(e);
+        return e;
+    }
+    e = entry_alloc(RES_TEXTURE, path, 0);
+    if (!e) return NULL;
+    g_misses++;
+    e->state = ASSET_PENDING;
+    e->fut = asset_load_texture_async(g_res_renderer, path);
+    entry_poll(e);      // ワーカーなしならもう出来ている
+    return e;
+}
+
+static ResEntry* get_font(const char *path, int size)
+{
+    if (!path || !path[0]) return NULL;
+
+    ResEntry *e = entry_find(RES_FONT, path, size);
+    if (e) {
+        g_hits++;
+        entry_touch(e);
+        return e;
+    }
+
+    // パックにあれば mmap を直接読む（なければファイル）
+    SDL_RWops *rw = asset_open_rw(path);
+    const Sint64 file_bytes = rw ? SDL_RWsize(rw) : -1;
+    TTF_Font *font = rw ? TTF_OpenFontRW(rw, 1, size) : NULL;
+    if (!font) {
+        SDL_Log("Failed to load font %s : %s", path, TTF_GetError());
+        return NULL;
+    }
+    e = entry_alloc(RES_FONT, path, size);
+    if (!e) {
+        TTF_CloseFont(font);
+        return NULL;
+    }
+    g_misses++;
+    e->state = ASSET_READY;
+    e->font = font;
+    entry_set_bytes(e, file_bytes > 0 ? (size_t)file_bytes : 0);
+    return e;
+}
+
+static ResEntry* get_chunk(const char *path)
+{
+    if (!path || !path[0]) return NULL;
+
+    ResEntry *e = entry_find(RES_CHUNK, path, 0);
+    if (e) {
+        g_hits++;
+        entry_touch(e);
+        return e;
+    }
+
+    Mix_Chunk *chunk = Mix_LoadWAV_RW(asset_open_rw(path), 1);
+    if (!chunk) {
+        SDL_Log("Failed to load sound %s : %s", path, Mix_GetError());
+        return NULL;
+    }
+    e = entry_alloc(RES_CHUNK, path, 0);
+    if (!e) {
+        Mix_FreeChunk(chunk);
+        return NULL;
+    }
+    g_misses++;
+    e->state = ASSET_READY;
+    e->chunk = chunk;
+    entry_set_bytes(e, chunk->alen);
+    return e;
+}
+
+static void entry_unref(ResEntry *e)
+{
+    if (!e || e->refs <= 0) return;
+    entry_touch(e);
+    if (--e->refs == 0 && e->state == ASSET_FAILED) {
+        entry_destroy(e);       // 読めなかったものは残さない（次はまた読みに行く）
+        return;
+    }
+    evict_over_budget();
+}
+
+// ===============================
+//  公開
+// ===============================
+void res_cache_init(SDL_Renderer *r)
+{
+    g_res_renderer = r;
+}
+
+void res_cache_shutdown(void)
+{
+    int held = 0;
+    for (int i = 0; i < RES_CACHE_MAX; i++) {
+        if (!g_res[i].used) continue;
+        if (g_res[i].refs > 0) held++;
+        entry_destroy(&g_res[i]);
+    }
+    if (held) SDL_Log("[RES] %d resource(s) still referenced at shutdown", held);
+    g_bytes = 0;
+    g_res_renderer = NULL;
+}
+
+void res_cache_pump(void)
+{
+    for (int i = 0; i < RES_CACHE_MAX; i++) {
+        ResEntry *e = &g_res[i];
+        if (!e->used) continue;
+        entry_poll(e);
+        if (e->refs == 0 && e->state == ASSET_FAILED) entry_destroy(e);   // 先読みして読めなかったもの
+    }
+    evict_over_budget();
+}
+
+void res_cache_set_budget(size_t bytes)
+{
+    g_budget = bytes;
+    evict_over_budget();
+}
+
+ResRef res_texture_acquire(const char *path)
+{
+    ResRef none = { 0 };
+    ResEntry *e = get_texture(path);
+    if (!e) return none;
+    e->refs++;
+    return entry_ref(e);
+}
+
+SDL_Texture* res_texture(ResRef ref)
+{
+    ResEntry *e = entry_from_ref(ref);
+    if (!e) return NULL;
+    entry_poll(e);
+    return e->tex;
+}
+
+AssetState res_texture_state(ResRef ref)
+{
+    ResEntry *e = entry_from_ref(ref);
+    if (!e) return ASSET_NONE;
+    entry_poll(e);
+    return e->state;
+}
+
+void res_release(ResRef *ref)
+{
+    if (!ref || ref->id == 0) return;
+    entry_unref(entry_from_ref(*ref));
+    ref->id = 0;
+}
+
+TTF_Font* res_font_acquire(const char *path, int size)
+{
+    ResEntry *e = get_font(path, size);
+    if (!e) return NULL;
+    e->refs++;
+    return e->font;
+}
+
+void res_font_release(TTF_Font *font)
+{
+    if (!font) return;
+    for (int i = 0; i < RES_CACHE_MAX; i++) {
+        if (g_res[i].used && g_res[i].kind == RES_FONT && g_res[i].font == font) {
+            entry_unref(&g_res[i]);
+            return;
+        }
+    }
+    SDL_Log("[RES] released a font the cache does not own");
+}
+
+Mix_Chunk* res_chunk_acquire(const char *path)
+{
+    ResEntry *e = get_chunk(path);
+    if (!e) return NULL;
+    e->refs++;
+    return e->chunk;
+}
+
+void res_chunk_release(Mix_Chunk *chunk)
+{
+    if (!chunk) return;
+    for (int i = 0; i < RES_CACHE_MAX; i++) {
+        if (g_res[i].used && g_res[i].kind == RES_CHUNK && g_res[i].chunk == chunk) {
+            entry_unref(&g_res[i]);
+            return;
+        }
+    }
+    SDL_Log("[RES] released a sound the cache does not own");
+}
+
+void res_prefetch_texture(const char *path)
+{
+    get_texture(path);
+}
+
+void res_prefetch_font(const char *path, int size)
+{
+    get_font(path, size);
+}
+
+void res_prefetch_chunk(const char *path)
+{
+    get_chunk(path);
+}
+
+void res_cache_get_stats(ResCacheStats *out)
+{
+    if (!out) return;
+    memset(out, 0, sizeof(*out));
+    out->hits = g_hits;
+    out->misses = g_misses;
+    out->evictions = g_evictions;
+    out->bytes = g_bytes;
+    out->budget = g_budget;
+    for (int i = 0; i < RES_CACHE_MAX; i++) {
+        if (!g_res[i].used) continue;
+        out->entries++;
+        if (g_res[i].refs <= 0) continue;
+        out->referenced++;
+        if (g_res[i].kind == RES_TEXTURE) out->texture_bytes_in_use += g_res[i].bytes;
+    }
+}
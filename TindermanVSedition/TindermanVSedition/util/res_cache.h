@@ -0,0 +1,68 @@
+#ifndef RES_CACHE_H
+#define RES_CACHE_H
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include <SDL2/SDL_mixer.h>
+#include <stdbool.h>
+
+#include "asset_loader.h"
+
+// ===============================
+//  シーンをまたぐリソースのキャッシュ（画像/フォント/効果音）
+//   - (種類, パス, フォントの大きさ) で1つだけ持ち、参照数を数える。
+//     シーンは enter で acquire、leave で release するだけ（自分では Destroy/Close しない）
+//   - 参照が 0 になっても捨てずに残す（次に同じものを頼まれたらそのまま返す）。
+//     合計が予算（res_cache_set_budget）を超えたら、参照 0 のものを使われていない順に捨てる
+//   - 画像は asset_loader で非同期に読む（出来るまで res_texture は NULL）
+//   - res_prefetch_* は参照を増やさずに読み始めるだけ（change_scene で次のシーンの分を頼む）
+//   - メインスレッドだけで使う
+// ===============================
+#ifndef RES_CACHE_BUDGET_MB
+#define RES_CACHE_BUDGET_MB 256     // 参照 0 のものを残しておける合計の目安
+#endif
+#define RES_CACHE_MAX 128
+
+typedef struct {
+    Uint32 id;      // 0 = 無効
+} ResRef;
+
+void res_cache_init(SDL_Renderer *r);
+void res_cache_shutdown(void);      // ui_text_cache_shutdown / asset_loader_shutdown より先に
+
+// メインスレッドから毎フレーム（asset_loader_pump のあと）。届いた画像を受け取り、予算を超えていれば捨てる
+void res_cache_pump(void);
+
+void res_cache_set_budget(size_t bytes);
+
+// 画像：読み込み中/失敗は res_texture が NULL。テクスチャはキャッシュのもの
+ResRef res_texture_acquire(const char *path);
+SDL_Texture* res_texture(ResRef ref);
+AssetState res_texture_state(ResRef ref);   // 届くまで待つ演出用（PENDING の間は待つ）
+void res_release(ResRef *ref);              // ref は無効になる
+
+// フォント/効果音：その場で開く（開けなければ NULL でログ）。返したものを release に渡す
+TTF_Font* res_font_acquire(const char *path, int size);
+void res_font_release(TTF_Font *font);
+Mix_Chunk* res_chunk_acquire(const char *path);
+void res_chunk_release(Mix_Chunk *chunk);
+
+// 参照を増やさずに読み始める（すでにあれば使った順を新しくするだけ）
+void res_prefetch_texture(const char *path);
+void res_prefetch_font(const char *path, int size);
+void res_prefetch_chunk(const char *path);
+
+typedef struct {
+    Uint64 hits;            // acquire/prefetch で既にあった
+    Uint64 misses;          // 読み始めた
+    Uint64 evictions;       // 予算超えで捨てた
+    size_t bytes;           // 今持っている分（画像は w*h*4、フォントはファイルの大きさ、効果音は波形）
+    size_t budget;
+    int entries;
+    int referenced;         // 参照中のもの
+    size_t texture_bytes_in_use;    // 参照中の画像の w*h*4（今のシーンが持っているテクスチャ）
+} ResCacheStats;
+
+void res_cache_get_stats(ResCacheStats *out);
+
+#endif
@@ -1,8 +1,29 @@
 #include "texture.h"
+#include "asset_pack.h"
 #include <SDL2/SDL_image.h>
 
+static SDL_BlendMode premultiplied_blend(void)
+{
+    return SDL_ComposeCustomBlendMode(SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD,
+                                      SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD);
+}
+
 SDL_Texture *load_texture(SDL_Renderer *r, const char *path)
 {
+    // パックにあれば展開済みのピクセルから（PNG の展開なし）
+    Uint32 flags = 0;
+    SDL_Surface *packed = asset_pack_surface(path, &flags);
+    if (packed)
+    {
+        SDL_Texture *tex = SDL_CreateTextureFromSurface(r, packed);
+        SDL_FreeSurface(packed);
+        if (tex)
+        {
+            texture_apply_pack_flags(tex, flags);
+            return tex;
+        }
+    }
+
     SDL_Texture *tex = IMG_LoadTexture(r, path);
     if (!tex)
     {
@@ -10,3 +31,38 @@ SDL_Texture *load_texture(SDL_Renderer *r, const char *path)
     }
     return tex;
 }
+
+void texture_apply_pack_flags(SDL_Texture *tex, Uint32 flags)
+{
+    if (!tex)
+        return;
+    if (flags & ASSET_PACK_PREMULTIPLIED)
+        SDL_SetTextureBlendMode(tex, premultiplied_blend());
+    if (flags & ASSET_PACK_HALF)
+        SDL_SetTextureScaleMode(tex, SDL_ScaleModeLinear);
+}
+
+bool texture_premultiplied_supported(SDL_Renderer *r)
+{
+    SDL_Texture *t = SDL_CreateTexture(r, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, 1, 1);
+    if (!t)
+        return false;
+    const bool ok = SDL_SetTextureBlendMode(t, premultiplied_blend()) == 0;
+    SDL_DestroyTexture(t);
+    return ok;
+}
+
+void texture_set_mod(SDL_Texture *tex, Uint8 r, Uint8 g, Uint8 b, Uint8 a)
+{
+    if (!tex)
+        return;
+    SDL_BlendMode mode;
+    if (SDL_GetTextureBlendMode(tex, &mode) == 0 && mode == premultiplied_blend())
+    {
+        r = (Uint8)((r * a + 127) / 255);
+        g = (Uint8)((g * a + 127) / 255);
+        b = (Uint8)((b * a + 127) / 255);
+    }
+    SDL_SetTextureColorMod(tex, r, g, b);
+    SDL_SetTextureAlphaMod(tex, a);
+}
@@ -2,7 +2,22 @@
 #define TEXTURE_H
 
 #include <SDL2/SDL.h>
+#include <stdbool.h>
 
 SDL_Texture *load_texture(SDL_Renderer *r, const char *path);
 
+// ===============================
+//  パックの画像（asset_pack_surface の flags）をテクスチャに反映する
+//   - ASSET_PACK_PREMULTIPLIED : premultiplied 用のブレンド（src*1 + dst*(1-srcA)）
+//   - ASSET_PACK_HALF          : 2倍に引き伸ばして描くので線形補間
+// ===============================
+void texture_apply_pack_flags(SDL_Texture *tex, Uint32 flags);
+
+// renderer が premultiplied のブレンドを使えるか（起動時に1回。ダメなら asset_pack_set_premultiplied(false)）
+bool texture_premultiplied_supported(SDL_Renderer *r);
+
+// 色と透明度の掛け算（SDL_SetTextureColorMod/AlphaMod の代わり）
+// premultiplied のテクスチャは RGB にも a を掛けないと、薄くしたときに明るく残る
+void texture_set_mod(SDL_Texture *tex, Uint8 r, Uint8 g, Uint8 b, Uint8 a);
+
 #endif